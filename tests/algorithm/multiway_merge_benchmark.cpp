@@ -13,6 +13,7 @@
 #include <tlx/algorithm/multiway_merge_splitting.hpp>
 #include <tlx/algorithm/parallel_multiway_merge.hpp>
 #include <tlx/cmdline_parser.hpp>
+#include <tlx/container/loser_tree.hpp>
 #include <tlx/container/string_view.hpp>
 #include <tlx/die.hpp>
 #include <tlx/logger.hpp>
@@ -26,6 +27,7 @@
 #include <random>
 #include <string>
 #include <thread>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -74,6 +76,8 @@ enum benchmark_type
 {
     SEQ_MWM_LT,
     SEQ_MWM_LT_STABLE,
+    SEQ_MWM_LT_GENERIC,
+    SEQ_MWM_LT_STABLE_GENERIC,
     SEQ_MWM_LT_COMBINED,
     SEQ_MWM_BB,
     SEQ_GNU_MWM,
@@ -135,6 +139,14 @@ public:
     }
 };
 
+//! The loser tree which multiway_merge() selects without the branchless
+//! LoserTreeInteger, to compare against it.
+template <bool Stable, typename ValueType>
+using GenericLoserTree = typename std::conditional<
+    sizeof(ValueType) <= 2 * sizeof(size_t),
+    tlx::LoserTreeCopy<Stable, ValueType, std::less<ValueType> >,
+    tlx::LoserTreePointer<Stable, ValueType, std::less<ValueType> > >::type;
+
 template <typename ValueType, benchmark_type Method>
 void test_multiway_merge(size_t seq_count, const size_t seq_size)
 {
@@ -235,6 +247,24 @@ void test_multiway_merge(size_t seq_count, const size_t seq_size)
                                            tlx::MWMA_LOSER_TREE);
                 break;
 
+            case SEQ_MWM_LT_GENERIC:
+                method_name = "seq_mwm_lt_generic";
+
+                tlx::multiway_merge_detail::multiway_merge_loser_tree<
+                    GenericLoserTree</* Stable */ false, ValueType> >(
+                    iterpairs.begin(), iterpairs.end(), out.begin(),
+                    total_size, cmp);
+                break;
+
+            case SEQ_MWM_LT_STABLE_GENERIC:
+                method_name = "seq_mwm_lt_stable_generic";
+
+                tlx::multiway_merge_detail::multiway_merge_loser_tree<
+                    GenericLoserTree</* Stable */ true, ValueType> >(
+                    iterpairs.begin(), iterpairs.end(), out.begin(),
+                    total_size, cmp);
+                break;
+
             case SEQ_MWM_BB:
                 method_name = "seq_mwm_bb";
 
@@ -382,6 +412,8 @@ void test_seqnum_sequential()
 {
     test_seqnum<ValueType, SEQ_MWM_LT>();
     test_seqnum<ValueType, SEQ_MWM_LT_STABLE>();
+    test_seqnum<ValueType, SEQ_MWM_LT_GENERIC>();
+    test_seqnum<ValueType, SEQ_MWM_LT_STABLE_GENERIC>();
     test_seqnum<ValueType, SEQ_MWM_LT_COMBINED>();
     test_seqnum<ValueType, SEQ_MWM_BB>();
     test_seqnum<ValueType, SEQ_GNU_MWM>();
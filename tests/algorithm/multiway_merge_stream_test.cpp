@@ -0,0 +1,224 @@
+/*******************************************************************************
+ * tests/algorithm/multiway_merge_stream_test.cpp
+ *
+ * Part of tlx - http://panthema.net/tlx
+ *
+ * Copyright (C) 2026 Timo Bingmann <tb@panthema.net>
+ *
+ * All rights reserved. Published under the Boost Software License, Version 1.0
+ ******************************************************************************/
+
+#include <tlx/algorithm/multiway_merge.hpp>
+#include <tlx/algorithm/multiway_merge_stream.hpp>
+#include <tlx/die.hpp>
+#include <tlx/logger.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+//! Item with a key and the index of its source, which is ignored when comparing
+//! items.
+struct Item
+{
+    std::uint32_t key;
+    std::uint32_t source;
+
+    bool operator<(const Item& other) const
+    {
+        return key < other.key;
+    }
+};
+
+//! Source delivering a vector in pieces of random size up to the requested
+//! size, like a socket.
+template <typename ValueType>
+class VectorSource
+{
+public:
+    using value_type = ValueType;
+
+    VectorSource(const std::vector<ValueType>& data, unsigned seed)
+        : data_(&data), rng_(seed)
+    {
+    }
+
+    size_t read(ValueType* out, size_t size)
+    {
+        size_t n = std::min(data_->size() - pos_, 1 + rng_() % size);
+        std::copy(data_->begin() + pos_, data_->begin() + pos_ + n, out);
+        pos_ += n;
+        return n;
+    }
+
+private:
+    const std::vector<ValueType>* data_;
+    size_t pos_ = 0;
+    std::minstd_rand rng_;
+};
+
+//! Sink appending to a vector, and checking the block size.
+template <typename ValueType>
+class VectorSink
+{
+public:
+    using value_type = ValueType;
+
+    explicit VectorSink(size_t block_size) : block_size_(block_size)
+    {
+    }
+
+    void write(const ValueType* data, size_t size)
+    {
+        // only the last block may be partial
+        die_unless(!partial_);
+        die_unless(size > 0 && size <= block_size_);
+        partial_ = size < block_size_;
+        output.insert(output.end(), data, data + size);
+    }
+
+    std::vector<ValueType> output;
+
+private:
+    size_t block_size_;
+    bool partial_ = false;
+};
+
+//! Merges num_seqs sorted random sequences with few distinct keys, and checks
+//! the output against a (stable) sort.
+template <bool Stable>
+void test_stream(size_t num_seqs, size_t block_size,
+                 tlx::MultiwayMergeAlgorithm mwma)
+{
+    LOG0 << "test_stream " << Stable << " num_seqs=" << num_seqs
+         << " block_size=" << block_size;
+
+    std::mt19937 rng(static_cast<unsigned>(num_seqs * 1000 + block_size));
+
+    std::vector<std::vector<Item> > seqs(num_seqs);
+    std::vector<Item> correct;
+    for (size_t i = 0; i < num_seqs; ++i)
+    {
+        size_t size = rng() % 5 == 0 ? 0 : rng() % 2000;
+        for (size_t j = 0; j < size; ++j)
+        {
+            seqs[i].push_back(
+                Item{ static_cast<std::uint32_t>(rng() % 500),
+                      static_cast<std::uint32_t>(i) });
+        }
+        std::sort(seqs[i].begin(), seqs[i].end());
+        correct.insert(correct.end(), seqs[i].begin(), seqs[i].end());
+    }
+    std::stable_sort(correct.begin(), correct.end());
+
+    std::vector<VectorSource<Item> > sources;
+    for (size_t i = 0; i < num_seqs; ++i)
+        sources.emplace_back(seqs[i], static_cast<unsigned>(i + 1));
+
+    VectorSink<Item> sink(block_size);
+    std::uint64_t total =
+        Stable ? tlx::stable_multiway_merge_stream(
+                     sources.begin(), sources.end(), sink, block_size,
+                     std::less<Item>(), mwma)
+               : tlx::multiway_merge_stream(sources.begin(), sources.end(),
+                                            sink, block_size,
+                                            std::less<Item>(), mwma);
+
+    die_unequal(total, correct.size());
+    die_unequal(sink.output.size(), correct.size());
+    for (size_t i = 0; i < correct.size(); ++i)
+    {
+        die_unequal(sink.output[i].key, correct[i].key);
+        if (Stable)
+            die_unequal(sink.output[i].source, correct[i].source);
+    }
+}
+
+//! Writes sorted runs to files, merges them from file to file, and reads the
+//! result back.
+void test_files(size_t num_files, size_t block_size)
+{
+    std::mt19937_64 rng(num_files);
+
+    std::vector<std::uint64_t> correct;
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < num_files; ++i)
+    {
+        std::vector<std::uint64_t> run(rng() % 50000);
+        for (std::uint64_t& x : run)
+            x = rng();
+        std::sort(run.begin(), run.end());
+        correct.insert(correct.end(), run.begin(), run.end());
+
+        paths.push_back("multiway_merge_stream_test." + std::to_string(i));
+        tlx::FileBlockSink<std::uint64_t> sink(paths.back());
+        die_unless(sink.good());
+        sink.write(run.data(), run.size());
+        die_unless(sink.close());
+    }
+    std::sort(correct.begin(), correct.end());
+
+    const std::string output_path = "multiway_merge_stream_test.out";
+    {
+        std::vector<tlx::FileBlockSource<std::uint64_t> > sources;
+        for (const std::string& path : paths)
+        {
+            sources.emplace_back(path, block_size);
+            die_unless(sources.back().good());
+        }
+
+        tlx::FileBlockSink<std::uint64_t> sink(output_path);
+        die_unless(sink.good());
+        die_unequal(tlx::multiway_merge_stream(sources.begin(), sources.end(),
+                                               sink, block_size),
+                    correct.size());
+        die_unless(sink.close());
+    }
+
+    std::vector<std::uint64_t> output(correct.size() + 1);
+    {
+        tlx::FileBlockSource<std::uint64_t> source(output_path);
+        die_unless(source.good());
+        die_unequal(source.read(output.data(), output.size()), correct.size());
+        die_unequal(source.read(output.data(), output.size()), 0u);
+    }
+    output.pop_back();
+    die_unless(output == correct);
+
+    for (const std::string& path : paths)
+        std::remove(path.c_str());
+    std::remove(output_path.c_str());
+
+    // missing files
+    tlx::FileBlockSource<std::uint64_t> missing(output_path);
+    die_if(missing.good());
+    std::uint64_t x;
+    die_unequal(missing.read(&x, 1), 0u);
+}
+
+int main()
+{
+    for (size_t n = 0; n <= 70; n += 1 + n / 2)
+    {
+        for (size_t block_size : { 1, 7, 64, 1000 })
+        {
+            test_stream<false>(n, block_size, tlx::MWMA_LOSER_TREE);
+            test_stream<true>(n, block_size, tlx::MWMA_LOSER_TREE);
+            test_stream<false>(n, block_size, tlx::MWMA_LOSER_TREE_COMBINED);
+            test_stream<true>(n, block_size, tlx::MWMA_LOSER_TREE_COMBINED);
+        }
+    }
+
+    test_files(1, 1000);
+    test_files(5, 4096);
+    test_files(40, 512);
+
+    return 0;
+}
+
+/******************************************************************************/
@@ -0,0 +1,280 @@
+/*******************************************************************************
+ * tests/container/btree_concurrent_map_test.cpp
+ *
+ * Part of tlx - http://panthema.net/tlx
+ *
+ * Copyright (C) 2026 Timo Bingmann <tb@panthema.net>
+ *
+ * All rights reserved. Published under the Boost Software License, Version 1.0
+ ******************************************************************************/
+
+#include <tlx/container/btree_concurrent_map.hpp>
+#include <tlx/die.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/******************************************************************************/
+// Instantiation Tests
+
+template class tlx::btree_concurrent_map<int, double>;
+template class tlx::btree_concurrent_map<uint64_t, uint64_t>;
+
+template <typename KeyType, int Slots>
+struct traits_slots : tlx::btree_default_traits<KeyType, KeyType>
+{
+    static const int leaf_slots = Slots;
+    static const int inner_slots = Slots;
+};
+
+/******************************************************************************/
+// Sequential Tests against std::map
+
+template <int Slots>
+void test_sequential(size_t num_ops)
+{
+    typedef tlx::btree_concurrent_map<unsigned int, unsigned int,
+                                      std::less<unsigned int>,
+                                      traits_slots<unsigned int, Slots> >
+        map_type;
+
+    map_type map;
+    std::map<unsigned int, unsigned int> ref;
+
+    die_unless(map.empty());
+    map.verify();
+
+    std::default_random_engine rng(34234235);
+
+    for (size_t i = 0; i < num_ops; ++i)
+    {
+        unsigned int key = rng() % (num_ops / 4 + 1);
+        unsigned int data = static_cast<unsigned int>(i);
+
+        switch (rng() % 4)
+        {
+        case 0:
+            die_unequal(map.insert(key, data),
+                        ref.insert(std::make_pair(key, data)).second);
+            break;
+        case 1:
+        {
+            bool inserted = (ref.find(key) == ref.end());
+            ref[key] = data;
+            die_unequal(map.insert_or_assign(key, data), inserted);
+            break;
+        }
+        case 2:
+            die_unequal(map.erase(key), ref.erase(key) != 0);
+            break;
+        default:
+        {
+            unsigned int found = 0;
+            std::map<unsigned int, unsigned int>::const_iterator it =
+                ref.find(key);
+            die_unequal(map.find(key, &found), it != ref.end());
+            if (it != ref.end())
+                die_unequal(found, it->second);
+            break;
+        }
+        }
+    }
+
+    map.verify();
+    die_unequal(map.size(), ref.size());
+
+    for (const std::pair<const unsigned int, unsigned int>& p : ref)
+    {
+        unsigned int data = 0;
+        die_unless(map.find(p.first, &data));
+        die_unequal(data, p.second);
+    }
+
+    map.clear();
+    map.verify();
+    die_unless(map.empty());
+    die_unless(!map.exists(0));
+}
+
+/******************************************************************************/
+// Concurrent Tests
+
+template <int Slots>
+void test_concurrent(size_t num_threads, size_t items_per_thread)
+{
+    typedef tlx::btree_concurrent_map<uint64_t, uint64_t, std::less<uint64_t>,
+                                      traits_slots<uint64_t, Slots> >
+        map_type;
+
+    map_type map;
+
+    // odd keys are inserted first and must be visible to readers throughout.
+    size_t num_keys = num_threads * items_per_thread;
+    for (uint64_t k = 1; k < 2 * num_keys; k += 2)
+        die_unless(map.insert(k, k));
+
+    std::atomic<bool> writers_done(false);
+    std::vector<std::thread> threads;
+
+    // writers insert the even keys of their residue class in random order,
+    // overwrite the data of their odd keys, and erase the even keys divisible
+    // by four again.
+    for (size_t t = 0; t < num_threads; ++t)
+    {
+        threads.emplace_back([&map, t, num_threads, num_keys]() {
+            std::vector<uint64_t> keys;
+            for (uint64_t k = 2 * t; k < 2 * num_keys; k += 2 * num_threads)
+                keys.push_back(k);
+            std::shuffle(keys.begin(), keys.end(),
+                         std::default_random_engine(static_cast<int>(t)));
+
+            for (uint64_t k : keys)
+            {
+                die_unless(map.insert(k, k));
+                die_unless(!map.insert(k, 0));
+                die_unless(!map.insert_or_assign(k + 1, k + 1 + num_keys));
+            }
+            for (uint64_t k : keys)
+            {
+                if (k % 4 == 0)
+                    die_unless(map.erase(k));
+            }
+        });
+    }
+
+    // readers look up odd keys, whose data is either the original or the
+    // overwritten value.
+    for (size_t t = 0; t < num_threads; ++t)
+    {
+        threads.emplace_back([&map, &writers_done, t, num_keys]() {
+            std::default_random_engine rng(static_cast<int>(1000 + t));
+            while (!writers_done.load())
+            {
+                for (size_t i = 0; i < 1000; ++i)
+                {
+                    uint64_t k = 2 * (rng() % num_keys) + 1;
+                    uint64_t data = 0;
+                    die_unless(map.find(k, &data));
+                    die_unless(data == k || data == k + num_keys);
+                }
+            }
+        });
+    }
+
+    for (size_t t = 0; t < num_threads; ++t)
+        threads[t].join();
+    writers_done = true;
+    for (size_t t = num_threads; t < threads.size(); ++t)
+        threads[t].join();
+
+    map.verify();
+
+    size_t expected = 0;
+    for (uint64_t k = 0; k < 2 * num_keys; ++k)
+    {
+        uint64_t data = 0;
+        bool present = (k % 2 == 1) || (k % 4 != 0);
+        die_unequal(map.find(k, &data), present);
+        if (present)
+        {
+            die_unequal(data, k % 2 == 1 ? k + num_keys : k);
+            ++expected;
+        }
+    }
+    die_unequal(map.size(), expected);
+}
+
+//! Writers insert keys between fixed anchor keys in random order, which splits
+//! the anchors' nodes over and over, moving anchors into new right halves.
+//! Readers concurrently look up and re-insert the anchors, which must always
+//! be found in place.
+template <int Slots>
+void test_split_race(size_t num_threads, size_t num_anchors, size_t gap)
+{
+    typedef tlx::btree_concurrent_map<uint64_t, uint64_t, std::less<uint64_t>,
+                                      traits_slots<uint64_t, Slots> >
+        map_type;
+
+    map_type map;
+    for (uint64_t a = 0; a < num_anchors; ++a)
+        die_unless(map.insert(a * gap, a));
+
+    std::atomic<size_t> writers_left(num_threads);
+    std::vector<std::thread> threads;
+
+    for (size_t t = 0; t < num_threads; ++t)
+    {
+        threads.emplace_back([&map, &writers_left, t, num_threads, num_anchors,
+                              gap]() {
+            std::vector<uint64_t> keys;
+            for (uint64_t a = 0; a < num_anchors; ++a)
+            {
+                for (uint64_t k = 1 + t; k < gap; k += num_threads)
+                    keys.push_back(a * gap + k);
+            }
+            std::shuffle(keys.begin(), keys.end(),
+                         std::default_random_engine(static_cast<int>(t)));
+
+            for (uint64_t k : keys)
+                die_unless(map.insert(k, k));
+            --writers_left;
+        });
+    }
+
+    for (size_t t = 0; t < num_threads; ++t)
+    {
+        threads.emplace_back([&map, &writers_left, t, num_anchors, gap]() {
+            std::default_random_engine rng(static_cast<int>(2000 + t));
+            while (writers_left.load() != 0)
+            {
+                uint64_t a = rng() % num_anchors;
+                uint64_t data = 0;
+                die_unless(map.find(a * gap, &data));
+                die_unequal(data, a);
+                die_unless(!map.insert(a * gap, a));
+                die_unless(!map.insert_or_assign(a * gap, a));
+                if (rng() % 64 == 0)
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    for (std::thread& thread : threads)
+        thread.join();
+
+    map.verify();
+    die_unequal(map.size(), num_anchors * gap);
+
+    for (uint64_t k = 0; k < num_anchors * gap; ++k)
+    {
+        uint64_t data = 0;
+        die_unless(map.find(k, &data));
+        die_unequal(data, k % gap == 0 ? k / gap : k);
+    }
+}
+
+/******************************************************************************/
+
+int main()
+{
+    test_sequential<4>(20000);
+    test_sequential<9>(20000);
+    test_sequential<32>(50000);
+
+    test_concurrent<4>(4, 20000);
+    test_concurrent<16>(8, 20000);
+
+    test_split_race<4>(8, 2000, 64);
+    test_split_race<8>(16, 500, 256);
+
+    return 0;
+}
+
+/******************************************************************************/
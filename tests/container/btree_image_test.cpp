@@ -0,0 +1,265 @@
+/*******************************************************************************
+ * tests/container/btree_image_test.cpp
+ *
+ * Part of tlx - http://panthema.net/tlx
+ *
+ * Copyright (C) 2026 Timo Bingmann <tb@panthema.net>
+ *
+ * All rights reserved. Published under the Boost Software License, Version 1.0
+ ******************************************************************************/
+
+#include <tlx/container/btree_image.hpp>
+#include <tlx/container/btree_map.hpp>
+#include <tlx/container/btree_multiset.hpp>
+#include <tlx/container/btree_set.hpp>
+#include <tlx/die.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/******************************************************************************/
+// Instantiation Tests
+
+template class tlx::btree_image<tlx::btree_set<int> >;
+template class tlx::btree_image<tlx::btree_map<uint64_t, double> >;
+
+template <typename KeyType, int Slots>
+struct traits_slots : tlx::btree_default_traits<KeyType, KeyType>
+{
+    static const int leaf_slots = Slots;
+    static const int inner_slots = Slots;
+};
+
+/******************************************************************************/
+
+//! Write an image of tree into an aligned buffer.
+template <typename TreeType>
+std::vector<uint64_t> write_image(const TreeType& tree)
+{
+    std::ostringstream os;
+    die_unless(tlx::btree_image<TreeType>::write(tree, os));
+    std::string str = os.str();
+
+    std::vector<uint64_t> buffer((str.size() + 7) / 8);
+    std::memcpy(buffer.data(), str.data(), str.size());
+    die_unequal(str.size() % tlx::btree_image_header::alignment, 0U);
+    return buffer;
+}
+
+//! Compare the image with the tree, and all searches at and between keys.
+template <typename TreeType>
+void check_image(const tlx::btree_image<TreeType>& image, const TreeType& tree,
+                 unsigned int max_key)
+{
+    typedef typename TreeType::key_of_value key_of_value;
+
+    die_unequal(image.size(), tree.size());
+    die_unequal(image.empty(), tree.empty());
+    die_unless(std::equal(tree.begin(), tree.end(), image.begin()));
+
+    // positions of the first item not less and greater than each key
+    std::vector<size_t> lower(max_key + 2), upper(max_key + 2);
+    size_t i = 0;
+    for (unsigned int k = 0; k <= max_key + 1; ++k)
+    {
+        while (i < image.size() && key_of_value::get(image.begin()[i]) < k)
+            ++i;
+        lower[k] = i;
+        while (i < image.size() && key_of_value::get(image.begin()[i]) == k)
+            ++i;
+        upper[k] = i;
+    }
+
+    for (unsigned int k = 0; k <= max_key + 1; ++k)
+    {
+        die_unequal(
+            static_cast<size_t>(image.lower_bound(k) - image.begin()),
+            lower[k]);
+        die_unequal(
+            static_cast<size_t>(image.upper_bound(k) - image.begin()),
+            upper[k]);
+        die_unequal(image.count(k), tree.count(k));
+        die_unequal(image.exists(k), tree.exists(k));
+        if (tree.exists(k))
+            die_unequal(key_of_value::get(*image.find(k)), k);
+        else
+            die_unless(image.find(k) == image.end());
+    }
+}
+
+template <typename TreeType>
+void test_tree(size_t num_items, unsigned int max_key)
+{
+    TreeType tree;
+    std::default_random_engine rng(static_cast<int>(num_items));
+    for (size_t i = 0; i < num_items; ++i)
+    {
+        unsigned int k = rng() % (max_key + 1);
+        tree.insert(typename TreeType::value_type(k));
+    }
+
+    std::vector<uint64_t> buffer = write_image(tree);
+    size_t size = buffer.size() * sizeof(uint64_t);
+
+    tlx::btree_image<TreeType> image;
+    die_unless(image.attach(buffer.data(), size));
+    die_unless(image.error() == nullptr);
+    die_unless(image.verify());
+    check_image(image, tree, max_key);
+}
+
+template <int Slots>
+void test_sizes()
+{
+    typedef tlx::btree_set<unsigned int, std::less<unsigned int>,
+                           traits_slots<unsigned int, Slots> >
+        set_type;
+    typedef tlx::btree_multiset<unsigned int, std::less<unsigned int>,
+                                traits_slots<unsigned int, Slots> >
+        multiset_type;
+
+    // the empty tree, a single leaf, and trees with several separator levels
+    for (size_t n : { 0, 1, 2, Slots, Slots + 1, 100, 1000, 5000 })
+    {
+        test_tree<set_type>(n, static_cast<unsigned int>(4 * n));
+        test_tree<multiset_type>(n, static_cast<unsigned int>(n / 4));
+    }
+}
+
+void test_map()
+{
+    typedef tlx::btree_map<unsigned int, uint64_t> map_type;
+
+    map_type map;
+    for (unsigned int k = 0; k < 20000; ++k)
+        map.insert2(3 * k, uint64_t(k) * k);
+
+    std::vector<uint64_t> buffer = write_image(map);
+    tlx::btree_image<map_type> image;
+    die_unless(image.attach(buffer.data(), buffer.size() * sizeof(uint64_t)));
+    die_unless(image.verify());
+
+    for (unsigned int k = 0; k < 60000; ++k)
+    {
+        tlx::btree_image<map_type>::const_iterator it = image.find(k);
+        if (k % 3 == 0)
+            die_unequal(it->second, uint64_t(k / 3) * (k / 3));
+        else
+            die_unless(it == image.end());
+    }
+
+    // wrong key or value size
+    tlx::btree_image<tlx::btree_map<unsigned int, unsigned int> > other;
+    die_unless(!other.attach(buffer.data(), buffer.size() * sizeof(uint64_t)));
+    die_unless(other.error() != nullptr);
+    die_unless(other.empty());
+}
+
+void test_corruption()
+{
+    typedef tlx::btree_set<unsigned int, std::less<unsigned int>,
+                           traits_slots<unsigned int, 8> >
+        set_type;
+
+    set_type set;
+    for (unsigned int k = 0; k < 1000; ++k)
+        set.insert(k);
+
+    std::vector<uint64_t> good = write_image(set);
+    size_t size = good.size() * sizeof(uint64_t);
+
+    tlx::btree_image<set_type> image;
+    die_unless(!image.attach(nullptr, 0));
+    die_unless(!image.attach(good.data(), 16));
+    die_unless(!image.attach(good.data(), size - 64));
+    die_unless(image.attach(good.data(), size));
+
+    std::vector<uint64_t> bad = good;
+    tlx::btree_image_header* h =
+        reinterpret_cast<tlx::btree_image_header*>(bad.data());
+
+    h->magic[0] = 'x';
+    die_unless(!image.attach(bad.data(), size));
+    die_unless(image.empty());
+    bad = good;
+    h->version = 2;
+    die_unless(!image.attach(bad.data(), size));
+    bad = good;
+    h->byte_order = 0x04030201;
+    die_unless(!image.attach(bad.data(), size));
+    bad = good;
+    h->size += 1000;
+    die_unless(!image.attach(bad.data(), size));
+    bad = good;
+    h->level_offset[0] = size;
+    die_unless(!image.attach(bad.data(), size));
+    bad = good;
+    h->levels = 1;
+    die_unless(!image.attach(bad.data(), size));
+
+    // swapped items pass the header checks but fail verification
+    bad = good;
+    unsigned int* values = reinterpret_cast<unsigned int*>(
+        reinterpret_cast<char*>(bad.data()) + h->values_offset);
+    std::swap(values[100], values[101]);
+    die_unless(image.attach(bad.data(), size));
+    die_unless(!image.verify());
+    die_unless(image.error() != nullptr);
+
+    // a modified separator key fails verification
+    bad = good;
+    unsigned int* keys = reinterpret_cast<unsigned int*>(
+        reinterpret_cast<char*>(bad.data()) + h->level_offset[1]);
+    keys[0] += 1;
+    die_unless(image.attach(bad.data(), size));
+    die_unless(!image.verify());
+}
+
+void test_file()
+{
+    typedef tlx::btree_multiset<unsigned int> multiset_type;
+
+    multiset_type set;
+    for (unsigned int k = 0; k < 100000; ++k)
+        set.insert(k / 3);
+
+    const std::string path = "btree_image_test.img";
+    {
+        std::ofstream os(path.c_str(), std::ios::binary);
+        die_unless(tlx::btree_image<multiset_type>::write(set, os));
+    }
+
+    tlx::btree_image<multiset_type> image;
+    die_unless(image.open(path));
+    die_unless(image.verify());
+    check_image(image, set, 100000 / 3);
+
+    std::remove(path.c_str());
+    die_unless(!image.open(path));
+    die_unless(image.empty());
+}
+
+/******************************************************************************/
+
+int main()
+{
+    test_sizes<4>();
+    test_sizes<7>();
+    test_sizes<32>();
+
+    test_map();
+    test_corruption();
+    test_file();
+
+    return 0;
+}
+
+/******************************************************************************/
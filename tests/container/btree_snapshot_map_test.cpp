@@ -0,0 +1,213 @@
+/*******************************************************************************
+ * tests/container/btree_snapshot_map_test.cpp
+ *
+ * Part of tlx - http://panthema.net/tlx
+ *
+ * Copyright (C) 2026 Timo Bingmann <tb@panthema.net>
+ *
+ * All rights reserved. Published under the Boost Software License, Version 1.0
+ ******************************************************************************/
+
+#include <tlx/container/btree_snapshot_map.hpp>
+#include <tlx/die.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/******************************************************************************/
+// Instantiation Tests
+
+template class tlx::btree_snapshot_map<int, double>;
+template class tlx::btree_snapshot_map<std::string, std::string>;
+
+template <typename KeyType, int Slots>
+struct traits_slots : tlx::btree_default_traits<KeyType, KeyType>
+{
+    static const int leaf_slots = Slots;
+    static const int inner_slots = Slots;
+};
+
+/******************************************************************************/
+
+//! Compare the contents of map with ref, iterating forward and backward, and
+//! check lower_bound() and upper_bound() at all keys and between them.
+template <typename MapType>
+void check_equal(const MapType& map,
+                 const std::map<unsigned int, unsigned int>& ref)
+{
+    map.verify();
+    die_unequal(map.size(), ref.size());
+    std::vector<std::pair<unsigned int, unsigned int> > expected(
+        ref.begin(), ref.end());
+    die_unless(std::equal(map.begin(), map.end(), expected.begin()));
+    die_unless(std::equal(map.rbegin(), map.rend(), expected.rbegin()));
+
+    for (const std::pair<const unsigned int, unsigned int>& p : ref)
+    {
+        die_unless(map.exists(p.first));
+        die_unless(map.find(p.first) != map.end());
+        die_unequal(map.find(p.first)->second, p.second);
+
+        for (unsigned int k = p.first; k <= p.first + 1; ++k)
+        {
+            typename MapType::const_iterator lb = map.lower_bound(k);
+            typename MapType::const_iterator ub = map.upper_bound(k);
+            if (ref.lower_bound(k) == ref.end())
+                die_unless(lb == map.end());
+            else
+                die_unequal(lb->first, ref.lower_bound(k)->first);
+            if (ref.upper_bound(k) == ref.end())
+                die_unless(ub == map.end());
+            else
+                die_unequal(ub->first, ref.upper_bound(k)->first);
+        }
+    }
+}
+
+template <int Slots>
+void test_snapshots(size_t num_ops)
+{
+    typedef tlx::btree_snapshot_map<unsigned int, unsigned int,
+                                    std::less<unsigned int>,
+                                    traits_slots<unsigned int, Slots> >
+        map_type;
+    typedef std::map<unsigned int, unsigned int> ref_type;
+
+    map_type map;
+    ref_type ref;
+
+    die_unless(map.empty());
+    die_unless(map.begin() == map.end());
+    die_unless(map.find(42) == map.end());
+    die_unless(map.lower_bound(42) == map.end());
+
+    std::vector<std::pair<map_type, ref_type> > snapshots;
+
+    std::default_random_engine rng(34234235);
+
+    for (size_t i = 0; i < num_ops; ++i)
+    {
+        unsigned int key = rng() % (num_ops / 2 + 1);
+        unsigned int data = static_cast<unsigned int>(i);
+
+        // insert more than erase while growing, then shrink to empty.
+        size_t op = rng() % 8;
+        if (i > num_ops / 2)
+            op = (op < 5) ? 2 : op;
+
+        if (op == 0 || op == 1)
+        {
+            die_unequal(map.insert(key, data),
+                        ref.insert(std::make_pair(key, data)).second);
+        }
+        else if (op == 2 || op == 3)
+        {
+            die_unequal(map.erase(key), ref.erase(key));
+        }
+        else if (op == 4)
+        {
+            bool inserted = (ref.find(key) == ref.end());
+            ref[key] = data;
+            die_unequal(map.insert_or_assign(key, data), inserted);
+        }
+
+        if (i % (num_ops / 16) == 0)
+        {
+            snapshots.emplace_back(map.snapshot(), ref);
+            check_equal(map, ref);
+        }
+    }
+
+    // all snapshots kept their contents while the map was modified.
+    for (size_t i = 0; i < snapshots.size(); ++i)
+        check_equal(snapshots[i].first, snapshots[i].second);
+
+    // modify a snapshot, the map remains unchanged.
+    map_type copy = snapshots[snapshots.size() / 2].first;
+    ref_type ref_copy = snapshots[snapshots.size() / 2].second;
+    for (unsigned int k = 0; k < 100; ++k)
+    {
+        copy.insert_or_assign(k, k);
+        ref_copy[k] = k;
+    }
+    check_equal(copy, ref_copy);
+    check_equal(snapshots[snapshots.size() / 2].first,
+                snapshots[snapshots.size() / 2].second);
+    check_equal(map, ref);
+
+    // drop the snapshots in mixed order.
+    for (size_t i = 0; i < snapshots.size(); i += 2)
+        snapshots[i].first.clear();
+    for (size_t i = 1; i < snapshots.size(); i += 2)
+        check_equal(snapshots[i].first, snapshots[i].second);
+    snapshots.clear();
+    check_equal(map, ref);
+
+    map.clear();
+    check_equal(map, ref_type());
+}
+
+//! Iterate snapshots in a background thread while the map is modified.
+void test_background_iteration()
+{
+    typedef tlx::btree_snapshot_map<unsigned int, unsigned int,
+                                    std::less<unsigned int>,
+                                    traits_slots<unsigned int, 8> >
+        map_type;
+
+    map_type map;
+    for (unsigned int k = 0; k < 10000; ++k)
+        map.insert(2 * k, k);
+
+    for (size_t round = 0; round < 8; ++round)
+    {
+        map_type snapshot = map.snapshot();
+        size_t size = snapshot.size();
+
+        std::thread reader([&snapshot, size]() {
+            size_t count = 0;
+            for (map_type::const_iterator it = snapshot.begin();
+                 it != snapshot.end(); ++it, ++count)
+            {
+                die_unequal(it->first % 2, 0U);
+            }
+            die_unequal(count, size);
+            snapshot.verify();
+        });
+
+        std::default_random_engine rng(static_cast<int>(round));
+        for (size_t i = 0; i < 5000; ++i)
+        {
+            unsigned int k = rng() % 20000;
+            if (k % 2 == 0)
+                map.erase(k);
+            else
+                map.insert(k - 1, k);
+        }
+
+        reader.join();
+    }
+
+    map.verify();
+}
+
+/******************************************************************************/
+
+int main()
+{
+    test_snapshots<4>(20000);
+    test_snapshots<7>(20000);
+    test_snapshots<32>(50000);
+
+    test_background_iteration();
+
+    return 0;
+}
+
+/******************************************************************************/
@@ -9,22 +9,37 @@
  ******************************************************************************/
 
 #include <tlx/container/btree.hpp>
+#include <tlx/container/btree_concurrent_map.hpp>
+#include <tlx/container/btree_image.hpp>
+#include <tlx/container/btree_map.hpp>
 #include <tlx/container/btree_multimap.hpp>
 #include <tlx/container/btree_multiset.hpp>
+#include <tlx/container/btree_snapshot_map.hpp>
 #include <tlx/container/splay_tree.hpp>
 #include <tlx/die.hpp>
+#include <tlx/slab_allocator.hpp>
 #include <tlx/timestamp.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <fstream>
 #include <functional>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <map>
+#include <mutex>
 #include <random>
 #include <set>
+#include <shared_mutex>
 #include <string>
+#include <thread>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 // *** Settings
 
@@ -143,6 +158,165 @@ public:
     }
 };
 
+//! Test a generic ordered set type with lower_bound queries
+template <typename SetType>
+class Test_Set_LowerBound
+{
+public:
+    SetType set;
+
+    static const char* op()
+    {
+        return "set_lower_bound";
+    }
+
+    Test_Set_LowerBound(size_t items)
+    {
+        std::default_random_engine rng(seed);
+        for (size_t i = 0; i < items; i++)
+            set.insert(rng());
+
+        die_unless(set.size() == items);
+    }
+
+    void run(size_t items)
+    {
+        std::default_random_engine rng(seed + 1);
+        size_t sum = 0;
+        for (size_t i = 0; i < items; i++)
+        {
+            typename SetType::const_iterator it = set.lower_bound(rng());
+            if (it != set.end())
+                sum += *it;
+        }
+        die_unless(sum != 0);
+    }
+};
+
+//! Comparator equivalent to std::less<size_t>, but which is not recognized by
+//! the B+ tree's specialized integer key search.
+struct generic_less
+{
+    bool operator()(const size_t& a, const size_t& b) const
+    {
+        return a < b;
+    }
+};
+
+//! Test a generic ordered set type with insertions and range deletions
+template <typename SetType>
+class Test_Set_InsertEraseRange
+{
+public:
+    Test_Set_InsertEraseRange(size_t)
+    {
+    }
+
+    static const char* op()
+    {
+        return "set_insert_erase_range";
+    }
+
+    void run(size_t items)
+    {
+        SetType set;
+
+        std::default_random_engine rng(seed);
+        for (size_t i = 0; i < items; i++)
+            set.insert(rng());
+
+        die_unless(set.size() == items);
+
+        // erase the key space in 16 ranges in scattered order
+        const size_t step = (rng.max() >> 4) + 1;
+        for (size_t i = 0; i < 16; i++)
+        {
+            size_t lo = ((i * 7) % 16) * step;
+            set.erase(set.lower_bound(lo), set.lower_bound(lo + step));
+        }
+
+        die_unless(set.empty());
+    }
+};
+
+//! Key streams for the insertion tests
+enum class KeyStream { Ascending, NearlySorted, Random };
+
+//! Test a generic ordered set type with insertions of a key stream, either
+//! plain or with the position of the previous insertion as hint.
+template <typename SetType, KeyStream Stream, bool Hint>
+class Test_Set_InsertStream
+{
+public:
+    std::vector<size_t> keys;
+
+    Test_Set_InsertStream(size_t items) : keys(items)
+    {
+        std::default_random_engine rng(seed);
+        for (size_t i = 0; i < items; i++)
+            keys[i] = (Stream == KeyStream::Random) ? rng() : i;
+
+        // nearly sorted: move every 16th key up to 64 positions away
+        if (Stream == KeyStream::NearlySorted)
+        {
+            for (size_t i = 0; i < items; i += 16)
+                std::swap(keys[i], keys[std::min(items - 1, i + rng() % 64)]);
+        }
+    }
+
+    static const char* op()
+    {
+        switch (Stream)
+        {
+        case KeyStream::Ascending:
+            return Hint ? "set_insert_ascending_hint" : "set_insert_ascending";
+        case KeyStream::NearlySorted:
+            return Hint ? "set_insert_nearly_sorted_hint" :
+                          "set_insert_nearly_sorted";
+        default:
+            return Hint ? "set_insert_random_hint" : "set_insert_random";
+        }
+    }
+
+    void run(size_t items)
+    {
+        SetType set;
+
+        if (Hint)
+        {
+            typename SetType::iterator hint = set.end();
+            for (size_t i = 0; i < items; i++)
+                hint = set.insert(hint, keys[i]);
+        }
+        else
+        {
+            for (size_t i = 0; i < items; i++)
+                set.insert(keys[i]);
+        }
+
+        die_unless(set.size() == items);
+    }
+};
+
+template <typename SetType>
+using Test_Set_InsertAscending =
+    Test_Set_InsertStream<SetType, KeyStream::Ascending, false>;
+template <typename SetType>
+using Test_Set_InsertAscendingHint =
+    Test_Set_InsertStream<SetType, KeyStream::Ascending, true>;
+template <typename SetType>
+using Test_Set_InsertNearlySorted =
+    Test_Set_InsertStream<SetType, KeyStream::NearlySorted, false>;
+template <typename SetType>
+using Test_Set_InsertNearlySortedHint =
+    Test_Set_InsertStream<SetType, KeyStream::NearlySorted, true>;
+template <typename SetType>
+using Test_Set_InsertRandom =
+    Test_Set_InsertStream<SetType, KeyStream::Random, false>;
+template <typename SetType>
+using Test_Set_InsertRandomHint =
+    Test_Set_InsertStream<SetType, KeyStream::Random, true>;
+
 //! Construct different set types for a generic test class
 template <template <typename SetType> class TestClass>
 struct TestFactory_Set
@@ -171,8 +345,48 @@ struct TestFactory_Set
         }
     };
 
+    //! Test the B+ tree with a comparator hiding the integer keys
+    template <int Slots>
+    struct BtreeSetGeneric
+        : TestClass<tlx::btree_multiset<
+              size_t, generic_less, struct btree_traits_speed<Slots, Slots> > >
+    {
+        BtreeSetGeneric(size_t n)
+            : TestClass<tlx::btree_multiset<
+                  size_t, generic_less,
+                  struct btree_traits_speed<Slots, Slots> > >(n)
+        {
+        }
+    };
+
+    //! Test the B+ tree with nodes pooled by a SlabAllocator
+    template <int Slots>
+    struct BtreeSetSlab
+        : TestClass<tlx::btree_multiset<
+              size_t, std::less<size_t>,
+              struct btree_traits_speed<Slots, Slots>,
+              tlx::SlabAllocator<size_t> > >
+    {
+        BtreeSetSlab(size_t n)
+            : TestClass<tlx::btree_multiset<
+                  size_t, std::less<size_t>,
+                  struct btree_traits_speed<Slots, Slots>,
+                  tlx::SlabAllocator<size_t> > >(n)
+        {
+        }
+    };
+
     //! Run tests on all set types
     void call_testrunner(size_t items);
+
+    //! Run tests on all ordered set types
+    void call_testrunner_ordered(size_t items);
+
+    //! Run tests on B+ trees with and without the integer key search
+    void call_testrunner_search(size_t items);
+
+    //! Run tests on B+ trees with the default and the slab node allocator
+    void call_testrunner_alloc(size_t items);
 };
 
 // -----------------------------------------------------------------------------
@@ -412,6 +626,53 @@ void TestFactory_Set<TestClass>::call_testrunner(size_t items)
 #endif
 }
 
+template <template <typename Type> class TestClass>
+void TestFactory_Set<TestClass>::call_testrunner_ordered(size_t items)
+{
+    testrunner_loop<StdSet>(items, "std::multiset");
+
+    testrunner_loop<BtreeSet<16> >(items, "tlx::btree_multiset<16> slots=16");
+    testrunner_loop<BtreeSet<64> >(items, "tlx::btree_multiset<64> slots=64");
+    testrunner_loop<BtreeSet<256> >(items,
+                                    "tlx::btree_multiset<256> slots=256");
+}
+
+template <template <typename Type> class TestClass>
+void TestFactory_Set<TestClass>::call_testrunner_alloc(size_t items)
+{
+    testrunner_loop<BtreeSet<16> >(items, "tlx::btree_multiset<16> slots=16");
+    testrunner_loop<BtreeSetSlab<16> >(
+        items, "tlx::btree_multiset<16>[SlabAllocator] slots=16");
+    testrunner_loop<BtreeSet<64> >(items, "tlx::btree_multiset<64> slots=64");
+    testrunner_loop<BtreeSetSlab<64> >(
+        items, "tlx::btree_multiset<64>[SlabAllocator] slots=64");
+    testrunner_loop<BtreeSet<256> >(items,
+                                    "tlx::btree_multiset<256> slots=256");
+    testrunner_loop<BtreeSetSlab<256> >(
+        items, "tlx::btree_multiset<256>[SlabAllocator] slots=256");
+}
+
+template <template <typename Type> class TestClass>
+void TestFactory_Set<TestClass>::call_testrunner_search(size_t items)
+{
+    testrunner_loop<BtreeSet<8> >(items, "tlx::btree_multiset<8> slots=8");
+    testrunner_loop<BtreeSetGeneric<8> >(
+        items, "tlx::btree_multiset<8>[generic_less] slots=8");
+    testrunner_loop<BtreeSet<16> >(items, "tlx::btree_multiset<16> slots=16");
+    testrunner_loop<BtreeSetGeneric<16> >(
+        items, "tlx::btree_multiset<16>[generic_less] slots=16");
+    testrunner_loop<BtreeSet<32> >(items, "tlx::btree_multiset<32> slots=32");
+    testrunner_loop<BtreeSetGeneric<32> >(
+        items, "tlx::btree_multiset<32>[generic_less] slots=32");
+    testrunner_loop<BtreeSet<64> >(items, "tlx::btree_multiset<64> slots=64");
+    testrunner_loop<BtreeSetGeneric<64> >(
+        items, "tlx::btree_multiset<64>[generic_less] slots=64");
+    testrunner_loop<BtreeSet<128> >(items,
+                                    "tlx::btree_multiset<128> slots=128");
+    testrunner_loop<BtreeSetGeneric<128> >(
+        items, "tlx::btree_multiset<128>[generic_less] slots=128");
+}
+
 template <template <typename Type> class TestClass>
 void TestFactory_Map<TestClass>::call_testrunner(size_t items)
 {
@@ -435,6 +696,683 @@ void TestFactory_Map<TestClass>::call_testrunner(size_t items)
 #endif
 }
 
+// -----------------------------------------------------------------------------
+
+//! Test bulk loading a B+ tree from a sorted sequence with a growing number of
+//! threads and report the speedup over the single-threaded run.
+template <int Slots>
+void test_bulk_load_parallel(size_t items)
+{
+    typedef tlx::btree_multiset<size_t, std::less<size_t>,
+                                struct btree_traits_speed<Slots, Slots> >
+        btree_type;
+
+    std::vector<size_t> keys(items);
+
+    std::default_random_engine rng(seed);
+    for (size_t i = 0; i < items; i++)
+        keys[i] = rng();
+
+    std::sort(keys.begin(), keys.end());
+
+    size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+    double time_single = 0;
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2)
+    {
+        size_t repeat = 0;
+        double ts1 = tlx::timestamp(), ts2;
+
+        do
+        {
+            btree_type bt;
+            bt.bulk_load(keys.begin(), keys.end(), threads);
+            die_unless(bt.size() == items);
+            ++repeat;
+            ts2 = tlx::timestamp();
+        } while ((ts2 - ts1) < 1.0);
+
+        double time = (ts2 - ts1) / repeat;
+        if (threads == 1)
+            time_single = time;
+
+        std::cout << "RESULT"
+                  << " container=tlx::btree_multiset<" << Slots << ">"
+                  << " slots=" << Slots << " op=bulk_load_parallel"
+                  << " items=" << items << " threads=" << threads
+                  << " repeat=" << repeat << " time_total=" << (ts2 - ts1)
+                  << " time=" << std::fixed << std::setprecision(10) << time
+                  << " speedup=" << (time_single / time)
+                  << " items_per_sec=" << items / time << std::endl;
+    }
+}
+
+//! Test merging sorted batches of random keys into a B+ tree which was bulk
+//! loaded with as many keys, by inserting the keys of each batch
+//! individually, and by insert_sorted(). Rebuilding the tree from all keys
+//! with bulk_load() is reported as reference. All rates are of added keys.
+template <int Slots>
+void test_insert_sorted_batches(size_t items, size_t batch)
+{
+    typedef tlx::btree_multiset<size_t, std::less<size_t>,
+                                struct btree_traits_speed<Slots, Slots> >
+        btree_type;
+
+    std::default_random_engine rng(seed);
+
+    std::vector<size_t> initial(items);
+    for (size_t i = 0; i < items; i++)
+        initial[i] = rng();
+    std::sort(initial.begin(), initial.end());
+
+    std::vector<size_t> keys(items);
+    for (size_t i = 0; i < items; i++)
+        keys[i] = rng();
+    for (size_t i = 0; i < items; i += batch)
+        std::sort(keys.begin() + i, keys.begin() + std::min(items, i + batch));
+
+    static const char* ops[3] = {
+        "insert_batch_keys", "insert_sorted", "bulk_load"
+    };
+
+    for (size_t method = 0; method < 3; ++method)
+    {
+        size_t repeat = 0;
+        double time_total = 0;
+
+        do
+        {
+            btree_type bt;
+            if (method != 2)
+                bt.bulk_load(initial.begin(), initial.end());
+
+            double ts1 = tlx::timestamp();
+            if (method == 0)
+            {
+                for (size_t i = 0; i < items; i++)
+                    bt.insert(keys[i]);
+            }
+            else if (method == 1)
+            {
+                for (size_t i = 0; i < items; i += batch)
+                {
+                    bt.insert_sorted(keys.begin() + i,
+                                     keys.begin() + std::min(items, i + batch));
+                }
+            }
+            else
+            {
+                std::vector<size_t> all(initial);
+                all.insert(all.end(), keys.begin(), keys.end());
+                std::sort(all.begin(), all.end());
+                ts1 = tlx::timestamp();
+                bt.bulk_load(all.begin(), all.end());
+            }
+            time_total += tlx::timestamp() - ts1;
+
+            die_unless(bt.size() == 2 * items);
+            ++repeat;
+        } while (time_total < 1.0);
+
+        double time = time_total / repeat;
+
+        std::cout << "RESULT"
+                  << " container=tlx::btree_multiset<" << Slots << ">"
+                  << " slots=" << Slots << " op=" << ops[method]
+                  << " items=" << items << " batch=" << batch
+                  << " repeat=" << repeat << " time_total=" << time_total
+                  << " time=" << std::fixed << std::setprecision(10) << time
+                  << " items_per_sec=" << items / time << std::endl;
+    }
+}
+
+//! btree_concurrent_map, which synchronizes by optimistic lock coupling.
+class Concurrent_Map
+{
+public:
+    static const char* name()
+    {
+        return "tlx::btree_concurrent_map";
+    }
+
+    bool insert(size_t key)
+    {
+        return map_.insert(key, key);
+    }
+
+    bool find(size_t key) const
+    {
+        return map_.exists(key);
+    }
+
+    bool erase(size_t key)
+    {
+        return map_.erase(key);
+    }
+
+private:
+    tlx::btree_concurrent_map<size_t, size_t> map_;
+};
+
+#if __cplusplus >= 201402L
+//! Reader/writer lock of the locked map.
+typedef std::shared_timed_mutex map_mutex_type;
+//! Shared lock on the locked map for lookups.
+typedef std::shared_lock<map_mutex_type> map_read_lock_type;
+#else
+typedef std::mutex map_mutex_type;
+typedef std::unique_lock<map_mutex_type> map_read_lock_type;
+#endif
+
+//! btree_map protected by a global reader/writer lock.
+class Locked_Map
+{
+public:
+    static const char* name()
+    {
+        return "tlx::btree_map+rwlock";
+    }
+
+    bool insert(size_t key)
+    {
+        std::unique_lock<map_mutex_type> lock(mutex_);
+        return map_.insert(std::make_pair(key, key)).second;
+    }
+
+    bool find(size_t key) const
+    {
+        map_read_lock_type lock(mutex_);
+        return map_.exists(key);
+    }
+
+    bool erase(size_t key)
+    {
+        std::unique_lock<map_mutex_type> lock(mutex_);
+        return map_.erase_one(key);
+    }
+
+private:
+    mutable map_mutex_type mutex_;
+    tlx::btree_map<size_t, size_t> map_;
+};
+
+//! Test a mixed workload of lookups, insertions and erasures of random keys on
+//! a map shared by a growing number of threads. The map initially holds items
+//! keys out of 2 * items, and read_percent of the operations are lookups, the
+//! others alternate between insert and erase.
+template <typename MapType>
+void test_concurrent_mixed(size_t items, size_t read_percent)
+{
+    size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2)
+    {
+        MapType map;
+
+        std::default_random_engine rng(seed);
+        for (size_t i = 0; i < items; i++)
+            map.insert(rng() % (2 * items));
+
+        size_t ops_per_thread = std::max<size_t>(items, 1024000) / threads;
+        std::vector<std::thread> workers;
+
+        double ts1 = tlx::timestamp();
+        for (size_t t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&map, t, items, read_percent,
+                                  ops_per_thread]() {
+                std::default_random_engine trng(seed + static_cast<int>(t));
+                size_t found = 0;
+                for (size_t i = 0; i < ops_per_thread; ++i)
+                {
+                    size_t key = trng() % (2 * items);
+                    if (trng() % 100 < read_percent)
+                        found += map.find(key);
+                    else if (i % 2 == 0)
+                        map.insert(key);
+                    else
+                        map.erase(key);
+                }
+                die_unless(found <= ops_per_thread);
+            });
+        }
+        for (std::thread& w : workers)
+            w.join();
+        double time = tlx::timestamp() - ts1;
+
+        size_t ops = ops_per_thread * threads;
+        std::cout << "RESULT"
+                  << " container=" << MapType::name()
+                  << " op=concurrent_mixed"
+                  << " items=" << items << " read_percent=" << read_percent
+                  << " threads=" << threads << " ops=" << ops
+                  << " time=" << std::fixed << std::setprecision(10) << time
+                  << " ops_per_sec=" << ops / time
+                  << " lookups_per_sec=" << ops * read_percent / 100.0 / time
+                  << std::endl;
+    }
+}
+
+//! Test taking a point-in-time copy of a map with random keys and then
+//! overwriting 1% of its items, by copying a btree_map and by taking a
+//! snapshot of a btree_snapshot_map, which copies only the modified paths.
+void test_snapshot(size_t items)
+{
+    tlx::btree_map<size_t, size_t> map;
+    tlx::btree_snapshot_map<size_t, size_t> smap;
+
+    std::vector<size_t> keys(items);
+    std::default_random_engine rng(seed);
+    for (size_t i = 0; i < items; i++)
+    {
+        keys[i] = rng();
+        map.insert(std::make_pair(keys[i], i));
+        smap.insert_or_assign(keys[i], i);
+    }
+
+    for (size_t method = 0; method < 2; ++method)
+    {
+        size_t repeat = 0;
+        double ts1 = tlx::timestamp(), ts2;
+
+        do
+        {
+            if (method == 0)
+            {
+                tlx::btree_map<size_t, size_t> copy(map);
+                for (size_t i = 0; i < items; i += 100)
+                    map[keys[i]] = repeat;
+                die_unless(copy.size() == map.size());
+            }
+            else
+            {
+                tlx::btree_snapshot_map<size_t, size_t> copy = smap.snapshot();
+                for (size_t i = 0; i < items; i += 100)
+                    smap.insert_or_assign(keys[i], repeat);
+                die_unless(copy.size() == smap.size());
+            }
+            ++repeat;
+            ts2 = tlx::timestamp();
+        } while ((ts2 - ts1) < 1.0);
+
+        double time = (ts2 - ts1) / repeat;
+
+        std::cout << "RESULT"
+                  << " container="
+                  << (method == 0 ? "tlx::btree_map" : "tlx::btree_snapshot_map")
+                  << " op=snapshot_update"
+                  << " items=" << items << " repeat=" << repeat
+                  << " time_total=" << (ts2 - ts1)
+                  << " time=" << std::fixed << std::setprecision(10) << time
+                  << std::endl;
+    }
+}
+
+//! Test scanning all items of a map built by random insertions, whose leaves
+//! are scattered in memory: by iterating, by for_each_range(), and by summing
+//! over the spans of for_each_leaf_span(), which prefetch leaves ahead.
+void test_range_scan(size_t items)
+{
+    typedef tlx::btree_map<size_t, size_t> map_type;
+
+    map_type map;
+    std::default_random_engine rng(seed);
+    for (size_t i = 0; i < items; i++)
+        map.insert(std::make_pair(rng(), i));
+
+    size_t total = 0;
+    for (map_type::const_iterator it = map.begin(); it != map.end(); ++it)
+        total += it->second;
+
+    for (size_t method = 0; method < 3; ++method)
+    {
+        size_t repeat = 0, sum = 0;
+        double ts1 = tlx::timestamp(), ts2;
+
+        do
+        {
+            if (method == 0)
+            {
+                for (map_type::const_iterator it = map.begin();
+                     it != map.end(); ++it)
+                    sum += it->second;
+            }
+            else if (method == 1)
+            {
+                map.for_each_range(
+                    0, std::numeric_limits<size_t>::max(),
+                    [&sum](const map_type::value_type& v) { sum += v.second; });
+            }
+            else
+            {
+                map.for_each_leaf_span(
+                    [&sum](const map_type::value_type* first,
+                           const map_type::value_type* last) {
+                        for (; first != last; ++first)
+                            sum += first->second;
+                    });
+            }
+            ++repeat;
+            ts2 = tlx::timestamp();
+        } while ((ts2 - ts1) < 1.0);
+
+        die_unless(sum == repeat * total);
+        double time = (ts2 - ts1) / repeat;
+
+        std::cout << "RESULT"
+                  << " container=tlx::btree_map"
+                  << " op="
+                  << (method == 0   ? "iterator"
+                      : method == 1 ? "for_each_range"
+                                    : "for_each_leaf_span")
+                  << " items=" << items << " repeat=" << repeat
+                  << " time_total=" << (ts2 - ts1)
+                  << " time=" << std::fixed << std::setprecision(10) << time
+                  << " items_per_sec=" << map.size() / time << std::endl;
+    }
+}
+
+//! Test a pass over all items of a map which writes a function of each item
+//! into an array, sequentially by iterating (num_threads = 0) and with
+//! parallel_for_each() on num_threads threads.
+void test_parallel_for_each(size_t items, size_t num_threads)
+{
+    typedef tlx::btree_map<size_t, size_t> map_type;
+
+    std::vector<std::pair<size_t, size_t> > pairs(items);
+    for (size_t i = 0; i < items; i++)
+        pairs[i] = std::make_pair(i, i);
+
+    map_type map;
+    map.bulk_load(pairs.begin(), pairs.end());
+
+    std::vector<size_t> out(items);
+    size_t repeat = 0;
+    double ts1 = tlx::timestamp(), ts2;
+
+    do
+    {
+        if (num_threads == 0)
+        {
+            for (map_type::const_iterator it = map.begin(); it != map.end();
+                 ++it)
+                out[it->first] = it->second + repeat;
+        }
+        else
+        {
+            map.parallel_for_each(
+                [&out, repeat](const map_type::value_type& v) {
+                    out[v.first] = v.second + repeat;
+                },
+                num_threads);
+        }
+        ++repeat;
+        ts2 = tlx::timestamp();
+    } while ((ts2 - ts1) < 1.0);
+
+    for (size_t i = 0; i < items; i++)
+        die_unless(out[i] == i + repeat - 1);
+    double time = (ts2 - ts1) / repeat;
+
+    std::cout << "RESULT"
+              << " container=tlx::btree_map op=for_each"
+              << " items=" << items << " threads=" << num_threads
+              << " repeat=" << repeat << " time_total=" << (ts2 - ts1)
+              << " time=" << std::fixed << std::setprecision(10) << time
+              << std::endl;
+}
+
+//! Test compacting a map after erase churn: the time of compact() and of a
+//! scan over all items before and after it, and the bytes per item.
+void test_compact(size_t items)
+{
+    typedef tlx::btree_map<size_t, size_t> map_type;
+
+    map_type map;
+    std::vector<size_t> keys(2 * items);
+    std::default_random_engine rng(seed);
+    for (size_t i = 0; i < 2 * items; i++)
+    {
+        keys[i] = rng();
+        map.insert(std::make_pair(keys[i], i));
+    }
+    // erase every second key, which leaves many nodes near the minimum fill
+    for (size_t i = 0; i < 2 * items; i += 2)
+        map.erase(keys[i]);
+
+    for (size_t round = 0; round < 2; ++round)
+    {
+        double ts1 = tlx::timestamp();
+        if (round == 1)
+            map.compact();
+        double ts2 = tlx::timestamp();
+
+        size_t repeat = 0, sum = 0;
+        double ts3;
+        do
+        {
+            for (map_type::const_iterator it = map.begin(); it != map.end();
+                 ++it)
+                sum += it->second;
+            ++repeat;
+            ts3 = tlx::timestamp();
+        } while ((ts3 - ts2) < 1.0);
+
+        die_unless(sum != 0);
+        map_type::tree_stats stats = map.get_stats();
+
+        std::cout << "RESULT"
+                  << " container=tlx::btree_map"
+                  << " op=" << (round == 0 ? "churned" : "compacted")
+                  << " items=" << map.size()
+                  << " avgfill_leaves=" << stats.avgfill_leaves()
+                  << " avgfill_inner=" << stats.avgfill_inner()
+                  << " bytes_per_item=" << stats.bytes_per_item()
+                  << std::fixed << std::setprecision(10)
+                  << " compact_time=" << (ts2 - ts1)
+                  << " scan_time=" << (ts3 - ts2) / repeat << std::endl;
+    }
+}
+
+//! Test copying a map built by random insertions, with the copy constructor
+//! (num_threads = 0) or with assign_compact() using num_threads threads, and
+//! scanning the copy afterwards.
+void test_copy(size_t items, size_t num_threads)
+{
+    typedef tlx::btree_map<size_t, size_t> map_type;
+
+    map_type map;
+    std::default_random_engine rng(seed);
+    for (size_t i = 0; i < items; i++)
+        map.insert(std::make_pair(rng(), i));
+
+    size_t repeat = 0;
+    double ts1 = tlx::timestamp(), ts2;
+    do
+    {
+        if (num_threads == 0)
+        {
+            map_type copy(map);
+            die_unless(copy.size() == map.size());
+        }
+        else
+        {
+            map_type copy;
+            copy.assign_compact(map, 1.0, num_threads);
+            die_unless(copy.size() == map.size());
+        }
+        ++repeat;
+        ts2 = tlx::timestamp();
+    } while ((ts2 - ts1) < 1.0);
+
+    map_type copy;
+    if (num_threads == 0)
+        copy = map;
+    else
+        copy.assign_compact(map, 1.0, num_threads);
+
+    size_t scan_repeat = 0, sum = 0;
+    double ts3 = tlx::timestamp(), ts4;
+    do
+    {
+        for (map_type::const_iterator it = copy.begin(); it != copy.end();
+             ++it)
+            sum += it->second;
+        ++scan_repeat;
+        ts4 = tlx::timestamp();
+    } while ((ts4 - ts3) < 1.0);
+    die_unless(sum != 0);
+
+    std::cout << "RESULT"
+              << " container=tlx::btree_map"
+              << " op=" << (num_threads == 0 ? "copy" : "assign_compact")
+              << " items=" << items << " threads=" << num_threads
+              << " repeat=" << repeat
+              << " bytes_per_item=" << copy.get_stats().bytes_per_item()
+              << std::fixed << std::setprecision(10)
+              << " copy_time=" << (ts2 - ts1) / repeat
+              << " scan_time=" << (ts4 - ts3) / scan_repeat << std::endl;
+}
+
+//! 64-byte mapped type for the leaf layout test.
+struct Payload64
+{
+    uint64_t words[8];
+};
+
+//! B+ tree traits with keys and data stored in separate leaf arrays.
+template <typename Key, typename Value>
+struct traits_soa : tlx::btree_default_traits<Key, Value>
+{
+    static const bool soa_leaves = true;
+};
+
+//! Test inserting random keys into a map with 64-byte data items and then
+//! looking all of them up, with the default leaf layout of pairs and with
+//! separate key and data arrays (soa_leaves), where searches touch only keys.
+template <bool SoA>
+void test_leaf_layout(size_t items)
+{
+    typedef std::pair<uint64_t, Payload64> value_type;
+    typedef typename std::conditional<
+        SoA, traits_soa<uint64_t, value_type>,
+        tlx::btree_default_traits<uint64_t, value_type> >::type traits_type;
+    typedef tlx::btree_map<uint64_t, Payload64, std::less<uint64_t>,
+                           traits_type>
+        map_type;
+
+    std::vector<uint64_t> keys(items);
+    std::default_random_engine rng(seed);
+    for (size_t i = 0; i < items; i++)
+        keys[i] = rng();
+
+    for (size_t op = 0; op < 2; ++op)
+    {
+        size_t repeat = 0, found = 0;
+        double time = 0;
+
+        do
+        {
+            map_type map;
+            Payload64 payload = { { 0, 1, 2, 3, 4, 5, 6, 7 } };
+
+            double ts1 = tlx::timestamp();
+            for (size_t i = 0; i < items; i++)
+                map.insert(value_type(keys[i], payload));
+            double ts2 = tlx::timestamp();
+
+            if (op == 0)
+            {
+                time += ts2 - ts1;
+            }
+            else
+            {
+                for (size_t i = 0; i < items; i++)
+                    found += map.exists(keys[i]);
+                time += tlx::timestamp() - ts2;
+            }
+            ++repeat;
+        } while (time < 1.0);
+
+        die_unless(op == 0 || found == repeat * items);
+
+        std::cout << "RESULT"
+                  << " container=tlx::btree_map"
+                  << " layout=" << (SoA ? "soa" : "pairs")
+                  << " op=" << (op == 0 ? "insert" : "find")
+                  << " items=" << items << " repeat=" << repeat
+                  << " time_total=" << time << " time=" << std::fixed
+                  << std::setprecision(10) << time / repeat << std::endl;
+    }
+}
+
+//! Test loading a map with random keys and then looking up 1% of them: by
+//! bulk_load() of the sorted items into a btree_map, and by mapping an image
+//! file with btree_image, without and with verifying the image.
+void test_image_load(size_t items)
+{
+    typedef tlx::btree_map<size_t, size_t> map_type;
+
+    std::vector<std::pair<size_t, size_t> > pairs(items);
+    std::default_random_engine rng(seed);
+    for (size_t i = 0; i < items; i++)
+        pairs[i] = std::make_pair(rng(), i);
+    std::sort(pairs.begin(), pairs.end());
+
+    const std::string path = "btree_speedtest.img";
+    {
+        map_type map;
+        map.bulk_load(pairs.begin(), pairs.end());
+        std::ofstream os(path.c_str(), std::ios::binary);
+        die_unless(tlx::btree_image<map_type>::write(map, os));
+    }
+
+    for (size_t method = 0; method < 3; ++method)
+    {
+        size_t repeat = 0, found = 0;
+        double ts1 = tlx::timestamp(), ts2;
+
+        do
+        {
+            if (method == 0)
+            {
+                map_type map;
+                map.bulk_load(pairs.begin(), pairs.end());
+                for (size_t i = 0; i < items; i += 100)
+                    found += map.count(pairs[i].first);
+            }
+            else
+            {
+                tlx::btree_image<map_type> image;
+                die_unless(image.open(path));
+                if (method == 2)
+                    die_unless(image.verify());
+                for (size_t i = 0; i < items; i += 100)
+                    found += image.count(pairs[i].first);
+            }
+            ++repeat;
+            ts2 = tlx::timestamp();
+        } while ((ts2 - ts1) < 1.0);
+
+        die_unless(found == repeat * ((items + 99) / 100));
+        double time = (ts2 - ts1) / repeat;
+
+        std::cout << "RESULT"
+                  << " container="
+                  << (method == 0 ? "tlx::btree_map" : "tlx::btree_image")
+                  << " op="
+                  << (method == 0   ? "bulk_load"
+                      : method == 1 ? "open"
+                                    : "open_verify")
+                  << " items=" << items << " repeat=" << repeat
+                  << " time_total=" << (ts2 - ts1)
+                  << " time=" << std::fixed << std::setprecision(10) << time
+                  << std::endl;
+    }
+
+    std::remove(path.c_str());
+}
+
 //! Speed test them!
 int main()
 {
@@ -471,6 +1409,172 @@ int main()
         }
     }
 
+    { // Set - speed test find and lower_bound with integer key search
+
+        repeat_until = min_items;
+
+        for (size_t items = min_items; items <= max_items; items *= 2)
+        {
+            std::cout << "set: find, lower_bound " << items << "\n";
+            TestFactory_Set<Test_Set_Find>().call_testrunner_search(items);
+            TestFactory_Set<Test_Set_LowerBound>().call_testrunner_search(
+                items);
+        }
+    }
+
+    { // Set - speed test node allocators
+
+        repeat_until = min_items;
+
+        for (size_t items = min_items; items <= max_items; items *= 2)
+        {
+            std::cout << "set: node allocators " << items << "\n";
+            TestFactory_Set<Test_Set_InsertFindDelete>().call_testrunner_alloc(
+                items);
+            TestFactory_Set<Test_Set_Find>().call_testrunner_alloc(items);
+        }
+    }
+
+    { // Set - speed test plain and hinted insertion of key streams
+
+        repeat_until = min_items;
+
+        for (size_t items = min_items; items <= max_items; items *= 2)
+        {
+            std::cout << "set: insert key streams " << items << "\n";
+            TestFactory_Set<Test_Set_InsertAscending>().call_testrunner_ordered(
+                items);
+            TestFactory_Set<Test_Set_InsertAscendingHint>()
+                .call_testrunner_ordered(items);
+            TestFactory_Set<Test_Set_InsertNearlySorted>()
+                .call_testrunner_ordered(items);
+            TestFactory_Set<Test_Set_InsertNearlySortedHint>()
+                .call_testrunner_ordered(items);
+            TestFactory_Set<Test_Set_InsertRandom>().call_testrunner_ordered(
+                items);
+            TestFactory_Set<Test_Set_InsertRandomHint>()
+                .call_testrunner_ordered(items);
+        }
+    }
+
+    { // Set - speed test insert and range erase
+
+        repeat_until = min_items;
+
+        for (size_t items = min_items; items <= max_items; items *= 2)
+        {
+            std::cout << "set: insert, erase range " << items << "\n";
+            TestFactory_Set<Test_Set_InsertEraseRange>()
+                .call_testrunner_ordered(items);
+        }
+    }
+
+    { // Set - speed test parallel bulk load
+
+        for (size_t items = min_items; items <= max_items; items *= 2)
+        {
+            std::cout << "set: parallel bulk load " << items << "\n";
+            test_bulk_load_parallel<64>(items);
+            test_bulk_load_parallel<256>(items);
+        }
+    }
+
+    { // Set - speed test merging sorted batches into a populated tree
+
+        for (size_t items = min_items; items <= max_items; items *= 2)
+        {
+            std::cout << "set: insert sorted batches " << items << "\n";
+            for (size_t batch = 1024; batch <= items; batch *= 32)
+            {
+                test_insert_sorted_batches<64>(items, batch);
+                test_insert_sorted_batches<256>(items, batch);
+            }
+        }
+    }
+
+    { // Map - speed test snapshots followed by updates
+
+        for (size_t items = min_items; items <= max_items; items *= 2)
+        {
+            std::cout << "map: snapshot, update " << items << "\n";
+            test_snapshot(items);
+        }
+    }
+
+    { // Map - speed test scanning trees up to beyond the last-level cache
+
+        for (size_t items = 1024000; items <= max_items / 4; items *= 2)
+        {
+            std::cout << "map: range scan " << items << "\n";
+            test_range_scan(items);
+        }
+    }
+
+    { // Map - speed test parallel traversal of partitioned ranges
+
+        size_t max_threads = std::thread::hardware_concurrency();
+        for (size_t items = 1024000; items <= max_items; items *= 4)
+        {
+            std::cout << "map: parallel for_each " << items << "\n";
+            test_parallel_for_each(items, 0);
+            for (size_t threads = 1; threads <= max_threads; threads *= 2)
+                test_parallel_for_each(items, threads);
+        }
+    }
+
+    { // Map - speed test compaction after erase churn
+
+        for (size_t items = 1024000; items <= max_items / 4; items *= 4)
+        {
+            std::cout << "map: compact " << items << "\n";
+            test_compact(items);
+        }
+    }
+
+    { // Map - speed test copying with the copy constructor and compacting
+
+        size_t max_threads = std::thread::hardware_concurrency();
+        for (size_t items = 1024000; items <= max_items / 4; items *= 4)
+        {
+            std::cout << "map: copy " << items << "\n";
+            test_copy(items, 0);
+            for (size_t threads = 1; threads <= max_threads; threads *= 2)
+                test_copy(items, threads);
+        }
+    }
+
+    { // Map - speed test leaf layouts with large data items
+
+        for (size_t items = min_items; items <= max_items / 16; items *= 4)
+        {
+            std::cout << "map: leaf layout, 64-byte data " << items << "\n";
+            test_leaf_layout<false>(items);
+            test_leaf_layout<true>(items);
+        }
+    }
+
+    { // Map - speed test loading an image file versus bulk loading
+
+        for (size_t items = min_items; items <= max_items; items *= 2)
+        {
+            std::cout << "map: image load, lookup " << items << "\n";
+            test_image_load(items);
+        }
+    }
+
+    { // Map - speed test concurrent lookups, insertions and erasures
+
+        for (size_t items = min_items; items <= max_items; items *= 8)
+        {
+            std::cout << "map: concurrent mixed " << items << "\n";
+            for (size_t read_percent : { 100, 90, 50 })
+            {
+                test_concurrent_mixed<Concurrent_Map>(items, read_percent);
+                test_concurrent_mixed<Locked_Map>(items, read_percent);
+            }
+        }
+    }
+
     { // Map - speed test only insertion
 
         repeat_until = min_items;
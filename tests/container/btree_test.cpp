@@ -14,12 +14,17 @@
 #include <tlx/container/btree_multiset.hpp>
 #include <tlx/container/btree_set.hpp>
 #include <tlx/die.hpp>
+#include <tlx/slab_allocator.hpp>
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <functional>
+#include <limits>
+#include <map>
+#include <random>
 #include <set>
 #include <string>
 #include <utility>
@@ -39,6 +44,34 @@ template class tlx::btree_map<int, double>;
 template class tlx::btree_multiset<int>;
 template class tlx::btree_multimap<int, int>;
 
+template <typename Key, typename Value>
+struct traits_soa : tlx::btree_default_traits<Key, Value>
+{
+    static const bool soa_leaves = true;
+};
+
+template class tlx::btree_map<int, double, std::less<int>,
+                              traits_soa<int, std::pair<int, double> > >;
+template class tlx::btree_multimap<int, int, std::less<int>,
+                                   traits_soa<int, std::pair<int, int> > >;
+
+//! Traits which do not derive from btree_default_traits, like those written
+//! before the optional flags were added.
+template <typename Key, typename Value>
+struct traits_standalone
+{
+    static const bool self_verify = false;
+    static const bool debug = false;
+    static const int leaf_slots = 16;
+    static const int inner_slots = 16;
+    static const size_t binsearch_threshold = 256;
+};
+
+template class tlx::btree_set<int, std::less<int>,
+                              traits_standalone<int, int> >;
+template class tlx::btree_map<int, double, std::less<int>,
+                              traits_standalone<int, std::pair<int, double> > >;
+
 /******************************************************************************/
 // Simple Tests
 
@@ -248,6 +281,108 @@ struct SimpleTest
         die_unless(bt.size() == 100000);
     }
 
+    static void test_multiset_erase_range()
+    {
+        typedef tlx::btree_multiset<unsigned int, std::less<unsigned int>,
+                                    traits_nodebug<unsigned int> >
+            btree_type;
+
+        btree_type bt;
+        std::multiset<unsigned int> set;
+
+        srand(34234235);
+        for (unsigned int i = 0; i < 3200; i++)
+        {
+            unsigned int k = rand() % 100;
+            bt.insert(k);
+            set.insert(k);
+        }
+
+        // erase ranges of positions, which cut through runs of equal keys
+        while (!bt.empty())
+        {
+            size_t first = rand() % bt.size();
+            size_t last =
+                first + 1 + rand() % ((bt.size() - first + 3) / 4);
+
+            typename btree_type::iterator bfirst = bt.begin(), blast;
+            std::multiset<unsigned int>::iterator sfirst = set.begin(), slast;
+            std::advance(bfirst, first);
+            std::advance(sfirst, first);
+            blast = bfirst, slast = sfirst;
+            std::advance(blast, last - first);
+            std::advance(slast, last - first);
+
+            bt.erase(bfirst, blast);
+            set.erase(sfirst, slast);
+
+            die_unless(bt.size() == set.size());
+            die_unless(std::equal(bt.begin(), bt.end(), set.begin()));
+        }
+
+        // erase ranges of keys
+        for (unsigned int i = 0; i < 3200; i++)
+        {
+            unsigned int k = rand() % 1000;
+            bt.insert(k);
+            set.insert(k);
+        }
+
+        while (!bt.empty())
+        {
+            unsigned int lo = rand() % 1000, hi = lo + rand() % 100;
+
+            bt.erase(bt.lower_bound(lo), bt.upper_bound(hi));
+            set.erase(set.lower_bound(lo), set.upper_bound(hi));
+
+            die_unless(bt.size() == set.size());
+            die_unless(std::equal(bt.begin(), bt.end(), set.begin()));
+
+            if (rand() % 16 == 0)
+            {
+                bt.erase(bt.begin(), bt.end());
+                set.clear();
+            }
+        }
+    }
+
+    static void test_map_erase_range()
+    {
+        typedef tlx::btree_map<unsigned int, std::string,
+                               std::less<unsigned int>,
+                               traits_nodebug<unsigned int> >
+            btree_type;
+
+        btree_type bt;
+
+        for (unsigned int i = 0; i < 3200; i++)
+            bt.insert2(i, "101");
+
+        // erase prefix, suffix and a middle range
+        bt.erase(bt.begin(), bt.find(100));
+        die_unless(bt.size() == 3100 && bt.begin()->first == 100);
+
+        bt.erase(bt.find(3000), bt.end());
+        die_unless(bt.size() == 2900 && bt.rbegin()->first == 2999);
+
+        bt.erase(bt.find(1000), bt.find(2000));
+        die_unless(bt.size() == 1900);
+        die_unless(bt.find(999) != bt.end() && bt.find(1000) == bt.end());
+        die_unless(bt.find(1999) == bt.end() && bt.find(2000) != bt.end());
+
+        bt.erase(bt.find(500), bt.find(500));
+        die_unless(bt.size() == 1900);
+
+        unsigned int i = 100;
+        for (typename btree_type::iterator it = bt.begin(); it != bt.end();
+             ++it, ++i)
+        {
+            if (i == 1000)
+                i = 2000;
+            die_unless(it->first == i);
+        }
+    }
+
     SimpleTest()
     {
         test_empty();
@@ -258,6 +393,8 @@ struct SimpleTest
         test2_map_insert_erase_strings();
         test_set_100000_uint64();
         test_multiset_100000_uint32();
+        test_multiset_erase_range();
+        test_map_erase_range();
     }
 };
 
@@ -1610,11 +1747,1105 @@ void test_bulkload()
     test_bulkload_map_instance(117649, 100000);
 }
 
+/******************************************************************************/
+// Test Node Key Search on Integer Keys
+
+template <typename Key, int Slots>
+struct traits_slots : tlx::btree_default_traits<Key, Key>
+{
+    static const bool self_verify = true;
+    static const bool debug = false;
+
+    static const int leaf_slots = Slots;
+    static const int inner_slots = Slots;
+};
+
+template <typename Key, int Slots>
+void test_integer_search_instance()
+{
+    typedef tlx::btree_multiset<Key, std::less<Key>, traits_slots<Key, Slots> >
+        btree_type;
+
+    btree_type bt;
+    std::multiset<Key> set;
+
+    // keys over the whole value range, with many duplicates, to check the
+    // order of negative and unsigned keys with the high bit set.
+    std::vector<Key> probes;
+    probes.push_back(std::numeric_limits<Key>::min());
+    probes.push_back(std::numeric_limits<Key>::max());
+    probes.push_back(0);
+
+    std::mt19937_64 rng(34234235);
+    for (size_t i = 0; i < 256; ++i)
+        probes.push_back(static_cast<Key>(rng()));
+
+    for (size_t i = 0; i < 3200; ++i)
+    {
+        Key k = probes[rng() % probes.size()];
+        bt.insert(k);
+        set.insert(k);
+    }
+
+    for (size_t i = 0; i < probes.size(); ++i)
+    {
+        for (Key k : { probes[i], static_cast<Key>(probes[i] - 1),
+                       static_cast<Key>(probes[i] + 1) })
+        {
+            die_unless(std::distance(bt.begin(), bt.lower_bound(k)) ==
+                       std::distance(set.begin(), set.lower_bound(k)));
+            die_unless(std::distance(bt.begin(), bt.upper_bound(k)) ==
+                       std::distance(set.begin(), set.upper_bound(k)));
+            die_unless(bt.count(k) == set.count(k));
+        }
+    }
+}
+
+void test_integer_search()
+{
+    test_integer_search_instance<uint32_t, 8>();
+    test_integer_search_instance<int32_t, 13>();
+    test_integer_search_instance<uint64_t, 16>();
+    test_integer_search_instance<int64_t, 31>();
+    // large nodes, which use binary search before scanning a window of keys
+    test_integer_search_instance<uint32_t, 128>();
+    test_integer_search_instance<int32_t, 200>();
+    test_integer_search_instance<uint64_t, 100>();
+    test_integer_search_instance<int64_t, 127>();
+}
+
+/******************************************************************************/
+// Test Order Statistics
+
+template <typename Key, int Slots>
+struct traits_order_statistics : traits_slots<Key, Slots>
+{
+    static const bool order_statistics = true;
+};
+
+template <int Slots>
+void test_order_statistics_instance()
+{
+    typedef tlx::btree_multiset<unsigned int, std::less<unsigned int>,
+                                traits_order_statistics<unsigned int, Slots> >
+        btree_type;
+
+    btree_type bt;
+    std::multiset<unsigned int> set;
+
+    // check rank(), select() and distance() against the multiset.
+    auto check = [&]() {
+        die_unless(bt.size() == set.size());
+        die_unless(std::equal(bt.begin(), bt.end(), set.begin()));
+
+        size_t i = 0;
+        for (std::multiset<unsigned int>::const_iterator it = set.begin();
+             it != set.end(); ++it, ++i)
+        {
+            die_unless(*bt.select(i) == *it);
+            if (i % 7 == 0)
+                die_unless(bt.distance(bt.begin(), bt.select(i)) == long(i));
+        }
+        die_unless(bt.select(i) == bt.end());
+        die_unless(bt.distance(bt.begin(), bt.end()) == long(i));
+
+        for (unsigned int k = 0; k < 1100; k += 3)
+        {
+            die_unless(bt.rank(k) == size_t(std::distance(
+                                         set.begin(), set.lower_bound(k))));
+            die_unless(bt.distance(bt.lower_bound(k), bt.upper_bound(k)) ==
+                       long(set.count(k)));
+        }
+    };
+
+    srand(34234235);
+    for (unsigned int i = 0; i < 3200; i++)
+    {
+        unsigned int k = rand() % 1000;
+        bt.insert(k);
+        set.insert(k);
+    }
+    check();
+
+    // erase by key, by iterator and ranges
+    for (unsigned int i = 0; i < 1000; i++)
+    {
+        unsigned int k = rand() % 1000;
+        die_unless(bt.erase_one(k) == (set.count(k) != 0));
+        if (set.count(k))
+            set.erase(set.find(k));
+
+        typename btree_type::iterator bi = bt.lower_bound(k + 1);
+        if (bi != bt.end())
+        {
+            set.erase(set.find(*bi));
+            bt.erase(bi);
+        }
+    }
+    check();
+
+    for (unsigned int i = 0; i < 20; i++)
+    {
+        unsigned int lo = rand() % 1000, hi = lo + rand() % 50;
+        bt.erase(bt.lower_bound(lo), bt.upper_bound(hi));
+        set.erase(set.lower_bound(lo), set.upper_bound(hi));
+    }
+    check();
+
+    // copies and bulk loading
+    btree_type copy(bt);
+    die_unless(copy.distance(copy.begin(), copy.end()) == long(set.size()));
+
+    std::vector<unsigned int> keys(set.begin(), set.end());
+    for (size_t threads = 1; threads <= 4; threads += 3)
+    {
+        btree_type bulk;
+        bulk.bulk_load(keys.begin(), keys.end(), threads);
+        die_unless(bulk.rank(500) == bt.rank(500));
+        die_unless(*bulk.select(keys.size() / 2) == keys[keys.size() / 2]);
+    }
+
+    // erase everything again
+    while (!set.empty())
+    {
+        unsigned int k = *set.begin();
+        bt.erase(k);
+        set.erase(k);
+    }
+    check();
+}
+
+void test_order_statistics()
+{
+    test_order_statistics_instance<8>();
+    test_order_statistics_instance<13>();
+    test_order_statistics_instance<32>();
+}
+
+/******************************************************************************/
+
+namespace tlx {
+
+//! Test helper granted access to the B+ tree internals.
+class btree_friend
+{
+public:
+    //! Check that two trees consist of identically shaped nodes.
+    template <typename BTreeWrapper>
+    static bool same_layout(const BTreeWrapper& a, const BTreeWrapper& b)
+    {
+        if (a.tree_.stats_.leaves != b.tree_.stats_.leaves ||
+            a.tree_.stats_.inner_nodes != b.tree_.stats_.inner_nodes)
+            return false;
+        if (a.tree_.root_ == nullptr || b.tree_.root_ == nullptr)
+            return a.tree_.root_ == b.tree_.root_;
+        return same_node<typename BTreeWrapper::btree_impl>(
+            a.tree_.root_, b.tree_.root_);
+    }
+
+    template <typename BTree>
+    static bool same_node(const typename BTree::node* a,
+                          const typename BTree::node* b)
+    {
+        if (a->level != b->level || a->slotuse != b->slotuse)
+            return false;
+        if (a->is_leafnode())
+            return true;
+
+        typedef typename BTree::InnerNode InnerNode;
+        const InnerNode* ia = static_cast<const InnerNode*>(a);
+        const InnerNode* ib = static_cast<const InnerNode*>(b);
+        for (unsigned short s = 0; s <= ia->slotuse; ++s)
+        {
+            if (!same_node<BTree>(ia->childid[s], ib->childid[s]))
+                return false;
+        }
+        return true;
+    }
+};
+
+} // namespace tlx
+
+void test_bulkload_parallel_instance(size_t numkeys, size_t num_threads)
+{
+    typedef tlx::btree_multiset<unsigned int, std::less<unsigned int>,
+                                traits_nodebug<unsigned int> >
+        btree_type;
+
+    std::vector<unsigned int> keys(numkeys);
+
+    srand(34234235);
+    for (unsigned int i = 0; i < numkeys; i++)
+    {
+        keys[i] = rand() % 10000;
+    }
+
+    std::sort(keys.begin(), keys.end());
+
+    btree_type bt1, bt2;
+    bt1.bulk_load(keys.begin(), keys.end());
+    bt2.bulk_load(keys.begin(), keys.end(), num_threads);
+
+    die_unless(bt2.size() == numkeys);
+    die_unless(tlx::btree_friend::same_layout(bt1, bt2));
+    die_unless(std::equal(bt2.begin(), bt2.end(), keys.begin()));
+    die_unless(std::equal(bt2.rbegin(), bt2.rend(), keys.rbegin()));
+}
+
+void test_bulkload_parallel()
+{
+    for (size_t n = 0; n < 3200; n += 97)
+        test_bulkload_parallel_instance(n, 4);
+
+    for (size_t threads = 1; threads <= 8; ++threads)
+    {
+        test_bulkload_parallel_instance(31996, threads);
+        test_bulkload_parallel_instance(117649, threads);
+    }
+
+    test_bulkload_parallel_instance(1000000, 7);
+}
+
+/******************************************************************************/
+// Test Insertion with Hints and Appending
+
+template <typename BTree>
+void test_insert_hint_instance(size_t num_items)
+{
+    typedef std::multiset<unsigned int> set_type;
+
+    // ascending, nearly sorted and random key streams
+    for (size_t stream = 0; stream < 3; ++stream)
+    {
+        std::vector<unsigned int> keys(num_items);
+
+        srand(34234235);
+        for (size_t i = 0; i < num_items; ++i)
+            keys[i] = (stream == 2) ? rand() % num_items : i / 2;
+        if (stream == 1)
+        {
+            for (size_t i = 0; i < num_items; i += 8)
+            {
+                size_t j = std::min(num_items - 1, i + rand() % 32);
+                std::swap(keys[i], keys[j]);
+            }
+        }
+
+        set_type set;
+        BTree bt1, bt2, bt3, bt4;
+
+        typename BTree::iterator hint = bt2.end();
+        for (size_t i = 0; i < num_items; ++i)
+        {
+            set.insert(keys[i]);
+
+            // plain insert with the append fast path
+            bt1.insert(keys[i]);
+
+            // hint at the previous position
+            hint = bt2.insert(hint, keys[i]);
+            die_unless(*hint == keys[i]);
+
+            // hint at a random position
+            typename BTree::iterator it = bt3.begin();
+            std::advance(it, bt3.empty() ? 0 : rand() % bt3.size());
+            it = bt3.insert(it, keys[i]);
+            die_unless(*it == keys[i]);
+        }
+
+        // range insertion uses hints
+        bt4.insert(keys.begin(), keys.end());
+
+        die_unless(bt1.size() == set.size());
+        die_unless(std::equal(bt1.begin(), bt1.end(), set.begin()));
+        die_unless(bt2.size() == set.size());
+        die_unless(std::equal(bt2.begin(), bt2.end(), set.begin()));
+        die_unless(bt3.size() == set.size());
+        die_unless(std::equal(bt3.begin(), bt3.end(), set.begin()));
+        die_unless(bt4.size() == set.size());
+        die_unless(std::equal(bt4.begin(), bt4.end(), set.begin()));
+    }
+}
+
+void test_insert_hint()
+{
+    test_insert_hint_instance<
+        tlx::btree_multiset<unsigned int, std::less<unsigned int>,
+                            traits_slots<unsigned int, 4> > >(1000);
+    test_insert_hint_instance<
+        tlx::btree_multiset<unsigned int, std::less<unsigned int>,
+                            traits_slots<unsigned int, 13> > >(2000);
+    test_insert_hint_instance<
+        tlx::btree_multiset<unsigned int, std::less<unsigned int>,
+                            traits_order_statistics<unsigned int, 8> > >(1000);
+
+    // hints on a set with unique keys must not insert duplicates
+    typedef tlx::btree_set<unsigned int, std::less<unsigned int>,
+                           traits_slots<unsigned int, 8> >
+        set_type;
+
+    set_type set;
+    for (unsigned int i = 0; i < 1000; ++i)
+        set.insert(i);
+    for (unsigned int i = 0; i < 1000; ++i)
+    {
+        set_type::iterator it = set.insert(set.find((i * 7) % 1000), i);
+        die_unless(*it == i);
+        set.insert(set.end(), i);
+        set.insert(i);
+    }
+    die_unless(set.size() == 1000);
+}
+
+/******************************************************************************/
+// Test Splitting and Joining Trees
+
+template <typename BTree>
+void test_split_join_instance(size_t num_items)
+{
+    typedef std::multiset<unsigned int> set_type;
+
+    BTree bt;
+    set_type set;
+
+    srand(34234235);
+    for (size_t i = 0; i < num_items; i++)
+    {
+        unsigned int k = rand() % (2 * num_items);
+        bt.insert(k);
+        set.insert(k);
+    }
+
+    std::vector<unsigned int> split_keys;
+    split_keys.push_back(0);
+    split_keys.push_back(2 * num_items);
+    for (size_t i = 0; i < 20; ++i)
+        split_keys.push_back(rand() % (2 * num_items + 2));
+
+    for (unsigned int key : split_keys)
+    {
+        BTree left = bt, right;
+        right.insert(42);
+
+        left.split(key, right);
+
+        die_unless(std::equal(left.begin(), left.end(), set.begin()));
+        die_unless(std::equal(right.begin(), right.end(),
+                              set.lower_bound(key)));
+        die_unless(left.size() ==
+                   size_t(std::distance(set.begin(), set.lower_bound(key))));
+        die_unless(right.size() ==
+                   size_t(std::distance(set.lower_bound(key), set.end())));
+
+        // node counts after split, also after modifying the trees
+        left.verify();
+        right.verify();
+        right.insert(key);
+        right.erase_one(key);
+        right.verify();
+
+        left.join(std::move(right));
+        left.verify();
+        die_unless(right.empty());
+        die_unless(left.size() == set.size());
+        die_unless(std::equal(left.begin(), left.end(), set.begin()));
+        die_unless(std::equal(left.rbegin(), left.rend(), set.rbegin()));
+    }
+
+    // join trees of all height combinations
+    for (size_t n1 = 0; n1 <= num_items; n1 = 3 * n1 + 1)
+    {
+        for (size_t n2 = 0; n2 <= num_items; n2 = 3 * n2 + 1)
+        {
+            BTree left, right;
+            for (size_t i = 0; i < n1; ++i)
+                left.insert(static_cast<unsigned int>(i / 2));
+            for (size_t i = 0; i < n2; ++i)
+                right.insert(static_cast<unsigned int>((n1 + i) / 2));
+
+            left.join(std::move(right));
+            die_unless(left.size() == n1 + n2);
+
+            size_t i = 0;
+            for (typename BTree::iterator it = left.begin(); it != left.end();
+                 ++it, ++i)
+                die_unless(*it == i / 2);
+            die_unless(i == n1 + n2);
+        }
+    }
+}
+
+void test_split_join()
+{
+    test_split_join_instance<
+        tlx::btree_multiset<unsigned int, std::less<unsigned int>,
+                            traits_slots<unsigned int, 4> > >(1000);
+    test_split_join_instance<
+        tlx::btree_multiset<unsigned int, std::less<unsigned int>,
+                            traits_slots<unsigned int, 13> > >(3000);
+    test_split_join_instance<
+        tlx::btree_multiset<unsigned int, std::less<unsigned int>,
+                            traits_order_statistics<unsigned int, 8> > >(2000);
+
+    // split and join a map with unique keys
+    typedef tlx::btree_map<unsigned int, unsigned int, std::less<unsigned int>,
+                           traits_slots<unsigned int, 8> >
+        map_type;
+
+    map_type map, archive;
+    for (unsigned int i = 0; i < 1000; ++i)
+        map.insert(std::make_pair(i, i * i));
+
+    map.split(300, archive);
+    die_unless(map.size() == 300 && archive.size() == 700);
+    die_unless(map.rbegin()->first == 299 && archive.begin()->first == 300);
+
+    map.join(std::move(archive));
+    die_unless(map.size() == 1000 && archive.empty());
+    for (unsigned int i = 0; i < 1000; ++i)
+        die_unless(map[i] == i * i);
+}
+
+/******************************************************************************/
+// Test the B+ tree with nodes taken from a SlabAllocator's pool
+
+void test_slab_allocator()
+{
+    typedef tlx::SlabAllocator<unsigned int> alloc_type;
+    typedef tlx::btree_multiset<
+        unsigned int, std::less<unsigned int>,
+        tlx::btree_default_traits<unsigned int, unsigned int>, alloc_type>
+        btree_type;
+
+    std::multiset<unsigned int> set;
+    btree_type bt;
+
+    // plain allocators report only the bytes of the nodes
+    tlx::btree_multiset<unsigned int> plain;
+    plain.insert(1);
+    die_unequal(plain.get_stats().bytes_reserved(),
+                plain.get_stats().bytes_used());
+
+    srand(34234235);
+    for (size_t i = 0; i < 100000; i++)
+    {
+        unsigned int k = rand() % 10000;
+        bt.insert(k);
+        set.insert(k);
+    }
+    die_unless(std::equal(bt.begin(), bt.end(), set.begin()));
+    die_unless(bt.get_stats().bytes_used() <=
+               bt.get_allocator().bytes_used());
+    die_unless(bt.get_stats().bytes_reserved() >=
+               bt.get_stats().bytes_used());
+    die_unequal(bt.get_stats().allocator_reserved,
+                bt.get_allocator().bytes_reserved());
+
+    // a copy shares the arena, erasing nodes returns them to the free lists
+    size_t used = bt.get_allocator().bytes_used();
+    {
+        btree_type bt2 = bt;
+        die_unless(bt2.get_allocator() == bt.get_allocator());
+        die_unequal(2 * used, bt.get_allocator().bytes_used());
+    }
+    die_unequal(used, bt.get_allocator().bytes_used());
+
+    size_t reserved = bt.get_stats().bytes_reserved();
+    for (size_t i = 0; i < 100000; i++)
+    {
+        unsigned int k = rand() % 10000;
+        std::multiset<unsigned int>::iterator it = set.find(k);
+        die_unequal(bt.erase_one(k), it != set.end() ? 1U : 0U);
+        if (it != set.end())
+            set.erase(it);
+        k = rand() % 10000;
+        bt.insert(k);
+        set.insert(k);
+    }
+    bt.verify();
+    die_unless(std::equal(bt.begin(), bt.end(), set.begin()));
+
+    // the recycled nodes suffice, no more memory was reserved
+    bt.clear();
+    die_unequal(bt.get_allocator().bytes_used(), 0U);
+    die_unequal(bt.get_stats().bytes_reserved(), reserved);
+
+    // the parallel loader takes nodes from the shared arena concurrently
+    std::vector<unsigned int> keys(set.begin(), set.end());
+    bt.bulk_load(keys.begin(), keys.end(), 4);
+    die_unless(std::equal(bt.begin(), bt.end(), keys.begin()));
+    die_unless(bt.get_stats().bytes_used() <=
+               bt.get_allocator().bytes_used());
+    die_unequal(bt.get_stats().allocator_reserved,
+                bt.get_allocator().bytes_reserved());
+}
+
+/******************************************************************************/
+// Test Merging Sorted Runs into a Tree
+
+template <typename BTree>
+void test_insert_sorted_instance(size_t num_items)
+{
+    typedef std::multiset<unsigned int> set_type;
+
+    BTree bt;
+    set_type set;
+
+    srand(34234235);
+
+    // runs of growing length: single items, runs within one leaf, runs that
+    // split leaves many ways, and runs left and right of all keys.
+    for (size_t run = 1; run <= num_items; run = 2 * run + 1)
+    {
+        for (size_t pass = 0; pass < 3; ++pass)
+        {
+            std::vector<unsigned int> keys(run);
+            for (size_t i = 0; i < run; ++i)
+            {
+                if (pass == 0)
+                    keys[i] = rand() % (4 * num_items);
+                else if (pass == 1)
+                    keys[i] = rand() % 16 + num_items;
+                else
+                    keys[i] = 4 * num_items + rand() % num_items;
+            }
+            std::sort(keys.begin(), keys.end());
+
+            die_unequal(bt.insert_sorted(keys.begin(), keys.end()),
+                        keys.size());
+            set.insert(keys.begin(), keys.end());
+
+            die_unless(bt.size() == set.size());
+            die_unless(std::equal(bt.begin(), bt.end(), set.begin()));
+            die_unless(std::equal(bt.rbegin(), bt.rend(), set.rbegin()));
+        }
+    }
+
+    // an empty run does nothing
+    std::vector<unsigned int> none;
+    die_unequal(bt.insert_sorted(none.begin(), none.end()), 0U);
+    die_unless(bt.size() == set.size());
+}
+
+void test_insert_sorted()
+{
+    test_insert_sorted_instance<
+        tlx::btree_multiset<unsigned int, std::less<unsigned int>,
+                            traits_slots<unsigned int, 4> > >(1000);
+    test_insert_sorted_instance<
+        tlx::btree_multiset<unsigned int, std::less<unsigned int>,
+                            traits_slots<unsigned int, 13> > >(3000);
+    test_insert_sorted_instance<
+        tlx::btree_multiset<unsigned int, std::less<unsigned int>,
+                            traits_order_statistics<unsigned int, 8> > >(1000);
+
+    // unique keys: items present in the tree or repeated in the run are
+    // skipped
+    typedef tlx::btree_map<unsigned int, unsigned int, std::less<unsigned int>,
+                           traits_slots<unsigned int, 8> >
+        map_type;
+
+    map_type map;
+    std::map<unsigned int, unsigned int> ref;
+    for (unsigned int i = 0; i < 1000; i += 3)
+    {
+        map.insert(std::make_pair(i, i));
+        ref.insert(std::make_pair(i, i));
+    }
+
+    std::vector<std::pair<unsigned int, unsigned int> > run;
+    for (unsigned int i = 0; i < 2000; ++i)
+        run.push_back(std::make_pair(i / 2, i));
+
+    size_t inserted = map.insert_sorted(run.begin(), run.end());
+    die_unequal(inserted, 1000U - ref.size());
+    ref.insert(run.begin(), run.end());
+
+    // short runs with repeated keys are merged into the leaves in place
+    for (unsigned int i = 0; i < 3000; i += 5)
+    {
+        run.clear();
+        run.push_back(std::make_pair(i, i));
+        run.push_back(std::make_pair(i, i + 1));
+        run.push_back(std::make_pair(i + 2, i));
+
+        size_t num_new = (ref.count(i) ? 0 : 1) + (ref.count(i + 2) ? 0 : 1);
+        die_unequal(map.insert_sorted(run.begin(), run.end()), num_new);
+        ref.insert(run.begin(), run.end());
+    }
+
+    die_unless(map.size() == ref.size());
+    std::vector<std::pair<unsigned int, unsigned int> > expected(
+        ref.begin(), ref.end());
+    die_unless(std::equal(map.begin(), map.end(), expected.begin()));
+}
+
+/******************************************************************************/
+// Test Range Scans over Leaf Spans
+
+template <typename BTree>
+void test_for_each_range_instance(size_t num_items)
+{
+    typedef std::vector<unsigned int> vector_type;
+
+    BTree bt;
+
+    srand(34234235);
+    for (size_t i = 0; i < num_items; ++i)
+        bt.insert(rand() % (num_items / 2 + 1));
+
+    // all spans together are the whole tree, and none is empty
+    vector_type all;
+    bt.for_each_leaf_span([&all](const unsigned int* first,
+                                 const unsigned int* last) {
+        die_unless(first < last);
+        all.insert(all.end(), first, last);
+    });
+    die_unless(all.size() == bt.size());
+    die_unless(std::equal(bt.begin(), bt.end(), all.begin()));
+
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        unsigned int lo = rand() % (num_items / 2 + 3);
+        unsigned int hi = lo + rand() % (i < 500 ? 8 : num_items / 2 + 3);
+
+        vector_type expected(bt.lower_bound(lo), bt.lower_bound(hi));
+
+        vector_type spans, items;
+        bt.for_each_leaf_span(
+            lo, hi, [&spans](const unsigned int* first,
+                             const unsigned int* last) {
+                die_unless(first < last);
+                spans.insert(spans.end(), first, last);
+            });
+        bt.for_each_range(lo, hi, [&items](const unsigned int& x) {
+            items.push_back(x);
+        });
+
+        die_unless(spans == expected);
+        die_unless(items == expected);
+    }
+}
+
+void test_for_each_range()
+{
+    test_for_each_range_instance<
+        tlx::btree_multiset<unsigned int, std::less<unsigned int>,
+                            traits_slots<unsigned int, 4> > >(2000);
+    test_for_each_range_instance<
+        tlx::btree_multiset<unsigned int, std::less<unsigned int>,
+                            traits_slots<unsigned int, 13> > >(8000);
+
+    // an empty tree calls nothing
+    tlx::btree_set<unsigned int> set;
+    set.for_each_range(0, 100, [](const unsigned int&) { die("item"); });
+    set.insert(5);
+    size_t count = 0;
+    set.for_each_range(0, 100, [&count](const unsigned int&) { ++count; });
+    set.for_each_range(5, 5, [&count](const unsigned int&) { ++count; });
+    die_unequal(count, 1U);
+}
+
+/******************************************************************************/
+// Test Compaction
+
+template <typename BTree>
+void test_compact_instance(size_t num_items)
+{
+    typedef std::multiset<unsigned int> set_type;
+
+    BTree bt;
+    set_type set;
+
+    srand(34234235);
+    for (size_t i = 0; i < num_items; ++i)
+    {
+        unsigned int k = rand() % (num_items / 2 + 1);
+        bt.insert(k);
+        set.insert(k);
+    }
+
+    // erase churn leaves the nodes about half full
+    for (size_t i = 0; i < 2 * num_items; ++i)
+    {
+        unsigned int k = rand() % (num_items / 2 + 1);
+        if (i % 3 == 0)
+        {
+            bt.insert(k);
+            set.insert(k);
+        }
+        else
+        {
+            die_unequal(bt.erase(k), set.erase(k));
+        }
+    }
+
+    for (double fill : { 1.0, 0.5, 0.75, 0.0, 2.0 })
+    {
+        double bytes_per_item = bt.get_stats().bytes_per_item();
+        bt.compact(fill);
+        bt.verify();
+
+        die_unless(bt.size() == set.size());
+        die_unless(std::equal(bt.begin(), bt.end(), set.begin()));
+        die_unless(std::equal(bt.rbegin(), bt.rend(), set.rbegin()));
+
+        typename BTree::tree_stats stats = bt.get_stats();
+        if (fill >= 1.0 && stats.size > 16 * BTree::leaf_slotmax)
+        {
+            die_unless(stats.avgfill_leaves() > 0.9);
+            die_unless(stats.bytes_per_item() <= bytes_per_item);
+        }
+        if (stats.inner_nodes != 0)
+            die_unless(stats.avgfill_inner() > 0.3);
+    }
+
+    // the compacted tree remains fully functional
+    for (size_t i = 0; i < num_items; ++i)
+    {
+        unsigned int k = rand() % (num_items / 2 + 1);
+        if (i % 2 == 0)
+        {
+            bt.insert(k);
+            set.insert(k);
+        }
+        else
+        {
+            die_unequal(bt.erase(k), set.erase(k));
+        }
+    }
+    die_unless(std::equal(bt.begin(), bt.end(), set.begin()));
+}
+
+void test_compact()
+{
+    for (size_t n : { 1, 2, 5, 20, 1000 })
+    {
+        test_compact_instance<
+            tlx::btree_multiset<unsigned int, std::less<unsigned int>,
+                                traits_slots<unsigned int, 4> > >(n);
+    }
+    test_compact_instance<
+        tlx::btree_multiset<unsigned int, std::less<unsigned int>,
+                            traits_slots<unsigned int, 13> > >(2000);
+    test_compact_instance<
+        tlx::btree_multiset<unsigned int, std::less<unsigned int>,
+                            traits_order_statistics<unsigned int, 8> > >(1000);
+
+    // an empty tree stays empty
+    tlx::btree_set<unsigned int> set;
+    set.compact();
+    die_unless(set.empty());
+    set.insert(1);
+    set.erase(1);
+    set.compact(0.5);
+    die_unless(set.empty() && set.begin() == set.end());
+}
+
+template <typename BTree>
+void test_assign_compact_instance(size_t num_items)
+{
+    typedef std::multiset<unsigned int> set_type;
+
+    BTree bt;
+    set_type set;
+
+    srand(34234235);
+    for (size_t i = 0; i < 2 * num_items; ++i)
+    {
+        unsigned int k = rand() % (num_items / 2 + 1);
+        if (i % 2 == 0 || i < num_items)
+        {
+            bt.insert(k);
+            set.insert(k);
+        }
+        else
+        {
+            die_unequal(bt.erase(k), set.erase(k));
+        }
+    }
+
+    for (size_t threads : { 1, 4 })
+    {
+        for (double fill : { 1.0, 0.5, 0.0 })
+        {
+            BTree copy;
+            copy.insert(42);
+            copy.assign_compact(bt, fill, threads);
+            copy.verify();
+
+            die_unless(copy.size() == set.size());
+            die_unless(copy == bt);
+            die_unless(std::equal(copy.rbegin(), copy.rend(), set.rbegin()));
+
+            typename BTree::tree_stats stats = copy.get_stats();
+            if (fill >= 1.0 && stats.size > 16 * BTree::leaf_slotmax)
+            {
+                die_unless(stats.avgfill_leaves() > 0.9);
+                die_unless(stats.bytes_per_item() <=
+                           bt.get_stats().bytes_per_item());
+            }
+
+            // the copy is independent and remains fully functional
+            for (size_t i = 0; i < num_items / 4; ++i)
+            {
+                unsigned int k = rand() % (num_items / 2 + 1);
+                if (i % 2 == 0)
+                    copy.insert(k);
+                else
+                    copy.erase(k);
+            }
+            copy.verify();
+        }
+    }
+
+    die_unless(std::equal(bt.begin(), bt.end(), set.begin()));
+
+    bt.assign_compact(bt, 0.75, 4);
+    die_unless(bt.size() == set.size());
+    die_unless(std::equal(bt.begin(), bt.end(), set.begin()));
+
+    // copying an empty tree clears the target
+    BTree empty;
+    bt.assign_compact(empty);
+    die_unless(bt.empty() && bt.begin() == bt.end());
+}
+
+void test_assign_compact()
+{
+    for (size_t n : { 1, 2, 5, 20, 300 })
+    {
+        test_assign_compact_instance<
+            tlx::btree_multiset<unsigned int, std::less<unsigned int>,
+                                traits_slots<unsigned int, 4> > >(n);
+    }
+    test_assign_compact_instance<
+        tlx::btree_multiset<unsigned int, std::less<unsigned int>,
+                            traits_slots<unsigned int, 4> > >(2000);
+    test_assign_compact_instance<
+        tlx::btree_multiset<unsigned int, std::less<unsigned int>,
+                            traits_order_statistics<unsigned int, 8> > >(2000);
+
+    // structure-of-arrays leaves with data
+    typedef tlx::btree_map<unsigned int, unsigned int,
+                           std::less<unsigned int>,
+                           traits_soa<unsigned int,
+                                      std::pair<unsigned int, unsigned int> > >
+        soa_map_type;
+
+    soa_map_type map;
+    for (unsigned int i = 0; i < 100000; ++i)
+        map.insert2(i * 7, i);
+
+    soa_map_type copy;
+    copy.assign_compact(map, 1.0, 4);
+    copy.verify();
+    die_unless(copy == map);
+    die_unequal(copy.find(700)->second, 100u);
+}
+
+/******************************************************************************/
+// Test Partitioning and Parallel Traversal
+
+template <typename BTree>
+void test_partition_instance(size_t num_items)
+{
+    typedef typename BTree::const_iterator const_iterator;
+
+    std::vector<unsigned int> keys(num_items);
+    srand(34234235);
+    for (size_t i = 0; i < num_items; ++i)
+        keys[i] = rand() % (num_items / 4 + 1);
+    std::sort(keys.begin(), keys.end());
+
+    BTree bt;
+    bt.bulk_load(keys.begin(), keys.end());
+
+    for (size_t r = 0; r < 20; ++r)
+    {
+        // the whole tree and random subranges with duplicate keys
+        const_iterator first = bt.begin(), last = bt.end();
+        if (r != 0)
+        {
+            unsigned int a = rand() % (num_items / 4 + 2);
+            unsigned int b = a + rand() % (num_items / 4 + 2);
+            first = bt.lower_bound(a);
+            last = (r % 2) ? bt.upper_bound(b) : bt.end();
+        }
+        size_t total = std::distance(first, last);
+
+        for (size_t k = 1; k <= 16; ++k)
+        {
+            std::vector<const_iterator> bounds = bt.partition(first, last, k);
+
+            die_unless(bounds.size() >= 2 && bounds.size() <= k + 1);
+            die_unless(bounds.front() == first && bounds.back() == last);
+
+            // boundaries are strictly ordered and cover the range
+            size_t sum = 0, max_part = 0;
+            for (size_t i = 0; i + 1 < bounds.size(); ++i)
+            {
+                size_t part = std::distance(bounds[i], bounds[i + 1]);
+                die_unless(part > 0 || total == 0);
+                sum += part;
+                max_part = std::max(max_part, part);
+            }
+            die_unequal(sum, total);
+
+            if (BTree::traits::order_statistics)
+                die_unless(max_part <= total / (bounds.size() - 1) + 1);
+            else if (total > 64 * k * BTree::leaf_slotmax)
+                die_unless(bounds.size() == k + 1 &&
+                           max_part <= 3 * total / k + BTree::leaf_slotmax);
+        }
+
+        // parallel_for_each visits each item exactly once
+        std::atomic<size_t> count(0), key_sum(0);
+        bt.parallel_for_each(
+            first, last,
+            [&count, &key_sum](const unsigned int& k) {
+                ++count;
+                key_sum += k;
+            },
+            4);
+
+        size_t expected = 0;
+        for (const_iterator it = first; it != last; ++it)
+            expected += *it;
+        die_unequal(count.load(), total);
+        die_unequal(key_sum.load(), expected);
+    }
+}
+
+void test_partition()
+{
+    test_partition_instance<
+        tlx::btree_multiset<unsigned int, std::less<unsigned int>,
+                            traits_slots<unsigned int, 4> > >(20000);
+    test_partition_instance<
+        tlx::btree_multiset<unsigned int, std::less<unsigned int>,
+                            traits_slots<unsigned int, 13> > >(100000);
+    test_partition_instance<
+        tlx::btree_multiset<unsigned int, std::less<unsigned int>,
+                            traits_order_statistics<unsigned int, 8> > >(
+        20000);
+
+    // an empty tree has one empty subrange
+    tlx::btree_set<unsigned int> set;
+    die_unequal(set.partition(4).size(), 2U);
+    set.parallel_for_each([](const unsigned int&) { die("item"); }, 4);
+}
+
+/******************************************************************************/
+// Test Leaves with Separate Key and Data Arrays
+
+template <typename Key, int Slots>
+struct traits_soa_slots : traits_slots<Key, Slots>
+{
+    static const bool soa_leaves = true;
+};
+
+void test_soa_leaves()
+{
+    typedef tlx::btree_multimap<unsigned int, unsigned int,
+                                std::less<unsigned int>,
+                                traits_soa_slots<unsigned int, 8> >
+        soa_type;
+    typedef tlx::btree_multimap<unsigned int, unsigned int,
+                                std::less<unsigned int>,
+                                traits_slots<unsigned int, 8> >
+        aos_type;
+    typedef std::pair<unsigned int, unsigned int> pair_type;
+
+    soa_type soa;
+    aos_type aos;
+
+    srand(34234235);
+    for (size_t i = 0; i < 3000; ++i)
+    {
+        unsigned int k = rand() % 1000;
+        soa.insert(pair_type(k, static_cast<unsigned int>(i)));
+        aos.insert(pair_type(k, static_cast<unsigned int>(i)));
+        if (i % 3 == 0)
+        {
+            k = rand() % 1000;
+            die_unequal(soa.erase(k), aos.erase(k));
+        }
+    }
+
+    // iterators present pair-like proxy references
+    die_unless(soa.size() == aos.size());
+    die_unless(std::equal(soa.begin(), soa.end(), aos.begin()));
+    die_unless(std::equal(soa.rbegin(), soa.rend(), aos.rbegin()));
+
+    for (soa_type::iterator it = soa.begin(); it != soa.end(); ++it)
+        it->second += it->first;
+    for (aos_type::iterator it = aos.begin(); it != aos.end(); ++it)
+        it->second += it->first;
+
+    std::vector<pair_type> items(soa.begin(), soa.end());
+    die_unless(std::equal(aos.begin(), aos.end(), items.begin()));
+
+    for (unsigned int k = 0; k < 1001; ++k)
+    {
+        soa_type::const_iterator it = soa.lower_bound(k);
+        aos_type::const_iterator ref = aos.lower_bound(k);
+        die_unequal(it == soa.end(), ref == aos.end());
+        if (ref != aos.end())
+        {
+            die_unless(*it == *ref);
+            pair_type p = *it;
+            die_unless(p == *ref);
+        }
+        die_unequal(soa.count(k), aos.count(k));
+    }
+
+    // structural operations move keys and data together
+    soa_type right;
+    soa.split(500, right);
+    die_unless(std::equal(soa.begin(), soa.end(), items.begin()));
+    soa.join(std::move(right));
+    die_unless(std::equal(soa.begin(), soa.end(), items.begin()));
+
+    soa_type copy(soa);
+    die_unless(copy == soa);
+    soa.erase(soa.lower_bound(100), soa.upper_bound(800));
+    die_unless(soa < copy || copy < soa);
+
+    soa_type bulk;
+    bulk.bulk_load(items.begin(), items.end());
+    die_unless(bulk == copy);
+    bulk.insert_sorted(items.begin(), items.begin() + 200);
+    die_unequal(bulk.size(), items.size() + 200);
+
+    std::vector<pair_type> range;
+    copy.for_each_range(
+        100, 200, [&range](const soa_type::const_iterator::reference& v) {
+            range.push_back(v);
+        });
+    die_unless(std::equal(range.begin(), range.end(),
+                          aos.lower_bound(100)));
+    die_unequal(range.size(), static_cast<size_t>(std::distance(
+                                  aos.lower_bound(100), aos.lower_bound(200))));
+}
+
 /******************************************************************************/
 
 int main()
 {
     test_simple();
+    test_integer_search();
+    test_order_statistics();
+    test_bulkload_parallel();
+    test_slab_allocator();
+    test_split_join();
+    test_insert_hint();
+    test_insert_sorted();
+    test_for_each_range();
+    test_soa_leaves();
+    test_partition();
+    test_compact();
+    test_assign_compact();
     if (tlx_more_tests)
     {
         test_large();
@@ -10,14 +10,18 @@
 
 #include <tlx/container/d_ary_addressable_int_heap.hpp>
 #include <tlx/container/d_ary_heap.hpp>
+#include <tlx/container/sequence_heap.hpp>
 #include <tlx/die.hpp>
 #include <tlx/timestamp.hpp>
+#include <algorithm>
 #include <cstdint>
 #include <cstdlib>
 #include <functional>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <queue>
+#include <random>
 #include <string>
 #include <vector>
 
@@ -122,6 +126,201 @@ public:
     }
 };
 
+//! number of items pushed or popped per batch
+const size_t batch_size = 10000;
+
+//! Test a generic heap type by filling it with batches of pseudo-random keys
+//! and then draining the keys below a growing horizon, one item at a time.
+template <typename HeapType>
+class Test_Heap_BatchDrain
+{
+public:
+    Test_Heap_BatchDrain(size_t)
+    {
+    }
+
+    static const char* op()
+    {
+        return "heap_batch_drain";
+    }
+
+    void run(size_t items)
+    {
+        HeapType heap;
+        std::vector<std::uint32_t> batch, out;
+
+        for (size_t i = 0; i < items; i += batch_size)
+        {
+            batch.clear();
+            for (size_t j = i; j < std::min(items, i + batch_size); ++j)
+                batch.push_back(static_cast<std::uint32_t>(j * 7919 % items));
+            for (const std::uint32_t& key : batch)
+                heap.push(key);
+        }
+
+        die_unless(heap.size() == items);
+
+        for (size_t horizon = batch_size; !heap.empty(); horizon += batch_size)
+        {
+            out.clear();
+            while (!heap.empty() && heap.top() < horizon)
+            {
+                out.push_back(heap.top());
+                heap.pop();
+            }
+        }
+    }
+};
+
+//! Test a d-ary heap type by filling it with push_bulk() and draining it with
+//! pop_while(), like Test_Heap_BatchDrain.
+template <typename HeapType>
+class Test_Heap_BatchDrainBulk
+{
+public:
+    Test_Heap_BatchDrainBulk(size_t)
+    {
+    }
+
+    static const char* op()
+    {
+        return "heap_batch_drain_bulk";
+    }
+
+    void run(size_t items)
+    {
+        HeapType heap;
+        std::vector<std::uint32_t> batch, out;
+
+        for (size_t i = 0; i < items; i += batch_size)
+        {
+            batch.clear();
+            for (size_t j = i; j < std::min(items, i + batch_size); ++j)
+                batch.push_back(static_cast<std::uint32_t>(j * 7919 % items));
+            heap.push_bulk(batch.begin(), batch.end());
+        }
+
+        die_unless(heap.size() == items);
+
+        for (size_t horizon = batch_size; !heap.empty(); horizon += batch_size)
+        {
+            out.clear();
+            heap.pop_while(
+                [horizon](const std::uint32_t& key) { return key < horizon; },
+                std::back_inserter(out));
+        }
+    }
+};
+
+//! Test a d-ary heap type by filling it with push_bulk() and emptying it with
+//! pop_k(), like Test_Heap_FillPopAll.
+template <typename HeapType>
+class Test_Heap_FillPopAllBulk
+{
+public:
+    Test_Heap_FillPopAllBulk(size_t)
+    {
+    }
+
+    static const char* op()
+    {
+        return "heap_fill_popall_bulk";
+    }
+
+    void run(size_t items)
+    {
+        HeapType heap;
+        std::vector<std::uint32_t> batch, out;
+
+        for (size_t i = 0; i < items; i += batch_size)
+        {
+            batch.clear();
+            for (size_t j = i; j < std::min(items, i + batch_size); ++j)
+                batch.push_back(static_cast<std::uint32_t>(items - j));
+            heap.push_bulk(batch.begin(), batch.end());
+        }
+
+        die_unless(heap.size() == items);
+
+        while (!heap.empty())
+        {
+            out.clear();
+            heap.pop_k(batch_size, std::back_inserter(out));
+        }
+    }
+};
+
+//! Test a generic heap type like a Dijkstra search: cycle it by popping the
+//! minimum and pushing a key, which is that minimum plus a random distance.
+template <typename HeapType>
+class Test_Heap_Dijkstra
+{
+public:
+    using key_type = typename HeapType::key_type;
+
+    HeapType heap_;
+
+    Test_Heap_Dijkstra(size_t items)
+    {
+        std::default_random_engine rng(items);
+        for (size_t i = 0; i < items; i++)
+            heap_.push(static_cast<key_type>(rng() % (16 * items)));
+
+        die_unless(heap_.size() == items);
+    }
+
+    static const char* op()
+    {
+        return "heap_dijkstra";
+    }
+
+    void run(size_t items)
+    {
+        HeapType heap = heap_;
+        std::default_random_engine rng(items);
+
+        for (size_t i = 0; i < items; i++)
+        {
+            key_type top = heap.top();
+            heap.pop();
+            heap.push(static_cast<key_type>(top + rng() % (16 * items)));
+        }
+
+        die_unless(heap.size() == items);
+    }
+};
+
+//! Test a generic heap type by filling it with random keys and emptying it
+template <typename HeapType>
+class Test_Heap_RandomFillPopAll
+{
+public:
+    Test_Heap_RandomFillPopAll(size_t)
+    {
+    }
+
+    static const char* op()
+    {
+        return "heap_random_fill_popall";
+    }
+
+    void run(size_t items)
+    {
+        HeapType heap;
+        std::default_random_engine rng(items);
+
+        for (size_t i = 0; i < items; i++)
+            heap.push(static_cast<std::uint32_t>(rng()));
+
+        die_unless(heap.size() == items);
+
+        for (size_t i = 0; i < items; i++)
+            heap.pop();
+
+        die_unless(heap.empty());
+    }
+};
+
 // -----------------------------------------------------------------------------
 
 //! Construct different heap types for a generic test class
@@ -146,6 +345,98 @@ struct TestFactory_Heap
     void call_testrunner(size_t items);
 };
 
+//! Construct the d-ary heap types, which have batch operations, for a generic
+//! test class
+template <template <typename HeapType> class TestClass>
+struct TestFactory_DAryHeap
+{
+    //! Test the d-ary heap with a specific arity
+    template <int Arity>
+    using DAryHeap = TestClass<tlx::DAryHeap<std::uint32_t, Arity> >;
+
+    //! Test the d-ary heap with a specific arity
+    template <int Arity>
+    using DAryAIntHeap =
+        TestClass<tlx::DAryAddressableIntHeap<std::uint32_t, Arity> >;
+
+    //! Run tests on all heap types
+    void call_testrunner(size_t items);
+};
+
+//! Comparison of keys which is not recognized as std::less, and hence selects
+//! the minimum child with branches.
+template <typename KeyType>
+struct PlainLess
+{
+    bool operator()(const KeyType& a, const KeyType& b) const
+    {
+        return a < b;
+    }
+};
+
+//! Construct d-ary heaps with different arities, child selection, and memory
+//! layouts for a generic test class
+template <template <typename HeapType> class TestClass, typename KeyType>
+struct TestFactory_DAryHeapLayout
+{
+    //! Test the d-ary heap selecting the minimum child with branches
+    template <int Arity>
+    using Branchy =
+        TestClass<tlx::DAryHeap<KeyType, Arity, PlainLess<KeyType> > >;
+
+    //! Test the d-ary heap with the default std::less
+    template <int Arity>
+    using Default = TestClass<tlx::DAryHeap<KeyType, Arity> >;
+
+    //! Test the d-ary heap with the default std::less and aligned siblings
+    template <int Arity>
+    using Aligned =
+        TestClass<tlx::DAryHeap<KeyType, Arity, std::less<KeyType>, true> >;
+
+    //! Run tests on all heap types
+    void call_testrunner(size_t items);
+};
+
+//! Construct addressable d-ary heaps with different handle stores for a
+//! generic test class
+template <template <typename HeapType> class TestClass>
+struct TestFactory_DAryHeapHandles
+{
+    //! Test the addressable d-ary heap with a vector of handles
+    template <int Arity>
+    using Vector =
+        TestClass<tlx::DAryAddressableIntHeap<std::uint32_t, Arity> >;
+
+    //! Test the addressable d-ary heap with a hash table of handles
+    template <int Arity>
+    using Hash =
+        TestClass<tlx::d_ary_addressable_hash_heap<std::uint32_t, Arity> >;
+
+    //! Run tests on all heap types
+    void call_testrunner(size_t items);
+};
+
+//! Construct the sequence heap and the binary and d-ary heaps it competes with
+//! for a generic test class
+template <template <typename HeapType> class TestClass>
+struct TestFactory_SequenceHeap
+{
+    //! Test the binary heap from STL
+    using StdQueue =
+        TestClass<std::priority_queue<std::uint32_t, std::vector<std::uint32_t>,
+                                      std::greater<std::uint32_t> > >;
+
+    //! Test the d-ary heap with a specific arity
+    template <int Arity>
+    using DAryHeap = TestClass<tlx::DAryHeap<std::uint32_t, Arity> >;
+
+    //! Test the sequence heap
+    using SequenceHeap = TestClass<tlx::SequenceHeap<std::uint32_t> >;
+
+    //! Run tests on all heap types
+    void call_testrunner(size_t items);
+};
+
 // -----------------------------------------------------------------------------
 
 size_t repeat_until;
@@ -220,6 +511,61 @@ void TestFactory_Heap<TestClass>::call_testrunner(size_t items)
     testrunner_loop<DAryAIntHeap<32> >(items, "tlx::DAryAIntHeap<32> slots=32");
 }
 
+template <template <typename Type> class TestClass>
+void TestFactory_DAryHeap<TestClass>::call_testrunner(size_t items)
+{
+    testrunner_loop<DAryHeap<2> >(items, "tlx::DAryHeap<2> slots=2");
+    testrunner_loop<DAryHeap<4> >(items, "tlx::DAryHeap<4> slots=4");
+    testrunner_loop<DAryHeap<8> >(items, "tlx::DAryHeap<8> slots=8");
+
+    testrunner_loop<DAryAIntHeap<2> >(items, "tlx::DAryAIntHeap<2> slots=2");
+    testrunner_loop<DAryAIntHeap<4> >(items, "tlx::DAryAIntHeap<4> slots=4");
+    testrunner_loop<DAryAIntHeap<8> >(items, "tlx::DAryAIntHeap<8> slots=8");
+}
+
+template <template <typename Type> class TestClass, typename KeyType>
+void TestFactory_DAryHeapLayout<TestClass, KeyType>::call_testrunner(
+    size_t items)
+{
+    std::string key = " key=" + std::to_string(8 * sizeof(KeyType));
+
+    testrunner_loop<Branchy<2> >(items, "tlx::DAryHeap<2> branchy" + key);
+    testrunner_loop<Branchy<4> >(items, "tlx::DAryHeap<4> branchy" + key);
+    testrunner_loop<Branchy<8> >(items, "tlx::DAryHeap<8> branchy" + key);
+    testrunner_loop<Branchy<16> >(items, "tlx::DAryHeap<16> branchy" + key);
+
+    testrunner_loop<Default<2> >(items, "tlx::DAryHeap<2> default" + key);
+    testrunner_loop<Default<4> >(items, "tlx::DAryHeap<4> default" + key);
+    testrunner_loop<Default<8> >(items, "tlx::DAryHeap<8> default" + key);
+    testrunner_loop<Default<16> >(items, "tlx::DAryHeap<16> default" + key);
+
+    testrunner_loop<Aligned<2> >(items, "tlx::DAryHeap<2> aligned" + key);
+    testrunner_loop<Aligned<4> >(items, "tlx::DAryHeap<4> aligned" + key);
+    testrunner_loop<Aligned<8> >(items, "tlx::DAryHeap<8> aligned" + key);
+    testrunner_loop<Aligned<16> >(items, "tlx::DAryHeap<16> aligned" + key);
+}
+
+template <template <typename Type> class TestClass>
+void TestFactory_DAryHeapHandles<TestClass>::call_testrunner(size_t items)
+{
+    testrunner_loop<Vector<2> >(items, "tlx::DAryAIntHeap<2> handles=vector");
+    testrunner_loop<Vector<4> >(items, "tlx::DAryAIntHeap<4> handles=vector");
+    testrunner_loop<Vector<8> >(items, "tlx::DAryAIntHeap<8> handles=vector");
+
+    testrunner_loop<Hash<2> >(items, "tlx::DAryAIntHeap<2> handles=hash");
+    testrunner_loop<Hash<4> >(items, "tlx::DAryAIntHeap<4> handles=hash");
+    testrunner_loop<Hash<8> >(items, "tlx::DAryAIntHeap<8> handles=hash");
+}
+
+template <template <typename Type> class TestClass>
+void TestFactory_SequenceHeap<TestClass>::call_testrunner(size_t items)
+{
+    testrunner_loop<StdQueue>(items, "std::priority_queue");
+    testrunner_loop<DAryHeap<4> >(items, "tlx::DAryHeap<4> slots=4");
+    testrunner_loop<DAryHeap<8> >(items, "tlx::DAryHeap<8> slots=8");
+    testrunner_loop<SequenceHeap>(items, "tlx::SequenceHeap");
+}
+
 //! Speed test them!
 int main()
 {
@@ -256,6 +602,75 @@ int main()
         }
     }
 
+    // Heap - speed test batch fill and pop all, with single or batch operations
+    {
+        repeat_until = min_items;
+
+        for (size_t items = min_items; items <= max_items; items *= 2)
+        {
+            std::cout << "heap: batch fill, pop all " << items << "\n";
+            TestFactory_DAryHeap<Test_Heap_FillPopAll>().call_testrunner(items);
+            TestFactory_DAryHeap<Test_Heap_FillPopAllBulk>().call_testrunner(
+                items);
+        }
+    }
+
+    // Heap - speed test batch fill and drain below a horizon
+    {
+        repeat_until = min_items;
+
+        for (size_t items = min_items; items <= max_items; items *= 2)
+        {
+            std::cout << "heap: batch fill, drain " << items << "\n";
+            TestFactory_DAryHeap<Test_Heap_BatchDrain>().call_testrunner(items);
+            TestFactory_DAryHeap<Test_Heap_BatchDrainBulk>().call_testrunner(
+                items);
+        }
+    }
+
+    // Heap - speed test Dijkstra-style cycles with arities and layouts
+    {
+        repeat_until = min_items;
+
+        for (size_t items = min_items; items <= max_items; items *= 2)
+        {
+            std::cout << "heap: dijkstra " << items << "\n";
+            TestFactory_DAryHeapLayout<Test_Heap_Dijkstra, std::uint32_t>()
+                .call_testrunner(items);
+            TestFactory_DAryHeapLayout<Test_Heap_Dijkstra, std::uint64_t>()
+                .call_testrunner(items);
+        }
+    }
+
+    // Heap - speed test handle stores of the addressable heap
+    {
+        repeat_until = min_items;
+
+        for (size_t items = min_items; items <= max_items; items *= 2)
+        {
+            std::cout << "heap: handles " << items << "\n";
+            TestFactory_DAryHeapHandles<Test_Heap_FillPopAll>()
+                .call_testrunner(items);
+            TestFactory_DAryHeapHandles<Test_Heap_FillCycle>().call_testrunner(
+                items);
+        }
+    }
+
+    // Heap - speed test the sequence heap on random keys, up to sizes far
+    // beyond the cache
+    {
+        repeat_until = min_items;
+
+        for (size_t items = min_items; items <= max_items; items *= 2)
+        {
+            std::cout << "heap: sequence heap " << items << "\n";
+            TestFactory_SequenceHeap<Test_Heap_RandomFillPopAll>()
+                .call_testrunner(items);
+            TestFactory_SequenceHeap<Test_Heap_FillCycle>().call_testrunner(
+                items);
+        }
+    }
+
     return 0;
 }
 
@@ -15,9 +15,11 @@
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <iterator>
 #include <ostream>
 #include <random>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
 // Force instantiation.
@@ -27,11 +29,19 @@ template class DAryHeap<std::uint8_t>;
 template class DAryHeap<std::uint16_t>;
 template class DAryHeap<std::uint32_t>;
 template class DAryHeap<std::uint64_t>;
+template class DAryHeap<std::uint32_t, 16, std::less<std::uint32_t>, true>;
+template class DAryHeap<std::uint64_t, 8, std::greater<std::uint64_t>, true>;
 
 template class DAryAddressableIntHeap<std::uint8_t>;
 template class DAryAddressableIntHeap<std::uint16_t>;
 template class DAryAddressableIntHeap<std::uint32_t>;
 template class DAryAddressableIntHeap<std::uint64_t>;
+template class DAryAddressableIntHeap<std::uint32_t, 4,
+                                      std::less<std::uint32_t>,
+                                      DAryHeapHashHandles<std::uint32_t> >;
+template class DAryAddressableIntHeap<std::uint64_t, 2,
+                                      std::greater<std::uint64_t>,
+                                      DAryHeapHashHandles<std::uint64_t> >;
 
 } // namespace tlx
 
@@ -135,10 +145,10 @@ void fill_heap_and_set(DAryHeap& heap, Set& set, KeysVector& keys)
 
 //! Basic APIs: push(), top(), and pop().
 template <typename KeyType, unsigned Arity = 2,
-          class Compare = std::less<KeyType> >
+          class Compare = std::less<KeyType>, bool CacheAligned = false>
 void d_ary_heap_test(size_t size, std::uint32_t r_seed = 42)
 {
-    tlx::DAryHeap<KeyType, Arity, Compare> x;
+    tlx::DAryHeap<KeyType, Arity, Compare, CacheAligned> x;
     die_unequal(x.size(), 0U);
     die_if(!x.empty());
 
@@ -165,7 +175,7 @@ void d_ary_heap_test(size_t size, std::uint32_t r_seed = 42)
     x.build_heap(s.begin(), s.end());
     check_heap(x, s);
 
-    tlx::DAryHeap<KeyType, Arity, Compare> y, z;
+    tlx::DAryHeap<KeyType, Arity, Compare, CacheAligned> y, z;
     y.build_heap(keys);
     check_heap(y, s);
 
@@ -175,10 +185,11 @@ void d_ary_heap_test(size_t size, std::uint32_t r_seed = 42)
 
 //! Basic APIs: push(), top(), pop(), and remove().
 template <typename KeyType, unsigned Arity = 2,
-          class Compare = std::less<KeyType> >
+          class Compare = std::less<KeyType>,
+          class Handles = tlx::DAryHeapVectorHandles<KeyType> >
 void d_ary_addressable_int_heap_test(size_t size, std::uint32_t r_seed = 42)
 {
-    tlx::DAryAddressableIntHeap<KeyType, Arity, Compare> x;
+    tlx::DAryAddressableIntHeap<KeyType, Arity, Compare, Handles> x;
     die_unequal(x.size(), 0U);
     die_if(!x.empty());
 
@@ -217,7 +228,7 @@ void d_ary_addressable_int_heap_test(size_t size, std::uint32_t r_seed = 42)
     check_heap(x, s);
     check_handles(x, s);
 
-    tlx::DAryAddressableIntHeap<KeyType, Arity, Compare> y, z;
+    tlx::DAryAddressableIntHeap<KeyType, Arity, Compare, Handles> y, z;
     y.build_heap(s.begin(), s.end());
     check_heap(y, s);
     check_handles(y, s);
@@ -227,13 +238,162 @@ void d_ary_addressable_int_heap_test(size_t size, std::uint32_t r_seed = 42)
     check_handles(z, s);
 }
 
+//! Batch APIs: push_bulk(), pop_k(), and pop_while().
+template <typename KeyType, unsigned Arity = 2,
+          class Compare = std::less<KeyType>, bool CacheAligned = false>
+void d_ary_heap_test_bulk(size_t size, std::uint32_t r_seed = 42)
+{
+    tlx::DAryHeap<KeyType, Arity, Compare, CacheAligned> x;
+    std::multiset<KeyType, Compare> s;
+    Compare cmp;
+
+    auto keys = get_shuffled_vector<KeyType>(size, r_seed);
+
+    // Test push_bulk() with batches of growing size, then with duplicates.
+    for (size_t begin = 0, n = 1; begin < size; begin += n, n *= 2)
+    {
+        size_t end = std::min(size, begin + n);
+        x.push_bulk(keys.begin() + begin, keys.begin() + end);
+        s.insert(keys.begin() + begin, keys.begin() + end);
+        check_heap(x, s);
+    }
+    x.push_bulk(keys.begin(), keys.begin() + size / 2);
+    s.insert(keys.begin(), keys.begin() + size / 2);
+    check_heap(x, s);
+    x.push_bulk(keys.begin(), keys.begin());
+    check_heap(x, s);
+
+    // Test pop_k() with small batches.
+    std::mt19937 gen(r_seed);
+    while (x.size() > size / 2)
+    {
+        size_t k = gen() % 10;
+        std::vector<KeyType> out;
+        x.pop_k(k, std::back_inserter(out));
+        die_unequal(out.size(), std::min(k, s.size()));
+        for (const KeyType& key : out)
+        {
+            die_unequal(key, *s.begin());
+            s.erase(s.begin());
+        }
+        check_heap(x, s);
+    }
+
+    // Test pop_while() up to a key in the middle.
+    KeyType bound = *std::next(s.begin(), s.size() / 2);
+    std::vector<KeyType> out;
+    x.pop_while([&](const KeyType& key) { return cmp(key, bound); },
+                std::back_inserter(out));
+    for (const KeyType& key : out)
+    {
+        die_unequal(key, *s.begin());
+        s.erase(s.begin());
+    }
+    check_heap(x, s);
+    die_if(cmp(x.top(), bound));
+
+    // Test pop_k() of all items.
+    out.clear();
+    x.pop_k(x.size() + 1, std::back_inserter(out));
+    die_unless(x.empty());
+    die_unless(std::equal(out.begin(), out.end(), s.begin()));
+}
+
+//! Checks that the children of the root start on a cache line boundary.
+template <typename KeyType, unsigned Arity>
+void d_ary_heap_test_alignment(size_t size)
+{
+    tlx::DAryHeap<KeyType, Arity, std::less<KeyType>, true> x;
+    for (size_t i = 0; i < size; ++i)
+    {
+        x.push(KeyType(size - i));
+        die_unequal(reinterpret_cast<std::uintptr_t>(&x.top() + 1) % 64, 0U);
+    }
+    die_unless(x.sanity_check());
+}
+
+//! Batch APIs: push_bulk(), pop_k(), and pop_while() with handles.
+template <typename KeyType, unsigned Arity = 2,
+          class Compare = std::less<KeyType>,
+          class Handles = tlx::DAryHeapVectorHandles<KeyType> >
+void d_ary_addressable_int_heap_test_bulk(size_t size,
+                                          std::uint32_t r_seed = 42)
+{
+    tlx::DAryAddressableIntHeap<KeyType, Arity, Compare, Handles> x;
+    std::set<KeyType, Compare> s;
+    Compare cmp;
+
+    auto keys = get_shuffled_vector<KeyType>(size, r_seed);
+
+    // Test push_bulk() with batches of growing size.
+    for (size_t begin = 0, n = 1; begin < size; begin += n, n *= 2)
+    {
+        size_t end = std::min(size, begin + n);
+        x.push_bulk(keys.begin() + begin, keys.begin() + end);
+        s.insert(keys.begin() + begin, keys.begin() + end);
+        check_heap(x, s);
+        check_handles(x, s);
+    }
+
+    // Test pop_k() with small batches, pushing the keys back in bulk.
+    std::mt19937 gen(r_seed);
+    for (size_t i = 0; x.size() > size / 2; ++i)
+    {
+        size_t k = gen() % 10;
+        std::vector<KeyType> out;
+        x.pop_k(k, std::back_inserter(out));
+        die_unequal(out.size(), std::min(k, s.size()));
+        for (const KeyType& key : out)
+        {
+            die_unequal(key, *s.begin());
+            die_if(x.contains(key));
+            s.erase(s.begin());
+        }
+        check_heap(x, s);
+        check_handles(x, s);
+
+        if (i % 2 == 0)
+        {
+            x.push_bulk(out.begin(), out.end());
+            s.insert(out.begin(), out.end());
+            check_heap(x, s);
+        }
+    }
+
+    // Test pop_while() up to a key in the middle.
+    KeyType bound = *std::next(s.begin(), s.size() / 2);
+    std::vector<KeyType> out;
+    x.pop_while([&](const KeyType& key) { return cmp(key, bound); },
+                std::back_inserter(out));
+    for (const KeyType& key : out)
+    {
+        die_unequal(key, *s.begin());
+        s.erase(s.begin());
+    }
+    check_heap(x, s);
+    check_handles(x, s);
+    die_if(cmp(x.top(), bound));
+
+    // Push all keys back at once, then pop all of them.
+    x.push_bulk(out.begin(), out.end());
+    s.insert(out.begin(), out.end());
+    check_heap(x, s);
+    check_handles(x, s);
+
+    out.clear();
+    x.pop_k(x.size(), std::back_inserter(out));
+    die_unless(x.empty() && x.sanity_check());
+    die_unless(std::equal(out.begin(), out.end(), s.begin()));
+}
+
 //! Tests update().
-template <typename KeyType, unsigned Arity = 2>
+template <typename KeyType, unsigned Arity = 2,
+          class Handles = tlx::DAryHeapVectorHandles<KeyType> >
 void d_ary_heap_test_update(size_t size, std::vector<double>& prio,
                             std::uint32_t r_seed = 42)
 {
-    tlx::DAryAddressableIntHeap<KeyType, Arity, Comparator<KeyType> > x{
-        Comparator<KeyType>(prio)};
+    tlx::DAryAddressableIntHeap<KeyType, Arity, Comparator<KeyType>, Handles>
+    x{Comparator<KeyType>(prio)};
     die_unequal(x.size(), 0U);
     die_if(!x.empty());
 
@@ -284,6 +444,80 @@ void d_ary_heap_test_update(size_t size, std::vector<double>& prio,
     prio = backup;
 }
 
+//! Compares sparse keys by priorities in a hash map.
+struct SparseComparator
+{
+    const std::unordered_map<std::uint64_t, double>& prio;
+
+    bool operator()(const std::uint64_t& x, const std::uint64_t& y) const
+    {
+        return prio.at(x) < prio.at(y);
+    }
+};
+
+//! Tests the hash table of handles with sparse 64-bit keys.
+template <unsigned Arity>
+void d_ary_heap_test_sparse(size_t size, std::uint32_t r_seed = 42)
+{
+    std::unordered_map<std::uint64_t, double> prio;
+    tlx::d_ary_addressable_hash_heap<std::uint64_t, Arity, SparseComparator>
+    x{SparseComparator{prio}};
+
+    std::mt19937_64 gen(r_seed);
+    std::uniform_real_distribution<> dis(0.0, 1.0);
+    std::vector<std::uint64_t> keys;
+    while (keys.size() < size)
+    {
+        // keys above 2^60, the largest one marks non present keys
+        std::uint64_t key = gen() | (std::uint64_t(1) << 60);
+        if (key == ~std::uint64_t(0) || prio.count(key))
+            continue;
+        prio[key] = dis(gen);
+        keys.push_back(key);
+    }
+
+    // Test push(), and update() of all priorities at random.
+    for (const std::uint64_t& key : keys)
+        x.push(key);
+    die_unless(x.sanity_check());
+    for (const std::uint64_t& key : keys)
+    {
+        prio[key] = dis(gen);
+        x.update(key);
+    }
+    die_unless(x.sanity_check());
+    die_unequal(x.size(), size);
+
+    // Test remove() and contains() of every second key.
+    for (size_t i = 0; i < keys.size(); i += 2)
+    {
+        die_unless(x.contains(keys[i]));
+        x.remove(keys[i]);
+        die_if(x.contains(keys[i]));
+    }
+    die_unless(x.sanity_check());
+    die_unequal(x.size(), size / 2);
+
+    // Test pop() in priority order, which shrinks the table.
+    std::vector<std::uint64_t> rest;
+    for (size_t i = 1; i < keys.size(); i += 2)
+        rest.push_back(keys[i]);
+    std::sort(rest.begin(), rest.end(), SparseComparator{prio});
+    for (const std::uint64_t& key : rest)
+    {
+        die_unequal(x.top(), key);
+        x.pop();
+        die_if(x.contains(key));
+    }
+    die_unless(x.empty() && x.sanity_check());
+
+    // Test build_heap() with the sparse keys.
+    x.build_heap(keys);
+    die_unless(x.sanity_check());
+    for (const std::uint64_t& key : keys)
+        die_unless(x.contains(key));
+}
+
 int main()
 {
     // Size of the tested heaps and random seed.
@@ -349,6 +583,39 @@ int main()
     d_ary_addressable_int_heap_test<std::uint64_t, 2,
                                     std::greater<std::uint64_t> >(size, r_seed);
 
+    // Batch APIs.
+    d_ary_heap_test_bulk<std::uint8_t, 1>(size, r_seed);
+    d_ary_heap_test_bulk<std::uint8_t, 2>(size, r_seed);
+    d_ary_heap_test_bulk<std::uint16_t, 3>(size, r_seed);
+    d_ary_heap_test_bulk<std::uint32_t, 4>(2000, r_seed);
+    d_ary_heap_test_bulk<std::uint32_t, 13>(2000, r_seed);
+    d_ary_heap_test_bulk<std::uint64_t, 2, std::greater<std::uint64_t> >(
+        2000, r_seed);
+    d_ary_heap_test_bulk<TestData, 3, TestCompare>(size, r_seed);
+
+    // Cache-aligned layout.
+    d_ary_heap_test<std::uint32_t, 16, std::less<std::uint32_t>, true>(
+        size, r_seed);
+    d_ary_heap_test<std::uint64_t, 8, std::greater<std::uint64_t>, true>(
+        size, r_seed);
+    d_ary_heap_test<TestData, 4, TestCompare, true>(size, r_seed);
+    d_ary_heap_test_bulk<std::uint32_t, 4, std::less<std::uint32_t>, true>(
+        2000, r_seed);
+    d_ary_heap_test_bulk<std::uint64_t, 8, std::less<std::uint64_t>, true>(
+        2000, r_seed);
+    d_ary_heap_test_alignment<std::uint32_t, 16>(2000);
+    d_ary_heap_test_alignment<std::uint64_t, 8>(2000);
+    d_ary_heap_test_alignment<std::uint16_t, 2>(2000);
+
+    d_ary_addressable_int_heap_test_bulk<std::uint8_t, 1>(size, r_seed);
+    d_ary_addressable_int_heap_test_bulk<std::uint8_t, 2>(size, r_seed);
+    d_ary_addressable_int_heap_test_bulk<std::uint16_t, 3>(size, r_seed);
+    d_ary_addressable_int_heap_test_bulk<std::uint32_t, 4>(2000, r_seed);
+    d_ary_addressable_int_heap_test_bulk<std::uint32_t, 13>(2000, r_seed);
+    d_ary_addressable_int_heap_test_bulk<std::uint64_t, 2,
+                                         std::greater<std::uint64_t> >(
+        2000, r_seed);
+
     // Custom compare function.
     std::vector<double> prio(size);
     std::mt19937 gen(r_seed);
@@ -364,6 +631,22 @@ int main()
     d_ary_heap_test_update<std::uint32_t>(size, prio, r_seed);
     d_ary_heap_test_update<std::uint64_t>(size, prio, r_seed);
 
+    // Hash table of handles.
+    using Hash32 = tlx::DAryHeapHashHandles<std::uint32_t>;
+    using Hash64 = tlx::DAryHeapHashHandles<std::uint64_t>;
+    d_ary_addressable_int_heap_test<std::uint32_t, 2, std::less<std::uint32_t>,
+                                    Hash32>(size, r_seed);
+    d_ary_addressable_int_heap_test<std::uint64_t, 4,
+                                    std::greater<std::uint64_t>, Hash64>(
+        size, r_seed);
+    d_ary_addressable_int_heap_test_bulk<std::uint32_t, 4,
+                                         std::less<std::uint32_t>, Hash32>(
+        2000, r_seed);
+    d_ary_heap_test_update<std::uint32_t, 2, Hash32>(size, prio, r_seed);
+    d_ary_heap_test_update<std::uint64_t, 4, Hash64>(size, prio, r_seed);
+    d_ary_heap_test_sparse<2>(2000, r_seed);
+    d_ary_heap_test_sparse<4>(2000, r_seed);
+
     return 0;
 }
 
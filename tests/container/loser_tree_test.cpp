@@ -16,9 +16,11 @@
 #include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <iostream>
 #include <random>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -124,6 +126,22 @@ template class LoserTreePointerUnguarded<false, MyIntPair, MyIntPairCompare>;
 template class LoserTreePointerUnguarded<true, MyIntPair, MyIntPairCompare>;
 template class LoserTreePointerUnguardedBase<MyIntPair, MyIntPairCompare>;
 
+template class LoserTreeInteger<false, std::uint64_t>;
+template class LoserTreeInteger<true, std::int32_t,
+                                std::greater<std::int32_t> >;
+
+template class LoserTreeIntegerUnguarded<false, std::uint64_t>;
+template class LoserTreeIntegerUnguarded<true, std::int32_t,
+                                         std::greater<std::int32_t> >;
+
+static_assert(std::is_same<LoserTree<false, std::uint64_t,
+                                     std::less<std::uint64_t> >,
+                           LoserTreeInteger<false, std::uint64_t> >::value,
+              "LoserTreeSwitch must select LoserTreeInteger");
+static_assert(std::is_same<LoserTree<false, MyInt, MyIntCompare>,
+                           LoserTreeCopy<false, MyInt, MyIntCompare> >::value,
+              "LoserTreeSwitch must select LoserTreeCopy");
+
 } // namespace tlx
 
 /******************************************************************************/
@@ -256,6 +274,107 @@ static void test_losertree()
     die_unequal(ctor_dtor_counter, 0);
 }
 
+/******************************************************************************/
+// test_losertree_integer
+
+//! Merges sequences of integer keys with many ties, and checks the output
+//! order of (key, source) pairs: sorted by key, and by source if stable.
+template <typename LoserTree, typename Compare>
+static inline void test_losertree_integer(bool stable, size_t num_vectors)
+{
+    sLOG1 << "test_losertree_integer:" << stable << num_vectors;
+
+    using Pair = std::pair<std::int64_t, size_t>;
+    std::vector<std::vector<std::int64_t> > vecs(num_vectors);
+    std::vector<Pair> correct;
+
+    std::default_random_engine rng(std::random_device{}());
+
+    for (size_t i = 0; i < num_vectors; ++i)
+    {
+        // vary the length, leave some sequences empty
+        size_t size = rng() % 4 == 0 ? 0 : rng() % 1000;
+        for (size_t j = 0; j < size; ++j)
+        {
+            std::int64_t key = static_cast<std::int64_t>(rng() % 100) - 50;
+            vecs[i].push_back(key);
+            correct.emplace_back(key, i);
+        }
+        std::sort(vecs[i].begin(), vecs[i].end(), Compare());
+    }
+
+    std::sort(correct.begin(), correct.end(),
+              [](const Pair& a, const Pair& b) {
+                  return Compare()(a.first, b.first) ||
+                         (!Compare()(b.first, a.first) && a.second < b.second);
+              });
+
+    LoserTree lt(vecs.size());
+
+    std::vector<size_t> lt_pos(vecs.size(), 0);
+    size_t remaining_inputs = 0;
+
+    for (size_t i = 0; i < vecs.size(); ++i)
+    {
+        if (vecs[i].empty())
+        {
+            lt.insert_start(nullptr, i, true);
+        }
+        else
+        {
+            lt.insert_start(&vecs[i][0], i, false);
+            ++remaining_inputs;
+        }
+    }
+
+    lt.init();
+
+    std::vector<Pair> result;
+
+    while (remaining_inputs != 0)
+    {
+        unsigned top = lt.min_source();
+        result.emplace_back(vecs[top][lt_pos[top]], top);
+
+        if (++lt_pos[top] != vecs[top].size())
+        {
+            lt.delete_min_insert(&vecs[top][lt_pos[top]], false);
+        }
+        else
+        {
+            lt.delete_min_insert(nullptr, true);
+            --remaining_inputs;
+        }
+    }
+
+    die_unequal(result.size(), correct.size());
+    for (size_t i = 0; i < result.size(); ++i)
+    {
+        die_unequal(result[i].first, correct[i].first);
+        if (stable)
+            die_unequal(result[i].second, correct[i].second);
+    }
+}
+
+static void test_losertree_integer()
+{
+    using Less = std::less<std::int64_t>;
+    using Greater = std::greater<std::int64_t>;
+
+    for (size_t n = 0; n <= 70; n += 1 + n / 8)
+    {
+        test_losertree_integer<
+            tlx::LoserTreeInteger<false, std::int64_t, Less>, Less>(
+            /* stable */ false, n);
+        test_losertree_integer<
+            tlx::LoserTreeInteger<true, std::int64_t, Less>, Less>(
+            /* stable */ true, n);
+        test_losertree_integer<
+            tlx::LoserTreeInteger<true, std::int64_t, Greater>, Greater>(
+            /* stable */ true, n);
+    }
+}
+
 /******************************************************************************/
 // benchmark_losertree
 
@@ -380,6 +499,7 @@ int main(int argc, char* argv[])
     if (benchmark.empty())
     {
         test_losertree();
+        test_losertree_integer();
         return 0;
     }
 
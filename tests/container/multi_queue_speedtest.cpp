@@ -0,0 +1,278 @@
+/*******************************************************************************
+ * tests/container/multi_queue_speedtest.cpp
+ *
+ * Part of tlx - http://panthema.net/tlx
+ *
+ * Copyright (C) 2026 Timo Bingmann <tb@panthema.net>
+ *
+ * All rights reserved. Published under the Boost Software License, Version 1.0
+ ******************************************************************************/
+
+#include <tlx/container/d_ary_heap.hpp>
+#include <tlx/container/multi_queue.hpp>
+#include <tlx/die.hpp>
+#include <tlx/timestamp.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// *** Settings
+
+//! number of items in the queue before and during the test
+const size_t prefill_items = 1000000;
+
+//! number of pop-push operation pairs per thread in the throughput test
+const size_t throughput_ops = 1000000;
+
+//! number of pop-push operation pairs per thread in the rank error test
+const size_t rank_ops = 200000;
+
+//! maximum number of threads
+const size_t max_threads = 16;
+
+// -----------------------------------------------------------------------------
+
+//! A single DAryHeap protected by a mutex, as baseline.
+class LockedHeap
+{
+public:
+    explicit LockedHeap(size_t /* num_threads */)
+    {
+    }
+
+    void push(const std::uint64_t& key)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        heap_.push(key);
+    }
+
+    bool try_pop(std::uint64_t& out)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (heap_.empty())
+            return false;
+        out = heap_.extract_top();
+        return true;
+    }
+
+private:
+    std::mutex mutex_;
+    tlx::DAryHeap<std::uint64_t, 4> heap_;
+};
+
+//! MultiQueue with c * p heaps.
+template <size_t C>
+class MultiQueue : public tlx::MultiQueue<std::uint64_t, 4>
+{
+public:
+    explicit MultiQueue(size_t num_threads)
+        : tlx::MultiQueue<std::uint64_t, 4>(num_threads, C)
+    {
+    }
+};
+
+//! One logged queue operation for the rank error replay.
+struct LogEntry
+{
+    //! global sequence number: taken before a push and after a pop
+    size_t seq;
+    //! the key pushed or popped
+    std::uint64_t key;
+    //! true for pop
+    bool pop;
+};
+
+//! Fenwick tree counting the keys in the queue by their compressed rank.
+class RankCounter
+{
+public:
+    explicit RankCounter(size_t n) : tree_(n + 1, 0)
+    {
+    }
+
+    void add(size_t i, long delta)
+    {
+        for (++i; i < tree_.size(); i += i & (~i + 1))
+            tree_[i] += delta;
+    }
+
+    //! number of keys with rank less than i
+    long prefix(size_t i) const
+    {
+        long sum = 0;
+        for (; i > 0; i -= i & (~i + 1))
+            sum += tree_[i];
+        return sum;
+    }
+
+private:
+    std::vector<long> tree_;
+};
+
+/*!
+ * Runs num_threads threads on a queue prefilled with random keys. Each thread
+ * repeatedly pops a key and pushes a larger one, like a label-setting shortest
+ * path search. If log is set, all operations are logged for the rank error.
+ */
+template <typename Queue>
+double run_threads(size_t num_threads, size_t ops,
+                   std::vector<LogEntry>* log = nullptr)
+{
+    Queue queue(num_threads);
+
+    std::mt19937_64 rng(42);
+    for (size_t i = 0; i < prefill_items; ++i)
+    {
+        std::uint64_t key = rng() % (prefill_items * 16);
+        queue.push(key);
+        if (log)
+            log->push_back(LogEntry{0, key, false});
+    }
+
+    std::atomic<size_t> seq{1};
+    std::atomic<size_t> ready{0};
+    std::vector<std::vector<LogEntry> > logs(num_threads);
+    std::vector<std::thread> threads;
+
+    double ts1 = 0;
+    for (size_t t = 0; t < num_threads; ++t)
+    {
+        threads.emplace_back([&, t]() {
+            std::minstd_rand trng(static_cast<unsigned>(t + 1));
+            std::vector<LogEntry>& tlog = logs[t];
+            if (log)
+                tlog.reserve(2 * ops);
+
+            // start all threads together
+            ready.fetch_add(1);
+            while (ready.load() != num_threads)
+                std::this_thread::yield();
+
+            std::uint64_t key;
+            for (size_t i = 0; i < ops; ++i)
+            {
+                die_unless(queue.try_pop(key));
+                if (log)
+                    tlog.push_back(LogEntry{seq.fetch_add(1), key, true});
+
+                key += 1 + trng() % 1024;
+                if (log)
+                    tlog.push_back(LogEntry{seq.fetch_add(1), key, false});
+                queue.push(key);
+            }
+        });
+    }
+
+    while (ready.load() != num_threads)
+        std::this_thread::yield();
+    ts1 = tlx::timestamp();
+    for (size_t t = 0; t < num_threads; ++t)
+        threads[t].join();
+    double ts2 = tlx::timestamp();
+
+    if (log)
+    {
+        for (size_t t = 0; t < num_threads; ++t)
+            log->insert(log->end(), logs[t].begin(), logs[t].end());
+    }
+    return ts2 - ts1;
+}
+
+//! Measures the throughput of pop-push pairs.
+template <typename Queue>
+void test_throughput(size_t num_threads, const std::string& name)
+{
+    double time = run_threads<Queue>(num_threads, throughput_ops);
+    double total_ops = 2.0 * static_cast<double>(num_threads * throughput_ops);
+
+    std::cout << "RESULT"
+              << " container=" << name
+              << " op=throughput"
+              << " threads=" << num_threads
+              << " items=" << prefill_items
+              << " ops=" << static_cast<size_t>(total_ops)
+              << " time=" << std::fixed << std::setprecision(6) << time
+              << " ops_per_sec=" << std::setprecision(0) << total_ops / time
+              << std::endl;
+}
+
+//! Measures the rank error of pops: the number of smaller keys in the queue,
+//! replaying the logged operations in the order of their sequence numbers.
+template <typename Queue>
+void test_rank_error(size_t num_threads, const std::string& name)
+{
+    std::vector<LogEntry> log;
+    run_threads<Queue>(num_threads, rank_ops, &log);
+
+    std::stable_sort(log.begin(), log.end(),
+                     [](const LogEntry& a, const LogEntry& b) {
+                         return a.seq < b.seq;
+                     });
+
+    std::vector<std::uint64_t> keys(log.size());
+    for (size_t i = 0; i < log.size(); ++i)
+        keys[i] = log[i].key;
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    RankCounter counter(keys.size());
+    size_t pops = 0;
+    double rank_sum = 0;
+    long rank_max = 0;
+    for (const LogEntry& e : log)
+    {
+        size_t r = static_cast<size_t>(
+            std::lower_bound(keys.begin(), keys.end(), e.key) - keys.begin());
+        if (!e.pop)
+        {
+            counter.add(r, 1);
+            continue;
+        }
+        long rank = counter.prefix(r);
+        rank_sum += static_cast<double>(rank);
+        rank_max = std::max(rank_max, rank);
+        counter.add(r, -1);
+        ++pops;
+    }
+
+    std::cout << "RESULT"
+              << " container=" << name
+              << " op=rank_error"
+              << " threads=" << num_threads
+              << " items=" << prefill_items
+              << " pops=" << pops
+              << " rank_mean=" << std::fixed << std::setprecision(2)
+              << rank_sum / static_cast<double>(pops)
+              << " rank_max=" << rank_max
+              << std::endl;
+}
+
+//! Speed test them!
+int main()
+{
+    for (size_t threads = 1; threads <= max_threads; threads *= 2)
+    {
+        test_throughput<LockedHeap>(threads, "LockedHeap");
+        test_throughput<MultiQueue<2> >(threads, "MultiQueue c=2");
+        test_throughput<MultiQueue<4> >(threads, "MultiQueue c=4");
+    }
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2)
+    {
+        test_rank_error<LockedHeap>(threads, "LockedHeap");
+        test_rank_error<MultiQueue<2> >(threads, "MultiQueue c=2");
+        test_rank_error<MultiQueue<4> >(threads, "MultiQueue c=4");
+    }
+
+    return 0;
+}
+
+/******************************************************************************/
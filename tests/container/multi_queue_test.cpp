@@ -0,0 +1,165 @@
+/*******************************************************************************
+ * tests/container/multi_queue_test.cpp
+ *
+ * Part of tlx - http://panthema.net/tlx
+ *
+ * Copyright (C) 2026 Timo Bingmann <tb@panthema.net>
+ *
+ * All rights reserved. Published under the Boost Software License, Version 1.0
+ ******************************************************************************/
+
+#include <tlx/container/multi_queue.hpp>
+#include <tlx/die.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <thread>
+#include <vector>
+
+/******************************************************************************/
+// Instantiation Tests
+
+template class tlx::MultiQueue<std::uint32_t>;
+template class tlx::MultiQueue<std::uint64_t, 8, std::greater<std::uint64_t> >;
+
+/******************************************************************************/
+// Sequential Tests
+
+//! Fills and drains the queue from one thread.
+template <unsigned Arity, typename Compare>
+void test_sequential(size_t num_threads, size_t c, size_t size)
+{
+    tlx::MultiQueue<std::uint32_t, Arity, Compare> q(num_threads, c);
+    die_unequal(q.num_queues(), std::max<size_t>(1, c * num_threads));
+    die_unless(q.empty());
+
+    std::uint32_t out;
+    die_if(q.try_pop(out));
+
+    std::vector<std::uint32_t> keys(size);
+    for (size_t i = 0; i < size; ++i)
+        keys[i] = static_cast<std::uint32_t>(i);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+
+    for (const std::uint32_t& key : keys)
+        q.push(key);
+    die_unequal(q.size(), size);
+    die_unless(q.sanity_check());
+
+    std::vector<std::uint32_t> popped;
+    while (q.try_pop(out))
+        popped.push_back(out);
+    die_unless(q.empty() && q.sanity_check());
+    die_unequal(popped.size(), size);
+
+    // a single heap pops in exact order
+    if (q.num_queues() == 1)
+        die_unless(std::is_sorted(popped.begin(), popped.end(), Compare()));
+
+    std::sort(popped.begin(), popped.end());
+    for (size_t i = 0; i < size; ++i)
+        die_unequal(popped[i], i);
+
+    // check clear()
+    for (const std::uint32_t& key : keys)
+        q.push(key);
+    q.clear();
+    die_unless(q.empty() && q.sanity_check());
+    die_if(q.try_pop(out));
+}
+
+//! Checks that pops have small rank, which is the number of smaller keys still
+//! in the queue.
+void test_rank(size_t num_threads, size_t size)
+{
+    tlx::MultiQueue<std::uint32_t> q(num_threads);
+    for (size_t i = 0; i < size; ++i)
+        q.push(static_cast<std::uint32_t>(size - 1 - i));
+
+    // keys still in the queue, and the smallest of them
+    std::vector<bool> present(size, true);
+    size_t low = 0;
+
+    std::uint32_t out;
+    size_t rank_sum = 0;
+    for (size_t i = 0; i < size / 2; ++i)
+    {
+        die_unless(q.try_pop(out));
+        die_unless(present[out]);
+        for (size_t k = low; k < out; ++k)
+            rank_sum += present[k];
+        present[out] = false;
+        while (!present[low])
+            ++low;
+    }
+    // the expected rank is in O(num_queues)
+    die_unless(rank_sum / (size / 2) < 4 * q.num_queues());
+}
+
+/******************************************************************************/
+// Concurrent Tests
+
+//! Threads push distinct keys, pop some of them and push them back, then pop
+//! all. Every key must be popped exactly once at the end.
+void test_concurrent(size_t num_threads, size_t items_per_thread)
+{
+    tlx::MultiQueue<std::uint64_t> q(num_threads);
+
+    std::vector<std::vector<std::uint64_t> > popped(num_threads);
+    std::vector<std::thread> threads;
+
+    for (size_t t = 0; t < num_threads; ++t)
+    {
+        threads.emplace_back([&q, &popped, t, num_threads, items_per_thread]() {
+            std::uint64_t total = num_threads * items_per_thread;
+            for (std::uint64_t k = t; k < total; k += num_threads)
+            {
+                q.push(k);
+                // pop and push back an item from time to time
+                std::uint64_t out;
+                if (k % 3 == 0 && q.try_pop(out))
+                    q.push(out);
+            }
+            std::uint64_t out;
+            while (q.try_pop(out))
+                popped[t].push_back(out);
+        });
+    }
+    for (size_t t = 0; t < num_threads; ++t)
+        threads[t].join();
+
+    // the last thread to finish saw an empty queue
+    die_unless(q.empty() && q.sanity_check());
+
+    std::vector<std::uint64_t> all;
+    for (size_t t = 0; t < num_threads; ++t)
+        all.insert(all.end(), popped[t].begin(), popped[t].end());
+    std::sort(all.begin(), all.end());
+    die_unequal(all.size(), num_threads * items_per_thread);
+    for (size_t i = 0; i < all.size(); ++i)
+        die_unequal(all[i], i);
+}
+
+/******************************************************************************/
+
+int main()
+{
+    test_sequential<2, std::less<std::uint32_t> >(1, 1, 1000);
+    test_sequential<4, std::greater<std::uint32_t> >(1, 1, 1000);
+    test_sequential<4, std::less<std::uint32_t> >(4, 2, 10000);
+    test_sequential<8, std::greater<std::uint32_t> >(8, 4, 10000);
+    test_sequential<4, std::less<std::uint32_t> >(0, 2, 100);
+
+    test_rank(4, 100000);
+    test_rank(16, 100000);
+
+    test_concurrent(2, 20000);
+    test_concurrent(4, 20000);
+    test_concurrent(8, 10000);
+
+    return 0;
+}
+
+/******************************************************************************/
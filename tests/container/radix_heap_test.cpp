@@ -738,6 +738,103 @@ void test_main_radix_heap_pair(std::mt19937& prng)
     }
 }
 
+//! Checks the pooled bucket storage: after reserve() a Dijkstra-like workload
+//! does not allocate, copies and moves keep the items, and shrink_to_fit()
+//! releases the storage.
+template <typename KeyType, unsigned Radix>
+void bucket_storage(std::mt19937& prng, size_t n, size_t rounds)
+{
+    using value_type = std::tuple<KeyType, std::uint32_t>;
+
+    // an assignable key extractor, unlike a lambda
+    struct TupleKeyExtract
+    {
+        KeyType operator()(const value_type& p) const
+        {
+            return std::get<0>(p);
+        }
+    };
+
+    using heap_type =
+        tlx::RadixHeap<value_type, TupleKeyExtract, KeyType, Radix>;
+    heap_type heap;
+
+    die_unequal(heap.capacity(), 0u);
+    die_unequal(heap.num_block_allocations(), 0u);
+
+    heap.reserve(n);
+    const size_t allocations = heap.num_block_allocations();
+    die_unless(heap.capacity() >= n);
+
+    std::uniform_int_distribution<KeyType> distr(0, 1000);
+    typename heap_type::bucket_data_type bucket;
+
+    for (size_t r = 0; r < rounds; ++r)
+    {
+        for (size_t i = 0; i < n; ++i)
+            heap.emplace_keyfirst(distr(prng), static_cast<std::uint32_t>(i));
+
+        // pop the top item and push a larger one, moving the items through
+        // all buckets
+        for (size_t i = 0; i < 4 * n; ++i)
+        {
+            KeyType key = std::get<0>(heap.top());
+            heap.pop();
+            heap.emplace_keyfirst(key + distr(prng),
+                                  static_cast<std::uint32_t>(i));
+        }
+
+        if (r % 2 == 0)
+        {
+            KeyType last = 0;
+            while (!heap.empty())
+            {
+                die_unless(std::get<0>(heap.top()) >= last);
+                last = std::get<0>(heap.top());
+                heap.pop();
+            }
+        }
+        else
+        {
+            while (!heap.empty())
+            {
+                bucket.clear();
+                heap.swap_top_bucket(bucket);
+            }
+        }
+        // reset the insertion limit
+        heap.clear();
+        die_unequal(heap.num_block_allocations(), allocations);
+    }
+
+    // copies and moves keep all items
+    for (size_t i = 0; i < n; ++i)
+        heap.emplace_keyfirst(distr(prng), static_cast<std::uint32_t>(i));
+    heap_type copy(heap);
+    heap_type moved(std::move(copy));
+    die_unless(copy.empty());
+    copy = moved;
+    die_unequal(copy.size(), n);
+    while (!heap.empty())
+    {
+        die_unequal(std::get<0>(copy.top()), std::get<0>(heap.top()));
+        die_unequal(std::get<0>(moved.top()), std::get<0>(heap.top()));
+        copy.pop(), moved.pop(), heap.pop();
+    }
+    die_unless(copy.empty() && moved.empty());
+
+    heap.shrink_to_fit();
+    die_unequal(heap.capacity(), 0u);
+}
+
+void test_main_bucket_storage(std::mt19937& prng)
+{
+    bucket_storage<std::uint32_t, 2>(prng, 10000, 4);
+    bucket_storage<std::uint32_t, 64>(prng, 10000, 4);
+    bucket_storage<std::uint64_t, 8>(prng, 1000, 4);
+    bucket_storage<std::int64_t, 8>(prng, 100000, 2);
+}
+
 /******************************************************************************/
 
 int main()
@@ -748,6 +845,7 @@ int main()
     test_main_int_rank(prng);
     test_main_bucket(prng);
     test_main_radix_heap_pair(prng);
+    test_main_bucket_storage(prng);
 
     return 0;
 }
@@ -0,0 +1,140 @@
+/*******************************************************************************
+ * tests/container/sequence_heap_test.cpp
+ *
+ * Part of tlx - http://panthema.net/tlx
+ *
+ * Copyright (C) 2026 Timo Bingmann <tb@panthema.net>
+ *
+ * All rights reserved. Published under the Boost Software License, Version 1.0
+ ******************************************************************************/
+
+#include <tlx/container/sequence_heap.hpp>
+#include <tlx/die.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+/******************************************************************************/
+// Instantiation Tests
+
+template class tlx::SequenceHeap<std::uint32_t>;
+template class tlx::SequenceHeap<std::string, std::greater<std::string> >;
+
+/******************************************************************************/
+
+//! Pushes random keys and pops them all. Small buffers and arity create many
+//! groups.
+template <typename Compare>
+void test_push_pop(size_t size, size_t insert_heap_size, size_t group_arity)
+{
+    tlx::SequenceHeap<std::uint32_t, Compare> heap(
+        Compare(), insert_heap_size, group_arity);
+    die_unless(heap.empty());
+
+    std::mt19937 rng(42);
+    std::vector<std::uint32_t> keys(size);
+    for (size_t i = 0; i < size; ++i)
+    {
+        keys[i] = static_cast<std::uint32_t>(rng() % (size / 2 + 1));
+        heap.push(keys[i]);
+    }
+    die_unequal(heap.size(), size);
+    die_unless(heap.sanity_check());
+
+    std::sort(keys.begin(), keys.end(), Compare());
+    for (size_t i = 0; i < size; ++i)
+    {
+        die_unequal(heap.top(), keys[i]);
+        die_unequal(heap.extract_top(), keys[i]);
+        if (i % 997 == 0)
+            die_unless(heap.sanity_check());
+    }
+    die_unless(heap.empty() && heap.sanity_check());
+}
+
+//! Interleaves pushes and pops and compares with std::priority_queue.
+void test_mixed(size_t ops, size_t insert_heap_size, size_t group_arity)
+{
+    tlx::SequenceHeap<std::uint64_t> heap(
+        std::less<std::uint64_t>(), insert_heap_size, group_arity);
+    std::priority_queue<std::uint64_t, std::vector<std::uint64_t>,
+                        std::greater<std::uint64_t> > pq;
+
+    std::mt19937_64 rng(1234);
+    for (size_t i = 0; i < ops; ++i)
+    {
+        // grow in the first half, shrink in the second
+        size_t r = rng() % 8;
+        bool push = pq.empty() || (i < ops / 2 ? r < 5 : r < 3);
+        if (push)
+        {
+            // keys grow over time, like in Dijkstra's algorithm, with some
+            // smaller than the current top
+            std::uint64_t key = i + rng() % 4096;
+            heap.push(key);
+            pq.push(key);
+        }
+        else
+        {
+            die_unequal(heap.top(), pq.top());
+            heap.pop();
+            pq.pop();
+        }
+        die_unequal(heap.size(), pq.size());
+        if (i % 4999 == 0)
+            die_unless(heap.sanity_check());
+    }
+    die_unless(heap.sanity_check());
+
+    while (!pq.empty())
+    {
+        die_unequal(heap.extract_top(), pq.top());
+        pq.pop();
+    }
+    die_unless(heap.empty() && heap.sanity_check());
+}
+
+//! Checks that keys move through the groups and clear().
+void test_groups()
+{
+    tlx::SequenceHeap<std::uint32_t> heap(std::less<std::uint32_t>(), 16, 4);
+    for (std::uint32_t i = 0; i < 10000; ++i)
+        heap.push(10000 - i);
+    // 10000 keys in runs of 16 * 4^i items with 4 runs per group
+    die_unless(heap.num_groups() >= 4);
+    die_unless(heap.sanity_check());
+    die_unequal(heap.top(), 1u);
+
+    heap.clear();
+    die_unless(heap.empty() && heap.sanity_check());
+    heap.push(5);
+    heap.push(3);
+    die_unequal(heap.extract_top(), 3u);
+    die_unequal(heap.extract_top(), 5u);
+    die_unless(heap.empty());
+}
+
+/******************************************************************************/
+
+int main()
+{
+    test_push_pop<std::less<std::uint32_t> >(1000, 4096, 64);
+    test_push_pop<std::less<std::uint32_t> >(100000, 16, 4);
+    test_push_pop<std::greater<std::uint32_t> >(100000, 64, 2);
+    test_push_pop<std::less<std::uint32_t> >(500000, 1024, 8);
+
+    test_mixed(200000, 8, 2);
+    test_mixed(200000, 32, 4);
+    test_mixed(1000000, 256, 16);
+
+    test_groups();
+
+    return 0;
+}
+
+/******************************************************************************/
@@ -0,0 +1,159 @@
+/*******************************************************************************
+ * tests/slab_allocator_test.cpp
+ *
+ * Part of tlx - http://panthema.net/tlx
+ *
+ * Copyright (C) 2026 Timo Bingmann <tb@panthema.net>
+ *
+ * All rights reserved. Published under the Boost Software License, Version 1.0
+ ******************************************************************************/
+
+#include <tlx/die.hpp>
+#include <tlx/slab_allocator.hpp>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace tlx {
+
+// forced instantiations
+template class SlabAllocator<int>;
+
+} // namespace tlx
+
+static void test_arena()
+{
+    tlx::SlabArena arena(4096, /* huge_pages */ false);
+    die_unequal(arena.slab_size(), 4096U);
+    die_unequal(arena.bytes_reserved(), 0U);
+
+    // blocks are carved from one slab and rounded to the alignment
+    std::vector<void*> blocks;
+    for (size_t i = 0; i < 100; ++i)
+        blocks.push_back(arena.allocate(24));
+    die_unequal(arena.bytes_used(), 100U * 32);
+    die_unequal(arena.num_slabs(), 1U);
+    die_unequal(arena.bytes_reserved(), 4096U);
+
+    // all blocks are disjoint and aligned
+    std::set<void*> distinct(blocks.begin(), blocks.end());
+    die_unequal(distinct.size(), blocks.size());
+    for (void* p : blocks)
+        die_unless(reinterpret_cast<uintptr_t>(p) % 16 == 0);
+
+    // freed blocks are recycled for the same size, last freed first
+    void* last = blocks.back();
+    for (void* p : blocks)
+        arena.deallocate(p, 24);
+    die_unequal(arena.bytes_used(), 0U);
+    die_unequal(arena.allocate(32), last);
+    die_unequal(arena.num_slabs(), 1U);
+
+    // a different size gets its own free list and more slabs
+    for (size_t i = 0; i < 100; ++i)
+        arena.allocate(48);
+    die_unequal(arena.num_slabs(), 2U);
+    die_unequal(arena.bytes_used(), 32U + 100U * 48);
+
+    // large blocks bypass the pool
+    void* large = arena.allocate(2000);
+    die_unequal(arena.bytes_reserved(), 2U * 4096 + 2000);
+    arena.deallocate(large, 2000);
+    die_unequal(arena.bytes_reserved(), 2U * 4096);
+}
+
+static void test_containers()
+{
+    using IntAlloc = tlx::SlabAllocator<int>;
+    using PairAlloc = tlx::SlabAllocator<std::pair<const int, int> >;
+
+    {
+        IntAlloc alloc;
+        std::list<int, IntAlloc> my_list(alloc);
+        for (int i = 0; i < 10000; ++i)
+            my_list.push_back(i);
+        die_unless(alloc.bytes_used() >= 10000 * sizeof(int));
+
+        int i = 0;
+        for (const int& x : my_list)
+            die_unequal(i++, x);
+
+        // erasing and refilling reuses the freed list nodes
+        size_t reserved = alloc.bytes_reserved();
+        for (int j = 0; j < 5000; ++j)
+            my_list.pop_front();
+        for (int j = 0; j < 5000; ++j)
+            my_list.push_back(j);
+        die_unequal(reserved, alloc.bytes_reserved());
+
+        my_list.clear();
+        die_unequal(alloc.bytes_used(), 0U);
+    }
+    {
+        // vectors allocate arrays, which are larger than the pooled sizes
+        std::vector<int, IntAlloc> my_vector;
+        for (int i = 0; i < 100000; ++i)
+            my_vector.push_back(i);
+        for (int i = 0; i < 100000; ++i)
+            die_unequal(i, my_vector[i]);
+    }
+    {
+        // share one arena between two maps
+        tlx::CountingPtr<tlx::SlabArena> arena =
+            tlx::make_counting<tlx::SlabArena>();
+        using Map = std::map<int, int, std::less<int>, PairAlloc>;
+        Map map1((std::less<int>()), PairAlloc(arena));
+        Map map2((std::less<int>()), PairAlloc(arena));
+        die_unless(map1.get_allocator() == map2.get_allocator());
+        for (int i = 0; i < 1000; ++i)
+        {
+            map1[i] = i;
+            map2[-i] = i;
+        }
+        die_unequal(arena->num_slabs(), 1U);
+        map1.clear();
+        map2.clear();
+        die_unequal(arena->bytes_used(), 0U);
+    }
+}
+
+static void test_threads()
+{
+    tlx::SlabArena arena(64 * 1024);
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&arena, t]() {
+            std::vector<void*> blocks;
+            for (size_t r = 0; r < 10; ++r)
+            {
+                for (size_t i = 0; i < 1000; ++i)
+                    blocks.push_back(arena.allocate(16 + 16 * (t % 2)));
+                for (void* p : blocks)
+                    arena.deallocate(p, 16 + 16 * (t % 2));
+                blocks.clear();
+            }
+        });
+    }
+    for (std::thread& t : threads)
+        t.join();
+
+    die_unequal(arena.bytes_used(), 0U);
+}
+
+int main()
+{
+    test_arena();
+    test_containers();
+    test_threads();
+
+    return 0;
+}
+
+/******************************************************************************/
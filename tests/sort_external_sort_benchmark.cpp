@@ -0,0 +1,149 @@
+/*******************************************************************************
+ * tests/sort_external_sort_benchmark.cpp
+ *
+ * Part of tlx - http://panthema.net/tlx
+ *
+ * Copyright (C) 2026 Timo Bingmann <tb@panthema.net>
+ *
+ * All rights reserved. Published under the Boost Software License, Version 1.0
+ ******************************************************************************/
+
+#include <tlx/algorithm/multiway_merge_stream.hpp>
+#include <tlx/cmdline_parser.hpp>
+#include <tlx/die.hpp>
+#include <tlx/sort/external_sort.hpp>
+#include <tlx/timestamp.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+
+//! 16 byte record sorted by its key.
+struct Record
+{
+    std::uint64_t key;
+    std::uint64_t value;
+};
+
+struct RecordCompare
+{
+    bool operator()(const Record& a, const Record& b) const
+    {
+        return a.key < b.key;
+    }
+};
+
+//! Sink checking the order, and optionally writing to a file.
+class CheckSink
+{
+public:
+    using value_type = Record;
+
+    explicit CheckSink(const std::string& path)
+    {
+        if (!path.empty())
+            die_unless(file_.open(path));
+    }
+
+    void write(const Record* data, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            die_unless(last_ <= data[i].key);
+            last_ = data[i].key;
+        }
+        if (file_.is_open())
+            die_unless(file_.write(data, size * sizeof(Record)));
+    }
+
+    bool close()
+    {
+        return file_.close();
+    }
+
+private:
+    std::uint64_t last_ = 0;
+    tlx::FileBlockWriter file_;
+};
+
+int main(int argc, char* argv[])
+{
+    std::uint64_t size = 1024 * 1024 * 1024;
+    std::uint64_t memory = 128 * 1024 * 1024;
+    std::uint64_t block_bytes = 1024 * 1024;
+    std::string temp_dir = ".", output;
+    size_t num_threads = std::thread::hardware_concurrency();
+    unsigned int repeat = 1;
+
+    tlx::CmdlineParser cp;
+    cp.set_description(
+        "TLX ExternalSorter benchmark: sorts random 16 byte records and "
+        "reports the I/O volume and throughput.");
+
+    cp.add_bytes('s', "size", size, "total size of records, default 1 GiB");
+    cp.add_bytes('M', "memory", memory, "memory limit, default 128 MiB");
+    cp.add_bytes('B', "block", block_bytes, "I/O block size, default 1 MiB");
+    cp.add_string('T', "temp", temp_dir, "directory for temporary files");
+    cp.add_string('o', "output", output, "write sorted records to this file");
+    cp.add_size_t('t', "threads", num_threads,
+                  "number of threads sorting runs");
+    cp.add_unsigned('R', "repeat", repeat, "number of repetitions");
+
+    if (!cp.process(argc, argv))
+        return EXIT_FAILURE;
+
+    const std::uint64_t num_items = size / sizeof(Record);
+
+    for (unsigned int r = 0; r < repeat; ++r)
+    {
+        tlx::ExternalSorter<Record, RecordCompare> sorter(
+            memory, temp_dir, RecordCompare(), block_bytes, num_threads);
+
+        double ts1 = tlx::timestamp();
+
+        std::mt19937_64 rng(r);
+        for (std::uint64_t i = 0; i < num_items; ++i)
+            sorter.push(Record{ rng(), i });
+
+        double ts2 = tlx::timestamp();
+
+        CheckSink sink(output);
+        die_unequal(sorter.finish(sink), num_items);
+        die_unless(sink.close());
+        die_unless(sorter.good());
+
+        double ts3 = tlx::timestamp();
+
+        std::uint64_t io_bytes = sorter.bytes_written() + sorter.bytes_read();
+        double total_bytes = static_cast<double>(num_items * sizeof(Record));
+
+        std::cout << "RESULT"
+                  << " items=" << num_items                         //
+                  << " bytes=" << num_items * sizeof(Record)        //
+                  << " memory=" << memory                           //
+                  << " block_bytes=" << block_bytes                 //
+                  << " num_threads=" << num_threads                 //
+                  << " runs=" << sorter.num_runs()                  //
+                  << " fan_in=" << sorter.fan_in()                  //
+                  << " passes=" << sorter.num_passes()              //
+                  << " bytes_written=" << sorter.bytes_written()    //
+                  << " bytes_read=" << sorter.bytes_read()          //
+                  << " io_bytes=" << io_bytes                       //
+                  << " run_time=" << (ts2 - ts1)                    //
+                  << " merge_time=" << (ts3 - ts2)                  //
+                  << " time=" << (ts3 - ts1)                        //
+                  << " throughput[MiB/s]="                          //
+                  << total_bytes / (ts3 - ts1) / 1024 / 1024        //
+                  << " io_throughput[MiB/s]="                       //
+                  << static_cast<double>(io_bytes) / (ts3 - ts1) / 1024 /
+                         1024
+                  << '\n';
+    }
+
+    return 0;
+}
+
+/******************************************************************************/
@@ -0,0 +1,249 @@
+/*******************************************************************************
+ * tests/sort_external_sort_test.cpp
+ *
+ * Part of tlx - http://panthema.net/tlx
+ *
+ * Copyright (C) 2026 Timo Bingmann <tb@panthema.net>
+ *
+ * All rights reserved. Published under the Boost Software License, Version 1.0
+ ******************************************************************************/
+
+#include <tlx/algorithm/multiway_merge_stream.hpp>
+#include <tlx/die.hpp>
+#include <tlx/logger.hpp>
+#include <tlx/sort/external_sort.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/******************************************************************************/
+// Instantiation Tests
+
+template class tlx::ExternalSorter<std::uint32_t>;
+template class tlx::ExternalSorter<double, std::greater<double> >;
+
+/******************************************************************************/
+
+//! Record with a key, and an index and checksum which are ignored when
+//! comparing.
+struct Record
+{
+    std::uint64_t key;
+    std::uint32_t index;
+    std::uint32_t check;
+};
+
+struct RecordCompare
+{
+    bool operator()(const Record& a, const Record& b) const
+    {
+        return a.key < b.key;
+    }
+};
+
+//! Sink appending to a vector.
+template <typename ValueType>
+class VectorSink
+{
+public:
+    using value_type = ValueType;
+
+    explicit VectorSink(size_t block_size) : block_size_(block_size)
+    {
+    }
+
+    void write(const ValueType* data, size_t size)
+    {
+        die_unless(size > 0 && size <= block_size_);
+        output.insert(output.end(), data, data + size);
+    }
+
+    std::vector<ValueType> output;
+
+private:
+    size_t block_size_;
+};
+
+//! Sorts random records with the given memory limit and block size, and
+//! checks the output and the number of merge passes.
+void test_records(size_t size, size_t memory_limit, size_t block_bytes,
+                  size_t num_threads, size_t expected_passes)
+{
+    tlx::ExternalSorter<Record, RecordCompare> sorter(
+        memory_limit, ".", RecordCompare(), block_bytes, num_threads);
+
+    std::mt19937_64 rng(size + memory_limit);
+    std::vector<Record> correct(size);
+    for (size_t i = 0; i < size; ++i)
+    {
+        // few distinct keys, with a checksum of key and index
+        std::uint64_t key = rng() % (size / 4 + 1);
+        correct[i] = Record{ key, static_cast<std::uint32_t>(i),
+                             static_cast<std::uint32_t>(key * 7 + i) };
+        sorter.push(correct[i]);
+    }
+    die_unequal(sorter.size(), size);
+
+    VectorSink<Record> sink(block_bytes / sizeof(Record));
+    die_unequal(sorter.finish(sink), size);
+    die_unless(sorter.good());
+    die_unequal(sorter.size(), 0u);
+
+    LOG0 << "test_records size=" << size << " runs=" << sorter.num_runs()
+         << " fan_in=" << sorter.fan_in() << " passes=" << sorter.num_passes()
+         << " written=" << sorter.bytes_written()
+         << " read=" << sorter.bytes_read();
+
+    die_unequal(sorter.num_passes(), expected_passes);
+    // runs left alone in a merge pass are not read and written again
+    die_unequal(sorter.bytes_written(), sorter.bytes_read());
+    die_unless(sorter.bytes_written() <=
+               (1 + sorter.num_passes()) * size * sizeof(Record));
+    if (sorter.num_runs() != 0)
+        die_unless(sorter.bytes_written() >= size * sizeof(Record));
+
+    die_unequal(sink.output.size(), size);
+    die_unless(std::is_sorted(sink.output.begin(), sink.output.end(),
+                              RecordCompare()));
+
+    // the same records by their unique index
+    std::vector<bool> seen(size);
+    for (const Record& r : sink.output)
+    {
+        die_unequal(r.check, static_cast<std::uint32_t>(r.key * 7 + r.index));
+        die_if(seen[r.index]);
+        seen[r.index] = true;
+        die_unequal(r.key, correct[r.index].key);
+    }
+}
+
+//! Sorts into a file and reads it back, twice with the same sorter.
+void test_file_sink()
+{
+    tlx::ExternalSorter<std::uint32_t, std::greater<std::uint32_t> > sorter(
+        16 * 1024, ".", std::greater<std::uint32_t>(), 1024, 2);
+
+    const std::string path = "sort_external_sort_test.out";
+    std::mt19937 rng(42);
+    for (size_t round = 0; round < 2; ++round)
+    {
+        std::vector<std::uint32_t> correct(100000 + round * 12345);
+        for (std::uint32_t& x : correct)
+        {
+            x = static_cast<std::uint32_t>(rng());
+            sorter.push(x);
+        }
+        std::sort(correct.begin(), correct.end(),
+                  std::greater<std::uint32_t>());
+
+        {
+            tlx::FileBlockSink<std::uint32_t> sink(path);
+            die_unless(sink.good());
+            die_unequal(sorter.finish(sink), correct.size());
+            die_unless(sink.close());
+        }
+        die_unless(sorter.good());
+
+        std::vector<std::uint32_t> output(correct.size() + 1);
+        tlx::FileBlockSource<std::uint32_t> source(path);
+        die_unless(source.good());
+        die_unequal(source.read(output.data(), output.size()),
+                    correct.size());
+        output.pop_back();
+        die_unless(output == correct);
+    }
+    std::remove(path.c_str());
+}
+
+//! Reports an error for a missing temporary directory.
+void test_missing_dir()
+{
+    tlx::ExternalSorter<std::uint64_t> sorter(
+        1024, "sort_external_sort_test.missing/dir");
+    for (std::uint64_t i = 0; i < 1000; ++i)
+        sorter.push(i);
+    die_if(sorter.good());
+    sorter.clear();
+}
+
+#if !defined(_WIN32)
+//! Truncates the first run file to two items before finish(), which must
+//! report the lost items, in a merge pass or in the final merge.
+void test_truncated_run(size_t size, size_t memory_limit,
+                        size_t expected_passes)
+{
+    const std::string dir = "sort_external_sort_test.tmp";
+    die_unless(mkdir(dir.c_str(), 0755) == 0 || errno == EEXIST);
+
+    tlx::ExternalSorter<std::uint64_t> sorter(
+        memory_limit, dir, std::less<std::uint64_t>(), 6144, 2);
+    for (std::uint64_t i = 0; i < size; ++i)
+        sorter.push(size - i);
+
+    // the first run is complete, since the second one is being written.
+    std::string first;
+    DIR* d = opendir(dir.c_str());
+    die_unless(d);
+    while (struct dirent* entry = readdir(d))
+    {
+        std::string name = entry->d_name;
+        if (name.size() > 2 && name.compare(name.size() - 2, 2, "_0") == 0)
+            first = dir + "/" + name;
+    }
+    closedir(d);
+    die_if(first.empty());
+    die_unequal(truncate(first.c_str(), 2 * sizeof(std::uint64_t)), 0);
+
+    VectorSink<std::uint64_t> sink(6144 / sizeof(std::uint64_t));
+    die_unless(sorter.finish(sink) < size);
+    die_if(sorter.good());
+    die_unequal(sorter.num_passes(), expected_passes);
+
+    // all temporary files are removed
+    die_unequal(rmdir(dir.c_str()), 0);
+}
+#endif
+
+/******************************************************************************/
+
+int main()
+{
+    // empty and in memory
+    test_records(0, 96 * 1024, 6144, 4, 0);
+    test_records(1000, 96 * 1024, 6144, 4, 0);
+
+    // runs of 2048 records, fan-in of 13 runs
+    test_records(2048 * 13, 96 * 1024, 6144, 4, 0);
+    test_records(2048 * 13 + 1, 96 * 1024, 6144, 1, 1);
+    test_records(2048 * 13 * 13, 96 * 1024, 6144, 4, 1);
+    test_records(2048 * 13 * 13 + 1000, 96 * 1024, 6144, 3, 2);
+
+    // runs of 20 records, fan-in of two runs
+    test_records(50000, 1000, 4096, 2, 11);
+
+    test_file_sink();
+    test_missing_dir();
+
+#if !defined(_WIN32)
+    // three runs of 4096 items in the final merge
+    test_truncated_run(3 * 4096, 96 * 1024, 0);
+    // 24 runs of 42 items, fan-in of two runs
+    test_truncated_run(1000, 1024, 4);
+#endif
+
+    return 0;
+}
+
+/******************************************************************************/
@@ -27,6 +27,7 @@ foreach (sort glob("tlx/algorithm/"."*.hpp")) {
 #include <tlx/algorithm/multisequence_selection.hpp> // NOLINT(misc-include-cleaner)
 #include <tlx/algorithm/multiway_merge.hpp> // NOLINT(misc-include-cleaner)
 #include <tlx/algorithm/multiway_merge_splitting.hpp> // NOLINT(misc-include-cleaner)
+#include <tlx/algorithm/multiway_merge_stream.hpp> // NOLINT(misc-include-cleaner)
 #include <tlx/algorithm/parallel_multiway_merge.hpp> // NOLINT(misc-include-cleaner)
 #include <tlx/algorithm/random_bipartition_shuffle.hpp> // NOLINT(misc-include-cleaner)
 // [[[end]]]
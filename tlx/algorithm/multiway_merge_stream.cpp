@@ -0,0 +1,251 @@
+/*******************************************************************************
+ * tlx/algorithm/multiway_merge_stream.cpp
+ *
+ * Part of tlx - http://panthema.net/tlx
+ *
+ * Copyright (C) 2026 Timo Bingmann <tb@panthema.net>
+ *
+ * All rights reserved. Published under the Boost Software License, Version 1.0
+ ******************************************************************************/
+
+#include <tlx/algorithm/multiway_merge_stream.hpp>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace tlx {
+
+/******************************************************************************/
+// FileBlockReader
+
+FileBlockReader::FileBlockReader(FileBlockReader&& other) noexcept
+    : fd_(other.fd_), stream_(other.stream_), offset_(other.offset_),
+      prefetch_(other.prefetch_), error_(other.error_)
+{
+    other.fd_ = -1;
+    other.stream_ = nullptr;
+}
+
+FileBlockReader& FileBlockReader::operator=(FileBlockReader&& other) noexcept
+{
+    if (this == &other)
+        return *this;
+    close();
+    fd_ = other.fd_;
+    stream_ = other.stream_;
+    offset_ = other.offset_;
+    prefetch_ = other.prefetch_;
+    error_ = other.error_;
+    other.fd_ = -1;
+    other.stream_ = nullptr;
+    return *this;
+}
+
+FileBlockReader::~FileBlockReader()
+{
+    close();
+}
+
+bool FileBlockReader::open(const std::string& path, size_t prefetch)
+{
+    close();
+    offset_ = 0;
+    prefetch_ = prefetch;
+    error_ = false;
+
+#if !defined(_WIN32)
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0)
+        return false;
+#if defined(POSIX_FADV_SEQUENTIAL)
+    // read ahead more aggressively, and prefetch the first block
+    posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+    posix_fadvise(fd_, 0, static_cast<off_t>(prefetch_), POSIX_FADV_WILLNEED);
+#endif
+    return true;
+#else
+    std::ifstream* in = new std::ifstream(path.c_str(), std::ios::binary);
+    if (!in->good())
+    {
+        delete in;
+        return false;
+    }
+    stream_ = in;
+    return true;
+#endif
+}
+
+size_t FileBlockReader::read(void* data, size_t size)
+{
+    if (!good())
+        return 0;
+
+#if !defined(_WIN32)
+    char* cdata = static_cast<char*>(data);
+    size_t done = 0;
+    while (done < size)
+    {
+        ssize_t r = ::read(fd_, cdata + done, size - done);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r < 0)
+        {
+            error_ = true;
+            break;
+        }
+        if (r == 0)
+            break;
+        done += static_cast<size_t>(r);
+    }
+    offset_ += done;
+#if defined(POSIX_FADV_WILLNEED)
+    // let the kernel fetch the next block while this one is processed
+    if (done == size && prefetch_ != 0)
+    {
+        posix_fadvise(fd_, static_cast<off_t>(offset_),
+                      static_cast<off_t>(prefetch_), POSIX_FADV_WILLNEED);
+    }
+#endif
+    return done;
+#else
+    std::ifstream* in = static_cast<std::ifstream*>(stream_);
+    in->read(static_cast<char*>(data), static_cast<std::streamsize>(size));
+    size_t done = static_cast<size_t>(in->gcount());
+    if (in->bad())
+        error_ = true;
+    offset_ += done;
+    return done;
+#endif
+}
+
+void FileBlockReader::close()
+{
+#if !defined(_WIN32)
+    if (fd_ >= 0)
+        ::close(fd_);
+#else
+    delete static_cast<std::ifstream*>(stream_);
+#endif
+    fd_ = -1;
+    stream_ = nullptr;
+}
+
+bool FileBlockReader::is_open() const noexcept
+{
+    return fd_ >= 0 || stream_ != nullptr;
+}
+
+/******************************************************************************/
+// FileBlockWriter
+
+FileBlockWriter::FileBlockWriter(FileBlockWriter&& other) noexcept
+    : fd_(other.fd_), stream_(other.stream_), error_(other.error_)
+{
+    other.fd_ = -1;
+    other.stream_ = nullptr;
+}
+
+FileBlockWriter& FileBlockWriter::operator=(FileBlockWriter&& other) noexcept
+{
+    if (this == &other)
+        return *this;
+    close();
+    fd_ = other.fd_;
+    stream_ = other.stream_;
+    error_ = other.error_;
+    other.fd_ = -1;
+    other.stream_ = nullptr;
+    return *this;
+}
+
+FileBlockWriter::~FileBlockWriter()
+{
+    close();
+}
+
+bool FileBlockWriter::open(const std::string& path)
+{
+    close();
+    error_ = false;
+
+#if !defined(_WIN32)
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    return fd_ >= 0;
+#else
+    std::ofstream* out = new std::ofstream(
+        path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out->good())
+    {
+        delete out;
+        return false;
+    }
+    stream_ = out;
+    return true;
+#endif
+}
+
+bool FileBlockWriter::write(const void* data, size_t size)
+{
+    if (!good())
+        return false;
+
+#if !defined(_WIN32)
+    const char* cdata = static_cast<const char*>(data);
+    size_t done = 0;
+    while (done < size)
+    {
+        ssize_t r = ::write(fd_, cdata + done, size - done);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+        {
+            error_ = true;
+            return false;
+        }
+        done += static_cast<size_t>(r);
+    }
+    return true;
+#else
+    std::ofstream* out = static_cast<std::ofstream*>(stream_);
+    if (!out->write(static_cast<const char*>(data),
+                    static_cast<std::streamsize>(size)))
+        error_ = true;
+    return !error_;
+#endif
+}
+
+bool FileBlockWriter::close()
+{
+    if (!is_open())
+        return !error_;
+
+#if !defined(_WIN32)
+    if (::close(fd_) != 0)
+        error_ = true;
+#else
+    std::ofstream* out = static_cast<std::ofstream*>(stream_);
+    out->close();
+    if (out->fail())
+        error_ = true;
+    delete out;
+#endif
+    fd_ = -1;
+    stream_ = nullptr;
+    return !error_;
+}
+
+bool FileBlockWriter::is_open() const noexcept
+{
+    return fd_ >= 0 || stream_ != nullptr;
+}
+
+} // namespace tlx
+
+/******************************************************************************/
@@ -0,0 +1,426 @@
+/*******************************************************************************
+ * tlx/algorithm/multiway_merge_stream.hpp
+ *
+ * Multiway merge of sorted streams which deliver their items in blocks.
+ *
+ * Part of tlx - http://panthema.net/tlx
+ *
+ * Copyright (C) 2026 Timo Bingmann <tb@panthema.net>
+ *
+ * All rights reserved. Published under the Boost Software License, Version 1.0
+ ******************************************************************************/
+
+#ifndef TLX_ALGORITHM_MULTIWAY_MERGE_STREAM_HEADER
+#define TLX_ALGORITHM_MULTIWAY_MERGE_STREAM_HEADER
+
+#include <tlx/algorithm/multiway_merge.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tlx {
+
+//! \addtogroup tlx_algorithm
+//! \{
+
+namespace multiway_merge_detail {
+
+/*!
+ * Streaming multiway merge, see multiway_merge_stream().
+ *
+ * Each round merges those items of the current input blocks, which no later
+ * block can undercut: all items not greater than the splitter, which is the
+ * smallest last item of the blocks. The block holding the splitter, the first
+ * one if several do, is merged completely, and is refilled afterwards. If
+ * Stable, items equal to the splitter from later sources are held back until
+ * the splitter's source has no more of them.
+ */
+template <bool Stable, typename SourceIterator, typename Sink,
+          typename Comparator>
+std::uint64_t multiway_merge_stream_base(SourceIterator sources_begin,
+                                         SourceIterator sources_end,
+                                         Sink& sink, size_t block_size,
+                                         Comparator comp,
+                                         MultiwayMergeAlgorithm mwma)
+{
+    using Source = typename std::iterator_traits<SourceIterator>::value_type;
+    using value_type = typename Source::value_type;
+    using block_iterator = typename std::vector<value_type>::iterator;
+    using iterator_pair = std::pair<block_iterator, block_iterator>;
+
+    assert(block_size > 0);
+    const size_t k = static_cast<size_t>(sources_end - sources_begin);
+
+    //! current block of each source, and the range of unmerged items
+    struct Input
+    {
+        std::vector<value_type> block;
+        size_t pos, end;
+    };
+    std::vector<Input> inputs(k);
+
+    // fetch the next block of source i, returns false if it is finished.
+    auto refill = [&](size_t i) {
+        Input& in = inputs[i];
+        in.block.resize(block_size);
+        in.pos = 0;
+        in.end = sources_begin[i].read(in.block.data(), block_size);
+        assert(in.end <= block_size);
+        if (in.end == 0)
+        {
+            // release the block of finished sources
+            std::vector<value_type>().swap(in.block);
+            return false;
+        }
+        return true;
+    };
+
+    // indexes of sources which are not finished, in ascending order.
+    std::vector<size_t> active;
+    active.reserve(k);
+    for (size_t i = 0; i < k; ++i)
+    {
+        if (refill(i))
+            active.push_back(i);
+    }
+
+    std::vector<value_type> out(block_size);
+    size_t out_fill = 0;
+    std::uint64_t total = 0;
+
+    std::vector<iterator_pair> seqs;
+    seqs.reserve(k);
+
+    while (!active.empty())
+    {
+        // the splitter is the smallest last item, on the first such source.
+        size_t m = active[0];
+        for (size_t j = 1; j < active.size(); ++j)
+        {
+            size_t i = active[j];
+            if (comp(inputs[i].block[inputs[i].end - 1],
+                     inputs[m].block[inputs[m].end - 1]))
+                m = i;
+        }
+        const value_type& splitter = inputs[m].block[inputs[m].end - 1];
+
+        // select the items which may be merged
+        seqs.clear();
+        size_t avail = 0;
+        for (size_t i : active)
+        {
+            Input& in = inputs[i];
+            block_iterator begin = in.block.begin() + in.pos;
+            block_iterator end = in.block.begin() + in.end;
+            // all items of the splitter's block are merged
+            if (Stable && i > m)
+                end = std::lower_bound(begin, end, splitter, comp);
+            else if (i != m)
+                end = std::upper_bound(begin, end, splitter, comp);
+            seqs.emplace_back(begin, end);
+            avail += static_cast<size_t>(end - begin);
+        }
+
+        // merge them in pieces which fit into the output block
+        while (avail != 0)
+        {
+            size_t n = std::min(avail, block_size - out_fill);
+            multiway_merge_base<Stable, /* Sentinels */ false>(
+                seqs.begin(), seqs.end(), out.begin() + out_fill,
+                static_cast<std::ptrdiff_t>(n), comp, mwma);
+            out_fill += n;
+            avail -= n;
+            total += n;
+
+            if (out_fill == block_size)
+            {
+                sink.write(out.data(), out_fill);
+                out_fill = 0;
+            }
+        }
+
+        // advance the inputs, and refill the exhausted blocks
+        size_t num_active = 0;
+        for (size_t j = 0; j < active.size(); ++j)
+        {
+            size_t i = active[j];
+            Input& in = inputs[i];
+            in.pos = static_cast<size_t>(seqs[j].first - in.block.begin());
+            if (in.pos != in.end || refill(i))
+                active[num_active++] = i;
+        }
+        active.resize(num_active);
+    }
+
+    if (out_fill != 0)
+        sink.write(out.data(), out_fill);
+
+    return total;
+}
+
+} // namespace multiway_merge_detail
+
+/*!
+ * Sequential multi-way merge of sorted streams, which are read in blocks from
+ * sources and written in blocks to a sink. At most (k + 1) * block_size items
+ * are buffered for k sources. The items in memory are merged by
+ * multiway_merge(), hence with the loser trees.
+ *
+ * A source has a \c value_type and a method <tt>size_t read(value_type* out,
+ * size_t size)</tt>, which writes the next up to size items to out and returns
+ * their number, 0 if the source is finished. The sink has a method <tt>void
+ * write(const value_type* data, size_t size)</tt>.
+ *
+ * \param sources_begin Begin iterator of the sources, a random access
+ *   iterator.
+ * \param sources_end End iterator of the sources.
+ * \param sink Receives the merged items.
+ * \param block_size Number of items per block.
+ * \param comp Comparator.
+ * \param mwma MultiwayMergeAlgorithm set to use.
+ * \return Number of items merged.
+ */
+template <typename SourceIterator, typename Sink,
+          typename Comparator = std::less<typename std::iterator_traits<
+              SourceIterator>::value_type::value_type> >
+std::uint64_t multiway_merge_stream(
+    SourceIterator sources_begin, SourceIterator sources_end, Sink& sink,
+    size_t block_size, Comparator comp = Comparator(),
+    MultiwayMergeAlgorithm mwma = MWMA_ALGORITHM_DEFAULT)
+{
+    return multiway_merge_detail::multiway_merge_stream_base<
+        /* Stable */ false>(sources_begin, sources_end, sink, block_size, comp,
+                            mwma);
+}
+
+/*!
+ * Stable sequential multi-way merge of sorted streams, see
+ * multiway_merge_stream(). Equal items are ordered by the index of their
+ * source.
+ *
+ * \param sources_begin Begin iterator of the sources, a random access
+ *   iterator.
+ * \param sources_end End iterator of the sources.
+ * \param sink Receives the merged items.
+ * \param block_size Number of items per block.
+ * \param comp Comparator.
+ * \param mwma MultiwayMergeAlgorithm set to use.
+ * \return Number of items merged.
+ */
+template <typename SourceIterator, typename Sink,
+          typename Comparator = std::less<typename std::iterator_traits<
+              SourceIterator>::value_type::value_type> >
+std::uint64_t stable_multiway_merge_stream(
+    SourceIterator sources_begin, SourceIterator sources_end, Sink& sink,
+    size_t block_size, Comparator comp = Comparator(),
+    MultiwayMergeAlgorithm mwma = MWMA_ALGORITHM_DEFAULT)
+{
+    return multiway_merge_detail::multiway_merge_stream_base<
+        /* Stable */ true>(sources_begin, sources_end, sink, block_size, comp,
+                           mwma);
+}
+
+/******************************************************************************/
+// File-backed Sources and Sinks
+
+/*!
+ * Reads a file sequentially with read(), and asks the operating system to
+ * prefetch the next block while the current one is processed. Falls back to
+ * std::ifstream without POSIX.
+ */
+class FileBlockReader
+{
+public:
+    FileBlockReader() = default;
+
+    //! Non-copyable.
+    FileBlockReader(const FileBlockReader&) = delete;
+    FileBlockReader& operator=(const FileBlockReader&) = delete;
+
+    //! Movable.
+    FileBlockReader(FileBlockReader&& other) noexcept;
+    FileBlockReader& operator=(FileBlockReader&& other) noexcept;
+
+    ~FileBlockReader();
+
+    //! Opens the file for reading, with \c prefetch bytes read ahead. Returns
+    //! false if it cannot be opened.
+    bool open(const std::string& path, size_t prefetch);
+
+    //! Reads up to size bytes into data. Returns the number of bytes read,
+    //! which is less than size only at the end of the file or on an error.
+    size_t read(void* data, size_t size);
+
+    //! Closes the file.
+    void close();
+
+    //! Returns true if the file is open and no error occurred.
+    bool good() const noexcept
+    {
+        return is_open() && !error_;
+    }
+
+    //! Returns true if the file is open.
+    bool is_open() const noexcept;
+
+private:
+    //! file descriptor, or std::ifstream without POSIX
+    int fd_ = -1;
+    void* stream_ = nullptr;
+
+    //! offset of the next byte to read
+    std::uint64_t offset_ = 0;
+
+    //! number of bytes to prefetch
+    size_t prefetch_ = 0;
+
+    //! set on read errors
+    bool error_ = false;
+};
+
+/*!
+ * Writes a file sequentially with write(). Falls back to std::ofstream without
+ * POSIX.
+ */
+class FileBlockWriter
+{
+public:
+    FileBlockWriter() = default;
+
+    //! Non-copyable.
+    FileBlockWriter(const FileBlockWriter&) = delete;
+    FileBlockWriter& operator=(const FileBlockWriter&) = delete;
+
+    //! Movable.
+    FileBlockWriter(FileBlockWriter&& other) noexcept;
+    FileBlockWriter& operator=(FileBlockWriter&& other) noexcept;
+
+    ~FileBlockWriter();
+
+    //! Creates or truncates the file for writing. Returns false if it cannot
+    //! be opened.
+    bool open(const std::string& path);
+
+    //! Writes size bytes from data. Returns false on an error.
+    bool write(const void* data, size_t size);
+
+    //! Closes the file, returns false if it was not written completely.
+    bool close();
+
+    //! Returns true if the file is open and no error occurred.
+    bool good() const noexcept
+    {
+        return is_open() && !error_;
+    }
+
+    //! Returns true if the file is open.
+    bool is_open() const noexcept;
+
+private:
+    //! file descriptor, or std::ofstream without POSIX
+    int fd_ = -1;
+    void* stream_ = nullptr;
+
+    //! set on write errors
+    bool error_ = false;
+};
+
+/*!
+ * Source for multiway_merge_stream() reading items of a trivially copyable
+ * type from a file in its binary representation. Trailing bytes which do not
+ * form a whole item are ignored.
+ */
+template <typename ValueType>
+class FileBlockSource
+{
+    static_assert(std::is_trivially_copyable<ValueType>::value,
+                  "FileBlockSource requires a trivially copyable type");
+
+public:
+    using value_type = ValueType;
+
+    FileBlockSource() = default;
+
+    //! Opens the file, prefetching prefetch_items ahead, see good().
+    explicit FileBlockSource(const std::string& path,
+                             size_t prefetch_items = 64 * 1024)
+    {
+        reader_.open(path, prefetch_items * sizeof(ValueType));
+    }
+
+    //! Reads up to size items into out, returns their number.
+    size_t read(ValueType* out, size_t size)
+    {
+        if (!reader_.is_open())
+            return 0;
+        size_t bytes = reader_.read(out, size * sizeof(ValueType));
+        return bytes / sizeof(ValueType);
+    }
+
+    //! Returns true if the file is open and no error occurred.
+    bool good() const noexcept
+    {
+        return reader_.good();
+    }
+
+private:
+    FileBlockReader reader_;
+};
+
+/*!
+ * Sink for multiway_merge_stream() writing items of a trivially copyable type
+ * to a file in their binary representation.
+ */
+template <typename ValueType>
+class FileBlockSink
+{
+    static_assert(std::is_trivially_copyable<ValueType>::value,
+                  "FileBlockSink requires a trivially copyable type");
+
+public:
+    using value_type = ValueType;
+
+    FileBlockSink() = default;
+
+    //! Creates or truncates the file, see good().
+    explicit FileBlockSink(const std::string& path)
+    {
+        writer_.open(path);
+    }
+
+    //! Writes size items from data.
+    void write(const ValueType* data, size_t size)
+    {
+        writer_.write(data, size * sizeof(ValueType));
+    }
+
+    //! Closes the file, returns false if it was not written completely.
+    bool close()
+    {
+        return writer_.close();
+    }
+
+    //! Returns true if the file is open and no error occurred.
+    bool good() const noexcept
+    {
+        return writer_.good();
+    }
+
+private:
+    FileBlockWriter writer_;
+};
+
+//! \}
+
+} // namespace tlx
+
+#endif // !TLX_ALGORITHM_MULTIWAY_MERGE_STREAM_HEADER
+
+/******************************************************************************/
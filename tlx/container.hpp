@@ -20,16 +20,21 @@ foreach (sort glob("tlx/container/"."*.hpp")) {
 }
 ]]]*/
 #include <tlx/container/btree.hpp>          // NOLINT(misc-include-cleaner)
+#include <tlx/container/btree_concurrent_map.hpp> // NOLINT(misc-include-cleaner)
+#include <tlx/container/btree_image.hpp>    // NOLINT(misc-include-cleaner)
 #include <tlx/container/btree_map.hpp>      // NOLINT(misc-include-cleaner)
 #include <tlx/container/btree_multimap.hpp> // NOLINT(misc-include-cleaner)
 #include <tlx/container/btree_multiset.hpp> // NOLINT(misc-include-cleaner)
 #include <tlx/container/btree_set.hpp>      // NOLINT(misc-include-cleaner)
+#include <tlx/container/btree_snapshot_map.hpp> // NOLINT(misc-include-cleaner)
 #include <tlx/container/d_ary_addressable_int_heap.hpp> // NOLINT(misc-include-cleaner)
 #include <tlx/container/d_ary_heap.hpp>    // NOLINT(misc-include-cleaner)
 #include <tlx/container/loser_tree.hpp>    // NOLINT(misc-include-cleaner)
 #include <tlx/container/lru_cache.hpp>     // NOLINT(misc-include-cleaner)
+#include <tlx/container/multi_queue.hpp>   // NOLINT(misc-include-cleaner)
 #include <tlx/container/radix_heap.hpp>    // NOLINT(misc-include-cleaner)
 #include <tlx/container/ring_buffer.hpp>   // NOLINT(misc-include-cleaner)
+#include <tlx/container/sequence_heap.hpp> // NOLINT(misc-include-cleaner)
 #include <tlx/container/simple_vector.hpp> // NOLINT(misc-include-cleaner)
 #include <tlx/container/splay_tree.hpp>    // NOLINT(misc-include-cleaner)
 #include <tlx/container/string_view.hpp>   // NOLINT(misc-include-cleaner)
@@ -18,10 +18,37 @@
 #include <algorithm>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <iterator>
+#include <limits>
 #include <memory>
+#include <thread>
+#include <type_traits>
 #include <utility>
+#include <vector>
+
+#ifndef TLX_BTREE_SIMD
+//! Use SSE2/AVX2 instructions to search keys in nodes of B+ trees with integer
+//! keys and std::less. Can be defined to 0 to disable the specialization.
+#if defined(__GNUC__) && defined(__SSE2__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define TLX_BTREE_SIMD 1
+#else
+#define TLX_BTREE_SIMD 0
+#endif
+#endif
+
+#if TLX_BTREE_SIMD
+#include <immintrin.h>
+#endif
+
+//! Hint to fetch the cache line at address p, used by the B+ tree range scans.
+#if defined(__GNUC__)
+#define TLX_BTREE_PREFETCH(p) __builtin_prefetch(p)
+#else
+#define TLX_BTREE_PREFETCH(p)
+#endif
 
 namespace tlx {
 
@@ -110,6 +137,559 @@ struct btree_default_traits
     //! than this threshold. See notes at
     //! http://panthema.net/2013/0504-STX-B+Tree-Binary-vs-Linear-Search
     static const size_t binsearch_threshold = 256;
+
+    //! If true, each inner node additionally stores the number of items in the
+    //! subtree of each child. These counts enable rank(), select() and
+    //! distance() in O(log n) time, at the cost of keeping them up-to-date
+    //! during all modifications.
+    static const bool order_statistics = false;
+
+    //! Number of leaves which for_each_leaf_span() and for_each_range()
+    //! prefetch ahead of the leaf currently visited.
+    static const unsigned short scan_prefetch = 4;
+
+    //! If true, leaves of maps store keys and data items in separate arrays
+    //! (structure of arrays) instead of an array of pairs. Key searches then
+    //! touch only the keys, but iterators return proxy objects which behave
+    //! like references to std::pair instead of plain references.
+    static const bool soa_leaves = false;
+};
+
+//! Maps any type to void, for detecting optional members of the traits.
+template <typename Type>
+struct btree_void
+{
+    typedef void type;
+};
+
+/*!
+ * The traits flag order_statistics, or false if the traits do not declare it,
+ * like standalone traits written before it was added.
+ */
+template <typename Traits, typename Enable = void>
+struct btree_traits_order_statistics
+{
+    static const bool value = false;
+};
+
+template <typename Traits>
+struct btree_traits_order_statistics<
+    Traits, typename btree_void<decltype(Traits::order_statistics)>::type>
+{
+    static const bool value = Traits::order_statistics;
+};
+
+/*!
+ * The traits parameter scan_prefetch, or four leaves if the traits do not
+ * declare it.
+ */
+template <typename Traits, typename Enable = void>
+struct btree_traits_scan_prefetch
+{
+    static const unsigned short value = 4;
+};
+
+template <typename Traits>
+struct btree_traits_scan_prefetch<
+    Traits, typename btree_void<decltype(Traits::scan_prefetch)>::type>
+{
+    static const unsigned short value = Traits::scan_prefetch;
+};
+
+/*!
+ * The traits flag soa_leaves, or false if the traits do not declare it.
+ */
+template <typename Traits, typename Enable = void>
+struct btree_traits_soa_leaves
+{
+    static const bool value = false;
+};
+
+template <typename Traits>
+struct btree_traits_soa_leaves<
+    Traits, typename btree_void<decltype(Traits::soa_leaves)>::type>
+{
+    static const bool value = Traits::soa_leaves;
+};
+
+/*!
+ * Search functions counting the number of keys in a sorted key array which are
+ * less (or less-or-equal) than a search key. The generic version is disabled,
+ * and the B+ tree then uses its linear or binary search on the comparator.
+ */
+template <typename Key, typename Compare, typename Enable = void>
+struct btree_simd_search
+{
+    //! Whether the specialized search can be used for Key and Compare.
+    static const bool enabled = false;
+
+    //! Number of keys below which binary search switches to count_less().
+    static const unsigned short window = 0;
+
+    //! Never called, because the search is disabled.
+    static unsigned short count_less(const Key*, unsigned short, const Key&)
+    {
+        return 0;
+    }
+
+    //! Never called, because the search is disabled.
+    static unsigned short count_lessequal(const Key*, unsigned short,
+                                          const Key&)
+    {
+        return 0;
+    }
+};
+
+#if TLX_BTREE_SIMD
+
+/*!
+ * Specialized key search for 32- and 64-bit integer keys ordered by std::less.
+ * Blocks of keys are compared with the search key at once, and the number of
+ * matching lanes is taken from the movemask. Uses AVX2 if the CPU supports it
+ * (checked at run-time, unless the code is compiled with AVX2 enabled), SSE2
+ * for 32-bit keys otherwise, and scalar code for the remaining keys.
+ */
+template <typename Key>
+struct btree_simd_search<
+    Key, std::less<Key>,
+    typename std::enable_if<std::is_integral<Key>::value &&
+                            (sizeof(Key) == 4 || sizeof(Key) == 8)>::type>
+{
+    //! Whether the specialized search can be used for Key and Compare.
+    static const bool enabled = true;
+
+    //! Number of keys below which binary search switches to count_less().
+    static const unsigned short window = 32;
+
+    //! Signed integer of the same width, because SIMD compares are signed.
+    typedef typename std::conditional<sizeof(Key) == 4, int32_t, int64_t>::type
+        signed_type;
+
+    //! Offset added to map unsigned keys to signed ones preserving the order.
+    static signed_type bias()
+    {
+        return std::is_signed<Key>::value
+                   ? 0
+                   : std::numeric_limits<signed_type>::min();
+    }
+
+    //! Number of keys in [keys, keys + n) less than key.
+    static unsigned short count_less(const Key* keys, unsigned short n,
+                                     const Key& key)
+    {
+        return count<false>(keys, n, key);
+    }
+
+    //! Number of keys in [keys, keys + n) less than or equal to key.
+    static unsigned short count_lessequal(const Key* keys, unsigned short n,
+                                          const Key& key)
+    {
+        return count<true>(keys, n, key);
+    }
+
+    template <bool Equal>
+    static unsigned short count(const Key* keys, unsigned short n,
+                                const Key& key)
+    {
+        unsigned short i = 0;
+
+#if defined(__AVX2__)
+        i = count_avx2<Equal>(keys, n, key);
+#else
+        if (__builtin_cpu_supports("avx2"))
+            i = count_avx2<Equal>(keys, n, key);
+        else if (sizeof(Key) == 4)
+            i = count_sse2<Equal>(keys, n, key);
+#endif
+
+        // scan the remaining keys which do not fill a whole block.
+        while (i < n && (Equal ? !(key < keys[i]) : keys[i] < key))
+            ++i;
+        return i;
+    }
+
+    //! Compare blocks of four 32-bit keys. Returns the result once a block
+    //! contains a non-matching key, otherwise the start of the remaining keys.
+    template <bool Equal>
+    static unsigned short count_sse2(const Key* keys, unsigned short n,
+                                     const Key& key)
+    {
+        const __m128i b = _mm_set1_epi32(static_cast<int32_t>(bias()));
+        const __m128i k =
+            _mm_xor_si128(_mm_set1_epi32(static_cast<int32_t>(key)), b);
+
+        unsigned short i = 0;
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128i v = _mm_xor_si128(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)), b);
+            // mask of keys[i] < key, or of keys[i] > key to be inverted.
+            int mask = _mm_movemask_ps(_mm_castsi128_ps(
+                Equal ? _mm_cmpgt_epi32(v, k) : _mm_cmpgt_epi32(k, v)));
+            if (Equal)
+                mask ^= 0xF;
+            if (mask != 0xF)
+                return i + __builtin_popcount(mask);
+        }
+        return i;
+    }
+
+    //! Compare blocks of eight 32-bit or four 64-bit keys. Returns the result
+    //! once a block contains a non-matching key, otherwise the start of the
+    //! remaining keys.
+    template <bool Equal>
+    __attribute__((target("avx2"))) static unsigned short
+    count_avx2(const Key* keys, unsigned short n, const Key& key)
+    {
+        const unsigned short lanes = 32 / sizeof(Key);
+        const int full = (1 << lanes) - 1;
+
+        const __m256i b = sizeof(Key) == 4
+                              ? _mm256_set1_epi32(static_cast<int32_t>(bias()))
+                              : _mm256_set1_epi64x(bias());
+        const __m256i k = _mm256_xor_si256(
+            sizeof(Key) == 4
+                ? _mm256_set1_epi32(static_cast<int32_t>(key))
+                : _mm256_set1_epi64x(static_cast<int64_t>(key)),
+            b);
+
+        unsigned short i = 0;
+        for (; i + lanes <= n; i += lanes)
+        {
+            __m256i v = _mm256_xor_si256(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i)),
+                b);
+            // mask of keys[i] < key, or of keys[i] > key to be inverted.
+            __m256i c;
+            if (sizeof(Key) == 4)
+                c = Equal ? _mm256_cmpgt_epi32(v, k) : _mm256_cmpgt_epi32(k, v);
+            else
+                c = Equal ? _mm256_cmpgt_epi64(v, k) : _mm256_cmpgt_epi64(k, v);
+            int mask = sizeof(Key) == 4
+                           ? _mm256_movemask_ps(_mm256_castsi256_ps(c))
+                           : _mm256_movemask_pd(_mm256_castsi256_pd(c));
+            if (Equal)
+                mask ^= full;
+            if (mask != full)
+                return i + __builtin_popcount(mask);
+        }
+        return i;
+    }
+};
+
+#endif // TLX_BTREE_SIMD
+
+/*!
+ * Array of item counts of the children's subtrees in an inner node. The
+ * specialization for disabled order statistics is empty, hence it takes no
+ * space as base class.
+ */
+template <typename SizeType, unsigned short Slots, bool Enabled>
+struct btree_child_counts
+{
+    //! Number of items in the subtree of each child
+    SizeType childcnt[Slots];
+
+    //! Return the array of subtree counts
+    SizeType* counts()
+    {
+        return childcnt;
+    }
+
+    //! Return the array of subtree counts
+    const SizeType* counts() const
+    {
+        return childcnt;
+    }
+};
+
+template <typename SizeType, unsigned short Slots>
+struct btree_child_counts<SizeType, Slots, false>
+{
+    //! Never called if order statistics are disabled.
+    SizeType* counts()
+    {
+        return nullptr;
+    }
+
+    //! Never called if order statistics are disabled.
+    const SizeType* counts() const
+    {
+        return nullptr;
+    }
+};
+
+/*!
+ * Proxy reference to an item of a B+ tree leaf which stores keys and data in
+ * separate arrays. It presents the item like a std::pair with members first and
+ * second, and converts to std::pair<Key, Data>.
+ */
+template <typename Key, typename Data>
+struct btree_pair_reference
+{
+    //! Key of the item
+    const Key& first;
+
+    //! Data of the item, mutable unless Data is const
+    Data& second;
+
+    //! Construct from the key and data slots of the item
+    btree_pair_reference(const Key& k, Data& d) : first(k), second(d)
+    {
+    }
+
+    //! Type of a copy of the item
+    typedef std::pair<Key, typename std::remove_const<Data>::type> pair_type;
+
+    //! Convert to a copy of the item
+    operator pair_type() const
+        noexcept(std::is_nothrow_copy_constructible<pair_type>::value)
+    {
+        return pair_type(first, second);
+    }
+};
+
+//! Equality of two proxy references or a proxy reference and a pair.
+template <typename Key, typename Data, typename Pair>
+bool operator==(const btree_pair_reference<Key, Data>& a, const Pair& b)
+{
+    return a.first == b.first && a.second == b.second;
+}
+
+//! Equality of a pair and a proxy reference.
+template <typename Key, typename Data, typename K2, typename D2>
+bool operator==(const std::pair<K2, D2>& a,
+                const btree_pair_reference<Key, Data>& b)
+{
+    return b == a;
+}
+
+//! Inequality of a proxy reference and a proxy reference or pair.
+template <typename Key, typename Data, typename Pair>
+bool operator!=(const btree_pair_reference<Key, Data>& a, const Pair& b)
+{
+    return !(a == b);
+}
+
+//! Inequality of a pair and a proxy reference.
+template <typename Key, typename Data, typename K2, typename D2>
+bool operator!=(const std::pair<K2, D2>& a,
+                const btree_pair_reference<Key, Data>& b)
+{
+    return !(b == a);
+}
+
+//! Lexicographic order of a proxy reference and a proxy reference or pair.
+template <typename Key, typename Data, typename Pair>
+bool operator<(const btree_pair_reference<Key, Data>& a, const Pair& b)
+{
+    return a.first < b.first || (!(b.first < a.first) && a.second < b.second);
+}
+
+//! Lexicographic order of a pair and a proxy reference.
+template <typename Key, typename Data, typename K2, typename D2>
+bool operator<(const std::pair<K2, D2>& a,
+               const btree_pair_reference<Key, Data>& b)
+{
+    return a.first < b.first || (!(b.first < a.first) && a.second < b.second);
+}
+
+/*!
+ * Proxy pointer returned by operator->() of B+ tree iterators over leaves which
+ * store keys and data in separate arrays. Holds a btree_pair_reference.
+ */
+template <typename Reference>
+struct btree_pair_pointer
+{
+    //! The referenced item
+    Reference ref;
+
+    //! Construct from the item's proxy reference
+    explicit btree_pair_pointer(const Reference& r) : ref(r)
+    {
+    }
+
+    //! Access members of the referenced item
+    const Reference* operator->() const
+    {
+        return &ref;
+    }
+};
+
+/*!
+ * Item storage of a B+ tree leaf. The generic version holds an array of
+ * value_type items, to which iterators return plain references. The
+ * specialization for SoA leaves of pairs stores keys and data in separate
+ * arrays.
+ */
+template <typename Key, typename Value, typename KeyOfValue,
+          unsigned short Slots, bool SoA>
+struct btree_leaf_slots
+{
+    //! Reference to an item returned by iterators
+    typedef Value& reference;
+
+    //! Constant reference to an item returned by const iterators
+    typedef const Value& const_reference;
+
+    //! Pointer to an item returned by iterators
+    typedef Value* pointer;
+
+    //! Constant pointer to an item returned by const iterators
+    typedef const Value* const_pointer;
+
+    //! True if the keys are stored contiguously, which is the case for sets.
+    static const bool contiguous_keys = std::is_same<Key, Value>::value;
+
+    //! Array of (key, data) pairs
+    Value slotdata[Slots];
+
+    //! Return key in slot s.
+    const Key& key(size_t s) const
+    {
+        return KeyOfValue::get(slotdata[s]);
+    }
+
+    //! Return the item in slot s.
+    const Value& value(size_t s) const
+    {
+        return slotdata[s];
+    }
+
+    //! Return a reference to the item in slot s.
+    reference ref(size_t s)
+    {
+        return slotdata[s];
+    }
+
+    //! Return a constant reference to the item in slot s.
+    const_reference ref(size_t s) const
+    {
+        return slotdata[s];
+    }
+
+    //! Return a pointer to the item in slot s.
+    pointer ptr(size_t s)
+    {
+        return slotdata + s;
+    }
+
+    //! Return a constant pointer to the item in slot s.
+    const_pointer ptr(size_t s) const
+    {
+        return slotdata + s;
+    }
+
+    //! Store the item in slot s.
+    void assign(size_t s, const Value& v)
+    {
+        slotdata[s] = v;
+    }
+
+    //! Copy the items in slots [first,last) to dest, starting at slot d_first.
+    void copy_slots(size_t first, size_t last, btree_leaf_slots* dest,
+                    size_t d_first) const
+    {
+        std::copy(slotdata + first, slotdata + last, dest->slotdata + d_first);
+    }
+
+    //! Copy the items in slots [first,last) to dest, ending before slot
+    //! d_last, starting with the last item.
+    void copy_slots_backward(size_t first, size_t last, btree_leaf_slots* dest,
+                             size_t d_last) const
+    {
+        std::copy_backward(slotdata + first, slotdata + last,
+                           dest->slotdata + d_last);
+    }
+};
+
+template <typename Key, typename Data, typename KeyOfValue,
+          unsigned short Slots>
+struct btree_leaf_slots<Key, std::pair<Key, Data>, KeyOfValue, Slots, true>
+{
+    //! Proxy reference to an item returned by iterators
+    typedef btree_pair_reference<Key, Data> reference;
+
+    //! Proxy constant reference to an item returned by const iterators
+    typedef btree_pair_reference<Key, const Data> const_reference;
+
+    //! Proxy pointer to an item returned by iterators
+    typedef btree_pair_pointer<reference> pointer;
+
+    //! Proxy constant pointer to an item returned by const iterators
+    typedef btree_pair_pointer<const_reference> const_pointer;
+
+    //! The keys are stored contiguously.
+    static const bool contiguous_keys = true;
+
+    //! Array of keys
+    Key slotkey[Slots];
+
+    //! Array of data items, in the same order as the keys
+    Data slotvalue[Slots];
+
+    //! Return key in slot s.
+    const Key& key(size_t s) const
+    {
+        return slotkey[s];
+    }
+
+    //! Return a copy of the item in slot s.
+    std::pair<Key, Data> value(size_t s) const
+    {
+        return std::pair<Key, Data>(slotkey[s], slotvalue[s]);
+    }
+
+    //! Return a proxy reference to the item in slot s.
+    reference ref(size_t s)
+    {
+        return reference(slotkey[s], slotvalue[s]);
+    }
+
+    //! Return a proxy constant reference to the item in slot s.
+    const_reference ref(size_t s) const
+    {
+        return const_reference(slotkey[s], slotvalue[s]);
+    }
+
+    //! Return a proxy pointer to the item in slot s.
+    pointer ptr(size_t s)
+    {
+        return pointer(ref(s));
+    }
+
+    //! Return a proxy constant pointer to the item in slot s.
+    const_pointer ptr(size_t s) const
+    {
+        return const_pointer(ref(s));
+    }
+
+    //! Store the item in slot s.
+    void assign(size_t s, const std::pair<Key, Data>& v)
+    {
+        slotkey[s] = v.first;
+        slotvalue[s] = v.second;
+    }
+
+    //! Copy the items in slots [first,last) to dest, starting at slot d_first.
+    void copy_slots(size_t first, size_t last, btree_leaf_slots* dest,
+                    size_t d_first) const
+    {
+        std::copy(slotkey + first, slotkey + last, dest->slotkey + d_first);
+        std::copy(slotvalue + first, slotvalue + last,
+                  dest->slotvalue + d_first);
+    }
+
+    //! Copy the items in slots [first,last) to dest, ending before slot
+    //! d_last, starting with the last item.
+    void copy_slots_backward(size_t first, size_t last, btree_leaf_slots* dest,
+                             size_t d_last) const
+    {
+        std::copy_backward(slotkey + first, slotkey + last,
+                           dest->slotkey + d_last);
+        std::copy_backward(slotvalue + first, slotvalue + last,
+                           dest->slotvalue + d_last);
+    }
 };
 
 /*!
@@ -159,7 +739,8 @@ public:
     //! implement multiset and multimap.
     static const bool allow_duplicates = Duplicates;
 
-    //! Seventh template parameter: STL allocator for tree nodes
+    //! Seventh template parameter: STL allocator for tree nodes. A
+    //! SlabAllocator pools the nodes in large memory regions.
     typedef Allocator allocator_type;
 
     //! \}
@@ -213,6 +794,19 @@ public:
     //! with TLX_BTREE_DEBUG and the key type must be std::ostream printable.
     static const bool debug = traits::debug;
 
+    //! Traits parameter: Maintain subtree item counts in inner nodes to
+    //! support rank(), select() and distance() in O(log n) time.
+    static const bool order_statistics =
+        btree_traits_order_statistics<traits>::value;
+
+    //! Traits parameter: Number of leaves prefetched ahead by range scans.
+    static const unsigned short scan_prefetch =
+        btree_traits_scan_prefetch<traits>::value;
+
+    //! Traits parameter: Store keys and data items of maps in separate arrays
+    //! in the leaves.
+    static const bool soa_leaves = btree_traits_soa_leaves<traits>::value;
+
     //! \}
 
 private:
@@ -246,7 +840,10 @@ private:
 
     //! Extended structure of a inner node in-memory. Contains only keys and no
     //! data items.
-    struct InnerNode : public node
+    struct InnerNode
+        : public node,
+          public btree_child_counts<size_type, inner_slotmax + 1,
+                                    order_statistics>
     {
         //! Define an related allocator for the InnerNode structs.
         typedef typename std::allocator_traits<
@@ -290,9 +887,16 @@ private:
         }
     };
 
+    //! Item storage of the leaves, either an array of value_type or separate
+    //! arrays of keys and data items.
+    typedef btree_leaf_slots<key_type, value_type, key_of_value, leaf_slotmax,
+                             soa_leaves>
+        leaf_slots_type;
+
     //! Extended structure of a leaf node in memory. Contains pairs of keys and
-    //! data items. Key and data slots are kept together in value_type.
-    struct LeafNode : public node
+    //! data items. Key and data slots are kept together in value_type, or in
+    //! separate arrays if soa_leaves is enabled.
+    struct LeafNode : public node, public leaf_slots_type
     {
         //! Define an related allocator for the LeafNode structs.
         typedef typename std::allocator_traits<
@@ -305,9 +909,6 @@ private:
         //! Double linked list pointers to traverse the leaves
         LeafNode* next_leaf;
 
-        //! Array of (key, data) pairs
-        value_type slotdata[leaf_slotmax];
-
         //! Set variables to initial values
         void initialize()
         {
@@ -315,12 +916,6 @@ private:
             prev_leaf = next_leaf = nullptr;
         }
 
-        //! Return key in slot s.
-        const key_type& key(size_t s) const
-        {
-            return key_of_value::get(slotdata[s]);
-        }
-
         //! True if the node's slots are full.
         bool is_full() const
         {
@@ -344,7 +939,7 @@ private:
         void set_slot(unsigned short slot, const value_type& value)
         {
             TLX_BTREE_ASSERT(slot < node::slotuse);
-            slotdata[slot] = value;
+            leaf_slots_type::assign(slot, value);
         }
     };
 
@@ -373,10 +968,10 @@ public:
         typedef typename BTree::value_type value_type;
 
         //! Reference to the value_type. STL required.
-        typedef value_type& reference;
+        typedef typename BTree::leaf_slots_type::reference reference;
 
         //! Pointer to the value_type. STL required.
-        typedef value_type* pointer;
+        typedef typename BTree::leaf_slots_type::pointer pointer;
 
         //! STL-magic iterator category
         typedef std::bidirectional_iterator_tag iterator_category;
@@ -441,13 +1036,13 @@ public:
         //! Dereference the iterator.
         reference operator*() const
         {
-            return curr_leaf->slotdata[curr_slot];
+            return curr_leaf->ref(curr_slot);
         }
 
         //! Dereference the iterator.
         pointer operator->() const
         {
-            return &curr_leaf->slotdata[curr_slot];
+            return curr_leaf->ptr(curr_slot);
         }
 
         //! Key of the current slot.
@@ -571,10 +1166,10 @@ public:
         typedef typename BTree::value_type value_type;
 
         //! Reference to the value_type. STL required.
-        typedef const value_type& reference;
+        typedef typename BTree::leaf_slots_type::const_reference reference;
 
         //! Pointer to the value_type. STL required.
-        typedef const value_type* pointer;
+        typedef typename BTree::leaf_slots_type::const_pointer pointer;
 
         //! STL-magic iterator category
         typedef std::bidirectional_iterator_tag iterator_category;
@@ -598,6 +1193,11 @@ public:
         //! data items directly
         friend class const_reverse_iterator;
 
+        //! Also friendly to the base btree class, because distance() needs to
+        //! read the curr_leaf and curr_slot values directly.
+        friend class BTree<key_type, value_type, key_of_value, key_compare,
+                           traits, allow_duplicates, allocator_type>;
+
         // The macro TLX_BTREE_FRIENDS can be used by outside class to access
         // the B+ tree internals. This was added for wxBTreeDemo to be able to
         // draw the tree.
@@ -638,13 +1238,13 @@ public:
         //! Dereference the iterator.
         reference operator*() const
         {
-            return curr_leaf->slotdata[curr_slot];
+            return curr_leaf->ref(curr_slot);
         }
 
         //! Dereference the iterator.
         pointer operator->() const
         {
-            return &curr_leaf->slotdata[curr_slot];
+            return curr_leaf->ptr(curr_slot);
         }
 
         //! Key of the current slot.
@@ -768,10 +1368,10 @@ public:
         typedef typename BTree::value_type value_type;
 
         //! Reference to the value_type. STL required.
-        typedef value_type& reference;
+        typedef typename BTree::leaf_slots_type::reference reference;
 
         //! Pointer to the value_type. STL required.
-        typedef value_type* pointer;
+        typedef typename BTree::leaf_slots_type::pointer pointer;
 
         //! STL-magic iterator category
         typedef std::bidirectional_iterator_tag iterator_category;
@@ -832,14 +1432,14 @@ public:
         reference operator*() const
         {
             TLX_BTREE_ASSERT(curr_slot > 0);
-            return curr_leaf->slotdata[curr_slot - 1];
+            return curr_leaf->ref(curr_slot - 1);
         }
 
         //! Dereference the iterator.
         pointer operator->() const
         {
             TLX_BTREE_ASSERT(curr_slot > 0);
-            return &curr_leaf->slotdata[curr_slot - 1];
+            return curr_leaf->ptr(curr_slot - 1);
         }
 
         //! Key of the current slot.
@@ -964,10 +1564,10 @@ public:
         typedef typename BTree::value_type value_type;
 
         //! Reference to the value_type. STL required.
-        typedef const value_type& reference;
+        typedef typename BTree::leaf_slots_type::const_reference reference;
 
         //! Pointer to the value_type. STL required.
-        typedef const value_type* pointer;
+        typedef typename BTree::leaf_slots_type::const_pointer pointer;
 
         //! STL-magic iterator category
         typedef std::bidirectional_iterator_tag iterator_category;
@@ -1033,14 +1633,14 @@ public:
         reference operator*() const
         {
             TLX_BTREE_ASSERT(curr_slot > 0);
-            return curr_leaf->slotdata[curr_slot - 1];
+            return curr_leaf->ref(curr_slot - 1);
         }
 
         //! Dereference the iterator.
         pointer operator->() const
         {
             TLX_BTREE_ASSERT(curr_slot > 0);
-            return &curr_leaf->slotdata[curr_slot - 1];
+            return curr_leaf->ptr(curr_slot - 1);
         }
 
         //! Key of the current slot.
@@ -1172,6 +1772,11 @@ public:
         //! Number of inner nodes in the B+ tree
         size_type inner_nodes = 0;
 
+        //! Bytes reserved by the node allocator's memory pool, as reported by
+        //! pooling allocators like SlabAllocator at the last node allocation or
+        //! deallocation. Zero for allocators without a bytes_reserved() method.
+        size_type allocator_reserved = 0;
+
         //! Base B+ tree parameter: The number of key/data slots in each leaf
         static const unsigned short leaf_slots = Self::leaf_slotmax;
 
@@ -1189,6 +1794,40 @@ public:
         {
             return static_cast<double>(size) / (leaves * leaf_slots);
         }
+
+        //! Return the average fill of inner nodes. As each node except the root
+        //! is a child, the inner nodes hold leaves + inner_nodes - 1 children
+        //! and leaves - 1 keys.
+        double avgfill_inner() const
+        {
+            if (inner_nodes == 0)
+                return 0.0;
+            return static_cast<double>(leaves - 1) /
+                   (inner_nodes * inner_slots);
+        }
+
+        //! Return the number of bytes occupied by the tree's nodes
+        size_type bytes_used() const
+        {
+            return leaves * sizeof(LeafNode) + inner_nodes * sizeof(InnerNode);
+        }
+
+        //! Return the number of bytes reserved for the tree's nodes, which
+        //! includes the unused part of a pooling allocator's memory regions.
+        size_type bytes_reserved() const
+        {
+            return allocator_reserved > bytes_used() ? allocator_reserved
+                                                     : bytes_used();
+        }
+
+        //! Return the number of node bytes per item, the memory overhead which
+        //! compact() reduces.
+        double bytes_per_item() const
+        {
+            if (size == 0)
+                return 0.0;
+            return static_cast<double>(bytes_used()) / size;
+        }
     };
 
     //! \}
@@ -1400,21 +2039,37 @@ private:
         return typename InnerNode::alloc_type(allocator_);
     }
 
-    //! Allocate and initialize a leaf node
-    LeafNode* allocate_leaf()
+    //! Allocate and initialize a leaf node without counting it in stats_.
+    LeafNode* construct_leaf()
     {
         LeafNode* n = new (leaf_node_allocator().allocate(1)) LeafNode();
         n->initialize();
+        return n;
+    }
+
+    //! Allocate and initialize an inner node without counting it in stats_.
+    InnerNode* construct_inner(unsigned short level)
+    {
+        InnerNode* n = new (inner_node_allocator().allocate(1)) InnerNode();
+        n->initialize(level);
+        return n;
+    }
+
+    //! Allocate and initialize a leaf node
+    LeafNode* allocate_leaf()
+    {
+        LeafNode* n = construct_leaf();
         stats_.leaves++;
+        update_allocator_reserved();
         return n;
     }
 
     //! Allocate and initialize an inner node
     InnerNode* allocate_inner(unsigned short level)
     {
-        InnerNode* n = new (inner_node_allocator().allocate(1)) InnerNode();
-        n->initialize(level);
+        InnerNode* n = construct_inner(level);
         stats_.inner_nodes++;
+        update_allocator_reserved();
         return n;
     }
 
@@ -1442,13 +2097,35 @@ private:
                 a, in, 1);
             stats_.inner_nodes--;
         }
+        update_allocator_reserved();
     }
 
-    //! \}
+    //! Query the bytes reserved by allocators which pool memory.
+    template <typename Alloc>
+    static auto allocator_bytes_reserved(const Alloc& alloc, int)
+        -> decltype(static_cast<size_type>(alloc.bytes_reserved()))
+    {
+        return static_cast<size_type>(alloc.bytes_reserved());
+    }
 
-public:
-    //! \name Fast Destruction of the B+ Tree
-    //! \{
+    //! Other allocators do not report reserved memory.
+    template <typename Alloc>
+    static size_type allocator_bytes_reserved(const Alloc&, long)
+    {
+        return 0;
+    }
+
+    //! Refresh stats_.allocator_reserved from the node allocator.
+    void update_allocator_reserved()
+    {
+        stats_.allocator_reserved = allocator_bytes_reserved(allocator_, 0);
+    }
+
+    //! \}
+
+public:
+    //! \name Fast Destruction of the B+ Tree
+    //! \{
 
     //! Frees all key/data pairs and all nodes of the tree.
     void clear()
@@ -1462,6 +2139,7 @@ public:
             head_leaf_ = tail_leaf_ = nullptr;
 
             stats_ = tree_stats();
+            update_allocator_reserved();
         }
 
         TLX_BTREE_ASSERT(stats_.size == 0);
@@ -1574,7 +2252,7 @@ private:
 
             unsigned short lo = 0, hi = n->slotuse;
 
-            while (lo < hi)
+            while (hi - lo > simd_window(n))
             {
                 unsigned short mid = (lo + hi) >> 1;
 
@@ -1588,6 +2266,12 @@ private:
                 }
             }
 
+            if (lo < hi)
+            {
+                hi = lo = static_cast<unsigned short>(
+                    lo + simd_search::count_less(&n->key(lo), hi - lo, key));
+            }
+
             TLX_BTREE_PRINT("BTree::find_lower: on " << n << " key " << key
                                                      << " -> " << lo << " / "
                                                      << hi);
@@ -1607,6 +2291,9 @@ private:
         }
 
         // for nodes <= binsearch_threshold do linear search.
+        if (simd_window(n) != 0)
+            return simd_search::count_less(&n->key(0), n->slotuse, key);
+
         unsigned short lo = 0;
         while (lo < n->slotuse && key_less(n->key(lo), key))
             ++lo;
@@ -1627,7 +2314,7 @@ private:
 
             unsigned short lo = 0, hi = n->slotuse;
 
-            while (lo < hi)
+            while (hi - lo > simd_window(n))
             {
                 unsigned short mid = (lo + hi) >> 1;
 
@@ -1641,6 +2328,13 @@ private:
                 }
             }
 
+            if (lo < hi)
+            {
+                hi = lo = static_cast<unsigned short>(
+                    lo +
+                    simd_search::count_lessequal(&n->key(lo), hi - lo, key));
+            }
+
             TLX_BTREE_PRINT("BTree::find_upper: on " << n << " key " << key
                                                      << " -> " << lo << " / "
                                                      << hi);
@@ -1660,12 +2354,33 @@ private:
         }
 
         // for nodes <= binsearch_threshold do linear search.
+        if (simd_window(n) != 0)
+            return simd_search::count_lessequal(&n->key(0), n->slotuse, key);
+
         unsigned short lo = 0;
         while (lo < n->slotuse && key_lessequal(n->key(lo), key))
             ++lo;
         return lo;
     }
 
+    //! Specialized key search functions for the key type and comparator.
+    typedef btree_simd_search<key_type, key_compare> simd_search;
+
+    //! Number of keys below which binary search in an inner node switches to
+    //! the specialized search, zero if it is not available.
+    static unsigned short simd_window(const InnerNode*)
+    {
+        return simd_search::window;
+    }
+
+    //! Number of keys below which binary search in a leaf switches to the
+    //! specialized search, zero if it is not available. Requires the keys to
+    //! be stored contiguously, which is the case for sets and SoA leaves.
+    static unsigned short simd_window(const LeafNode*)
+    {
+        return leaf_slots_type::contiguous_keys ? simd_search::window : 0;
+    }
+
     //! \}
 
 public:
@@ -1912,6 +2627,466 @@ public:
 
     //! \}
 
+public:
+    //! \name Order Statistics: Rank and Select Queries
+    //! \{
+
+    // The template parameters defer the check of order_statistics until a
+    // member is called, so trees without it can be instantiated explicitly.
+
+    //! Returns the number of items with keys less than key, which is the
+    //! position of lower_bound(key) in the sorted sequence. Requires
+    //! order_statistics to be enabled in the traits.
+    template <bool OrderStatistics = order_statistics>
+    size_type rank(const key_type& key) const
+    {
+        static_assert(
+            OrderStatistics && order_statistics,
+            "rank() requires order_statistics in the B+ tree traits");
+
+        const node* n = root_;
+        if (!n)
+            return 0;
+
+        size_type r = 0;
+
+        while (!n->is_leafnode())
+        {
+            const InnerNode* inner = static_cast<const InnerNode*>(n);
+            unsigned short slot = find_lower(inner, key);
+
+            r += sum_counts(inner, 0, slot);
+            n = inner->childid[slot];
+        }
+
+        const LeafNode* leaf = static_cast<const LeafNode*>(n);
+        return r + find_lower(leaf, key);
+    }
+
+    //! Returns an iterator to the k-th smallest item (counting from zero), or
+    //! end() if k >= size(). Requires order_statistics to be enabled in the
+    //! traits.
+    template <bool OrderStatistics = order_statistics>
+    iterator select(size_type k)
+    {
+        static_assert(
+            OrderStatistics && order_statistics,
+            "select() requires order_statistics in the B+ tree traits");
+
+        if (k >= size())
+            return end();
+
+        node* n = root_;
+
+        while (!n->is_leafnode())
+        {
+            InnerNode* inner = static_cast<InnerNode*>(n);
+            unsigned short slot = 0;
+
+            while (k >= inner->counts()[slot])
+                k -= inner->counts()[slot++];
+
+            n = inner->childid[slot];
+        }
+
+        return iterator(static_cast<LeafNode*>(n),
+                        static_cast<unsigned short>(k));
+    }
+
+    //! Returns a constant iterator to the k-th smallest item (counting from
+    //! zero), or end() if k >= size(). Requires order_statistics to be enabled
+    //! in the traits.
+    template <bool OrderStatistics = order_statistics>
+    const_iterator select(size_type k) const
+    {
+        static_assert(
+            OrderStatistics && order_statistics,
+            "select() requires order_statistics in the B+ tree traits");
+
+        return select_counted(k);
+    }
+
+    //! Returns the number of items between the two iterators, like
+    //! std::distance(), but in O(log n) time by descending to both positions.
+    //! If a run of equal keys spans many leaves, finding the position of an
+    //! iterator in it additionally walks the leaves of the run. Requires
+    //! order_statistics to be enabled in the traits.
+    template <bool OrderStatistics = order_statistics>
+    std::ptrdiff_t distance(const_iterator first, const_iterator last) const
+    {
+        static_assert(
+            OrderStatistics && order_statistics,
+            "distance() requires order_statistics in the B+ tree traits");
+
+        return static_cast<std::ptrdiff_t>(iterator_rank(last)) -
+               static_cast<std::ptrdiff_t>(iterator_rank(first));
+    }
+
+private:
+    //! Descends to the k-th smallest item using the subtree counts, like
+    //! select(), which checks order_statistics at compile time.
+    const_iterator select_counted(size_type k) const
+    {
+        if (k >= size())
+            return end();
+
+        const node* n = root_;
+
+        while (!n->is_leafnode())
+        {
+            const InnerNode* inner = static_cast<const InnerNode*>(n);
+            unsigned short slot = 0;
+
+            while (k >= inner->counts()[slot])
+                k -= inner->counts()[slot++];
+
+            n = inner->childid[slot];
+        }
+
+        return const_iterator(static_cast<const LeafNode*>(n),
+                              static_cast<unsigned short>(k));
+    }
+
+    //! Returns the number of items before the iterator's position.
+    size_type iterator_rank(const const_iterator& iter) const
+    {
+        if (iter.curr_leaf == nullptr)
+            return 0;
+        if (iter.curr_slot >= iter.curr_leaf->slotuse)
+            return size();
+
+        const key_type& key = iter.curr_leaf->key(iter.curr_slot);
+
+        // descend to the first leaf which may contain key.
+        const node* n = root_;
+        size_type r = 0;
+
+        while (!n->is_leafnode())
+        {
+            const InnerNode* inner = static_cast<const InnerNode*>(n);
+            unsigned short slot = find_lower(inner, key);
+
+            r += sum_counts(inner, 0, slot);
+            n = inner->childid[slot];
+        }
+
+        // walk right over leaves with equal keys until the iterator's leaf.
+        const LeafNode* leaf = static_cast<const LeafNode*>(n);
+
+        while (leaf != iter.curr_leaf)
+        {
+            tlx_die_unless(leaf != nullptr);
+            r += leaf->slotuse;
+            leaf = leaf->next_leaf;
+        }
+
+        return r + iter.curr_slot;
+    }
+
+    //! Sum of the subtree counts of the children [begin,end) of an inner node.
+    static size_type sum_counts(const InnerNode* inner, unsigned short begin,
+                                unsigned short end)
+    {
+        size_type sum = 0;
+        for (unsigned short s = begin; s < end; ++s)
+            sum += inner->counts()[s];
+        return sum;
+    }
+
+    //! Number of items in the subtree n, calculated from the counts in n.
+    static size_type subtree_size(const node* n)
+    {
+        if (n->is_leafnode())
+            return n->slotuse;
+
+        const InnerNode* inner = static_cast<const InnerNode*>(n);
+        return sum_counts(inner, 0, inner->slotuse + 1);
+    }
+
+    //! \}
+
+public:
+    //! \name Range Scans over Leaf Spans
+    //! \{
+
+    //! Call fn(first, last) for each contiguous span [first, last) of items in
+    //! one leaf, in order, covering all items whose keys are in [lo, hi). The
+    //! leaves are found via their parent inner nodes, which allows to prefetch
+    //! the next scan_prefetch leaves while the span of a leaf is processed,
+    //! instead of following next_leaf pointers one cache miss at a time. Not
+    //! available with soa_leaves, which store no value_type arrays.
+    template <typename Visitor>
+    void for_each_leaf_span(const key_type& lo, const key_type& hi,
+                            Visitor fn) const
+    {
+        static_assert(!soa_leaves,
+                      "for_each_leaf_span() requires leaves of value_type");
+        if (!root_ || !key_less(lo, hi))
+            return;
+
+        auto visit = [&fn](const LeafNode* leaf, unsigned short first,
+                           unsigned short last) {
+            fn(leaf->ptr(first), leaf->ptr(last));
+        };
+        scan_subtree(root_, &lo, &hi, visit);
+    }
+
+    //! Call fn(first, last) for each leaf's span of items [first, last), in
+    //! order, covering all items of the tree. See for_each_leaf_span(lo, hi).
+    template <typename Visitor>
+    void for_each_leaf_span(Visitor fn) const
+    {
+        static_assert(!soa_leaves,
+                      "for_each_leaf_span() requires leaves of value_type");
+        if (!root_)
+            return;
+
+        auto visit = [&fn](const LeafNode* leaf, unsigned short first,
+                           unsigned short last) {
+            fn(leaf->ptr(first), leaf->ptr(last));
+        };
+        scan_subtree(root_, nullptr, nullptr, visit);
+    }
+
+    //! Call fn(value) for each item whose key is in [lo, hi), in order. Scans
+    //! like for_each_leaf_span(), hence the loop over each leaf's items is free
+    //! of iterator logic and can be vectorized by the compiler. With
+    //! soa_leaves, fn is called with const_iterator::reference proxies.
+    template <typename Function>
+    void for_each_range(const key_type& lo, const key_type& hi,
+                        Function fn) const
+    {
+        if (!root_ || !key_less(lo, hi))
+            return;
+
+        auto visit = [&fn](const LeafNode* leaf, unsigned short first,
+                           unsigned short last) {
+            for (unsigned short s = first; s < last; ++s)
+                fn(leaf->ref(s));
+        };
+        scan_subtree(root_, &lo, &hi, visit);
+    }
+
+private:
+    //! Issue prefetches for all cache lines of the leaf n.
+    static void prefetch_leaf(const node* n)
+    {
+        const char* p = reinterpret_cast<const char*>(n);
+        for (size_t i = 0; i < sizeof(LeafNode); i += 64)
+            TLX_BTREE_PREFETCH(p + i);
+    }
+
+    //! Recursively scan the subtree n for keys in [*lo, *hi). A nullptr bound
+    //! is unlimited; lo is set to nullptr once the first leaf was visited.
+    //! Returns false if a key not less than *hi was reached.
+    template <typename LeafVisitor>
+    bool scan_subtree(const node* n, const key_type* lo, const key_type* hi,
+                      LeafVisitor& fn) const
+    {
+        if (n->is_leafnode())
+            return scan_leaf(static_cast<const LeafNode*>(n), lo, hi, fn);
+
+        const InnerNode* inner = static_cast<const InnerNode*>(n);
+        unsigned short slot = lo ? find_lower(inner, *lo) : 0;
+        unsigned short end = inner->slotuse + 1;
+
+        if (inner->level > 1)
+        {
+            for (; slot < end; ++slot)
+            {
+                if (!scan_subtree(inner->childid[slot], lo, hi, fn))
+                    return false;
+                lo = nullptr;
+            }
+            return true;
+        }
+
+        // the children are leaves: keep scan_prefetch leaves in flight.
+        for (unsigned short p = slot;
+             p < end && p < slot + scan_prefetch; ++p)
+            prefetch_leaf(inner->childid[p]);
+
+        for (; slot < end; ++slot)
+        {
+            if (slot + scan_prefetch < end)
+                prefetch_leaf(inner->childid[slot + scan_prefetch]);
+
+            if (!scan_leaf(static_cast<const LeafNode*>(inner->childid[slot]),
+                           lo, hi, fn))
+                return false;
+            lo = nullptr;
+        }
+        return true;
+    }
+
+    //! Scan the leaf for keys in [*lo, *hi) and call fn(leaf, first, last)
+    //! with the range of slots, see scan_subtree().
+    template <typename LeafVisitor>
+    bool scan_leaf(const LeafNode* leaf, const key_type* lo,
+                   const key_type* hi, LeafVisitor& fn) const
+    {
+        unsigned short first = lo ? find_lower(leaf, *lo) : 0;
+        unsigned short last = leaf->slotuse;
+        bool more = true;
+
+        if (hi && last > 0 && !key_less(leaf->key(last - 1), *hi))
+        {
+            last = find_lower(leaf, *hi);
+            more = false;
+        }
+
+        if (first < last)
+            fn(leaf, first, last);
+        return more;
+    }
+
+    //! \}
+
+public:
+    //! \name Parallel Traversal of Subranges
+    //! \{
+
+    //! Split the items [first,last) into at most k consecutive subranges of
+    //! roughly equal size. Returns the boundaries first = b[0] < b[1] < ... <
+    //! b[j] = last with 1 <= j <= k, without walking the leaves. With
+    //! order_statistics the subranges are equal up to one item, found by
+    //! select(). Otherwise the boundaries are the first items of subtrees on
+    //! the highest level which has at least four subtrees per subrange in
+    //! [first,last), hence sizes differ by about the fill factor of the nodes.
+    std::vector<const_iterator> partition(const_iterator first,
+                                          const_iterator last, size_t k) const
+    {
+        std::vector<const_iterator> bounds(1, first);
+
+        if (k > 1 && first != last)
+        {
+            if (order_statistics)
+                partition_select(first, last, k, &bounds);
+            else
+                partition_subtrees(first, last, k, &bounds);
+        }
+
+        bounds.push_back(last);
+        return bounds;
+    }
+
+    //! Split all items into at most k consecutive subranges of roughly equal
+    //! size. See partition(first, last, k).
+    std::vector<const_iterator> partition(size_t k) const
+    {
+        return partition(begin(), end(), k);
+    }
+
+    //! Call fn(value) for each item in [first,last) using num_threads threads.
+    //! Each thread processes one subrange of partition(first, last,
+    //! num_threads) leaf by leaf, hence the threads need no coordination, but
+    //! fn must be safe to call concurrently.
+    template <typename Function>
+    void parallel_for_each(const_iterator first, const_iterator last,
+                           const Function& fn, size_t num_threads) const
+    {
+        std::vector<const_iterator> bounds =
+            partition(first, last, std::max<size_t>(num_threads, 1));
+
+        run_threads(bounds.size() - 1, [this, &bounds, &fn](size_t t) {
+            for_each_slot(bounds[t], bounds[t + 1], fn);
+        });
+    }
+
+    //! Call fn(value) for each item using num_threads threads. See
+    //! parallel_for_each(first, last, fn, num_threads).
+    template <typename Function>
+    void parallel_for_each(const Function& fn, size_t num_threads) const
+    {
+        parallel_for_each(begin(), end(), fn, num_threads);
+    }
+
+private:
+    //! Append the k - 1 inner boundaries of equal subranges of [first,last)
+    //! found by select_counted().
+    void partition_select(const const_iterator& first,
+                          const const_iterator& last, size_t k,
+                          std::vector<const_iterator>* bounds) const
+    {
+        size_type r0 = iterator_rank(first), r1 = iterator_rank(last);
+        size_type prev = r0;
+
+        for (size_t j = 1; j < k; ++j)
+        {
+            size_type r = r0 + (r1 - r0) * j / k;
+            if (r == prev)
+                continue;
+            bounds->push_back(select_counted(r));
+            prev = r;
+        }
+    }
+
+    //! Append boundaries of subranges of [first,last) at the first items of
+    //! subtrees, which are chosen evenly from the highest level having at
+    //! least 4 k subtrees that intersect the key range of [first,last).
+    void partition_subtrees(const const_iterator& first,
+                            const const_iterator& last, size_t k,
+                            std::vector<const_iterator>* bounds) const
+    {
+        const key_type& lo = first.key();
+        bool bounded = (last != end());
+        const key_type* hi = bounded ? &last.key() : nullptr;
+
+        std::vector<const node*> level(1, root_), next;
+
+        while (!level[0]->is_leafnode() && level.size() < 4 * k)
+        {
+            next.clear();
+            for (const node* n : level)
+            {
+                const InnerNode* inner = static_cast<const InnerNode*>(n);
+                unsigned short s = find_lower(inner, lo);
+                unsigned short e = hi ? find_lower(inner, *hi) : inner->slotuse;
+                for (; s <= e && s <= inner->slotuse; ++s)
+                    next.push_back(inner->childid[s]);
+            }
+            level.swap(next);
+        }
+
+        for (size_t j = 1; j < k; ++j)
+        {
+            const node* n = level[j * level.size() / k];
+            while (!n->is_leafnode())
+                n = static_cast<const InnerNode*>(n)->childid[0];
+
+            const_iterator b(static_cast<const LeafNode*>(n), 0);
+
+            // only boundaries strictly inside the key range keep the order of
+            // the iterators, also with duplicate keys.
+            if (!key_less(lo, b.key()) || (hi && !key_less(b.key(), *hi)))
+                continue;
+            if (bounds->size() > 1 && bounds->back() == b)
+                continue;
+            bounds->push_back(b);
+        }
+    }
+
+    //! Call fn(value) for the items [first,last) by walking their leaves.
+    template <typename Function>
+    void for_each_slot(const const_iterator& first, const const_iterator& last,
+                       const Function& fn) const
+    {
+        const LeafNode* leaf = first.curr_leaf;
+        unsigned short slot = first.curr_slot;
+
+        while (leaf != last.curr_leaf)
+        {
+            for (; slot < leaf->slotuse; ++slot)
+                fn(leaf->ref(slot));
+            leaf = leaf->next_leaf;
+            slot = 0;
+        }
+        for (; slot < last.curr_slot; ++slot)
+            fn(leaf->ref(slot));
+    }
+
+    //! \}
+
 public:
     //! \name B+ Tree Object Comparison Functions
     //! \{
@@ -1980,7 +3155,8 @@ public:
                 {
                     root_ = copy_recursive(other.root_);
                 }
-                stats_ = other.stats_;
+                stats_ = other.get_stats();
+                update_allocator_reserved();
             }
 
             if (self_verify)
@@ -2011,77 +3187,270 @@ public:
         }
     }
 
-private:
-    //! Recursively copy nodes from another B+ tree object
-    struct node* copy_recursive(const node* n)
+    //! Replace the contents with a copy of other, which is rebuilt in linear
+    //! time from the leaf chain of other into leaves and inner nodes filled to
+    //! about target_fill of their capacity, like by compact(). The nodes are
+    //! allocated in key order, level by level, and the leaves are copied by up
+    //! to num_threads threads, each taking a contiguous range of the leaves of
+    //! other. The allocator must be thread-safe if num_threads > 1.
+    void assign_compact(const BTree& other, double target_fill = 1.0,
+                        size_t num_threads = 1)
     {
-        if (n->is_leafnode())
-        {
-            const LeafNode* leaf = static_cast<const LeafNode*>(n);
-            LeafNode* newleaf = allocate_leaf();
+        if (this == &other)
+            return compact(target_fill);
 
-            newleaf->slotuse = leaf->slotuse;
-            std::copy(leaf->slotdata, leaf->slotdata + leaf->slotuse,
-                      newleaf->slotdata);
+        clear();
 
-            if (head_leaf_ == nullptr)
-            {
-                head_leaf_ = tail_leaf_ = newleaf;
-                newleaf->prev_leaf = newleaf->next_leaf = nullptr;
-            }
-            else
-            {
-                newleaf->prev_leaf = tail_leaf_;
-                tail_leaf_->next_leaf = newleaf;
-                tail_leaf_ = newleaf;
-            }
+        key_less_ = other.key_comp();
+        allocator_ = other.get_allocator();
 
-            return newleaf;
-        }
+        if (other.empty())
+            return;
 
-        const InnerNode* inner = static_cast<const InnerNode*>(n);
-        InnerNode* newinner = allocate_inner(inner->level);
+        TLX_BTREE_PRINT("BTree::assign_compact: " << other.size()
+                                                  << " items to "
+                                                  << target_fill << " fill.");
 
-        newinner->slotuse = inner->slotuse;
-        std::copy(inner->slotkey, inner->slotkey + inner->slotuse,
-                  newinner->slotkey);
+        size_t leaf_fill =
+            compact_fill(target_fill, leaf_slotmin, leaf_slotmax);
+        size_t inner_fill =
+            compact_fill(target_fill, inner_slotmin + 1, inner_slotmax + 1);
 
-        for (unsigned short slot = 0; slot <= inner->slotuse; ++slot)
-            newinner->childid[slot] = copy_recursive(inner->childid[slot]);
+        std::vector<const LeafNode*> src_leaves;
+        src_leaves.reserve(other.get_stats().leaves);
+        collect_leaves(other.root_, &src_leaves);
 
-        return newinner;
-    }
+        // each thread copies a range of source leaves into its own chain.
+        size_t threads = bulk_load_threads(src_leaves.size(), num_threads);
+        std::vector<std::vector<node*> > thread_nodes(threads);
+        std::vector<std::vector<const key_type*> > thread_maxkeys(threads);
 
-    //! \}
+        run_threads(threads, [&](size_t t) {
+            size_t begin = src_leaves.size() * t / threads;
+            size_t end = src_leaves.size() * (t + 1) / threads;
 
-public:
-    //! \name Public Insertion Functions
-    //! \{
+            size_t num_items = other.size();
+            if (threads > 1)
+            {
+                num_items = 0;
+                for (size_t i = begin; i < end; ++i)
+                    num_items += src_leaves[i]->slotuse;
+            }
+
+            // each range holds at least one source leaf, and hence enough
+            // items for the minimum fill of the new leaves.
+            size_t num_leaves =
+                bulk_load_nodes(num_items, leaf_fill, leaf_slotmax);
+            std::vector<node*>& nodes = thread_nodes[t];
+            std::vector<const key_type*>& maxkeys = thread_maxkeys[t];
+            nodes.resize(num_leaves);
+            maxkeys.resize(num_leaves);
+
+            size_t src = begin;
+            unsigned short src_slot = 0;
+            LeafNode* prev = nullptr;
+
+            for (size_t i = 0; i < num_leaves; ++i)
+            {
+                LeafNode* leaf = construct_leaf();
+                leaf->slotuse =
+                    static_cast<unsigned short>(num_items / (num_leaves - i));
+
+                for (unsigned short s = 0; s < leaf->slotuse; )
+                {
+                    const LeafNode* src_leaf = src_leaves[src];
+                    if (src_slot == src_leaf->slotuse)
+                    {
+                        ++src;
+                        src_slot = 0;
+                        continue;
+                    }
+
+                    unsigned short n = std::min<unsigned short>(
+                        leaf->slotuse - s, src_leaf->slotuse - src_slot);
+                    src_leaf->copy_slots(src_slot, src_slot + n, leaf, s);
+                    src_slot += n;
+                    s += n;
+                }
+
+                leaf->prev_leaf = prev;
+                if (prev != nullptr)
+                    prev->next_leaf = leaf;
+                prev = leaf;
+
+                nodes[i] = leaf;
+                maxkeys[i] = &leaf->key(leaf->slotuse - 1);
+                num_items -= leaf->slotuse;
+            }
+
+            TLX_BTREE_ASSERT(num_items == 0);
+        });
+
+        // concatenate and link the leaf chains of the threads.
+        std::vector<node*> nodes;
+        std::vector<const key_type*> maxkeys;
+        nodes.swap(thread_nodes[0]);
+        maxkeys.swap(thread_maxkeys[0]);
+
+        for (size_t t = 1; t < threads; ++t)
+        {
+            LeafNode* left = static_cast<LeafNode*>(nodes.back());
+            LeafNode* right = static_cast<LeafNode*>(thread_nodes[t].front());
+            left->next_leaf = right;
+            right->prev_leaf = left;
+
+            nodes.insert(nodes.end(), thread_nodes[t].begin(),
+                         thread_nodes[t].end());
+            maxkeys.insert(maxkeys.end(), thread_maxkeys[t].begin(),
+                           thread_maxkeys[t].end());
+        }
+
+        head_leaf_ = static_cast<LeafNode*>(nodes.front());
+        tail_leaf_ = static_cast<LeafNode*>(nodes.back());
+        stats_.size = other.size();
+        stats_.leaves = nodes.size();
+
+        bulk_load_levels(&nodes, &maxkeys, inner_fill, num_threads);
+
+        if (self_verify)
+            verify();
+    }
+
+private:
+    //! Append the leaves of the subtree n to leaves, in key order, by walking
+    //! only the inner nodes.
+    static void collect_leaves(const node* n,
+                               std::vector<const LeafNode*>* leaves)
+    {
+        if (n->is_leafnode())
+        {
+            leaves->push_back(static_cast<const LeafNode*>(n));
+            return;
+        }
+
+        const InnerNode* inner = static_cast<const InnerNode*>(n);
+        if (inner->level == 1)
+        {
+            for (unsigned short s = 0; s <= inner->slotuse; ++s)
+            {
+                leaves->push_back(
+                    static_cast<const LeafNode*>(inner->childid[s]));
+            }
+            return;
+        }
+
+        for (unsigned short s = 0; s <= inner->slotuse; ++s)
+            collect_leaves(inner->childid[s], leaves);
+    }
+
+    //! Recursively copy nodes from another B+ tree object
+    struct node* copy_recursive(const node* n)
+    {
+        if (n->is_leafnode())
+        {
+            const LeafNode* leaf = static_cast<const LeafNode*>(n);
+            LeafNode* newleaf = allocate_leaf();
+
+            newleaf->slotuse = leaf->slotuse;
+            leaf->copy_slots(0, leaf->slotuse, newleaf, 0);
+
+            if (head_leaf_ == nullptr)
+            {
+                head_leaf_ = tail_leaf_ = newleaf;
+                newleaf->prev_leaf = newleaf->next_leaf = nullptr;
+            }
+            else
+            {
+                newleaf->prev_leaf = tail_leaf_;
+                tail_leaf_->next_leaf = newleaf;
+                tail_leaf_ = newleaf;
+            }
+
+            return newleaf;
+        }
+
+        const InnerNode* inner = static_cast<const InnerNode*>(n);
+        InnerNode* newinner = allocate_inner(inner->level);
+
+        newinner->slotuse = inner->slotuse;
+        std::copy(inner->slotkey, inner->slotkey + inner->slotuse,
+                  newinner->slotkey);
+
+        for (unsigned short slot = 0; slot <= inner->slotuse; ++slot)
+            newinner->childid[slot] = copy_recursive(inner->childid[slot]);
+
+        if (order_statistics)
+        {
+            std::copy(inner->counts(), inner->counts() + inner->slotuse + 1,
+                      newinner->counts());
+        }
+
+        return newinner;
+    }
+
+    //! \}
+
+public:
+    //! \name Public Insertion Functions
+    //! \{
 
     //! Attempt to insert a key/data pair into the B+ tree. If the tree does not
     //! allow duplicate keys, then the insert may fail if it is already present.
+    //! Keys greater than all others are appended to the last leaf directly, as
+    //! long as it has a free slot.
     std::pair<iterator, bool> insert(const value_type& x)
     {
-        return insert_start(key_of_value::get(x), x);
+        const key_type& key = key_of_value::get(x);
+
+        if (tail_leaf_ && !tail_leaf_->is_full() &&
+            key_less(tail_leaf_->key(tail_leaf_->slotuse - 1), key))
+        {
+            std::pair<iterator, bool> r;
+            if (insert_leaf_direct(tail_leaf_, key, x, &r))
+                return r;
+        }
+
+        return insert_start(key, x);
     }
 
-    //! Attempt to insert a key/data pair into the B+ tree. The iterator hint is
-    //! currently ignored by the B+ tree insertion routine.
-    iterator insert(iterator /* hint */, const value_type& x)
+    //! Attempt to insert a key/data pair into the B+ tree. The item is placed
+    //! directly into the leaf of the iterator hint if it belongs there and the
+    //! leaf has a free slot. Otherwise the insertion descends from the root as
+    //! usual. The neighbour leaves are not tried, since reading them costs
+    //! about as much as the descent when the hint is poor.
+    iterator insert(iterator hint, const value_type& x)
     {
-        return insert_start(key_of_value::get(x), x).first;
+        const key_type& key = key_of_value::get(x);
+
+        LeafNode* leaf = hint.curr_leaf ? hint.curr_leaf : tail_leaf_;
+
+        if (leaf && leaf->slotuse > 0)
+        {
+            std::pair<iterator, bool> r;
+            if (insert_leaf_direct(leaf, key, x, &r))
+                return r.first;
+        }
+
+        return insert_start(key, x).first;
     }
 
     //! Attempt to insert the range [first,last) of value_type pairs into the B+
-    //! tree. Each key/data pair is inserted individually; to bulk load the
-    //! tree, use a constructor with range.
+    //! tree. Each key/data pair is inserted individually. While the keys
+    //! ascend, the position of the previous one is used as hint, which makes
+    //! inserting ascending runs cheap, other keys are inserted without hint.
+    //! To bulk load the tree, use a constructor with range.
     template <typename InputIterator>
     void insert(InputIterator first, InputIterator last)
     {
+        iterator prev = end();
         InputIterator iter = first;
         while (iter != last)
         {
-            insert(*iter);
+            const value_type& x = *iter;
+            if (prev != end() && !key_less(key_of_value::get(x), prev.key()))
+                prev = insert(prev, x);
+            else
+                prev = insert(x).first;
             ++iter;
         }
     }
@@ -2121,6 +3490,12 @@ private:
 
             newroot->slotuse = 1;
 
+            if (order_statistics)
+            {
+                newroot->counts()[0] = subtree_size(root_);
+                newroot->counts()[1] = subtree_size(newchild);
+            }
+
             root_ = newroot;
         }
 
@@ -2142,6 +3517,86 @@ private:
         return r;
     }
 
+    /*!
+     * Insert an item directly into the given leaf without descending from the
+     * root, which is possible if the leaf has a free slot and the key belongs
+     * into it without changing the leaf's largest key: as the separator keys
+     * in the inner nodes stay valid, no ancestor needs to be found. The only
+     * exception are keys appended to the last leaf, which has no separator
+     * key. Returns false if the insertion must descend from the root.
+     */
+    bool insert_leaf_direct(LeafNode* leaf, const key_type& key,
+                            const value_type& value,
+                            std::pair<iterator, bool>* result)
+    {
+        if (leaf->is_full())
+            return false;
+
+        bool append = (leaf == tail_leaf_ &&
+                       key_less(leaf->key(leaf->slotuse - 1), key));
+
+        if (!append)
+        {
+            // the key must lie within (smallest, largest key] of the leaf, to
+            // arrive at the same leaf and slot as insert_descend(). Keys in
+            // the gap to the previous leaf are left to the descent, to avoid
+            // reading that leaf too.
+            if (key_less(leaf->key(leaf->slotuse - 1), key))
+                return false;
+            if (leaf->prev_leaf && !key_less(leaf->key(0), key))
+                return false;
+            // the subtree sizes of all ancestors would need updating.
+            if (order_statistics)
+                return false;
+        }
+
+        unsigned short slot = append ? leaf->slotuse : find_lower(leaf, key);
+
+        if (!allow_duplicates && slot < leaf->slotuse &&
+            key_equal(key, leaf->key(slot)))
+        {
+            *result = std::pair<iterator, bool>(iterator(leaf, slot), false);
+            return true;
+        }
+
+        TLX_BTREE_PRINT("BTree::insert_leaf_direct into " << leaf << " at slot "
+                                                          << slot);
+
+        leaf->copy_slots_backward(slot, leaf->slotuse, leaf,
+                                  leaf->slotuse + 1);
+
+        leaf->assign(slot, value);
+        leaf->slotuse++;
+
+        if (order_statistics)
+        {
+            // the last leaf's ancestors are on the rightmost path
+            node* n = root_;
+            while (!n->is_leafnode())
+            {
+                InnerNode* inner = static_cast<InnerNode*>(n);
+                ++inner->counts()[inner->slotuse];
+                n = inner->childid[inner->slotuse];
+            }
+        }
+
+        ++stats_.size;
+
+#ifdef TLX_BTREE_DEBUG
+        if (debug)
+            print(std::cout);
+#endif
+
+        if (self_verify)
+        {
+            verify();
+            TLX_BTREE_ASSERT(exists(key));
+        }
+
+        *result = std::pair<iterator, bool>(iterator(leaf, slot), true);
+        return true;
+    }
+
     /*!
      * Insert an item into the B+ tree.
      *
@@ -2169,82 +3624,22 @@ private:
             std::pair<iterator, bool> r = insert_descend(
                 inner->childid[slot], key, value, &newkey, &newchild);
 
+            if (order_statistics)
+            {
+                if (newchild)
+                    inner->counts()[slot] = subtree_size(inner->childid[slot]);
+                else if (r.second)
+                    ++inner->counts()[slot];
+            }
+
             if (newchild)
             {
                 TLX_BTREE_PRINT("BTree::insert_descend newchild"
                                 << " with key " << newkey << " node "
                                 << newchild << " at slot " << slot);
 
-                if (inner->is_full())
-                {
-                    split_inner_node(inner, splitkey, splitnode, slot);
-
-                    TLX_BTREE_PRINT("BTree::insert_descend done split_inner:"
-                                    << " putslot: " << slot << " putkey: "
-                                    << newkey << " upkey: " << *splitkey);
-
-#ifdef TLX_BTREE_DEBUG
-                    if (debug)
-                    {
-                        print_node(std::cout, inner);
-                        print_node(std::cout, *splitnode);
-                    }
-#endif
-
-                    // check if insert slot is in the split sibling node
-                    TLX_BTREE_PRINT("BTree::insert_descend switch: "
-                                    << slot << " > " << inner->slotuse + 1);
-
-                    if (slot == inner->slotuse + 1 &&
-                        inner->slotuse < (*splitnode)->slotuse)
-                    {
-                        // special case when the insert slot matches the split
-                        // place between the two nodes, then the insert key
-                        // becomes the split key.
-
-                        TLX_BTREE_ASSERT(inner->slotuse + 1 < inner_slotmax);
-
-                        InnerNode* split = static_cast<InnerNode*>(*splitnode);
-
-                        // move the split key and it's datum into the left node
-                        inner->slotkey[inner->slotuse] = *splitkey;
-                        inner->childid[inner->slotuse + 1] = split->childid[0];
-                        inner->slotuse++;
-
-                        // set new split key and move corresponding datum into
-                        // right node
-                        split->childid[0] = newchild;
-                        *splitkey = newkey;
-
-                        return r;
-                    }
-
-                    if (slot >= inner->slotuse + 1)
-                    {
-                        // in case the insert slot is in the newly create split
-                        // node, we reuse the code below.
-
-                        slot -= inner->slotuse + 1;
-                        inner = static_cast<InnerNode*>(*splitnode);
-                        TLX_BTREE_PRINT("BTree::insert_descend switching to "
-                                        "splitted node "
-                                        << inner << " slot " << slot);
-                    }
-                }
-
-                // move items and put pointer to child node into correct slot
-                TLX_BTREE_ASSERT(slot >= 0 && slot <= inner->slotuse);
-
-                std::copy_backward(inner->slotkey + slot,
-                                   inner->slotkey + inner->slotuse,
-                                   inner->slotkey + inner->slotuse + 1);
-                std::copy_backward(inner->childid + slot,
-                                   inner->childid + inner->slotuse + 1,
-                                   inner->childid + inner->slotuse + 2);
-
-                inner->slotkey[slot] = newkey;
-                inner->childid[slot + 1] = newchild;
-                inner->slotuse++;
+                insert_inner_child(inner, slot, newkey, newchild, splitkey,
+                                   splitnode);
             }
 
             return r;
@@ -2276,11 +3671,10 @@ private:
         // move items and put data item into correct data slot
         TLX_BTREE_ASSERT(slot >= 0 && slot <= leaf->slotuse);
 
-        std::copy_backward(leaf->slotdata + slot,
-                           leaf->slotdata + leaf->slotuse,
-                           leaf->slotdata + leaf->slotuse + 1);
+        leaf->copy_slots_backward(slot, leaf->slotuse, leaf,
+                                  leaf->slotuse + 1);
 
-        leaf->slotdata[slot] = value;
+        leaf->assign(slot, value);
         leaf->slotuse++;
 
         if (splitnode && leaf != *splitnode && slot == leaf->slotuse - 1)
@@ -2293,6 +3687,99 @@ private:
         return std::pair<iterator, bool>(iterator(leaf, slot), true);
     }
 
+    //! Insert the child node newchild with the split key newkey into the inner
+    //! node right after the child at slot. If the inner node is full, it is
+    //! split and the new sibling and its insertion key are returned in the two
+    //! parameters.
+    void insert_inner_child(InnerNode* inner, unsigned short slot,
+                            const key_type& newkey, node* newchild,
+                            key_type* splitkey, node** splitnode)
+    {
+        if (inner->is_full())
+        {
+            split_inner_node(inner, splitkey, splitnode, slot);
+
+            TLX_BTREE_PRINT("BTree::insert_inner_child done split_inner:"
+                            << " putslot: " << slot << " putkey: " << newkey
+                            << " upkey: " << *splitkey);
+
+#ifdef TLX_BTREE_DEBUG
+            if (debug)
+            {
+                print_node(std::cout, inner);
+                print_node(std::cout, *splitnode);
+            }
+#endif
+
+            // check if insert slot is in the split sibling node
+            TLX_BTREE_PRINT("BTree::insert_inner_child switch: "
+                            << slot << " > " << inner->slotuse + 1);
+
+            if (slot == inner->slotuse + 1 &&
+                inner->slotuse < (*splitnode)->slotuse)
+            {
+                // special case when the insert slot matches the split place
+                // between the two nodes, then the insert key becomes the split
+                // key.
+
+                TLX_BTREE_ASSERT(inner->slotuse + 1 < inner_slotmax);
+
+                InnerNode* split = static_cast<InnerNode*>(*splitnode);
+
+                // move the split key and it's datum into the left node
+                inner->slotkey[inner->slotuse] = *splitkey;
+                inner->childid[inner->slotuse + 1] = split->childid[0];
+                if (order_statistics)
+                    inner->counts()[inner->slotuse + 1] = split->counts()[0];
+                inner->slotuse++;
+
+                // set new split key and move corresponding datum into right
+                // node
+                split->childid[0] = newchild;
+                if (order_statistics)
+                    split->counts()[0] = subtree_size(newchild);
+                *splitkey = newkey;
+
+                return;
+            }
+
+            if (slot >= inner->slotuse + 1)
+            {
+                // in case the insert slot is in the newly create split node,
+                // we reuse the code below.
+
+                slot -= inner->slotuse + 1;
+                inner = static_cast<InnerNode*>(*splitnode);
+                TLX_BTREE_PRINT("BTree::insert_inner_child switching to "
+                                "splitted node "
+                                << inner << " slot " << slot);
+            }
+        }
+
+        // move items and put pointer to child node into correct slot
+        TLX_BTREE_ASSERT(slot >= 0 && slot <= inner->slotuse);
+
+        std::copy_backward(inner->slotkey + slot,
+                           inner->slotkey + inner->slotuse,
+                           inner->slotkey + inner->slotuse + 1);
+        std::copy_backward(inner->childid + slot,
+                           inner->childid + inner->slotuse + 1,
+                           inner->childid + inner->slotuse + 2);
+
+        inner->slotkey[slot] = newkey;
+        inner->childid[slot + 1] = newchild;
+
+        if (order_statistics)
+        {
+            std::copy_backward(inner->counts() + slot + 1,
+                               inner->counts() + inner->slotuse + 1,
+                               inner->counts() + inner->slotuse + 2);
+            inner->counts()[slot + 1] = subtree_size(newchild);
+        }
+
+        inner->slotuse++;
+    }
+
     //! Split up a leaf node into two equally-filled sibling leaves. Returns the
     //! new nodes and it's insertion key in the two parameters.
     void split_leaf_node(LeafNode* leaf, key_type* out_newkey,
@@ -2319,8 +3806,7 @@ private:
             newleaf->next_leaf->prev_leaf = newleaf;
         }
 
-        std::copy(leaf->slotdata + mid, leaf->slotdata + leaf->slotuse,
-                  newleaf->slotdata);
+        leaf->copy_slots(mid, leaf->slotuse, newleaf, 0);
 
         leaf->slotuse = mid;
         leaf->next_leaf = newleaf;
@@ -2364,6 +3850,11 @@ private:
                   newinner->slotkey);
         std::copy(inner->childid + mid + 1, inner->childid + inner->slotuse + 1,
                   newinner->childid);
+        if (order_statistics)
+        {
+            std::copy(inner->counts() + mid + 1,
+                      inner->counts() + inner->slotuse + 1, newinner->counts());
+        }
 
         inner->slotuse = mid;
 
@@ -2423,7 +3914,30 @@ public:
         }
 
         TLX_BTREE_ASSERT(it == iend && num_items == 0);
+        TLX_BTREE_ASSERT(stats_.leaves == num_leaves);
+
+        bulk_load_inner(num_leaves, inner_slotmax + 1);
+
+        if (self_verify)
+            verify();
+    }
+
+private:
+    //! Number of nodes to hold num items or children with about per_node in
+    //! each, but at most max_node. The items are then distributed evenly, each
+    //! node gets at least per_node or max_node / 2 of them.
+    static size_t bulk_load_nodes(size_t num, size_t per_node,
+                                  size_t max_node)
+    {
+        return std::max<size_t>(
+            1, std::max(num / per_node, (num + max_node - 1) / max_node));
+    }
 
+    //! Construct the inner nodes above the chain of num_leaves leaves from
+    //! head_leaf_ to tail_leaf_, with about children_per_node children in
+    //! each inner node, and set root_.
+    void bulk_load_inner(size_t num_leaves, size_t children_per_node)
+    {
         // if the btree is so small to fit into one leaf, then we're done.
         if (head_leaf_ == tail_leaf_)
         {
@@ -2431,11 +3945,9 @@ public:
             return;
         }
 
-        TLX_BTREE_ASSERT(stats_.leaves == num_leaves);
-
         // create first level of inner nodes, pointing to the leaves.
-        size_t num_parents =
-            (num_leaves + (inner_slotmax + 1) - 1) / (inner_slotmax + 1);
+        size_t num_parents = bulk_load_nodes(num_leaves, children_per_node,
+                                             inner_slotmax + 1);
 
         TLX_BTREE_PRINT("BTree::bulk_load, level 1: "
                         << num_leaves << " leaves in " << num_parents
@@ -2463,9 +3975,13 @@ public:
             {
                 n->slotkey[s] = leaf->key(leaf->slotuse - 1);
                 n->childid[s] = leaf;
+                if (order_statistics)
+                    n->counts()[s] = leaf->slotuse;
                 leaf = leaf->next_leaf;
             }
             n->childid[n->slotuse] = leaf;
+            if (order_statistics)
+                n->counts()[n->slotuse] = leaf->slotuse;
 
             // track max key of any descendant.
             nextlevel[i].first = n;
@@ -2481,8 +3997,8 @@ public:
         for (int level = 2; num_parents != 1; ++level)
         {
             size_t num_children = num_parents;
-            num_parents =
-                (num_children + (inner_slotmax + 1) - 1) / (inner_slotmax + 1);
+            num_parents = bulk_load_nodes(num_children, children_per_node,
+                                          inner_slotmax + 1);
 
             TLX_BTREE_PRINT("BTree::bulk_load, level "
                             << level << ": " << num_children << " children in "
@@ -2506,9 +4022,16 @@ public:
                 {
                     n->slotkey[s] = *nextlevel[inner_index].second;
                     n->childid[s] = nextlevel[inner_index].first;
+                    if (order_statistics)
+                        n->counts()[s] = subtree_size(n->childid[s]);
                     ++inner_index;
                 }
                 n->childid[n->slotuse] = nextlevel[inner_index].first;
+                if (order_statistics)
+                {
+                    n->counts()[n->slotuse] =
+                        subtree_size(n->childid[n->slotuse]);
+                }
 
                 // reuse nextlevel array for parents, because we can overwrite
                 // slots we've already consumed.
@@ -2524,1190 +4047,2879 @@ public:
 
         root_ = nextlevel[0].first;
         delete[] nextlevel;
-
-        if (self_verify)
-            verify();
     }
 
-    //! \}
+public:
+    //! Bulk load a sorted range using num_threads threads. The leaves and
+    //! each level of inner nodes are cut into contiguous ranges of nodes, which
+    //! are filled concurrently, and the leaf links are stitched together at the
+    //! range boundaries. The resulting tree has exactly the same layout as one
+    //! constructed by bulk_load(ibegin, iend). The tree must be empty when
+    //! calling this function, and the allocator must be thread-safe.
+    template <typename Iterator>
+    void bulk_load(Iterator ibegin, Iterator iend, size_t num_threads)
+    {
+        TLX_BTREE_ASSERT(empty());
 
-private:
-    //! \name Support Class Encapsulating Deletion Results
-    //! \{
+        size_t num_items = iend - ibegin;
+        size_t num_leaves = (num_items + leaf_slotmax - 1) / leaf_slotmax;
 
-    //! Result flags of recursive deletion.
-    enum result_flags_t
-    {
-        //! Deletion successful and no fix-ups necessary.
-        btree_ok = 0,
+        size_t threads = bulk_load_threads(num_leaves, num_threads);
+        if (threads <= 1)
+            return bulk_load(ibegin, iend);
 
-        //! Deletion not successful because key was not found.
-        btree_not_found = 1,
+        TLX_BTREE_PRINT("BTree::bulk_load, level 0: "
+                        << num_items << " items into " << num_leaves
+                        << " leaves with " << threads << " threads.");
 
-        //! Deletion successful, the last key was updated so parent slotkeys
-        //! need updates.
-        btree_update_lastkey = 2,
+        stats_.size = num_items;
 
-        //! Deletion successful, children nodes were merged and the parent needs
-        //! to remove the empty node.
-        btree_fixmerge = 4
-    };
+        // nodes of the current level and the max key in each of their subtrees
+        std::vector<node*> nodes(num_leaves);
+        std::vector<const key_type*> maxkeys(num_leaves);
 
-    //! B+ tree recursive deletion has much information which is needs to be
-    //! passed upward.
-    struct result_t
-    {
-        //! Merged result flags
-        result_flags_t flags;
+        run_threads(threads, [&](size_t t) {
+            size_t begin = num_leaves * t / threads;
+            size_t end = num_leaves * (t + 1) / threads;
 
-        //! The key to be updated at the parent's slot
-        key_type lastkey;
+            Iterator it =
+                ibegin + bulk_load_offset(num_items, num_leaves, begin);
+            LeafNode* prev = nullptr;
 
-        //! Constructor of a result with a specific flag, this can also be used
-        //! as for implicit conversion.
-        result_t(result_flags_t f = btree_ok) : flags(f), lastkey()
-        {
-        }
+            for (size_t i = begin; i < end; ++i)
+            {
+                LeafNode* leaf = construct_leaf();
+
+                // copy keys or (key,value) pairs into leaf nodes, uses template
+                // switch leaf->set_slot().
+                leaf->slotuse = static_cast<unsigned short>(
+                    bulk_load_offset(num_items, num_leaves, i + 1) -
+                    bulk_load_offset(num_items, num_leaves, i));
+                for (size_t s = 0; s < leaf->slotuse; ++s, ++it)
+                    leaf->set_slot(s, *it);
+
+                leaf->prev_leaf = prev;
+                if (prev != nullptr)
+                    prev->next_leaf = leaf;
+                prev = leaf;
+
+                nodes[i] = leaf;
+                maxkeys[i] = &leaf->key(leaf->slotuse - 1);
+            }
+        });
 
-        //! Constructor with a lastkey value.
-        result_t(result_flags_t f, const key_type& k) : flags(f), lastkey(k)
+        // link the leaf ranges of the threads together.
+        for (size_t t = 1; t < threads; ++t)
         {
+            size_t i = num_leaves * t / threads;
+            LeafNode* left = static_cast<LeafNode*>(nodes[i - 1]);
+            LeafNode* right = static_cast<LeafNode*>(nodes[i]);
+            left->next_leaf = right;
+            right->prev_leaf = left;
         }
 
-        //! Test if this result object has a given flag set.
-        bool has(result_flags_t f) const
-        {
-            return (flags & f) != 0;
-        }
+        head_leaf_ = static_cast<LeafNode*>(nodes.front());
+        tail_leaf_ = static_cast<LeafNode*>(nodes.back());
+        stats_.leaves = num_leaves;
 
-        //! Merge two results OR-ing the result flags and overwriting lastkeys.
-        result_t& operator|=(const result_t& other)
+        bulk_load_levels(&nodes, &maxkeys, inner_slotmax + 1, num_threads);
+
+        if (self_verify)
+            verify();
+    }
+
+private:
+    //! Number of items placed into the first i of num_nodes nodes by the bulk
+    //! loader. Equivalent to the running sum of the loop in bulk_load(), which
+    //! assigns num_items / num_nodes items to the first nodes and one more to
+    //! the last (num_items % num_nodes) ones.
+    static size_t bulk_load_offset(size_t num_items, size_t num_nodes,
+                                   size_t i)
+    {
+        size_t q = num_items / num_nodes;
+        size_t m = num_items % num_nodes;
+        return i * q + (i > num_nodes - m ? i - (num_nodes - m) : 0);
+    }
+
+    //! Construct the levels of inner nodes above the nodes of one level and
+    //! the max keys of their subtrees, with about children_per_node children
+    //! in each inner node, using up to num_threads threads, and set root_. The
+    //! two vectors are used as scratch space.
+    void bulk_load_levels(std::vector<node*>* nodes,
+                          std::vector<const key_type*>* maxkeys,
+                          size_t children_per_node, size_t num_threads)
+    {
+        std::vector<node*> parents;
+        std::vector<const key_type*> parent_maxkeys;
+
+        for (unsigned short level = 1; nodes->size() != 1; ++level)
         {
-            flags = result_flags_t(flags | other.flags);
+            size_t num_children = nodes->size();
+            size_t num_parents = bulk_load_nodes(
+                num_children, children_per_node, inner_slotmax + 1);
 
-            // we overwrite existing lastkeys on purpose
-            if (other.has(btree_update_lastkey))
-                lastkey = other.lastkey;
+            TLX_BTREE_PRINT("BTree::bulk_load, level "
+                            << level << ": " << num_children << " children in "
+                            << num_parents << " inner nodes.");
 
-            return *this;
+            parents.resize(num_parents);
+            parent_maxkeys.resize(num_parents);
+
+            size_t threads = bulk_load_threads(num_parents, num_threads);
+
+            run_threads(threads, [&](size_t t) {
+                size_t begin = num_parents * t / threads;
+                size_t end = num_parents * (t + 1) / threads;
+
+                for (size_t i = begin; i < end; ++i)
+                {
+                    size_t cbegin =
+                        bulk_load_offset(num_children, num_parents, i);
+                    size_t cend =
+                        bulk_load_offset(num_children, num_parents, i + 1);
+
+                    InnerNode* n = construct_inner(level);
+
+                    // an inner node has one key less than children.
+                    n->slotuse = static_cast<unsigned short>(cend - cbegin - 1);
+                    TLX_BTREE_ASSERT(n->slotuse > 0);
+
+                    for (unsigned short s = 0; s < n->slotuse; ++s)
+                    {
+                        n->slotkey[s] = *(*maxkeys)[cbegin + s];
+                        n->childid[s] = (*nodes)[cbegin + s];
+                    }
+                    n->childid[n->slotuse] = (*nodes)[cend - 1];
+
+                    if (order_statistics)
+                    {
+                        for (unsigned short s = 0; s <= n->slotuse; ++s)
+                            n->counts()[s] = subtree_size(n->childid[s]);
+                    }
+
+                    parents[i] = n;
+                    parent_maxkeys[i] = (*maxkeys)[cend - 1];
+                }
+            });
+
+            stats_.inner_nodes += num_parents;
+
+            nodes->swap(parents);
+            maxkeys->swap(parent_maxkeys);
         }
-    };
+
+        root_ = (*nodes)[0];
+        update_allocator_reserved();
+    }
+
+    //! Number of threads used by the parallel bulk loader to construct
+    //! num_nodes nodes, such that each thread gets a reasonable amount of work.
+    static size_t bulk_load_threads(size_t num_nodes, size_t num_threads)
+    {
+        return std::max<size_t>(1, std::min(num_threads, num_nodes / 64));
+    }
+
+    //! Run fn(t) for t = 0..num_threads-1 on separate threads and wait for
+    //! them, the calling thread runs fn(0).
+    template <typename Functor>
+    static void run_threads(size_t num_threads, const Functor& fn)
+    {
+        std::vector<std::thread> threads;
+        threads.reserve(num_threads - 1);
+        for (size_t t = 1; t < num_threads; ++t)
+            threads.emplace_back(fn, t);
+        fn(0);
+        for (std::thread& th : threads)
+            th.join();
+    }
 
     //! \}
 
 public:
-    //! \name Public Erase Functions
+    //! \name Compaction of the Tree
     //! \{
 
-    //! Erases one (the first) of the key/data pairs associated with the given
-    //! key.
-    bool erase_one(const key_type& key)
+    //! Re-pack all items into leaves and inner nodes filled to about
+    //! target_fill of their capacity, which is clamped to the range from the
+    //! minimum fill to 1.0, in linear time. The leaves are rewritten in order,
+    //! each old leaf is freed as soon as its items are moved, hence at most
+    //! one extra leaf is needed. The inner nodes are rebuilt like by
+    //! bulk_load(). Invalidates all iterators.
+    void compact(double target_fill = 1.0)
     {
-        TLX_BTREE_PRINT("BTree::erase_one(" << key << ") on btree size "
-                                            << size());
+        if (!root_)
+            return;
 
-        if (self_verify)
-            verify();
+        TLX_BTREE_PRINT("BTree::compact: " << size() << " items in "
+                                           << stats_.leaves << " leaves to "
+                                           << target_fill << " fill.");
 
-        if (!root_)
-            return false;
+        size_t leaf_fill =
+            compact_fill(target_fill, leaf_slotmin, leaf_slotmax);
+        size_t inner_fill =
+            compact_fill(target_fill, inner_slotmin + 1, inner_slotmax + 1);
 
-        result_t result = erase_one_descend(key, root_, nullptr, nullptr,
-                                            nullptr, nullptr, nullptr, 0);
+        // free the inner nodes, keeping the leaf chain.
+        if (!root_->is_leafnode())
+        {
+            free_inner_recursive(root_);
+            root_ = nullptr;
+        }
 
-        if (!result.has(btree_not_found))
-            --stats_.size;
+        size_t num_items = size();
+        size_t num_leaves =
+            bulk_load_nodes(num_items, leaf_fill, leaf_slotmax);
+
+        LeafNode* old_leaf = head_leaf_;
+        unsigned short old_slot = 0;
+        head_leaf_ = tail_leaf_ = nullptr;
+
+        for (size_t i = 0; i < num_leaves; ++i)
+        {
+            LeafNode* leaf = allocate_leaf();
+            leaf->slotuse =
+                static_cast<unsigned short>(num_items / (num_leaves - i));
+
+            // move items from the old leaves, freeing each one when empty.
+            for (unsigned short s = 0; s < leaf->slotuse; )
+            {
+                if (old_slot == old_leaf->slotuse)
+                {
+                    LeafNode* next = old_leaf->next_leaf;
+                    free_node(old_leaf);
+                    old_leaf = next;
+                    old_slot = 0;
+                    continue;
+                }
+
+                unsigned short n = std::min<unsigned short>(
+                    leaf->slotuse - s, old_leaf->slotuse - old_slot);
+                old_leaf->copy_slots(old_slot, old_slot + n, leaf, s);
+                old_slot += n;
+                s += n;
+            }
+
+            if (tail_leaf_ != nullptr)
+            {
+                tail_leaf_->next_leaf = leaf;
+                leaf->prev_leaf = tail_leaf_;
+            }
+            else
+            {
+                head_leaf_ = leaf;
+            }
+            tail_leaf_ = leaf;
+
+            num_items -= leaf->slotuse;
+        }
+
+        TLX_BTREE_ASSERT(num_items == 0);
+        TLX_BTREE_ASSERT(old_leaf->next_leaf == nullptr &&
+                         old_slot == old_leaf->slotuse);
+        free_node(old_leaf);
+
+        bulk_load_inner(num_leaves, inner_fill);
 
-#ifdef TLX_BTREE_DEBUG
-        if (debug)
-            print(std::cout);
-#endif
         if (self_verify)
             verify();
-
-        return !result.has(btree_not_found);
     }
 
-    //! Erases all the key/data pairs associated with the given key. This is
-    //! implemented using erase_one().
-    size_type erase(const key_type& key)
+private:
+    //! Number of items or children per node for a target_fill of max_fill,
+    //! clamped to the range [min_fill,max_fill].
+    static size_t compact_fill(double target_fill, size_t min_fill,
+                               size_t max_fill)
     {
-        size_type c = 0;
+        target_fill = std::min(std::max(target_fill, 0.0), 1.0);
+        return std::max<size_t>(
+            min_fill, static_cast<size_t>(target_fill * max_fill + 0.5));
+    }
 
-        while (erase_one(key))
+    //! Free all inner nodes of the subtree n, but not the leaves.
+    void free_inner_recursive(node* n)
+    {
+        InnerNode* inner = static_cast<InnerNode*>(n);
+        if (inner->level > 1)
         {
-            ++c;
-            if (!allow_duplicates)
-                break;
+            for (unsigned short s = 0; s < inner->slotuse + 1; ++s)
+                free_inner_recursive(inner->childid[s]);
         }
-
-        return c;
+        free_node(inner);
     }
 
-    //! Erase the key/data pair referenced by the iterator.
-    void erase(iterator iter)
-    {
-        TLX_BTREE_PRINT("BTree::erase_iter(" << iter.curr_leaf << ","
-                                             << iter.curr_slot
-                                             << ") on btree size " << size());
+    //! \}
 
-        if (self_verify)
-            verify();
+public:
+    //! \name Batch Insertion of a Sorted Run
+    //! \{
+
+    //! Insert the sorted range [first,last) into the possibly non-empty tree.
+    //! The run is merged into the tree in one pass: each affected leaf is
+    //! visited once, its items are merged with the new ones and, if they do
+    //! not fit, split into as many evenly filled leaves as needed. The new
+    //! separators are then added to the parents in bulk, splitting these
+    //! several ways as well. If the tree does not allow duplicate keys, items
+    //! whose key is already present, or equal to a preceding item of the run,
+    //! are skipped. Returns the number of items inserted.
+    template <typename Iterator>
+    size_type insert_sorted(Iterator first, Iterator last)
+    {
+        if (first == last)
+            return 0;
 
         if (!root_)
-            return;
+            root_ = head_leaf_ = tail_leaf_ = allocate_leaf();
 
-        result_t result = erase_iter_descend(iter, root_, nullptr, nullptr,
-                                             nullptr, nullptr, nullptr, 0);
+        TLX_BTREE_PRINT("BTree::insert_sorted into tree of size " << size());
 
-        if (!result.has(btree_not_found))
-            --stats_.size;
+        std::vector<value_type> buffer;
+        std::vector<std::pair<key_type, node*> > splits;
+        size_type inserted = 0;
+
+        insert_sorted_descend(root_, first, last, &buffer, &splits, &inserted);
+
+        // the root was split: put new roots above it until one suffices.
+        while (!splits.empty())
+        {
+            std::vector<node*> children(1, root_);
+            std::vector<key_type> keys;
+            std::vector<size_type> counts;
+            for (const std::pair<key_type, node*>& s : splits)
+            {
+                keys.push_back(s.first);
+                children.push_back(s.second);
+            }
+            if (order_statistics)
+            {
+                for (const node* n : children)
+                    counts.push_back(subtree_size(n));
+            }
+
+            InnerNode* newroot = allocate_inner(root_->level + 1);
+            splits.clear();
+            insert_sorted_fill_inner(newroot, children, keys, counts, &splits);
+            root_ = newroot;
+        }
+
+        stats_.size += inserted;
+        update_allocator_reserved();
 
 #ifdef TLX_BTREE_DEBUG
         if (debug)
             print(std::cout);
 #endif
+
         if (self_verify)
             verify();
-    }
 
-#ifdef BTREE_TODO
-    //! Erase all key/data pairs in the range [first,last). This function is
-    //! currently not implemented by the B+ Tree.
-    void erase(iterator /* first */, iterator /* last */)
-    {
-        abort();
+        return inserted;
     }
-#endif
 
     //! \}
 
 private:
-    //! \name Private Erase Functions
+    //! \name Private Batch Insertion Functions
     //! \{
 
-    /*!
-     * Erase one (the first) key/data pair in the B+ tree matching key.
-     *
-     * Descends down the tree in search of key. During the descent the parent,
-     * left and right siblings and their parents are computed and passed
-     * down. Once the key/data pair is found, it is removed from the leaf. If
-     * the leaf underflows 6 different cases are handled. These cases resolve
-     * the underflow by shifting key/data pairs from adjacent sibling nodes,
-     * merging two sibling nodes or trimming the tree.
-     */
-    result_t erase_one_descend(const key_type& key, node* curr, node* left,
-                               node* right, InnerNode* left_parent,
-                               InnerNode* right_parent, InnerNode* parent,
-                               unsigned int parentslot)
+    //! Merge the sorted range [first,last) into the subtree n. The keys are
+    //! routed to the children by the separators, hence all keys are at most
+    //! the maximum key of n, except on the rightmost path. If n must be split,
+    //! the new right siblings are appended to splits, each with the maximum
+    //! key of the node left of it.
+    template <typename Iterator>
+    void insert_sorted_descend(
+        node* n, Iterator first, Iterator last,
+        std::vector<value_type>* buffer,
+        std::vector<std::pair<key_type, node*> >* splits, size_type* inserted)
     {
-        if (curr->is_leafnode())
+        if (n->is_leafnode())
         {
-            LeafNode* leaf = static_cast<LeafNode*>(curr);
-            LeafNode* left_leaf = static_cast<LeafNode*>(left);
-            LeafNode* right_leaf = static_cast<LeafNode*>(right);
+            insert_sorted_leaf(static_cast<LeafNode*>(n), first, last, buffer,
+                               splits, inserted);
+            return;
+        }
 
-            unsigned short slot = find_lower(leaf, key);
+        InnerNode* inner = static_cast<InnerNode*>(n);
 
-            if (slot >= leaf->slotuse || !key_equal(key, leaf->key(slot)))
-            {
-                TLX_BTREE_PRINT("Could not find key " << key << " to erase.");
+        // new children created below inner, and the slots they follow
+        std::vector<std::pair<key_type, node*> > new_children;
+        std::vector<unsigned short> new_slots;
 
-                return btree_not_found;
-            }
+        Iterator it = first;
+        while (it != last)
+        {
+            unsigned short slot = find_lower(inner, key_of_value::get(*it));
 
-            TLX_BTREE_PRINT("Found key in leaf " << curr << " at slot "
-                                                 << slot);
+            Iterator child_first = it;
+            if (slot < inner->slotuse)
+            {
+                ++it;
+                while (it != last &&
+                       !key_less(inner->slotkey[slot], key_of_value::get(*it)))
+                    ++it;
+            }
+            else
+            {
+                it = last;
+            }
 
-            std::copy(leaf->slotdata + slot + 1, leaf->slotdata + leaf->slotuse,
-                      leaf->slotdata + slot);
+            insert_sorted_descend(inner->childid[slot], child_first, it,
+                                  buffer, &new_children, inserted);
+            new_slots.resize(new_children.size(), slot);
 
-            leaf->slotuse--;
+            if (order_statistics)
+                inner->counts()[slot] = subtree_size(inner->childid[slot]);
+        }
 
-            result_t myres = btree_ok;
+        if (new_children.empty())
+            return;
 
-            // if the last key of the leaf was changed, the parent is notified
-            // and updates the key of this leaf
-            if (slot == leaf->slotuse)
+        if (inner->slotuse + new_children.size() <= inner_slotmax)
+        {
+            // interleave the new children in place, from the back
+            int out = inner->slotuse + static_cast<int>(new_children.size());
+            int j = static_cast<int>(new_children.size()) - 1;
+            for (int slot = inner->slotuse; slot >= 0; --slot)
             {
-                if (parent && parentslot < parent->slotuse)
-                {
-                    TLX_BTREE_ASSERT(parent->childid[parentslot] == curr);
-                    parent->slotkey[parentslot] = leaf->key(leaf->slotuse - 1);
-                }
-                else
+                if (slot < inner->slotuse)
+                    inner->slotkey[out] = inner->slotkey[slot];
+
+                for ( ; j >= 0 && new_slots[j] == slot; --j, --out)
                 {
-                    if (leaf->slotuse >= 1)
-                    {
-                        TLX_BTREE_PRINT("Scheduling lastkeyupdate: key "
-                                        << leaf->key(leaf->slotuse - 1));
-                        myres |= result_t(btree_update_lastkey,
-                                          leaf->key(leaf->slotuse - 1));
-                    }
-                    else
+                    inner->childid[out] = new_children[j].second;
+                    inner->slotkey[out - 1] = new_children[j].first;
+                    if (order_statistics)
                     {
-                        TLX_BTREE_ASSERT(leaf == root_);
+                        inner->counts()[out] =
+                            subtree_size(new_children[j].second);
                     }
                 }
+
+                inner->childid[out] = inner->childid[slot];
+                if (order_statistics)
+                    inner->counts()[out] = inner->counts()[slot];
+                --out;
             }
+            inner->slotuse += static_cast<unsigned short>(new_children.size());
+            return;
+        }
 
-            if (leaf->is_underflow() && !(leaf == root_ && leaf->slotuse >= 1))
-            {
-                // determine what to do about the underflow
+        // interleave the new children with the old ones and redistribute
+        std::vector<node*> children;
+        std::vector<key_type> keys;
+        std::vector<size_type> counts;
+        children.reserve(inner->slotuse + 1 + new_children.size());
+        keys.reserve(inner->slotuse + new_children.size());
 
-                // case : if this empty leaf is the root, then delete all nodes
-                // and set root to nullptr.
-                if (left_leaf == nullptr && right_leaf == nullptr)
-                {
-                    TLX_BTREE_ASSERT(leaf == root_);
-                    TLX_BTREE_ASSERT(leaf->slotuse == 0);
+        size_t j = 0;
+        for (unsigned short slot = 0; slot <= inner->slotuse; ++slot)
+        {
+            children.push_back(inner->childid[slot]);
+            if (order_statistics)
+                counts.push_back(inner->counts()[slot]);
 
-                    free_node(root_);
+            for ( ; j < new_children.size() && new_slots[j] == slot; ++j)
+            {
+                keys.push_back(new_children[j].first);
+                children.push_back(new_children[j].second);
+                if (order_statistics)
+                    counts.push_back(subtree_size(new_children[j].second));
+            }
 
-                    root_ = leaf = nullptr;
-                    head_leaf_ = tail_leaf_ = nullptr;
+            if (slot < inner->slotuse)
+                keys.push_back(inner->slotkey[slot]);
+        }
 
-                    // will be decremented soon by insert_start()
-                    TLX_BTREE_ASSERT(stats_.size == 1);
-                    TLX_BTREE_ASSERT(stats_.leaves == 0);
-                    TLX_BTREE_ASSERT(stats_.inner_nodes == 0);
+        insert_sorted_fill_inner(inner, children, keys, counts, splits);
+    }
 
-                    return btree_ok;
-                }
-                // case : if both left and right leaves would underflow in case
-                // of a shift, then merging is necessary. choose the more local
-                // merger with our parent
-                if ((left_leaf == nullptr || left_leaf->is_few()) &&
-                    (right_leaf == nullptr || right_leaf->is_few()))
-                {
-                    if (left_parent == parent)
-                        myres |= merge_leaves(left_leaf, leaf, left_parent);
-                    else
-                        myres |= merge_leaves(leaf, right_leaf, right_parent);
-                }
-                // case : the right leaf has extra data, so balance right with
-                // current
-                else if ((left_leaf != nullptr && left_leaf->is_few()) &&
-                         (right_leaf != nullptr && !right_leaf->is_few()))
-                {
-                    if (right_parent == parent)
-                        myres |= shift_left_leaf(leaf, right_leaf, right_parent,
-                                                 parentslot);
-                    else
-                        myres |= merge_leaves(left_leaf, leaf, left_parent);
-                }
-                // case : the left leaf has extra data, so balance left with
-                // current
-                else if ((left_leaf != nullptr && !left_leaf->is_few()) &&
-                         (right_leaf != nullptr && right_leaf->is_few()))
-                {
-                    if (left_parent == parent)
-                        shift_right_leaf(left_leaf, leaf, left_parent,
-                                         parentslot - 1);
-                    else
-                        myres |= merge_leaves(leaf, right_leaf, right_parent);
-                }
-                // case : both the leaf and right leaves have extra data and our
-                // parent, choose the leaf with more data
-                else if (left_parent == right_parent)
-                {
-                    if (left_leaf->slotuse <= right_leaf->slotuse)
-                        myres |= shift_left_leaf(leaf, right_leaf, right_parent,
-                                                 parentslot);
-                    else
-                        shift_right_leaf(left_leaf, leaf, left_parent,
-                                         parentslot - 1);
-                }
-                else
+    //! Merge the sorted range [first,last) into the items of leaf. If the
+    //! items fit, they are merged in place from the back. Otherwise they are
+    //! merged into buffer and distributed over leaf and as many new leaves as
+    //! needed.
+    template <typename Iterator>
+    void insert_sorted_leaf(
+        LeafNode* leaf, Iterator first, Iterator last,
+        std::vector<value_type>* buffer,
+        std::vector<std::pair<key_type, node*> >* splits, size_type* inserted)
+    {
+        // count the items to insert, skipping duplicates in unique trees.
+        size_t num_new = 0;
+        if (allow_duplicates)
+        {
+            num_new = last - first;
+        }
+        else
+        {
+            unsigned short slot = 0;
+            for (Iterator it = first; it != last; ++it)
+            {
+                const key_type& key = key_of_value::get(*it);
+                if (it != first && key_equal(key_of_value::get(*(it - 1)), key))
+                    continue;
+                while (slot < leaf->slotuse && key_less(leaf->key(slot), key))
+                    ++slot;
+                if (slot < leaf->slotuse && key_equal(leaf->key(slot), key))
+                    continue;
+                ++num_new;
+            }
+            if (num_new == 0)
+                return;
+        }
+        *inserted += num_new;
+
+        // new items are placed before existing items with an equal key, like
+        // insert() does.
+        if (leaf->slotuse + num_new <= leaf_slotmax)
+        {
+            int num_items = static_cast<int>(leaf->slotuse + num_new);
+            int slot = leaf->slotuse - 1;
+            int out = num_items - 1;
+            for (Iterator it = last; it != first; --it)
+            {
+                const key_type& key = key_of_value::get(*(it - 1));
+                if (!allow_duplicates && it - 1 != first &&
+                    key_equal(key_of_value::get(*(it - 2)), key))
+                    continue;
+
+                // shift the existing items not less than key
+                int lo = 0, hi = slot + 1;
+                while (lo < hi)
                 {
-                    if (left_parent == parent)
-                        shift_right_leaf(left_leaf, leaf, left_parent,
-                                         parentslot - 1);
+                    int mid = (lo + hi) >> 1;
+                    if (key_less(leaf->key(mid), key))
+                        lo = mid + 1;
                     else
-                        myres |= shift_left_leaf(leaf, right_leaf, right_parent,
-                                                 parentslot);
+                        hi = mid;
                 }
-            }
+                leaf->copy_slots_backward(lo, slot + 1, leaf, out + 1);
+                out -= slot + 1 - lo;
+                slot = lo - 1;
 
-            return myres;
+                // in unique trees, skip keys equal to the existing item moved
+                if (!allow_duplicates && out + 1 < num_items &&
+                    key_equal(leaf->key(out + 1), key))
+                    continue;
+
+                leaf->assign(out--, *(it - 1));
+            }
+            leaf->slotuse += static_cast<unsigned short>(num_new);
+            return;
         }
 
-        // !curr->is_leafnode()
-        InnerNode* inner = static_cast<InnerNode*>(curr);
-        InnerNode* left_inner = static_cast<InnerNode*>(left);
-        InnerNode* right_inner = static_cast<InnerNode*>(right);
+        buffer->clear();
+        unsigned short slot = 0;
+        for (Iterator it = first; it != last; ++it)
+        {
+            const key_type& key = key_of_value::get(*it);
 
-        node *myleft, *myright;
-        InnerNode *myleft_parent, *myright_parent;
+            while (slot < leaf->slotuse && key_less(leaf->key(slot), key))
+                buffer->push_back(leaf->value(slot++));
 
-        unsigned short slot = find_lower(inner, key);
+            if (!allow_duplicates)
+            {
+                if (slot < leaf->slotuse && key_equal(key, leaf->key(slot)))
+                    continue;
+                if (!buffer->empty() &&
+                    key_equal(key, key_of_value::get(buffer->back())))
+                    continue;
+            }
 
-        if (slot == 0)
-        {
-            myleft =
-                (left == nullptr) ?
-                    nullptr :
-                    static_cast<InnerNode*>(left)->childid[left->slotuse - 1];
-            myleft_parent = left_parent;
-        }
-        else
-        {
-            myleft = inner->childid[slot - 1];
-            myleft_parent = inner;
+            buffer->push_back(*it);
         }
+        while (slot < leaf->slotuse)
+            buffer->push_back(leaf->value(slot++));
 
-        if (slot == inner->slotuse)
-        {
-            myright = (right == nullptr) ?
-                          nullptr :
-                          static_cast<InnerNode*>(right)->childid[0];
-            myright_parent = right_parent;
-        }
-        else
+        size_t num_items = buffer->size();
+        size_t num_leaves = (num_items + leaf_slotmax - 1) / leaf_slotmax;
+
+        TLX_BTREE_PRINT("BTree::insert_sorted_leaf: " << num_items
+                                                      << " items into "
+                                                      << num_leaves
+                                                      << " leaves");
+
+        LeafNode* prev = nullptr;
+        for (size_t i = 0; i < num_leaves; ++i)
         {
-            myright = inner->childid[slot + 1];
-            myright_parent = inner;
-        }
+            size_t begin = bulk_load_offset(num_items, num_leaves, i);
+            size_t end = bulk_load_offset(num_items, num_leaves, i + 1);
 
-        TLX_BTREE_PRINT("erase_one_descend into " << inner->childid[slot]);
+            LeafNode* n = leaf;
+            if (i != 0)
+            {
+                n = allocate_leaf();
 
-        result_t result =
-            erase_one_descend(key, inner->childid[slot], myleft, myright,
-                              myleft_parent, myright_parent, inner, slot);
+                // link the new leaf after prev
+                n->prev_leaf = prev;
+                n->next_leaf = prev->next_leaf;
+                if (n->next_leaf)
+                    n->next_leaf->prev_leaf = n;
+                else
+                    tail_leaf_ = n;
+                prev->next_leaf = n;
 
-        result_t myres = btree_ok;
+                splits->push_back(
+                    std::make_pair(prev->key(prev->slotuse - 1), n));
+            }
 
-        if (result.has(btree_not_found))
-        {
-            return result;
+            for (size_t j = begin; j < end; ++j)
+                n->assign(j - begin, (*buffer)[j]);
+            n->slotuse = static_cast<unsigned short>(end - begin);
+            prev = n;
         }
+    }
 
-        if (result.has(btree_update_lastkey))
+    //! Fill the children, separator keys and, with order statistics, subtree
+    //! counts into inner. If there are more children than fit, they are
+    //! distributed evenly over inner and new right siblings on the same level,
+    //! which are appended to splits.
+    void insert_sorted_fill_inner(
+        InnerNode* inner, const std::vector<node*>& children,
+        const std::vector<key_type>& keys,
+        const std::vector<size_type>& counts,
+        std::vector<std::pair<key_type, node*> >* splits)
+    {
+        TLX_BTREE_ASSERT(keys.size() + 1 == children.size());
+
+        size_t num_children = children.size();
+        size_t num_nodes = (num_children + inner_slotmax) / (inner_slotmax + 1);
+
+        for (size_t i = 0; i < num_nodes; ++i)
         {
-            if (parent && parentslot < parent->slotuse)
-            {
-                TLX_BTREE_PRINT("Fixing lastkeyupdate: key "
-                                << result.lastkey << " into parent " << parent
-                                << " at parentslot " << parentslot);
+            size_t begin = bulk_load_offset(num_children, num_nodes, i);
+            size_t end = bulk_load_offset(num_children, num_nodes, i + 1);
 
-                TLX_BTREE_ASSERT(parent->childid[parentslot] == curr);
-                parent->slotkey[parentslot] = result.lastkey;
+            InnerNode* n = inner;
+            if (i != 0)
+            {
+                n = allocate_inner(inner->level);
+                splits->push_back(std::make_pair(keys[begin - 1], n));
             }
-            else
+
+            std::copy(children.begin() + begin, children.begin() + end,
+                      n->childid);
+            std::copy(keys.begin() + begin, keys.begin() + end - 1,
+                      n->slotkey);
+            if (order_statistics)
             {
-                TLX_BTREE_PRINT("Forwarding lastkeyupdate: key "
-                                << result.lastkey);
-                myres |= result_t(btree_update_lastkey, result.lastkey);
+                std::copy(counts.begin() + begin, counts.begin() + end,
+                          n->counts());
             }
+            n->slotuse = static_cast<unsigned short>(end - begin - 1);
         }
+    }
 
-        if (result.has(btree_fixmerge))
-        {
-            // either the current node or the next is empty and should be
-            // removed
-            if (inner->childid[slot]->slotuse != 0)
-                slot++;
+    //! \}
 
-            // this is the child slot invalidated by the merge
-            TLX_BTREE_ASSERT(inner->childid[slot]->slotuse == 0);
+private:
+    //! \name Support Class Encapsulating Deletion Results
+    //! \{
 
-            free_node(inner->childid[slot]);
+    //! Result flags of recursive deletion.
+    enum result_flags_t
+    {
+        //! Deletion successful and no fix-ups necessary.
+        btree_ok = 0,
 
-            std::copy(inner->slotkey + slot, inner->slotkey + inner->slotuse,
-                      inner->slotkey + slot - 1);
-            std::copy(inner->childid + slot + 1,
-                      inner->childid + inner->slotuse + 1,
-                      inner->childid + slot);
+        //! Deletion not successful because key was not found.
+        btree_not_found = 1,
 
-            inner->slotuse--;
+        //! Deletion successful, the last key was updated so parent slotkeys
+        //! need updates.
+        btree_update_lastkey = 2,
 
-            if (inner->level == 1)
-            {
-                // fix split key for children leaves
-                slot--;
-                LeafNode* child = static_cast<LeafNode*>(inner->childid[slot]);
-                inner->slotkey[slot] = child->key(child->slotuse - 1);
-            }
+        //! Deletion successful, children nodes were merged and the parent needs
+        //! to remove the empty node.
+        btree_fixmerge = 4
+    };
+
+    //! B+ tree recursive deletion has much information which is needs to be
+    //! passed upward.
+    struct result_t
+    {
+        //! Merged result flags
+        result_flags_t flags;
+
+        //! The key to be updated at the parent's slot
+        key_type lastkey;
+
+        //! Constructor of a result with a specific flag, this can also be used
+        //! as for implicit conversion.
+        result_t(result_flags_t f = btree_ok) : flags(f), lastkey()
+        {
         }
 
-        if (inner->is_underflow() && !(inner == root_ && inner->slotuse >= 1))
+        //! Constructor with a lastkey value.
+        result_t(result_flags_t f, const key_type& k) : flags(f), lastkey(k)
         {
-            // case: the inner node is the root and has just one child. that
-            // child becomes the new root
-            if (left_inner == nullptr && right_inner == nullptr)
-            {
-                TLX_BTREE_ASSERT(inner == root_);
-                TLX_BTREE_ASSERT(inner->slotuse == 0);
+        }
 
-                root_ = inner->childid[0];
+        //! Test if this result object has a given flag set.
+        bool has(result_flags_t f) const
+        {
+            return (flags & f) != 0;
+        }
 
-                inner->slotuse = 0;
-                free_node(inner);
+        //! Merge two results OR-ing the result flags and overwriting lastkeys.
+        result_t& operator|=(const result_t& other)
+        {
+            flags = result_flags_t(flags | other.flags);
 
-                return btree_ok;
-            }
-            // case : if both left and right leaves would underflow in case
-            // of a shift, then merging is necessary. choose the more local
-            // merger with our parent
-            if ((left_inner == nullptr || left_inner->is_few()) &&
-                (right_inner == nullptr || right_inner->is_few()))
-            {
-                if (left_parent == parent)
-                    myres |= merge_inner(left_inner, inner, left_parent,
-                                         parentslot - 1);
-                else
-                    myres |= merge_inner(inner, right_inner, right_parent,
-                                         parentslot);
-            }
-            // case : the right leaf has extra data, so balance right with
-            // current
-            else if ((left_inner != nullptr && left_inner->is_few()) &&
-                     (right_inner != nullptr && !right_inner->is_few()))
-            {
-                if (right_parent == parent)
-                    shift_left_inner(inner, right_inner, right_parent,
-                                     parentslot);
-                else
-                    myres |= merge_inner(left_inner, inner, left_parent,
-                                         parentslot - 1);
-            }
-            // case : the left leaf has extra data, so balance left with
-            // current
-            else if ((left_inner != nullptr && !left_inner->is_few()) &&
-                     (right_inner != nullptr && right_inner->is_few()))
-            {
-                if (left_parent == parent)
-                    shift_right_inner(left_inner, inner, left_parent,
-                                      parentslot - 1);
-                else
-                    myres |= merge_inner(inner, right_inner, right_parent,
-                                         parentslot);
-            }
-            // case : both the leaf and right leaves have extra data and our
-            // parent, choose the leaf with more data
-            else if (left_parent == right_parent)
-            {
-                if (left_inner->slotuse <= right_inner->slotuse)
-                    shift_left_inner(inner, right_inner, right_parent,
-                                     parentslot);
-                else
-                    shift_right_inner(left_inner, inner, left_parent,
-                                      parentslot - 1);
-            }
-            else
+            // we overwrite existing lastkeys on purpose
+            if (other.has(btree_update_lastkey))
+                lastkey = other.lastkey;
+
+            return *this;
+        }
+    };
+
+    //! \}
+
+public:
+    //! \name Public Erase Functions
+    //! \{
+
+    //! Erases one (the first) of the key/data pairs associated with the given
+    //! key.
+    bool erase_one(const key_type& key)
+    {
+        TLX_BTREE_PRINT("BTree::erase_one(" << key << ") on btree size "
+                                            << size());
+
+        if (self_verify)
+            verify();
+
+        if (!root_)
+            return false;
+
+        result_t result = erase_one_descend(key, root_, nullptr, nullptr,
+                                            nullptr, nullptr, nullptr, 0);
+
+        if (!result.has(btree_not_found))
+            --stats_.size;
+
+#ifdef TLX_BTREE_DEBUG
+        if (debug)
+            print(std::cout);
+#endif
+        if (self_verify)
+            verify();
+
+        return !result.has(btree_not_found);
+    }
+
+    //! Erases all the key/data pairs associated with the given key. This is
+    //! implemented using erase_one().
+    size_type erase(const key_type& key)
+    {
+        size_type c = 0;
+
+        while (erase_one(key))
+        {
+            ++c;
+            if (!allow_duplicates)
+                break;
+        }
+
+        return c;
+    }
+
+    //! Erase the key/data pair referenced by the iterator.
+    void erase(iterator iter)
+    {
+        TLX_BTREE_PRINT("BTree::erase_iter(" << iter.curr_leaf << ","
+                                             << iter.curr_slot
+                                             << ") on btree size " << size());
+
+        if (self_verify)
+            verify();
+
+        if (!root_)
+            return;
+
+        result_t result = erase_iter_descend(iter, root_, nullptr, nullptr,
+                                             nullptr, nullptr, nullptr, 0);
+
+        if (!result.has(btree_not_found))
+            --stats_.size;
+
+#ifdef TLX_BTREE_DEBUG
+        if (debug)
+            print(std::cout);
+#endif
+        if (self_verify)
+            verify();
+    }
+
+    //! Erase all key/data pairs in the range [first,last). Subtrees lying
+    //! completely inside the range are freed as a whole, and only the nodes on
+    //! the two boundary paths are split, rebalanced and joined again. Hence
+    //! the cost is O(log n + number of leaves in the range) instead of one
+    //! descent per erased item.
+    void erase(iterator first, iterator last)
+    {
+        TLX_BTREE_PRINT("BTree::erase_range(" << first.curr_leaf << ","
+                                              << first.curr_slot << " - "
+                                              << last.curr_leaf << ","
+                                              << last.curr_slot
+                                              << ") on btree size " << size());
+
+        if (self_verify)
+            verify();
+
+        if (!root_)
+            return;
+
+        // iterators past the last slot of a leaf refer to the next leaf
+        if (first.curr_slot >= first.curr_leaf->slotuse &&
+            first.curr_leaf->next_leaf)
+            first = iterator(first.curr_leaf->next_leaf, 0);
+        if (last.curr_slot >= last.curr_leaf->slotuse &&
+            last.curr_leaf->next_leaf)
+            last = iterator(last.curr_leaf->next_leaf, 0);
+
+        if (first == last)
+            return;
+
+        if (first == begin() && last == end())
+        {
+            clear();
+            return;
+        }
+
+        std::vector<unsigned short> first_path, last_path;
+        find_iterator_path(first, &first_path);
+        find_iterator_path(last, &last_path);
+
+        // cut the leaf chain at both ends of the range, unless both ends are
+        // inside the same leaf, such that the erased leaves are detached.
+        LeafNode* left_leaf = (first.curr_slot > 0) ?
+                                  first.curr_leaf :
+                                  first.curr_leaf->prev_leaf;
+        LeafNode* right_leaf =
+            (last.curr_slot < last.curr_leaf->slotuse) ? last.curr_leaf :
+                                                         nullptr;
+
+        if (left_leaf != right_leaf)
+        {
+            if (left_leaf)
+                left_leaf->next_leaf = nullptr;
+            if (right_leaf)
+                right_leaf->prev_leaf = nullptr;
+        }
+
+        size_type erased = 0;
+        node *left = nullptr, *right = nullptr;
+
+        erase_range_descend(root_, first_path.data(), last_path.data(), &left,
+                            &right, &erased);
+
+        root_ = join_trees(left, right);
+        stats_.size -= erased;
+
+        if (root_)
+        {
+            head_leaf_ = leftmost_leaf(root_);
+            tail_leaf_ = rightmost_leaf(root_);
+        }
+        else
+        {
+            head_leaf_ = tail_leaf_ = nullptr;
+        }
+
+#ifdef TLX_BTREE_DEBUG
+        if (debug)
+            print(std::cout);
+#endif
+        if (self_verify)
+            verify();
+    }
+
+    //! \}
+
+private:
+    //! \name Private Erase Functions
+    //! \{
+
+    /*!
+     * Erase one (the first) key/data pair in the B+ tree matching key.
+     *
+     * Descends down the tree in search of key. During the descent the parent,
+     * left and right siblings and their parents are computed and passed
+     * down. Once the key/data pair is found, it is removed from the leaf. If
+     * the leaf underflows 6 different cases are handled. These cases resolve
+     * the underflow by shifting key/data pairs from adjacent sibling nodes,
+     * merging two sibling nodes or trimming the tree.
+     */
+    result_t erase_one_descend(const key_type& key, node* curr, node* left,
+                               node* right, InnerNode* left_parent,
+                               InnerNode* right_parent, InnerNode* parent,
+                               unsigned int parentslot)
+    {
+        if (curr->is_leafnode())
+        {
+            LeafNode* leaf = static_cast<LeafNode*>(curr);
+            LeafNode* left_leaf = static_cast<LeafNode*>(left);
+            LeafNode* right_leaf = static_cast<LeafNode*>(right);
+
+            unsigned short slot = find_lower(leaf, key);
+
+            if (slot >= leaf->slotuse || !key_equal(key, leaf->key(slot)))
+            {
+                TLX_BTREE_PRINT("Could not find key " << key << " to erase.");
+
+                return btree_not_found;
+            }
+
+            TLX_BTREE_PRINT("Found key in leaf " << curr << " at slot "
+                                                 << slot);
+
+            leaf->copy_slots(slot + 1, leaf->slotuse, leaf, slot);
+
+            leaf->slotuse--;
+
+            if (order_statistics && parent)
+                parent->counts()[parentslot]--;
+
+            result_t myres = btree_ok;
+
+            // if the last key of the leaf was changed, the parent is notified
+            // and updates the key of this leaf
+            if (slot == leaf->slotuse)
+            {
+                if (parent && parentslot < parent->slotuse)
+                {
+                    TLX_BTREE_ASSERT(parent->childid[parentslot] == curr);
+                    parent->slotkey[parentslot] = leaf->key(leaf->slotuse - 1);
+                }
+                else
+                {
+                    if (leaf->slotuse >= 1)
+                    {
+                        TLX_BTREE_PRINT("Scheduling lastkeyupdate: key "
+                                        << leaf->key(leaf->slotuse - 1));
+                        myres |= result_t(btree_update_lastkey,
+                                          leaf->key(leaf->slotuse - 1));
+                    }
+                    else
+                    {
+                        TLX_BTREE_ASSERT(leaf == root_);
+                    }
+                }
+            }
+
+            if (leaf->is_underflow() && !(leaf == root_ && leaf->slotuse >= 1))
+            {
+                // determine what to do about the underflow
+
+                // case : if this empty leaf is the root, then delete all nodes
+                // and set root to nullptr.
+                if (left_leaf == nullptr && right_leaf == nullptr)
+                {
+                    TLX_BTREE_ASSERT(leaf == root_);
+                    TLX_BTREE_ASSERT(leaf->slotuse == 0);
+
+                    free_node(root_);
+
+                    root_ = leaf = nullptr;
+                    head_leaf_ = tail_leaf_ = nullptr;
+
+                    // will be decremented soon by insert_start()
+                    TLX_BTREE_ASSERT(stats_.size == 1);
+                    TLX_BTREE_ASSERT(stats_.leaves == 0);
+                    TLX_BTREE_ASSERT(stats_.inner_nodes == 0);
+
+                    return btree_ok;
+                }
+                // case : if both left and right leaves would underflow in case
+                // of a shift, then merging is necessary. choose the more local
+                // merger with our parent
+                if ((left_leaf == nullptr || left_leaf->is_few()) &&
+                    (right_leaf == nullptr || right_leaf->is_few()))
+                {
+                    if (left_parent == parent)
+                        myres |= merge_leaves(left_leaf, leaf, left_parent);
+                    else
+                        myres |= merge_leaves(leaf, right_leaf, right_parent);
+                }
+                // case : the right leaf has extra data, so balance right with
+                // current
+                else if ((left_leaf != nullptr && left_leaf->is_few()) &&
+                         (right_leaf != nullptr && !right_leaf->is_few()))
+                {
+                    if (right_parent == parent)
+                        myres |= shift_left_leaf(leaf, right_leaf, right_parent,
+                                                 parentslot);
+                    else
+                        myres |= merge_leaves(left_leaf, leaf, left_parent);
+                }
+                // case : the left leaf has extra data, so balance left with
+                // current
+                else if ((left_leaf != nullptr && !left_leaf->is_few()) &&
+                         (right_leaf != nullptr && right_leaf->is_few()))
+                {
+                    if (left_parent == parent)
+                        shift_right_leaf(left_leaf, leaf, left_parent,
+                                         parentslot - 1);
+                    else
+                        myres |= merge_leaves(leaf, right_leaf, right_parent);
+                }
+                // case : both the leaf and right leaves have extra data and our
+                // parent, choose the leaf with more data
+                else if (left_parent == right_parent)
+                {
+                    if (left_leaf->slotuse <= right_leaf->slotuse)
+                        myres |= shift_left_leaf(leaf, right_leaf, right_parent,
+                                                 parentslot);
+                    else
+                        shift_right_leaf(left_leaf, leaf, left_parent,
+                                         parentslot - 1);
+                }
+                else
+                {
+                    if (left_parent == parent)
+                        shift_right_leaf(left_leaf, leaf, left_parent,
+                                         parentslot - 1);
+                    else
+                        myres |= shift_left_leaf(leaf, right_leaf, right_parent,
+                                                 parentslot);
+                }
+            }
+
+            return myres;
+        }
+
+        // !curr->is_leafnode()
+        InnerNode* inner = static_cast<InnerNode*>(curr);
+        InnerNode* left_inner = static_cast<InnerNode*>(left);
+        InnerNode* right_inner = static_cast<InnerNode*>(right);
+
+        node *myleft, *myright;
+        InnerNode *myleft_parent, *myright_parent;
+
+        unsigned short slot = find_lower(inner, key);
+
+        if (slot == 0)
+        {
+            myleft =
+                (left == nullptr) ?
+                    nullptr :
+                    static_cast<InnerNode*>(left)->childid[left->slotuse - 1];
+            myleft_parent = left_parent;
+        }
+        else
+        {
+            myleft = inner->childid[slot - 1];
+            myleft_parent = inner;
+        }
+
+        if (slot == inner->slotuse)
+        {
+            myright = (right == nullptr) ?
+                          nullptr :
+                          static_cast<InnerNode*>(right)->childid[0];
+            myright_parent = right_parent;
+        }
+        else
+        {
+            myright = inner->childid[slot + 1];
+            myright_parent = inner;
+        }
+
+        TLX_BTREE_PRINT("erase_one_descend into " << inner->childid[slot]);
+
+        result_t result =
+            erase_one_descend(key, inner->childid[slot], myleft, myright,
+                              myleft_parent, myright_parent, inner, slot);
+
+        result_t myres = btree_ok;
+
+        if (result.has(btree_not_found))
+        {
+            return result;
+        }
+
+        if (order_statistics && parent)
+            parent->counts()[parentslot]--;
+
+        if (result.has(btree_update_lastkey))
+        {
+            if (parent && parentslot < parent->slotuse)
+            {
+                TLX_BTREE_PRINT("Fixing lastkeyupdate: key "
+                                << result.lastkey << " into parent " << parent
+                                << " at parentslot " << parentslot);
+
+                TLX_BTREE_ASSERT(parent->childid[parentslot] == curr);
+                parent->slotkey[parentslot] = result.lastkey;
+            }
+            else
+            {
+                TLX_BTREE_PRINT("Forwarding lastkeyupdate: key "
+                                << result.lastkey);
+                myres |= result_t(btree_update_lastkey, result.lastkey);
+            }
+        }
+
+        if (result.has(btree_fixmerge))
+        {
+            // either the current node or the next is empty and should be
+            // removed
+            if (inner->childid[slot]->slotuse != 0)
+                slot++;
+
+            // this is the child slot invalidated by the merge
+            TLX_BTREE_ASSERT(inner->childid[slot]->slotuse == 0);
+
+            if (order_statistics)
+            {
+                // the items were merged into the left sibling
+                inner->counts()[slot - 1] += inner->counts()[slot];
+                std::copy(inner->counts() + slot + 1,
+                          inner->counts() + inner->slotuse + 1,
+                          inner->counts() + slot);
+            }
+
+            free_node(inner->childid[slot]);
+
+            std::copy(inner->slotkey + slot, inner->slotkey + inner->slotuse,
+                      inner->slotkey + slot - 1);
+            std::copy(inner->childid + slot + 1,
+                      inner->childid + inner->slotuse + 1,
+                      inner->childid + slot);
+
+            inner->slotuse--;
+
+            if (inner->level == 1)
+            {
+                // fix split key for children leaves
+                slot--;
+                LeafNode* child = static_cast<LeafNode*>(inner->childid[slot]);
+                inner->slotkey[slot] = child->key(child->slotuse - 1);
+            }
+        }
+
+        if (inner->is_underflow() && !(inner == root_ && inner->slotuse >= 1))
+        {
+            // case: the inner node is the root and has just one child. that
+            // child becomes the new root
+            if (left_inner == nullptr && right_inner == nullptr)
+            {
+                TLX_BTREE_ASSERT(inner == root_);
+                TLX_BTREE_ASSERT(inner->slotuse == 0);
+
+                root_ = inner->childid[0];
+
+                inner->slotuse = 0;
+                free_node(inner);
+
+                return btree_ok;
+            }
+            // case : if both left and right leaves would underflow in case
+            // of a shift, then merging is necessary. choose the more local
+            // merger with our parent
+            if ((left_inner == nullptr || left_inner->is_few()) &&
+                (right_inner == nullptr || right_inner->is_few()))
+            {
+                if (left_parent == parent)
+                    myres |= merge_inner(left_inner, inner, left_parent,
+                                         parentslot - 1);
+                else
+                    myres |= merge_inner(inner, right_inner, right_parent,
+                                         parentslot);
+            }
+            // case : the right leaf has extra data, so balance right with
+            // current
+            else if ((left_inner != nullptr && left_inner->is_few()) &&
+                     (right_inner != nullptr && !right_inner->is_few()))
+            {
+                if (right_parent == parent)
+                    shift_left_inner(inner, right_inner, right_parent,
+                                     parentslot);
+                else
+                    myres |= merge_inner(left_inner, inner, left_parent,
+                                         parentslot - 1);
+            }
+            // case : the left leaf has extra data, so balance left with
+            // current
+            else if ((left_inner != nullptr && !left_inner->is_few()) &&
+                     (right_inner != nullptr && right_inner->is_few()))
+            {
+                if (left_parent == parent)
+                    shift_right_inner(left_inner, inner, left_parent,
+                                      parentslot - 1);
+                else
+                    myres |= merge_inner(inner, right_inner, right_parent,
+                                         parentslot);
+            }
+            // case : both the leaf and right leaves have extra data and our
+            // parent, choose the leaf with more data
+            else if (left_parent == right_parent)
+            {
+                if (left_inner->slotuse <= right_inner->slotuse)
+                    shift_left_inner(inner, right_inner, right_parent,
+                                     parentslot);
+                else
+                    shift_right_inner(left_inner, inner, left_parent,
+                                      parentslot - 1);
+            }
+            else
+            {
+                if (left_parent == parent)
+                    shift_right_inner(left_inner, inner, left_parent,
+                                      parentslot - 1);
+                else
+                    shift_left_inner(inner, right_inner, right_parent,
+                                     parentslot);
+            }
+        }
+
+        return myres;
+    }
+
+    /*!
+     * Erase one key/data pair referenced by an iterator in the B+ tree.
+     *
+     * Descends down the tree in search of an iterator. During the descent the
+     * parent, left and right siblings and their parents are computed and passed
+     * down. The difficulty is that the iterator contains only a pointer to a
+     * LeafNode, which means that this function must do a recursive depth first
+     * search for that leaf node in the subtree containing all pairs of the same
+     * key. This subtree can be very large, even the whole tree, though in
+     * practice it would not make sense to have so many duplicate keys.
+     *
+     * Once the referenced key/data pair is found, it is removed from the leaf
+     * and the same underflow cases are handled as in erase_one_descend.
+     */
+    result_t erase_iter_descend(const iterator& iter, node* curr, node* left,
+                                node* right, InnerNode* left_parent,
+                                InnerNode* right_parent, InnerNode* parent,
+                                unsigned int parentslot)
+    {
+        if (curr->is_leafnode())
+        {
+            LeafNode* leaf = static_cast<LeafNode*>(curr);
+            LeafNode* left_leaf = static_cast<LeafNode*>(left);
+            LeafNode* right_leaf = static_cast<LeafNode*>(right);
+
+            // if this is not the correct leaf, get next step in recursive
+            // search
+            if (leaf != iter.curr_leaf)
+            {
+                return btree_not_found;
+            }
+
+            if (iter.curr_slot >= leaf->slotuse)
+            {
+                TLX_BTREE_PRINT("Could not find iterator ("
+                                << iter.curr_leaf << "," << iter.curr_slot
+                                << ") to erase. Invalid leaf node?");
+
+                return btree_not_found;
+            }
+
+            unsigned short slot = iter.curr_slot;
+
+            TLX_BTREE_PRINT("Found iterator in leaf " << curr << " at slot "
+                                                      << slot);
+
+            leaf->copy_slots(slot + 1, leaf->slotuse, leaf, slot);
+
+            leaf->slotuse--;
+
+            if (order_statistics && parent)
+                parent->counts()[parentslot]--;
+
+            result_t myres = btree_ok;
+
+            // if the last key of the leaf was changed, the parent is notified
+            // and updates the key of this leaf
+            if (slot == leaf->slotuse)
+            {
+                if (parent && parentslot < parent->slotuse)
+                {
+                    TLX_BTREE_ASSERT(parent->childid[parentslot] == curr);
+                    parent->slotkey[parentslot] = leaf->key(leaf->slotuse - 1);
+                }
+                else
+                {
+                    if (leaf->slotuse >= 1)
+                    {
+                        TLX_BTREE_PRINT("Scheduling lastkeyupdate: key "
+                                        << leaf->key(leaf->slotuse - 1));
+                        myres |= result_t(btree_update_lastkey,
+                                          leaf->key(leaf->slotuse - 1));
+                    }
+                    else
+                    {
+                        TLX_BTREE_ASSERT(leaf == root_);
+                    }
+                }
+            }
+
+            if (leaf->is_underflow() && !(leaf == root_ && leaf->slotuse >= 1))
+            {
+                // determine what to do about the underflow
+
+                // case : if this empty leaf is the root, then delete all nodes
+                // and set root to nullptr.
+                if (left_leaf == nullptr && right_leaf == nullptr)
+                {
+                    TLX_BTREE_ASSERT(leaf == root_);
+                    TLX_BTREE_ASSERT(leaf->slotuse == 0);
+
+                    free_node(root_);
+
+                    root_ = leaf = nullptr;
+                    head_leaf_ = tail_leaf_ = nullptr;
+
+                    // will be decremented soon by insert_start()
+                    TLX_BTREE_ASSERT(stats_.size == 1);
+                    TLX_BTREE_ASSERT(stats_.leaves == 0);
+                    TLX_BTREE_ASSERT(stats_.inner_nodes == 0);
+
+                    return btree_ok;
+                }
+                // case : if both left and right leaves would underflow in case
+                // of a shift, then merging is necessary. choose the more local
+                // merger with our parent
+                if ((left_leaf == nullptr || left_leaf->is_few()) &&
+                    (right_leaf == nullptr || right_leaf->is_few()))
+                {
+                    if (left_parent == parent)
+                        myres |= merge_leaves(left_leaf, leaf, left_parent);
+                    else
+                        myres |= merge_leaves(leaf, right_leaf, right_parent);
+                }
+                // case : the right leaf has extra data, so balance right with
+                // current
+                else if ((left_leaf != nullptr && left_leaf->is_few()) &&
+                         (right_leaf != nullptr && !right_leaf->is_few()))
+                {
+                    if (right_parent == parent)
+                    {
+                        myres |= shift_left_leaf(leaf, right_leaf, right_parent,
+                                                 parentslot);
+                    }
+                    else
+                    {
+                        myres |= merge_leaves(left_leaf, leaf, left_parent);
+                    }
+                }
+                // case : the left leaf has extra data, so balance left with
+                // current
+                else if ((left_leaf != nullptr && !left_leaf->is_few()) &&
+                         (right_leaf != nullptr && right_leaf->is_few()))
+                {
+                    if (left_parent == parent)
+                    {
+                        shift_right_leaf(left_leaf, leaf, left_parent,
+                                         parentslot - 1);
+                    }
+                    else
+                    {
+                        myres |= merge_leaves(leaf, right_leaf, right_parent);
+                    }
+                }
+                // case : both the leaf and right leaves have extra data and our
+                // parent, choose the leaf with more data
+                else if (left_parent == right_parent)
+                {
+                    if (left_leaf->slotuse <= right_leaf->slotuse)
+                    {
+                        myres |= shift_left_leaf(leaf, right_leaf, right_parent,
+                                                 parentslot);
+                    }
+                    else
+                    {
+                        shift_right_leaf(left_leaf, leaf, left_parent,
+                                         parentslot - 1);
+                    }
+                }
+                else
+                {
+                    if (left_parent == parent)
+                    {
+                        shift_right_leaf(left_leaf, leaf, left_parent,
+                                         parentslot - 1);
+                    }
+                    else
+                    {
+                        myres |= shift_left_leaf(leaf, right_leaf, right_parent,
+                                                 parentslot);
+                    }
+                }
+            }
+
+            return myres;
+        }
+
+        // !curr->is_leafnode()
+        InnerNode* inner = static_cast<InnerNode*>(curr);
+        InnerNode* left_inner = static_cast<InnerNode*>(left);
+        InnerNode* right_inner = static_cast<InnerNode*>(right);
+
+        // find first slot below which the searched iterator might be
+        // located.
+
+        result_t result;
+        unsigned short slot = find_lower(inner, iter.key());
+
+        while (slot <= inner->slotuse)
+        {
+            node *myleft, *myright;
+            InnerNode *myleft_parent, *myright_parent;
+
+            if (slot == 0)
+            {
+                myleft = (left == nullptr) ? nullptr :
+                                             static_cast<InnerNode*>(left)
+                                                 ->childid[left->slotuse - 1];
+                myleft_parent = left_parent;
+            }
+            else
+            {
+                myleft = inner->childid[slot - 1];
+                myleft_parent = inner;
+            }
+
+            if (slot == inner->slotuse)
+            {
+                myright = (right == nullptr) ?
+                              nullptr :
+                              static_cast<InnerNode*>(right)->childid[0];
+                myright_parent = right_parent;
+            }
+            else
+            {
+                myright = inner->childid[slot + 1];
+                myright_parent = inner;
+            }
+
+            TLX_BTREE_PRINT("erase_iter_descend into " << inner->childid[slot]);
+
+            result =
+                erase_iter_descend(iter, inner->childid[slot], myleft, myright,
+                                   myleft_parent, myright_parent, inner, slot);
+
+            if (!result.has(btree_not_found))
+                break;
+
+            // continue recursive search for leaf on next slot
+
+            if (slot < inner->slotuse &&
+                key_less(inner->slotkey[slot], iter.key()))
+                return btree_not_found;
+
+            ++slot;
+        }
+
+            if (slot > inner->slotuse)
+                return btree_not_found;
+
+            if (order_statistics && parent)
+                parent->counts()[parentslot]--;
+
+            result_t myres = btree_ok;
+
+            if (result.has(btree_update_lastkey))
+            {
+                if (parent && parentslot < parent->slotuse)
+                {
+                    TLX_BTREE_PRINT("Fixing lastkeyupdate: key "
+                                    << result.lastkey << " into parent "
+                                    << parent << " at parentslot "
+                                    << parentslot);
+
+                    TLX_BTREE_ASSERT(parent->childid[parentslot] == curr);
+                    parent->slotkey[parentslot] = result.lastkey;
+                }
+                else
+                {
+                    TLX_BTREE_PRINT("Forwarding lastkeyupdate: key "
+                                    << result.lastkey);
+                    myres |= result_t(btree_update_lastkey, result.lastkey);
+                }
+            }
+
+            if (result.has(btree_fixmerge))
+            {
+                // either the current node or the next is empty and should be
+                // removed
+                if (inner->childid[slot]->slotuse != 0)
+                    slot++;
+
+                // this is the child slot invalidated by the merge
+                TLX_BTREE_ASSERT(inner->childid[slot]->slotuse == 0);
+
+                if (order_statistics)
+                {
+                    // the items were merged into the left sibling
+                    inner->counts()[slot - 1] += inner->counts()[slot];
+                    std::copy(inner->counts() + slot + 1,
+                              inner->counts() + inner->slotuse + 1,
+                              inner->counts() + slot);
+                }
+
+                free_node(inner->childid[slot]);
+
+                std::copy(inner->slotkey + slot,
+                          inner->slotkey + inner->slotuse,
+                          inner->slotkey + slot - 1);
+                std::copy(inner->childid + slot + 1,
+                          inner->childid + inner->slotuse + 1,
+                          inner->childid + slot);
+
+                inner->slotuse--;
+
+                if (inner->level == 1)
+                {
+                    // fix split key for children leaves
+                    slot--;
+                    LeafNode* child =
+                        static_cast<LeafNode*>(inner->childid[slot]);
+                    inner->slotkey[slot] = child->key(child->slotuse - 1);
+                }
+            }
+
+            if (inner->is_underflow() &&
+                !(inner == root_ && inner->slotuse >= 1))
+            {
+                // case: the inner node is the root and has just one
+                // child. that child becomes the new root
+                if (left_inner == nullptr && right_inner == nullptr)
+                {
+                    TLX_BTREE_ASSERT(inner == root_);
+                    TLX_BTREE_ASSERT(inner->slotuse == 0);
+
+                    root_ = inner->childid[0];
+
+                    inner->slotuse = 0;
+                    free_node(inner);
+
+                    return btree_ok;
+                }
+                // case : if both left and right leaves would underflow in case
+                // of a shift, then merging is necessary. choose the more local
+                // merger with our parent
+                if ((left_inner == nullptr || left_inner->is_few()) &&
+                    (right_inner == nullptr || right_inner->is_few()))
+                {
+                    if (left_parent == parent)
+                    {
+                        myres |= merge_inner(left_inner, inner, left_parent,
+                                             parentslot - 1);
+                    }
+                    else
+                    {
+                        myres |= merge_inner(inner, right_inner, right_parent,
+                                             parentslot);
+                    }
+                }
+                // case : the right leaf has extra data, so balance right with
+                // current
+                else if ((left_inner != nullptr && left_inner->is_few()) &&
+                         (right_inner != nullptr && !right_inner->is_few()))
+                {
+                    if (right_parent == parent)
+                    {
+                        shift_left_inner(inner, right_inner, right_parent,
+                                         parentslot);
+                    }
+                    else
+                    {
+                        myres |= merge_inner(left_inner, inner, left_parent,
+                                             parentslot - 1);
+                    }
+                }
+                // case : the left leaf has extra data, so balance left with
+                // current
+                else if ((left_inner != nullptr && !left_inner->is_few()) &&
+                         (right_inner != nullptr && right_inner->is_few()))
+                {
+                    if (left_parent == parent)
+                    {
+                        shift_right_inner(left_inner, inner, left_parent,
+                                          parentslot - 1);
+                    }
+                    else
+                    {
+                        myres |= merge_inner(inner, right_inner, right_parent,
+                                             parentslot);
+                    }
+                }
+                // case : both the leaf and right leaves have extra data and our
+                // parent, choose the leaf with more data
+                else if (left_parent == right_parent)
+                {
+                    if (left_inner->slotuse <= right_inner->slotuse)
+                    {
+                        shift_left_inner(inner, right_inner, right_parent,
+                                         parentslot);
+                    }
+                    else
+                    {
+                        shift_right_inner(left_inner, inner, left_parent,
+                                          parentslot - 1);
+                    }
+                }
+                else
+                {
+                    if (left_parent == parent)
+                    {
+                        shift_right_inner(left_inner, inner, left_parent,
+                                          parentslot - 1);
+                    }
+                    else
+                    {
+                        shift_left_inner(inner, right_inner, right_parent,
+                                         parentslot);
+                    }
+                }
+            }
+
+            return myres;
+    }
+
+    //! Merge two leaf nodes. The function moves all key/data pairs from right
+    //! to left and sets right's slotuse to zero. The right slot is then removed
+    //! by the calling parent node.
+    result_t merge_leaves(LeafNode* left, LeafNode* right, InnerNode* parent)
+    {
+        TLX_BTREE_PRINT("Merge leaf nodes " << left << " and " << right
+                                            << " with common parent " << parent
+                                            << ".");
+        (void) parent;
+
+        TLX_BTREE_ASSERT(left->is_leafnode() && right->is_leafnode());
+        TLX_BTREE_ASSERT(parent->level == 1);
+
+        TLX_BTREE_ASSERT(left->slotuse + right->slotuse < leaf_slotmax);
+
+        right->copy_slots(0, right->slotuse, left, left->slotuse);
+
+        left->slotuse += right->slotuse;
+
+        left->next_leaf = right->next_leaf;
+        if (left->next_leaf)
+            left->next_leaf->prev_leaf = left;
+        else
+            tail_leaf_ = left;
+
+        right->slotuse = 0;
+
+        return btree_fixmerge;
+    }
+
+    //! Merge two inner nodes. The function moves all key/childid pairs from
+    //! right to left and sets right's slotuse to zero. The right slot is then
+    //! removed by the calling parent node.
+    static result_t merge_inner(InnerNode* left, InnerNode* right,
+                                InnerNode* parent, unsigned int parentslot)
+    {
+        TLX_BTREE_PRINT("Merge inner nodes " << left << " and " << right
+                                             << " with common parent " << parent
+                                             << ".");
+
+        TLX_BTREE_ASSERT(left->level == right->level);
+        TLX_BTREE_ASSERT(parent->level == left->level + 1);
+
+        TLX_BTREE_ASSERT(parent->childid[parentslot] == left);
+
+        TLX_BTREE_ASSERT(left->slotuse + right->slotuse < inner_slotmax);
+
+        if (self_verify)
+        {
+            // find the left node's slot in the parent's children
+            unsigned int leftslot = 0;
+            while (leftslot <= parent->slotuse &&
+                   parent->childid[leftslot] != left)
+                ++leftslot;
+
+            TLX_BTREE_ASSERT(leftslot < parent->slotuse);
+            TLX_BTREE_ASSERT(parent->childid[leftslot] == left);
+            TLX_BTREE_ASSERT(parent->childid[leftslot + 1] == right);
+
+            TLX_BTREE_ASSERT(parentslot == leftslot);
+        }
+
+        // retrieve the decision key from parent
+        left->slotkey[left->slotuse] = parent->slotkey[parentslot];
+        left->slotuse++;
+
+        // copy over keys and children from right
+        std::copy(right->slotkey, right->slotkey + right->slotuse,
+                  left->slotkey + left->slotuse);
+        std::copy(right->childid, right->childid + right->slotuse + 1,
+                  left->childid + left->slotuse);
+        if (order_statistics)
+        {
+            std::copy(right->counts(), right->counts() + right->slotuse + 1,
+                      left->counts() + left->slotuse);
+        }
+
+        left->slotuse += right->slotuse;
+        right->slotuse = 0;
+
+        return btree_fixmerge;
+    }
+
+    //! Balance two leaf nodes. The function moves key/data pairs from right to
+    //! left so that both nodes are equally filled. The parent node is updated
+    //! if possible.
+    static result_t shift_left_leaf(LeafNode* left, LeafNode* right,
+                                    InnerNode* parent, unsigned int parentslot)
+    {
+        TLX_BTREE_ASSERT(left->is_leafnode() && right->is_leafnode());
+        TLX_BTREE_ASSERT(parent->level == 1);
+
+        TLX_BTREE_ASSERT(left->next_leaf == right);
+        TLX_BTREE_ASSERT(left == right->prev_leaf);
+
+        TLX_BTREE_ASSERT(left->slotuse < right->slotuse);
+        TLX_BTREE_ASSERT(parent->childid[parentslot] == left);
+
+        unsigned int shiftnum = (right->slotuse - left->slotuse) >> 1;
+
+        TLX_BTREE_PRINT("Shifting (leaf) " << shiftnum << " entries to left "
+                                           << left << " from right " << right
+                                           << " with common parent " << parent
+                                           << ".");
+
+        TLX_BTREE_ASSERT(left->slotuse + shiftnum < leaf_slotmax);
+
+        // copy the first items from the right node to the last slot in the left
+        // node.
+
+        right->copy_slots(0, shiftnum, left, left->slotuse);
+
+        left->slotuse += shiftnum;
+
+        // shift all slots in the right node to the left
+
+        right->copy_slots(shiftnum, right->slotuse, right, 0);
+
+        right->slotuse -= shiftnum;
+
+        if (order_statistics)
+        {
+            parent->counts()[parentslot] += shiftnum;
+            parent->counts()[parentslot + 1] -= shiftnum;
+        }
+
+        // fixup parent
+        if (parentslot < parent->slotuse)
+        {
+            parent->slotkey[parentslot] = left->key(left->slotuse - 1);
+            return btree_ok;
+        }
+
+        // the update is further up the tree
+        return result_t(btree_update_lastkey, left->key(left->slotuse - 1));
+    }
+
+    //! Balance two inner nodes. The function moves key/data pairs from right to
+    //! left so that both nodes are equally filled. The parent node is updated
+    //! if possible.
+    static void shift_left_inner(InnerNode* left, InnerNode* right,
+                                 InnerNode* parent, unsigned int parentslot)
+    {
+        TLX_BTREE_ASSERT(left->level == right->level);
+        TLX_BTREE_ASSERT(parent->level == left->level + 1);
+
+        TLX_BTREE_ASSERT(left->slotuse < right->slotuse);
+        TLX_BTREE_ASSERT(parent->childid[parentslot] == left);
+
+        unsigned int shiftnum = (right->slotuse - left->slotuse) >> 1;
+
+        TLX_BTREE_PRINT("Shifting (inner) " << shiftnum << " entries to left "
+                                            << left << " from right " << right
+                                            << " with common parent " << parent
+                                            << ".");
+
+        TLX_BTREE_ASSERT(left->slotuse + shiftnum < inner_slotmax);
+
+        if (self_verify)
+        {
+            // find the left node's slot in the parent's children and compare to
+            // parentslot
+
+            unsigned int leftslot = 0;
+            while (leftslot <= parent->slotuse &&
+                   parent->childid[leftslot] != left)
+                ++leftslot;
+
+            TLX_BTREE_ASSERT(leftslot < parent->slotuse);
+            TLX_BTREE_ASSERT(parent->childid[leftslot] == left);
+            TLX_BTREE_ASSERT(parent->childid[leftslot + 1] == right);
+
+            TLX_BTREE_ASSERT(leftslot == parentslot);
+        }
+
+        // copy the parent's decision slotkey and childid to the first new key
+        // on the left
+        left->slotkey[left->slotuse] = parent->slotkey[parentslot];
+        left->slotuse++;
+
+        // copy the other items from the right node to the last slots in the
+        // left node.
+        std::copy(right->slotkey, right->slotkey + shiftnum - 1,
+                  left->slotkey + left->slotuse);
+        std::copy(right->childid, right->childid + shiftnum,
+                  left->childid + left->slotuse);
+
+        if (order_statistics)
+        {
+            std::copy(right->counts(), right->counts() + shiftnum,
+                      left->counts() + left->slotuse);
+            size_type moved = sum_counts(right, 0, shiftnum);
+            parent->counts()[parentslot] += moved;
+            parent->counts()[parentslot + 1] -= moved;
+            std::copy(right->counts() + shiftnum,
+                      right->counts() + right->slotuse + 1, right->counts());
+        }
+
+        left->slotuse += shiftnum - 1;
+
+        // fixup parent
+        parent->slotkey[parentslot] = right->slotkey[shiftnum - 1];
+
+        // shift all slots in the right node
+        std::copy(right->slotkey + shiftnum, right->slotkey + right->slotuse,
+                  right->slotkey);
+        std::copy(right->childid + shiftnum,
+                  right->childid + right->slotuse + 1, right->childid);
+
+        right->slotuse -= shiftnum;
+    }
+
+    //! Balance two leaf nodes. The function moves key/data pairs from left to
+    //! right so that both nodes are equally filled. The parent node is updated
+    //! if possible.
+    static void shift_right_leaf(LeafNode* left, LeafNode* right,
+                                 InnerNode* parent, unsigned int parentslot)
+    {
+        TLX_BTREE_ASSERT(left->is_leafnode() && right->is_leafnode());
+        TLX_BTREE_ASSERT(parent->level == 1);
+
+        TLX_BTREE_ASSERT(left->next_leaf == right);
+        TLX_BTREE_ASSERT(left == right->prev_leaf);
+        TLX_BTREE_ASSERT(parent->childid[parentslot] == left);
+
+        TLX_BTREE_ASSERT(left->slotuse > right->slotuse);
+
+        unsigned int shiftnum = (left->slotuse - right->slotuse) >> 1;
+
+        TLX_BTREE_PRINT("Shifting (leaf) " << shiftnum << " entries to right "
+                                           << right << " from left " << left
+                                           << " with common parent " << parent
+                                           << ".");
+
+        if (self_verify)
+        {
+            // find the left node's slot in the parent's children
+            unsigned int leftslot = 0;
+            while (leftslot <= parent->slotuse &&
+                   parent->childid[leftslot] != left)
+                ++leftslot;
+
+            TLX_BTREE_ASSERT(leftslot < parent->slotuse);
+            TLX_BTREE_ASSERT(parent->childid[leftslot] == left);
+            TLX_BTREE_ASSERT(parent->childid[leftslot + 1] == right);
+
+            TLX_BTREE_ASSERT(leftslot == parentslot);
+        }
+
+        // shift all slots in the right node
+
+        TLX_BTREE_ASSERT(right->slotuse + shiftnum < leaf_slotmax);
+
+        right->copy_slots_backward(0, right->slotuse, right,
+                                   right->slotuse + shiftnum);
+
+        right->slotuse += shiftnum;
+
+        // copy the last items from the left node to the first slot in the right
+        // node.
+        left->copy_slots(left->slotuse - shiftnum, left->slotuse, right, 0);
+
+        left->slotuse -= shiftnum;
+
+        if (order_statistics)
+        {
+            parent->counts()[parentslot] -= shiftnum;
+            parent->counts()[parentslot + 1] += shiftnum;
+        }
+
+        parent->slotkey[parentslot] = left->key(left->slotuse - 1);
+    }
+
+    //! Balance two inner nodes. The function moves key/data pairs from left to
+    //! right so that both nodes are equally filled. The parent node is updated
+    //! if possible.
+    static void shift_right_inner(InnerNode* left, InnerNode* right,
+                                  InnerNode* parent, unsigned int parentslot)
+    {
+        TLX_BTREE_ASSERT(left->level == right->level);
+        TLX_BTREE_ASSERT(parent->level == left->level + 1);
+
+        TLX_BTREE_ASSERT(left->slotuse > right->slotuse);
+        TLX_BTREE_ASSERT(parent->childid[parentslot] == left);
+
+        unsigned int shiftnum = (left->slotuse - right->slotuse) >> 1;
+
+        TLX_BTREE_PRINT("Shifting (leaf) " << shiftnum << " entries to right "
+                                           << right << " from left " << left
+                                           << " with common parent " << parent
+                                           << ".");
+
+        if (self_verify)
+        {
+            // find the left node's slot in the parent's children
+            unsigned int leftslot = 0;
+            while (leftslot <= parent->slotuse &&
+                   parent->childid[leftslot] != left)
+                ++leftslot;
+
+            TLX_BTREE_ASSERT(leftslot < parent->slotuse);
+            TLX_BTREE_ASSERT(parent->childid[leftslot] == left);
+            TLX_BTREE_ASSERT(parent->childid[leftslot + 1] == right);
+
+            TLX_BTREE_ASSERT(leftslot == parentslot);
+        }
+
+        // shift all slots in the right node
+
+        TLX_BTREE_ASSERT(right->slotuse + shiftnum < inner_slotmax);
+
+        std::copy_backward(right->slotkey, right->slotkey + right->slotuse,
+                           right->slotkey + right->slotuse + shiftnum);
+        std::copy_backward(right->childid, right->childid + right->slotuse + 1,
+                           right->childid + right->slotuse + 1 + shiftnum);
+
+        if (order_statistics)
+        {
+            std::copy_backward(right->counts(),
+                               right->counts() + right->slotuse + 1,
+                               right->counts() + right->slotuse + 1 + shiftnum);
+            std::copy(left->counts() + left->slotuse - shiftnum + 1,
+                      left->counts() + left->slotuse + 1, right->counts());
+            size_type moved = sum_counts(right, 0, shiftnum);
+            parent->counts()[parentslot] -= moved;
+            parent->counts()[parentslot + 1] += moved;
+        }
+
+        right->slotuse += shiftnum;
+
+        // copy the parent's decision slotkey and childid to the last new key on
+        // the right
+        right->slotkey[shiftnum - 1] = parent->slotkey[parentslot];
+
+        // copy the remaining last items from the left node to the first slot in
+        // the right node.
+        std::copy(left->slotkey + left->slotuse - shiftnum + 1,
+                  left->slotkey + left->slotuse, right->slotkey);
+        std::copy(left->childid + left->slotuse - shiftnum + 1,
+                  left->childid + left->slotuse + 1, right->childid);
+
+        // copy the first to-be-removed key from the left node to the parent's
+        // decision slot
+        parent->slotkey[parentslot] = left->slotkey[left->slotuse - shiftnum];
+
+        left->slotuse -= shiftnum;
+    }
+
+    //! \}
+
+private:
+    //! \name Private Range Erase Functions: Splitting and Joining Subtrees
+    //! \{
+
+    //! Return the leftmost leaf of the subtree n.
+    static LeafNode* leftmost_leaf(node* n)
+    {
+        while (!n->is_leafnode())
+            n = static_cast<InnerNode*>(n)->childid[0];
+        return static_cast<LeafNode*>(n);
+    }
+
+    //! Return the rightmost leaf of the subtree n.
+    static LeafNode* rightmost_leaf(node* n)
+    {
+        while (!n->is_leafnode())
+        {
+            InnerNode* inner = static_cast<InnerNode*>(n);
+            n = inner->childid[inner->slotuse];
+        }
+        return static_cast<LeafNode*>(n);
+    }
+
+    //! Determine the path from the root to the slot referenced by iter.
+    //! path[level] is the child slot taken in the inner node at that level,
+    //! and path[0] is the slot in the leaf. With duplicate keys, the leaf
+    //! found by key descent may lie before the iterator's leaf, hence the path
+    //! is then advanced leaf by leaf until the leaf is reached.
+    void find_iterator_path(const iterator& iter,
+                            std::vector<unsigned short>* path) const
+    {
+        std::vector<const InnerNode*> nodes(root_->level + 1);
+        path->resize(root_->level + 1);
+
+        bool at_end = (iter.curr_slot >= iter.curr_leaf->slotuse);
+
+        const node* n = root_;
+        while (!n->is_leafnode())
+        {
+            const InnerNode* inner = static_cast<const InnerNode*>(n);
+            unsigned short slot =
+                at_end ? inner->slotuse : find_lower(inner, iter.key());
+
+            nodes[inner->level] = inner;
+            (*path)[inner->level] = slot;
+            n = inner->childid[slot];
+        }
+
+        while (n != iter.curr_leaf)
+        {
+            unsigned short level = 1;
+            while (level <= root_->level &&
+                   (*path)[level] == nodes[level]->slotuse)
+                ++level;
+
+            tlx_die_unless(level <= root_->level);
+            ++(*path)[level];
+
+            for ( ; level > 1; --level)
             {
-                if (left_parent == parent)
-                    shift_right_inner(left_inner, inner, left_parent,
-                                      parentslot - 1);
-                else
-                    shift_left_inner(inner, right_inner, right_parent,
-                                     parentslot);
+                nodes[level - 1] = static_cast<const InnerNode*>(
+                    nodes[level]->childid[(*path)[level]]);
+                (*path)[level - 1] = 0;
             }
+
+            n = nodes[1]->childid[(*path)[1]];
         }
 
-        return myres;
+        (*path)[0] = iter.curr_slot;
     }
 
-    /*!
-     * Erase one key/data pair referenced by an iterator in the B+ tree.
-     *
-     * Descends down the tree in search of an iterator. During the descent the
-     * parent, left and right siblings and their parents are computed and passed
-     * down. The difficulty is that the iterator contains only a pointer to a
-     * LeafNode, which means that this function must do a recursive depth first
-     * search for that leaf node in the subtree containing all pairs of the same
-     * key. This subtree can be very large, even the whole tree, though in
-     * practice it would not make sense to have so many duplicate keys.
-     *
-     * Once the referenced key/data pair is found, it is removed from the leaf
-     * and the same underflow cases are handled as in erase_one_descend.
-     */
-    result_t erase_iter_descend(const iterator& iter, node* curr, node* left,
-                                node* right, InnerNode* left_parent,
-                                InnerNode* right_parent, InnerNode* parent,
-                                unsigned int parentslot)
+    //! Free the subtree n including all its items. Returns the number of
+    //! items freed.
+    size_type clear_subtree(node* n)
     {
-        if (curr->is_leafnode())
+        size_type count = 0;
+
+        if (n->is_leafnode())
         {
-            LeafNode* leaf = static_cast<LeafNode*>(curr);
-            LeafNode* left_leaf = static_cast<LeafNode*>(left);
-            LeafNode* right_leaf = static_cast<LeafNode*>(right);
+            count = n->slotuse;
+        }
+        else
+        {
+            InnerNode* inner = static_cast<InnerNode*>(n);
 
-            // if this is not the correct leaf, get next step in recursive
-            // search
-            if (leaf != iter.curr_leaf)
-            {
-                return btree_not_found;
-            }
+            for (unsigned short slot = 0; slot <= inner->slotuse; ++slot)
+                count += clear_subtree(inner->childid[slot]);
+        }
 
-            if (iter.curr_slot >= leaf->slotuse)
-            {
-                TLX_BTREE_PRINT("Could not find iterator ("
-                                << iter.curr_leaf << "," << iter.curr_slot
-                                << ") to erase. Invalid leaf node?");
+        free_node(n);
+        return count;
+    }
 
-                return btree_not_found;
-            }
+    //! Shrink the inner node to its children [0,slot), the other children
+    //! must already have been taken care of. Returns the remaining subtree,
+    //! which is either the inner node, its only child, or nullptr. In the
+    //! latter two cases the inner node is freed.
+    node* cut_inner_prefix(InnerNode* inner, unsigned short slot)
+    {
+        if (slot >= 2)
+        {
+            inner->slotuse = slot - 1;
+            return inner;
+        }
 
-            unsigned short slot = iter.curr_slot;
+        node* prefix = (slot == 1) ? inner->childid[0] : nullptr;
+        free_node(inner);
+        return prefix;
+    }
 
-            TLX_BTREE_PRINT("Found iterator in leaf " << curr << " at slot "
-                                                      << slot);
+    //! Returns a subtree containing the children (slot,slotuse] of the inner
+    //! node, which is either nullptr, the only child, or a newly allocated
+    //! inner node. The inner node itself is not modified.
+    node* copy_inner_suffix(const InnerNode* inner, unsigned short slot)
+    {
+        unsigned short num = inner->slotuse - slot;
 
-            std::copy(leaf->slotdata + slot + 1, leaf->slotdata + leaf->slotuse,
-                      leaf->slotdata + slot);
+        if (num == 0)
+            return nullptr;
+        if (num == 1)
+            return inner->childid[inner->slotuse];
 
-            leaf->slotuse--;
+        InnerNode* suffix = allocate_inner(inner->level);
 
-            result_t myres = btree_ok;
+        std::copy(inner->slotkey + slot + 1, inner->slotkey + inner->slotuse,
+                  suffix->slotkey);
+        std::copy(inner->childid + slot + 1,
+                  inner->childid + inner->slotuse + 1, suffix->childid);
+        if (order_statistics)
+        {
+            std::copy(inner->counts() + slot + 1,
+                      inner->counts() + inner->slotuse + 1, suffix->counts());
+        }
 
-            // if the last key of the leaf was changed, the parent is notified
-            // and updates the key of this leaf
-            if (slot == leaf->slotuse)
+        suffix->slotuse = num - 1;
+        return suffix;
+    }
+
+    /*!
+     * Remove the items between the two paths from the subtree n. The parts
+     * left and right of the range are returned as separate subtrees, which
+     * fulfill the B+ tree invariants with the relaxed fill of a root node.
+     * While both paths descend into the same child, the two parts are built
+     * on the way back up. Once they diverge, all children in between are
+     * freed as a whole.
+     */
+    void erase_range_descend(node* n, const unsigned short* first_path,
+                             const unsigned short* last_path, node** left,
+                             node** right, size_type* erased)
+    {
+        if (n->is_leafnode())
+        {
+            LeafNode* leaf = static_cast<LeafNode*>(n);
+
+            unsigned short first_slot = first_path[0];
+            unsigned short last_slot = last_path[0];
+
+            leaf->copy_slots(last_slot, leaf->slotuse, leaf, first_slot);
+
+            leaf->slotuse -= last_slot - first_slot;
+            *erased += last_slot - first_slot;
+
+            if (leaf->slotuse == 0)
             {
-                if (parent && parentslot < parent->slotuse)
-                {
-                    TLX_BTREE_ASSERT(parent->childid[parentslot] == curr);
-                    parent->slotkey[parentslot] = leaf->key(leaf->slotuse - 1);
-                }
-                else
-                {
-                    if (leaf->slotuse >= 1)
-                    {
-                        TLX_BTREE_PRINT("Scheduling lastkeyupdate: key "
-                                        << leaf->key(leaf->slotuse - 1));
-                        myres |= result_t(btree_update_lastkey,
-                                          leaf->key(leaf->slotuse - 1));
-                    }
-                    else
-                    {
-                        TLX_BTREE_ASSERT(leaf == root_);
-                    }
-                }
+                free_node(leaf);
+                leaf = nullptr;
             }
 
-            if (leaf->is_underflow() && !(leaf == root_ && leaf->slotuse >= 1))
-            {
-                // determine what to do about the underflow
+            *left = leaf;
+            *right = nullptr;
+            return;
+        }
 
-                // case : if this empty leaf is the root, then delete all nodes
-                // and set root to nullptr.
-                if (left_leaf == nullptr && right_leaf == nullptr)
-                {
-                    TLX_BTREE_ASSERT(leaf == root_);
-                    TLX_BTREE_ASSERT(leaf->slotuse == 0);
+        InnerNode* inner = static_cast<InnerNode*>(n);
 
-                    free_node(root_);
+        unsigned short first_slot = first_path[inner->level];
+        unsigned short last_slot = last_path[inner->level];
 
-                    root_ = leaf = nullptr;
-                    head_leaf_ = tail_leaf_ = nullptr;
+        node *child_left, *child_right;
 
-                    // will be decremented soon by insert_start()
-                    TLX_BTREE_ASSERT(stats_.size == 1);
-                    TLX_BTREE_ASSERT(stats_.leaves == 0);
-                    TLX_BTREE_ASSERT(stats_.inner_nodes == 0);
+        if (first_slot == last_slot)
+        {
+            erase_range_descend(inner->childid[first_slot], first_path,
+                                last_path, &child_left, &child_right, erased);
+        }
+        else
+        {
+            child_left = erase_suffix_descend(inner->childid[first_slot],
+                                              first_path, erased);
 
-                    return btree_ok;
-                }
-                // case : if both left and right leaves would underflow in case
-                // of a shift, then merging is necessary. choose the more local
-                // merger with our parent
-                if ((left_leaf == nullptr || left_leaf->is_few()) &&
-                    (right_leaf == nullptr || right_leaf->is_few()))
-                {
-                    if (left_parent == parent)
-                        myres |= merge_leaves(left_leaf, leaf, left_parent);
-                    else
-                        myres |= merge_leaves(leaf, right_leaf, right_parent);
-                }
-                // case : the right leaf has extra data, so balance right with
-                // current
-                else if ((left_leaf != nullptr && left_leaf->is_few()) &&
-                         (right_leaf != nullptr && !right_leaf->is_few()))
-                {
-                    if (right_parent == parent)
-                    {
-                        myres |= shift_left_leaf(leaf, right_leaf, right_parent,
-                                                 parentslot);
-                    }
-                    else
-                    {
-                        myres |= merge_leaves(left_leaf, leaf, left_parent);
-                    }
-                }
-                // case : the left leaf has extra data, so balance left with
-                // current
-                else if ((left_leaf != nullptr && !left_leaf->is_few()) &&
-                         (right_leaf != nullptr && right_leaf->is_few()))
-                {
-                    if (left_parent == parent)
-                    {
-                        shift_right_leaf(left_leaf, leaf, left_parent,
-                                         parentslot - 1);
-                    }
-                    else
-                    {
-                        myres |= merge_leaves(leaf, right_leaf, right_parent);
-                    }
-                }
-                // case : both the leaf and right leaves have extra data and our
-                // parent, choose the leaf with more data
-                else if (left_parent == right_parent)
-                {
-                    if (left_leaf->slotuse <= right_leaf->slotuse)
-                    {
-                        myres |= shift_left_leaf(leaf, right_leaf, right_parent,
-                                                 parentslot);
-                    }
-                    else
-                    {
-                        shift_right_leaf(left_leaf, leaf, left_parent,
-                                         parentslot - 1);
-                    }
-                }
-                else
-                {
-                    if (left_parent == parent)
-                    {
-                        shift_right_leaf(left_leaf, leaf, left_parent,
-                                         parentslot - 1);
-                    }
-                    else
-                    {
-                        myres |= shift_left_leaf(leaf, right_leaf, right_parent,
-                                                 parentslot);
-                    }
-                }
-            }
+            for (unsigned short s = first_slot + 1; s < last_slot; ++s)
+                *erased += clear_subtree(inner->childid[s]);
 
-            return myres;
+            child_right = erase_prefix_descend(inner->childid[last_slot],
+                                               last_path, erased);
         }
 
-        // !curr->is_leafnode()
-        InnerNode* inner = static_cast<InnerNode*>(curr);
-        InnerNode* left_inner = static_cast<InnerNode*>(left);
-        InnerNode* right_inner = static_cast<InnerNode*>(right);
-
-        // find first slot below which the searched iterator might be
-        // located.
+        node* suffix = copy_inner_suffix(inner, last_slot);
+        node* prefix = cut_inner_prefix(inner, first_slot);
 
-        result_t result;
-        unsigned short slot = find_lower(inner, iter.key());
+        *left = join_trees(prefix, child_left);
+        *right = join_trees(child_right, suffix);
+    }
 
-        while (slot <= inner->slotuse)
+    //! Remove all items at or after the path's position from the subtree n.
+    //! Returns the remaining subtree.
+    node* erase_suffix_descend(node* n, const unsigned short* path,
+                               size_type* erased)
+    {
+        if (n->is_leafnode())
         {
-            node *myleft, *myright;
-            InnerNode *myleft_parent, *myright_parent;
+            LeafNode* leaf = static_cast<LeafNode*>(n);
 
-            if (slot == 0)
-            {
-                myleft = (left == nullptr) ? nullptr :
-                                             static_cast<InnerNode*>(left)
-                                                 ->childid[left->slotuse - 1];
-                myleft_parent = left_parent;
-            }
-            else
-            {
-                myleft = inner->childid[slot - 1];
-                myleft_parent = inner;
-            }
+            *erased += leaf->slotuse - path[0];
+            leaf->slotuse = path[0];
 
-            if (slot == inner->slotuse)
-            {
-                myright = (right == nullptr) ?
-                              nullptr :
-                              static_cast<InnerNode*>(right)->childid[0];
-                myright_parent = right_parent;
-            }
-            else
+            if (leaf->slotuse == 0)
             {
-                myright = inner->childid[slot + 1];
-                myright_parent = inner;
+                free_node(leaf);
+                return nullptr;
             }
+            return leaf;
+        }
 
-            TLX_BTREE_PRINT("erase_iter_descend into " << inner->childid[slot]);
+        InnerNode* inner = static_cast<InnerNode*>(n);
+        unsigned short slot = path[inner->level];
 
-            result =
-                erase_iter_descend(iter, inner->childid[slot], myleft, myright,
-                                   myleft_parent, myright_parent, inner, slot);
+        for (unsigned short s = slot + 1; s <= inner->slotuse; ++s)
+            *erased += clear_subtree(inner->childid[s]);
 
-            if (!result.has(btree_not_found))
-                break;
+        node* child = erase_suffix_descend(inner->childid[slot], path, erased);
+
+        return join_trees(cut_inner_prefix(inner, slot), child);
+    }
+
+    //! Remove all items before the path's position from the subtree n.
+    //! Returns the remaining subtree.
+    node* erase_prefix_descend(node* n, const unsigned short* path,
+                               size_type* erased)
+    {
+        if (n->is_leafnode())
+        {
+            LeafNode* leaf = static_cast<LeafNode*>(n);
+            unsigned short slot = path[0];
 
-            // continue recursive search for leaf on next slot
+            leaf->copy_slots(slot, leaf->slotuse, leaf, 0);
 
-            if (slot < inner->slotuse &&
-                key_less(inner->slotkey[slot], iter.key()))
-                return btree_not_found;
+            leaf->slotuse -= slot;
+            *erased += slot;
 
-            ++slot;
+            if (leaf->slotuse == 0)
+            {
+                free_node(leaf);
+                return nullptr;
+            }
+            return leaf;
         }
 
-            if (slot > inner->slotuse)
-                return btree_not_found;
+        InnerNode* inner = static_cast<InnerNode*>(n);
+        unsigned short slot = path[inner->level];
 
-            result_t myres = btree_ok;
+        for (unsigned short s = 0; s < slot; ++s)
+            *erased += clear_subtree(inner->childid[s]);
 
-            if (result.has(btree_update_lastkey))
-            {
-                if (parent && parentslot < parent->slotuse)
-                {
-                    TLX_BTREE_PRINT("Fixing lastkeyupdate: key "
-                                    << result.lastkey << " into parent "
-                                    << parent << " at parentslot "
-                                    << parentslot);
+        node* child = erase_prefix_descend(inner->childid[slot], path, erased);
+        node* suffix = copy_inner_suffix(inner, slot);
+        free_node(inner);
 
-                    TLX_BTREE_ASSERT(parent->childid[parentslot] == curr);
-                    parent->slotkey[parentslot] = result.lastkey;
-                }
-                else
-                {
-                    TLX_BTREE_PRINT("Forwarding lastkeyupdate: key "
-                                    << result.lastkey);
-                    myres |= result_t(btree_update_lastkey, result.lastkey);
-                }
-            }
+        return join_trees(child, suffix);
+    }
 
-            if (result.has(btree_fixmerge))
-            {
-                // either the current node or the next is empty and should be
-                // removed
-                if (inner->childid[slot]->slotuse != 0)
-                    slot++;
+    /*!
+     * Concatenate two subtrees of the same level, where all keys in left are
+     * less or equal to those in right. sep must be the largest key in left.
+     * Both nodes may be underfilled like a root node. If their items fit into
+     * one node, right is merged into left and freed, and true is returned.
+     * Otherwise items are shifted such that neither node underflows, and sep
+     * is updated to the new largest key in left.
+     */
+    bool merge_or_balance(node* left, node* right, key_type* sep)
+    {
+        TLX_BTREE_ASSERT(left->level == right->level);
 
-                // this is the child slot invalidated by the merge
-                TLX_BTREE_ASSERT(inner->childid[slot]->slotuse == 0);
+        if (left->is_leafnode())
+        {
+            LeafNode* leftleaf = static_cast<LeafNode*>(left);
+            LeafNode* rightleaf = static_cast<LeafNode*>(right);
 
-                free_node(inner->childid[slot]);
+            TLX_BTREE_ASSERT(leftleaf->next_leaf == rightleaf);
 
-                std::copy(inner->slotkey + slot,
-                          inner->slotkey + inner->slotuse,
-                          inner->slotkey + slot - 1);
-                std::copy(inner->childid + slot + 1,
-                          inner->childid + inner->slotuse + 1,
-                          inner->childid + slot);
+            if (leftleaf->slotuse + rightleaf->slotuse <= leaf_slotmax)
+            {
+                rightleaf->copy_slots(0, rightleaf->slotuse, leftleaf,
+                                      leftleaf->slotuse);
 
-                inner->slotuse--;
+                leftleaf->slotuse += rightleaf->slotuse;
 
-                if (inner->level == 1)
-                {
-                    // fix split key for children leaves
-                    slot--;
-                    LeafNode* child =
-                        static_cast<LeafNode*>(inner->childid[slot]);
-                    inner->slotkey[slot] = child->key(child->slotuse - 1);
-                }
+                leftleaf->next_leaf = rightleaf->next_leaf;
+                if (leftleaf->next_leaf)
+                    leftleaf->next_leaf->prev_leaf = leftleaf;
+
+                free_node(rightleaf);
+                return true;
             }
 
-            if (inner->is_underflow() &&
-                !(inner == root_ && inner->slotuse >= 1))
+            if (leftleaf->is_underflow())
             {
-                // case: the inner node is the root and has just one
-                // child. that child becomes the new root
-                if (left_inner == nullptr && right_inner == nullptr)
-                {
-                    TLX_BTREE_ASSERT(inner == root_);
-                    TLX_BTREE_ASSERT(inner->slotuse == 0);
+                unsigned int shiftnum =
+                    (rightleaf->slotuse - leftleaf->slotuse) >> 1;
 
-                    root_ = inner->childid[0];
-
-                    inner->slotuse = 0;
-                    free_node(inner);
+                rightleaf->copy_slots(0, shiftnum, leftleaf,
+                                      leftleaf->slotuse);
+                rightleaf->copy_slots(shiftnum, rightleaf->slotuse, rightleaf,
+                                      0);
 
-                    return btree_ok;
-                }
-                // case : if both left and right leaves would underflow in case
-                // of a shift, then merging is necessary. choose the more local
-                // merger with our parent
-                if ((left_inner == nullptr || left_inner->is_few()) &&
-                    (right_inner == nullptr || right_inner->is_few()))
-                {
-                    if (left_parent == parent)
-                    {
-                        myres |= merge_inner(left_inner, inner, left_parent,
-                                             parentslot - 1);
-                    }
-                    else
-                    {
-                        myres |= merge_inner(inner, right_inner, right_parent,
-                                             parentslot);
-                    }
-                }
-                // case : the right leaf has extra data, so balance right with
-                // current
-                else if ((left_inner != nullptr && left_inner->is_few()) &&
-                         (right_inner != nullptr && !right_inner->is_few()))
-                {
-                    if (right_parent == parent)
-                    {
-                        shift_left_inner(inner, right_inner, right_parent,
-                                         parentslot);
-                    }
-                    else
-                    {
-                        myres |= merge_inner(left_inner, inner, left_parent,
-                                             parentslot - 1);
-                    }
-                }
-                // case : the left leaf has extra data, so balance left with
-                // current
-                else if ((left_inner != nullptr && !left_inner->is_few()) &&
-                         (right_inner != nullptr && right_inner->is_few()))
-                {
-                    if (left_parent == parent)
-                    {
-                        shift_right_inner(left_inner, inner, left_parent,
-                                          parentslot - 1);
-                    }
-                    else
-                    {
-                        myres |= merge_inner(inner, right_inner, right_parent,
-                                             parentslot);
-                    }
-                }
-                // case : both the leaf and right leaves have extra data and our
-                // parent, choose the leaf with more data
-                else if (left_parent == right_parent)
-                {
-                    if (left_inner->slotuse <= right_inner->slotuse)
-                    {
-                        shift_left_inner(inner, right_inner, right_parent,
-                                         parentslot);
-                    }
-                    else
-                    {
-                        shift_right_inner(left_inner, inner, left_parent,
-                                          parentslot - 1);
-                    }
-                }
-                else
-                {
-                    if (left_parent == parent)
-                    {
-                        shift_right_inner(left_inner, inner, left_parent,
-                                          parentslot - 1);
-                    }
-                    else
-                    {
-                        shift_left_inner(inner, right_inner, right_parent,
-                                         parentslot);
-                    }
-                }
+                leftleaf->slotuse += shiftnum;
+                rightleaf->slotuse -= shiftnum;
             }
+            else if (rightleaf->is_underflow())
+            {
+                unsigned int shiftnum =
+                    (leftleaf->slotuse - rightleaf->slotuse) >> 1;
 
-            return myres;
-    }
+                rightleaf->copy_slots_backward(0, rightleaf->slotuse,
+                                               rightleaf,
+                                               rightleaf->slotuse + shiftnum);
+                leftleaf->copy_slots(leftleaf->slotuse - shiftnum,
+                                     leftleaf->slotuse, rightleaf, 0);
 
-    //! Merge two leaf nodes. The function moves all key/data pairs from right
-    //! to left and sets right's slotuse to zero. The right slot is then removed
-    //! by the calling parent node.
-    result_t merge_leaves(LeafNode* left, LeafNode* right, InnerNode* parent)
-    {
-        TLX_BTREE_PRINT("Merge leaf nodes " << left << " and " << right
-                                            << " with common parent " << parent
-                                            << ".");
-        (void) parent;
+                leftleaf->slotuse -= shiftnum;
+                rightleaf->slotuse += shiftnum;
+            }
 
-        TLX_BTREE_ASSERT(left->is_leafnode() && right->is_leafnode());
-        TLX_BTREE_ASSERT(parent->level == 1);
+            *sep = leftleaf->key(leftleaf->slotuse - 1);
+            return false;
+        }
 
-        TLX_BTREE_ASSERT(left->slotuse + right->slotuse < leaf_slotmax);
+        InnerNode* leftinner = static_cast<InnerNode*>(left);
+        InnerNode* rightinner = static_cast<InnerNode*>(right);
 
-        std::copy(right->slotdata, right->slotdata + right->slotuse,
-                  left->slotdata + left->slotuse);
+        if (leftinner->slotuse + rightinner->slotuse + 1 <= inner_slotmax)
+        {
+            leftinner->slotkey[leftinner->slotuse] = *sep;
+            leftinner->slotuse++;
 
-        left->slotuse += right->slotuse;
+            std::copy(rightinner->slotkey,
+                      rightinner->slotkey + rightinner->slotuse,
+                      leftinner->slotkey + leftinner->slotuse);
+            std::copy(rightinner->childid,
+                      rightinner->childid + rightinner->slotuse + 1,
+                      leftinner->childid + leftinner->slotuse);
+            if (order_statistics)
+            {
+                std::copy(rightinner->counts(),
+                          rightinner->counts() + rightinner->slotuse + 1,
+                          leftinner->counts() + leftinner->slotuse);
+            }
 
-        left->next_leaf = right->next_leaf;
-        if (left->next_leaf)
-            left->next_leaf->prev_leaf = left;
-        else
-            tail_leaf_ = left;
+            leftinner->slotuse += rightinner->slotuse;
 
-        right->slotuse = 0;
+            free_node(rightinner);
+            return true;
+        }
 
-        return btree_fixmerge;
-    }
+        if (leftinner->is_underflow())
+        {
+            // same as shift_left_inner() with sep as the parent's slot.
+            unsigned int shiftnum =
+                (rightinner->slotuse - leftinner->slotuse) >> 1;
 
-    //! Merge two inner nodes. The function moves all key/childid pairs from
-    //! right to left and sets right's slotuse to zero. The right slot is then
-    //! removed by the calling parent node.
-    static result_t merge_inner(InnerNode* left, InnerNode* right,
-                                InnerNode* parent, unsigned int parentslot)
-    {
-        TLX_BTREE_PRINT("Merge inner nodes " << left << " and " << right
-                                             << " with common parent " << parent
-                                             << ".");
+            leftinner->slotkey[leftinner->slotuse] = *sep;
+            leftinner->slotuse++;
 
-        TLX_BTREE_ASSERT(left->level == right->level);
-        TLX_BTREE_ASSERT(parent->level == left->level + 1);
+            std::copy(rightinner->slotkey, rightinner->slotkey + shiftnum - 1,
+                      leftinner->slotkey + leftinner->slotuse);
+            std::copy(rightinner->childid, rightinner->childid + shiftnum,
+                      leftinner->childid + leftinner->slotuse);
+            if (order_statistics)
+            {
+                std::copy(rightinner->counts(), rightinner->counts() + shiftnum,
+                          leftinner->counts() + leftinner->slotuse);
+                std::copy(rightinner->counts() + shiftnum,
+                          rightinner->counts() + rightinner->slotuse + 1,
+                          rightinner->counts());
+            }
 
-        TLX_BTREE_ASSERT(parent->childid[parentslot] == left);
+            leftinner->slotuse += shiftnum - 1;
 
-        TLX_BTREE_ASSERT(left->slotuse + right->slotuse < inner_slotmax);
+            *sep = rightinner->slotkey[shiftnum - 1];
 
-        if (self_verify)
+            std::copy(rightinner->slotkey + shiftnum,
+                      rightinner->slotkey + rightinner->slotuse,
+                      rightinner->slotkey);
+            std::copy(rightinner->childid + shiftnum,
+                      rightinner->childid + rightinner->slotuse + 1,
+                      rightinner->childid);
+
+            rightinner->slotuse -= shiftnum;
+        }
+        else if (rightinner->is_underflow())
         {
-            // find the left node's slot in the parent's children
-            unsigned int leftslot = 0;
-            while (leftslot <= parent->slotuse &&
-                   parent->childid[leftslot] != left)
-                ++leftslot;
+            // same as shift_right_inner() with sep as the parent's slot.
+            unsigned int shiftnum =
+                (leftinner->slotuse - rightinner->slotuse) >> 1;
 
-            TLX_BTREE_ASSERT(leftslot < parent->slotuse);
-            TLX_BTREE_ASSERT(parent->childid[leftslot] == left);
-            TLX_BTREE_ASSERT(parent->childid[leftslot + 1] == right);
+            std::copy_backward(rightinner->slotkey,
+                               rightinner->slotkey + rightinner->slotuse,
+                               rightinner->slotkey + rightinner->slotuse +
+                                   shiftnum);
+            std::copy_backward(rightinner->childid,
+                               rightinner->childid + rightinner->slotuse + 1,
+                               rightinner->childid + rightinner->slotuse + 1 +
+                                   shiftnum);
+            if (order_statistics)
+            {
+                std::copy_backward(
+                    rightinner->counts(),
+                    rightinner->counts() + rightinner->slotuse + 1,
+                    rightinner->counts() + rightinner->slotuse + 1 + shiftnum);
+                std::copy(
+                    leftinner->counts() + leftinner->slotuse - shiftnum + 1,
+                    leftinner->counts() + leftinner->slotuse + 1,
+                    rightinner->counts());
+            }
 
-            TLX_BTREE_ASSERT(parentslot == leftslot);
-        }
+            rightinner->slotuse += shiftnum;
 
-        // retrieve the decision key from parent
-        left->slotkey[left->slotuse] = parent->slotkey[parentslot];
-        left->slotuse++;
+            rightinner->slotkey[shiftnum - 1] = *sep;
 
-        // copy over keys and children from right
-        std::copy(right->slotkey, right->slotkey + right->slotuse,
-                  left->slotkey + left->slotuse);
-        std::copy(right->childid, right->childid + right->slotuse + 1,
-                  left->childid + left->slotuse);
+            std::copy(leftinner->slotkey + leftinner->slotuse - shiftnum + 1,
+                      leftinner->slotkey + leftinner->slotuse,
+                      rightinner->slotkey);
+            std::copy(leftinner->childid + leftinner->slotuse - shiftnum + 1,
+                      leftinner->childid + leftinner->slotuse + 1,
+                      rightinner->childid);
 
-        left->slotuse += right->slotuse;
-        right->slotuse = 0;
+            *sep = leftinner->slotkey[leftinner->slotuse - shiftnum];
 
-        return btree_fixmerge;
+            leftinner->slotuse -= shiftnum;
+        }
+
+        return false;
     }
 
-    //! Balance two leaf nodes. The function moves key/data pairs from right to
-    //! left so that both nodes are equally filled. The parent node is updated
-    //! if possible.
-    static result_t shift_left_leaf(LeafNode* left, LeafNode* right,
-                                    InnerNode* parent, unsigned int parentslot)
+    /*!
+     * Concatenate the two trees a and b, where all keys in a are less or equal
+     * to all keys in b. Both trees must fulfill the B+ tree invariants, except
+     * that their roots may be underfilled. The lower tree is attached to the
+     * corresponding level of the higher tree's spine, hence only the
+     * O(log n) nodes on that spine are touched. Returns the new root.
+     */
+    node* join_trees(node* a, node* b)
     {
-        TLX_BTREE_ASSERT(left->is_leafnode() && right->is_leafnode());
-        TLX_BTREE_ASSERT(parent->level == 1);
-
-        TLX_BTREE_ASSERT(left->next_leaf == right);
-        TLX_BTREE_ASSERT(left == right->prev_leaf);
+        if (a == nullptr)
+            return b;
+        if (b == nullptr)
+            return a;
 
-        TLX_BTREE_ASSERT(left->slotuse < right->slotuse);
-        TLX_BTREE_ASSERT(parent->childid[parentslot] == left);
+        LeafNode* a_tail = rightmost_leaf(a);
+        LeafNode* b_head = leftmost_leaf(b);
 
-        unsigned int shiftnum = (right->slotuse - left->slotuse) >> 1;
+        a_tail->next_leaf = b_head;
+        b_head->prev_leaf = a_tail;
 
-        TLX_BTREE_PRINT("Shifting (leaf) " << shiftnum << " entries to left "
-                                           << left << " from right " << right
-                                           << " with common parent " << parent
-                                           << ".");
+        key_type maxkey = a_tail->key(a_tail->slotuse - 1);
 
-        TLX_BTREE_ASSERT(left->slotuse + shiftnum < leaf_slotmax);
+        key_type newkey = key_type();
+        node* newchild = nullptr;
+        node* root;
 
-        // copy the first items from the right node to the last slot in the left
-        // node.
+        if (a->level == b->level)
+        {
+            newkey = maxkey;
+            if (merge_or_balance(a, b, &newkey))
+                return a;
 
-        std::copy(right->slotdata, right->slotdata + shiftnum,
-                  left->slotdata + left->slotuse);
+            root = a;
+            newchild = b;
+        }
+        else if (a->level > b->level)
+        {
+            join_right_spine(static_cast<InnerNode*>(a), b, maxkey, &newkey,
+                             &newchild);
+            root = a;
+        }
+        else
+        {
+            join_left_spine(static_cast<InnerNode*>(b), a, maxkey, &newkey,
+                            &newchild);
+            root = b;
+        }
 
-        left->slotuse += shiftnum;
+        if (newchild)
+        {
+            InnerNode* newroot = allocate_inner(root->level + 1);
+            newroot->slotkey[0] = newkey;
 
-        // shift all slots in the right node to the left
+            newroot->childid[0] = root;
+            newroot->childid[1] = newchild;
 
-        std::copy(right->slotdata + shiftnum, right->slotdata + right->slotuse,
-                  right->slotdata);
+            newroot->slotuse = 1;
 
-        right->slotuse -= shiftnum;
+            if (order_statistics)
+            {
+                newroot->counts()[0] = subtree_size(root);
+                newroot->counts()[1] = subtree_size(newchild);
+            }
 
-        // fixup parent
-        if (parentslot < parent->slotuse)
-        {
-            parent->slotkey[parentslot] = left->key(left->slotuse - 1);
-            return btree_ok;
+            root = newroot;
         }
 
-        // the update is further up the tree
-        return result_t(btree_update_lastkey, left->key(left->slotuse - 1));
+        return root;
     }
 
-    //! Balance two inner nodes. The function moves key/data pairs from right to
-    //! left so that both nodes are equally filled. The parent node is updated
-    //! if possible.
-    static void shift_left_inner(InnerNode* left, InnerNode* right,
-                                 InnerNode* parent, unsigned int parentslot)
+    //! Attach the lower tree b to the rightmost spine of the subtree n.
+    //! maxkey is the largest key in n. Splits of n are returned in the last two
+    //! parameters, like in insert_descend().
+    void join_right_spine(InnerNode* n, node* b, const key_type& maxkey,
+                          key_type* splitkey, node** splitnode)
     {
-        TLX_BTREE_ASSERT(left->level == right->level);
-        TLX_BTREE_ASSERT(parent->level == left->level + 1);
+        if (n->level == b->level + 1)
+        {
+            key_type sep = maxkey;
+            bool merged = merge_or_balance(n->childid[n->slotuse], b, &sep);
 
-        TLX_BTREE_ASSERT(left->slotuse < right->slotuse);
-        TLX_BTREE_ASSERT(parent->childid[parentslot] == left);
+            if (order_statistics)
+            {
+                n->counts()[n->slotuse] =
+                    subtree_size(n->childid[n->slotuse]);
+            }
 
-        unsigned int shiftnum = (right->slotuse - left->slotuse) >> 1;
+            if (!merged)
+                insert_inner_child(n, n->slotuse, sep, b, splitkey, splitnode);
+            return;
+        }
 
-        TLX_BTREE_PRINT("Shifting (inner) " << shiftnum << " entries to left "
-                                            << left << " from right " << right
-                                            << " with common parent " << parent
-                                            << ".");
+        key_type newkey = key_type();
+        node* newchild = nullptr;
 
-        TLX_BTREE_ASSERT(left->slotuse + shiftnum < inner_slotmax);
+        join_right_spine(static_cast<InnerNode*>(n->childid[n->slotuse]), b,
+                         maxkey, &newkey, &newchild);
 
-        if (self_verify)
+        if (order_statistics)
+            n->counts()[n->slotuse] = subtree_size(n->childid[n->slotuse]);
+
+        if (newchild)
+            insert_inner_child(n, n->slotuse, newkey, newchild, splitkey,
+                               splitnode);
+    }
+
+    //! Attach the lower tree a to the leftmost spine of the subtree n. maxkey
+    //! is the largest key in a. Splits of n are returned in the last two
+    //! parameters, like in insert_descend().
+    void join_left_spine(InnerNode* n, node* a, const key_type& maxkey,
+                         key_type* splitkey, node** splitnode)
+    {
+        if (n->level == a->level + 1)
         {
-            // find the left node's slot in the parent's children and compare to
-            // parentslot
+            node* first = n->childid[0];
+            n->childid[0] = a;
 
-            unsigned int leftslot = 0;
-            while (leftslot <= parent->slotuse &&
-                   parent->childid[leftslot] != left)
-                ++leftslot;
+            key_type sep = maxkey;
+            bool merged = merge_or_balance(a, first, &sep);
 
-            TLX_BTREE_ASSERT(leftslot < parent->slotuse);
-            TLX_BTREE_ASSERT(parent->childid[leftslot] == left);
-            TLX_BTREE_ASSERT(parent->childid[leftslot + 1] == right);
+            if (order_statistics)
+                n->counts()[0] = subtree_size(a);
 
-            TLX_BTREE_ASSERT(leftslot == parentslot);
+            if (!merged)
+                insert_inner_child(n, 0, sep, first, splitkey, splitnode);
+            return;
         }
 
-        // copy the parent's decision slotkey and childid to the first new key
-        // on the left
-        left->slotkey[left->slotuse] = parent->slotkey[parentslot];
-        left->slotuse++;
+        key_type newkey = key_type();
+        node* newchild = nullptr;
 
-        // copy the other items from the right node to the last slots in the
-        // left node.
-        std::copy(right->slotkey, right->slotkey + shiftnum - 1,
-                  left->slotkey + left->slotuse);
-        std::copy(right->childid, right->childid + shiftnum,
-                  left->childid + left->slotuse);
+        join_left_spine(static_cast<InnerNode*>(n->childid[0]), a, maxkey,
+                        &newkey, &newchild);
 
-        left->slotuse += shiftnum - 1;
+        if (order_statistics)
+            n->counts()[0] = subtree_size(n->childid[0]);
 
-        // fixup parent
-        parent->slotkey[parentslot] = right->slotkey[shiftnum - 1];
+        if (newchild)
+            insert_inner_child(n, 0, newkey, newchild, splitkey, splitnode);
+    }
 
-        // shift all slots in the right node
-        std::copy(right->slotkey + shiftnum, right->slotkey + right->slotuse,
-                  right->slotkey);
-        std::copy(right->childid + shiftnum,
-                  right->childid + right->slotuse + 1, right->childid);
+    //! \}
 
-        right->slotuse -= shiftnum;
-    }
+public:
+    //! \name Splitting and Joining Whole Trees
+    //! \{
 
-    //! Balance two leaf nodes. The function moves key/data pairs from left to
-    //! right so that both nodes are equally filled. The parent node is updated
-    //! if possible.
-    static void shift_right_leaf(LeafNode* left, LeafNode* right,
-                                 InnerNode* parent, unsigned int parentslot)
+    /*!
+     * Move all items with keys greater or equal to key into the tree right,
+     * whose previous contents are erased. Whole subtrees are moved, only the
+     * O(log n) nodes on the path to key are split and rebalanced. Afterwards
+     * the nodes of the smaller of the two trees are counted for get_stats().
+     * With order_statistics, the item counts are taken from the roots, and
+     * only the inner nodes are visited, about a B-th of all nodes. Otherwise
+     * all its nodes are visited to count the items.
+     */
+    void split(const key_type& key, BTree& right)
     {
-        TLX_BTREE_ASSERT(left->is_leafnode() && right->is_leafnode());
-        TLX_BTREE_ASSERT(parent->level == 1);
+        TLX_BTREE_PRINT("BTree::split(" << key << ") on btree size "
+                                        << size());
+        TLX_BTREE_ASSERT(&right != this);
 
-        TLX_BTREE_ASSERT(left->next_leaf == right);
-        TLX_BTREE_ASSERT(left == right->prev_leaf);
-        TLX_BTREE_ASSERT(parent->childid[parentslot] == left);
+        right.clear();
+        right.allocator_ = allocator_;
+        right.key_less_ = key_less_;
 
-        TLX_BTREE_ASSERT(left->slotuse > right->slotuse);
+        iterator pos = lower_bound(key);
 
-        unsigned int shiftnum = (left->slotuse - right->slotuse) >> 1;
+        // iterators past the last slot of a leaf refer to the next leaf
+        if (root_ && pos.curr_slot >= pos.curr_leaf->slotuse &&
+            pos.curr_leaf->next_leaf)
+            pos = iterator(pos.curr_leaf->next_leaf, 0);
 
-        TLX_BTREE_PRINT("Shifting (leaf) " << shiftnum << " entries to right "
-                                           << right << " from left " << left
-                                           << " with common parent " << parent
-                                           << ".");
+        if (pos == end())
+            return;
 
-        if (self_verify)
+        if (pos == begin())
         {
-            // find the left node's slot in the parent's children
-            unsigned int leftslot = 0;
-            while (leftslot <= parent->slotuse &&
-                   parent->childid[leftslot] != left)
-                ++leftslot;
+            swap(right);
+            return;
+        }
 
-            TLX_BTREE_ASSERT(leftslot < parent->slotuse);
-            TLX_BTREE_ASSERT(parent->childid[leftslot] == left);
-            TLX_BTREE_ASSERT(parent->childid[leftslot + 1] == right);
+        std::vector<unsigned short> path;
+        find_iterator_path(pos, &path);
 
-            TLX_BTREE_ASSERT(leftslot == parentslot);
+        // cut the leaf chain if the split falls between two leaves, otherwise
+        // split_descend() splits the leaf.
+        if (pos.curr_slot == 0)
+        {
+            pos.curr_leaf->prev_leaf->next_leaf = nullptr;
+            pos.curr_leaf->prev_leaf = nullptr;
         }
 
-        // shift all slots in the right node
-
-        TLX_BTREE_ASSERT(right->slotuse + shiftnum < leaf_slotmax);
+        node *left_root, *right_root;
+        split_descend(root_, path.data(), &left_root, &right_root);
 
-        std::copy_backward(right->slotdata, right->slotdata + right->slotuse,
-                           right->slotdata + right->slotuse + shiftnum);
+        root_ = left_root;
+        head_leaf_ = leftmost_leaf(root_);
+        tail_leaf_ = rightmost_leaf(root_);
 
-        right->slotuse += shiftnum;
+        right.root_ = right_root;
+        right.head_leaf_ = leftmost_leaf(right_root);
+        right.tail_leaf_ = rightmost_leaf(right_root);
 
-        // copy the last items from the left node to the first slot in the right
-        // node.
-        std::copy(left->slotdata + left->slotuse - shiftnum,
-                  left->slotdata + left->slotuse, right->slotdata);
+        // stats_ counts the nodes of both trees, divide them up.
+        tree_stats smaller;
+        bool left_smaller;
+        if (order_statistics)
+        {
+            // the sizes are in the root counts, and the nodes of the smaller
+            // tree are counted without visiting its leaves.
+            size_type right_size = subtree_size(right_root);
+            left_smaller = 2 * right_size >= stats_.size;
+            count_nodes_above_leaves(left_smaller ? root_ : right_root,
+                                     &smaller);
+            smaller.size = left_smaller ? stats_.size - right_size : right_size;
+        }
+        else
+        {
+            left_smaller = count_smaller_subtree(root_, right_root, &smaller);
+        }
 
-        left->slotuse -= shiftnum;
+        if (left_smaller)
+        {
+            right.stats_.size = stats_.size - smaller.size;
+            right.stats_.leaves = stats_.leaves - smaller.leaves;
+            right.stats_.inner_nodes = stats_.inner_nodes - smaller.inner_nodes;
+            stats_.size = smaller.size;
+            stats_.leaves = smaller.leaves;
+            stats_.inner_nodes = smaller.inner_nodes;
+        }
+        else
+        {
+            right.stats_.size = smaller.size;
+            right.stats_.leaves = smaller.leaves;
+            right.stats_.inner_nodes = smaller.inner_nodes;
+            stats_.size -= smaller.size;
+            stats_.leaves -= smaller.leaves;
+            stats_.inner_nodes -= smaller.inner_nodes;
+        }
+        update_allocator_reserved();
+        right.update_allocator_reserved();
 
-        parent->slotkey[parentslot] = left->key(left->slotuse - 1);
+#ifdef TLX_BTREE_DEBUG
+        if (debug)
+        {
+            print(std::cout);
+            right.print(std::cout);
+        }
+#endif
+        if (self_verify)
+        {
+            verify();
+            right.verify();
+        }
     }
 
-    //! Balance two inner nodes. The function moves key/data pairs from left to
-    //! right so that both nodes are equally filled. The parent node is updated
-    //! if possible.
-    static void shift_right_inner(InnerNode* left, InnerNode* right,
-                                  InnerNode* parent, unsigned int parentslot)
+    /*!
+     * Append all items of the tree right, which must all be greater than the
+     * items in this tree, or greater or equal if duplicates are allowed. Both
+     * trees must use equal allocators. The smaller tree is attached to the
+     * boundary spine of the larger one, hence only O(log n) nodes are
+     * touched. The tree right is empty afterwards.
+     */
+    void join(BTree&& right)
     {
-        TLX_BTREE_ASSERT(left->level == right->level);
-        TLX_BTREE_ASSERT(parent->level == left->level + 1);
+        TLX_BTREE_PRINT("BTree::join() of btree size " << size() << " and "
+                                                      << right.size());
+        TLX_BTREE_ASSERT(&right != this);
 
-        TLX_BTREE_ASSERT(left->slotuse > right->slotuse);
-        TLX_BTREE_ASSERT(parent->childid[parentslot] == left);
+        if (right.empty())
+            return;
 
-        unsigned int shiftnum = (left->slotuse - right->slotuse) >> 1;
+        if (empty())
+        {
+            swap(right);
+            return;
+        }
 
-        TLX_BTREE_PRINT("Shifting (leaf) " << shiftnum << " entries to right "
-                                           << right << " from left " << left
-                                           << " with common parent " << parent
-                                           << ".");
+        tlx_die_verbose_unless(allocator_ == right.allocator_,
+                               "join() requires equal allocators");
+        TLX_BTREE_ASSERT(
+            allow_duplicates ?
+                key_lessequal(tail_leaf_->key(tail_leaf_->slotuse - 1),
+                              right.head_leaf_->key(0)) :
+                key_less(tail_leaf_->key(tail_leaf_->slotuse - 1),
+                         right.head_leaf_->key(0)));
 
+        // the right tree's nodes are counted here before join_trees() frees
+        // or allocates any of them.
+        stats_.size += right.stats_.size;
+        stats_.leaves += right.stats_.leaves;
+        stats_.inner_nodes += right.stats_.inner_nodes;
+
+        root_ = join_trees(root_, right.root_);
+        head_leaf_ = leftmost_leaf(root_);
+        tail_leaf_ = rightmost_leaf(root_);
+
+        right.root_ = nullptr;
+        right.head_leaf_ = right.tail_leaf_ = nullptr;
+        right.stats_ = tree_stats();
+        right.update_allocator_reserved();
+        update_allocator_reserved();
+
+#ifdef TLX_BTREE_DEBUG
+        if (debug)
+            print(std::cout);
+#endif
         if (self_verify)
+            verify();
+    }
+
+private:
+    /*!
+     * Split the subtree n at the slot given by path, like find_iterator_path()
+     * determines it. The items before the slot are returned in left, the
+     * others in right, both fulfilling the B+ tree invariants with the relaxed
+     * fill of a root node. A leaf is split by moving its upper part into a new
+     * leaf, inner nodes are split into prefix and suffix and joined with the
+     * parts of their child.
+     */
+    void split_descend(node* n, const unsigned short* path, node** left,
+                       node** right)
+    {
+        if (n->is_leafnode())
         {
-            // find the left node's slot in the parent's children
-            unsigned int leftslot = 0;
-            while (leftslot <= parent->slotuse &&
-                   parent->childid[leftslot] != left)
-                ++leftslot;
+            LeafNode* leaf = static_cast<LeafNode*>(n);
+            unsigned short slot = path[0];
 
-            TLX_BTREE_ASSERT(leftslot < parent->slotuse);
-            TLX_BTREE_ASSERT(parent->childid[leftslot] == left);
-            TLX_BTREE_ASSERT(parent->childid[leftslot + 1] == right);
+            if (slot == 0)
+            {
+                *left = nullptr;
+                *right = leaf;
+                return;
+            }
 
-            TLX_BTREE_ASSERT(leftslot == parentslot);
+            LeafNode* newleaf = allocate_leaf();
+
+            leaf->copy_slots(slot, leaf->slotuse, newleaf, 0);
+
+            newleaf->slotuse = leaf->slotuse - slot;
+            leaf->slotuse = slot;
+
+            newleaf->next_leaf = leaf->next_leaf;
+            if (newleaf->next_leaf)
+                newleaf->next_leaf->prev_leaf = newleaf;
+            leaf->next_leaf = nullptr;
+
+            *left = leaf;
+            *right = newleaf;
+            return;
         }
 
-        // shift all slots in the right node
+        InnerNode* inner = static_cast<InnerNode*>(n);
+        unsigned short slot = path[inner->level];
 
-        TLX_BTREE_ASSERT(right->slotuse + shiftnum < inner_slotmax);
+        node *child_left, *child_right;
+        split_descend(inner->childid[slot], path, &child_left, &child_right);
 
-        std::copy_backward(right->slotkey, right->slotkey + right->slotuse,
-                           right->slotkey + right->slotuse + shiftnum);
-        std::copy_backward(right->childid, right->childid + right->slotuse + 1,
-                           right->childid + right->slotuse + 1 + shiftnum);
+        node* suffix = copy_inner_suffix(inner, slot);
+        node* prefix = cut_inner_prefix(inner, slot);
 
-        right->slotuse += shiftnum;
+        *left = join_trees(prefix, child_left);
+        *right = join_trees(child_right, suffix);
+    }
 
-        // copy the parent's decision slotkey and childid to the last new key on
-        // the right
-        right->slotkey[shiftnum - 1] = parent->slotkey[parentslot];
+    //! Count the items and nodes of one subtree on the stack, returns false if
+    //! the stack is empty.
+    static bool count_subtree_step(std::vector<const node*>* stack,
+                                   tree_stats* stats)
+    {
+        if (stack->empty())
+            return false;
 
-        // copy the remaining last items from the left node to the first slot in
-        // the right node.
-        std::copy(left->slotkey + left->slotuse - shiftnum + 1,
-                  left->slotkey + left->slotuse, right->slotkey);
-        std::copy(left->childid + left->slotuse - shiftnum + 1,
-                  left->childid + left->slotuse + 1, right->childid);
+        const node* n = stack->back();
+        stack->pop_back();
 
-        // copy the first to-be-removed key from the left node to the parent's
-        // decision slot
-        parent->slotkey[parentslot] = left->slotkey[left->slotuse - shiftnum];
+        if (n->is_leafnode())
+        {
+            stats->size += n->slotuse;
+            stats->leaves++;
+        }
+        else
+        {
+            const InnerNode* inner = static_cast<const InnerNode*>(n);
+            stack->insert(stack->end(), inner->childid,
+                          inner->childid + inner->slotuse + 1);
+            stats->inner_nodes++;
+        }
+        return true;
+    }
 
-        left->slotuse -= shiftnum;
+    //! Count the leaves and inner nodes of the subtree n, visiting only its
+    //! inner nodes. The leaves are counted as children of level 1 nodes.
+    static void count_nodes_above_leaves(const node* n, tree_stats* stats)
+    {
+        if (n->is_leafnode())
+        {
+            stats->leaves++;
+            return;
+        }
+
+        std::vector<const InnerNode*> stack(
+            1, static_cast<const InnerNode*>(n));
+        while (!stack.empty())
+        {
+            const InnerNode* inner = stack.back();
+            stack.pop_back();
+            stats->inner_nodes++;
+
+            if (inner->level == 1)
+            {
+                stats->leaves += inner->slotuse + 1;
+                continue;
+            }
+            for (unsigned short i = 0; i <= inner->slotuse; ++i)
+            {
+                stack.push_back(
+                    static_cast<const InnerNode*>(inner->childid[i]));
+            }
+        }
+    }
+
+    //! Count the items and nodes of the subtrees a and b in lockstep until one
+    //! of them is complete, such that the cost depends only on the smaller
+    //! one. Its counts are returned in stats, and true if it was a.
+    static bool count_smaller_subtree(const node* a, const node* b,
+                                      tree_stats* stats)
+    {
+        std::vector<const node*> stack_a(1, a), stack_b(1, b);
+        tree_stats stats_a, stats_b;
+
+        while (true)
+        {
+            if (!count_subtree_step(&stack_a, &stats_a))
+            {
+                *stats = stats_a;
+                return true;
+            }
+            if (!count_subtree_step(&stack_b, &stats_b))
+            {
+                *stats = stats_b;
+                return false;
+            }
+        }
     }
 
     //! \}
@@ -3820,9 +7032,10 @@ public:
         {
             verify_node(root_, &minkey, &maxkey, vstats);
 
-            tlx_die_unless(vstats.size == stats_.size);
-            tlx_die_unless(vstats.leaves == stats_.leaves);
-            tlx_die_unless(vstats.inner_nodes == stats_.inner_nodes);
+            const tree_stats& stats = get_stats();
+            tlx_die_unless(vstats.size == stats.size);
+            tlx_die_unless(vstats.leaves == stats.leaves);
+            tlx_die_unless(vstats.inner_nodes == stats.inner_nodes);
 
             verify_leaflinks();
         }
@@ -3875,8 +7088,16 @@ private:
                 key_type submaxkey = key_type();
 
                 tlx_die_unless(subnode->level + 1 == inner->level);
+
+                size_type subsize = vstats.size;
                 verify_node(subnode, &subminkey, &submaxkey, vstats);
 
+                if (order_statistics)
+                {
+                    tlx_die_unless(inner->counts()[slot] ==
+                                   vstats.size - subsize);
+                }
+
                 TLX_BTREE_PRINT("verify subnode " << subnode << ": "
                                                   << subminkey << " - "
                                                   << submaxkey);
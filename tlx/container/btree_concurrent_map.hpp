@@ -0,0 +1,915 @@
+/*******************************************************************************
+ * tlx/container/btree_concurrent_map.hpp
+ *
+ * Part of tlx - http://panthema.net/tlx
+ *
+ * Copyright (C) 2026 Timo Bingmann <tb@panthema.net>
+ *
+ * All rights reserved. Published under the Boost Software License, Version 1.0
+ ******************************************************************************/
+
+#ifndef TLX_CONTAINER_BTREE_CONCURRENT_MAP_HEADER
+#define TLX_CONTAINER_BTREE_CONCURRENT_MAP_HEADER
+
+#include <tlx/container/btree.hpp>
+#include <tlx/die/core.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace tlx {
+
+//! \addtogroup tlx_container_btree
+//! \{
+
+/*!
+ * B+ tree map which can be read and modified by many threads at once.
+ *
+ * The nodes have the layout of BTree's nodes, except that leaves keep keys and
+ * data in separate arrays, and each node's header carries a version word. The
+ * tree is synchronized by optimistic lock coupling: readers never write to
+ * shared memory, they read a node's version before and after inspecting it and
+ * restart from the root if it changed. Writers descend in the same way and
+ * lock only the nodes they modify by incrementing their version to an odd
+ * value, and back to an even one when done. Full nodes are split eagerly on
+ * the way down, hence a split locks only the node and its parent.
+ *
+ * Because readers may observe keys and data while they are overwritten, both
+ * must be trivially copyable. Erasing does not merge underflowing nodes, and
+ * nodes are only freed by clear() and the destructor, so no node reachable by
+ * a concurrent reader is ever deallocated. The traits' self_verify and debug
+ * options are ignored; verify() may be called when no other thread accesses
+ * the map.
+ */
+template <typename Key_, typename Data_, typename Compare_ = std::less<Key_>,
+          typename Traits_ =
+              btree_default_traits<Key_, std::pair<Key_, Data_> >,
+          typename Alloc_ = std::allocator<std::pair<Key_, Data_> > >
+class btree_concurrent_map
+{
+    static_assert(std::is_trivially_copyable<Key_>::value,
+                  "Key_ must be trivially copyable for optimistic reads");
+    static_assert(std::is_trivially_copyable<Data_>::value,
+                  "Data_ must be trivially copyable for optimistic reads");
+
+public:
+    //! \name Template Parameter Types
+    //! \{
+
+    //! First template parameter: The key type of the btree. This is stored in
+    //! inner nodes and leaves.
+    typedef Key_ key_type;
+
+    //! Second template parameter: The value type associated with each key.
+    //! Stored in the B+ tree's leaves
+    typedef Data_ data_type;
+
+    //! Third template parameter: Key comparison function object
+    typedef Compare_ key_compare;
+
+    //! Fourth template parameter: Traits object used to define more parameters
+    //! of the B+ tree
+    typedef Traits_ traits;
+
+    //! Fifth template parameter: STL allocator for tree nodes. It must be
+    //! thread-safe.
+    typedef Alloc_ allocator_type;
+
+    //! \}
+
+public:
+    //! \name Constructed Types
+    //! \{
+
+    //! Typedef of our own type
+    typedef btree_concurrent_map<key_type, data_type, key_compare, traits,
+                                 allocator_type>
+        self;
+
+    //! Size type used to count keys
+    typedef size_t size_type;
+
+    //! \}
+
+public:
+    //! \name Static Constant Options and Values of the B+ Tree
+    //! \{
+
+    //! Base B+ tree parameter: The number of key/data slots in each leaf
+    static const unsigned short leaf_slotmax = traits::leaf_slots;
+
+    //! Base B+ tree parameter: The number of key slots in each inner node,
+    //! this can differ from slots in each leaf.
+    static const unsigned short inner_slotmax = traits::inner_slots;
+
+    //! \}
+
+private:
+    //! \name Node Classes for In-Memory Nodes
+    //! \{
+
+    //! The header structure of each node in-memory. This structure is extended
+    //! by InnerNode or LeafNode.
+    struct node
+    {
+        //! Version word: odd while a writer holds the node's lock, and
+        //! incremented on both locking and unlocking.
+        std::atomic<uint64_t> version;
+
+        //! Level in the b-tree, if level == 0 -> leaf node
+        unsigned short level;
+
+        //! Number of key slots in use. It is read concurrently by optimistic
+        //! readers, hence atomic.
+        std::atomic<unsigned short> slotuse;
+
+        //! Delayed initialisation of constructed node.
+        void initialize(const unsigned short l)
+        {
+            version.store(0, std::memory_order_relaxed);
+            level = l;
+            slotuse.store(0, std::memory_order_relaxed);
+        }
+
+        //! True if this is a leaf node.
+        bool is_leafnode() const
+        {
+            return (level == 0);
+        }
+    };
+
+    //! Extended structure of a inner node in-memory. Contains only keys and no
+    //! data items.
+    struct InnerNode : public node
+    {
+        //! Define an related allocator for the InnerNode structs.
+        typedef typename std::allocator_traits<
+            Alloc_>::template rebind_alloc<InnerNode>
+            alloc_type;
+
+        //! Keys of children or data pointers
+        key_type slotkey[inner_slotmax];
+
+        //! Pointers to children. They are read concurrently by optimistic
+        //! readers, hence atomic, and published with release stores.
+        std::atomic<node*> childid[inner_slotmax + 1];
+
+        //! Child at slot, for threads holding the lock or the only reference.
+        node* child(unsigned short slot) const
+        {
+            return childid[slot].load(std::memory_order_relaxed);
+        }
+
+        //! Set variables to initial values.
+        void initialize(const unsigned short l)
+        {
+            node::initialize(l);
+        }
+    };
+
+    //! Extended structure of a leaf node in memory. Contains keys and data
+    //! items in separate arrays, so the key array can be searched like the
+    //! inner nodes' one.
+    struct LeafNode : public node
+    {
+        //! Define an related allocator for the LeafNode structs.
+        typedef typename std::allocator_traits<
+            Alloc_>::template rebind_alloc<LeafNode>
+            alloc_type;
+
+        //! Keys of data items
+        key_type slotkey[leaf_slotmax];
+
+        //! Data items
+        data_type slotdata[leaf_slotmax];
+
+        //! Set variables to initial values
+        void initialize()
+        {
+            node::initialize(0);
+        }
+    };
+
+    //! Result of an optimistic attempt of an operation.
+    enum result_t { result_false, result_true, result_restart };
+
+    //! \}
+
+private:
+    //! \name Tree Object Data Members
+    //! \{
+
+    //! Pointer to the B+ tree's root node, either leaf or inner node.
+    std::atomic<node*> root_;
+
+    //! Number of items in the B+ tree.
+    std::atomic<size_type> size_;
+
+    //! Key comparison object. More comparison functions are generated from
+    //! this < relation.
+    key_compare key_less_;
+
+    //! Memory allocator.
+    allocator_type allocator_;
+
+    //! \}
+
+public:
+    //! \name Constructors and Destructor
+    //! \{
+
+    //! Default constructor initializing an empty B+ tree with the standard key
+    //! comparison function.
+    explicit btree_concurrent_map(
+        const allocator_type& alloc = allocator_type())
+        : size_(0), allocator_(alloc)
+    {
+        root_.store(allocate_leaf(), std::memory_order_relaxed);
+    }
+
+    //! Constructor initializing an empty B+ tree with a special key comparison
+    //! object.
+    explicit btree_concurrent_map(
+        const key_compare& kcf,
+        const allocator_type& alloc = allocator_type())
+        : size_(0), key_less_(kcf), allocator_(alloc)
+    {
+        root_.store(allocate_leaf(), std::memory_order_relaxed);
+    }
+
+    //! Frees up all used B+ tree memory pages
+    ~btree_concurrent_map()
+    {
+        node* root = root_.load(std::memory_order_relaxed);
+        clear_recursive(root);
+        free_node(root);
+    }
+
+    //! Non-copyable.
+    btree_concurrent_map(const btree_concurrent_map&) = delete;
+    //! Non-copyable.
+    btree_concurrent_map& operator = (const btree_concurrent_map&) = delete;
+
+    //! \}
+
+public:
+    //! \name Key and Value Comparison Function Objects
+    //! \{
+
+    //! Constant access to the key comparison object sorting the B+ tree.
+    key_compare key_comp() const
+    {
+        return key_less_;
+    }
+
+    //! \}
+
+private:
+    //! \name Convenient Key Comparison Functions Generated From key_less
+    //! \{
+
+    //! True if a < b ? "constructed" from key_less_()
+    bool key_less(const key_type& a, const key_type& b) const
+    {
+        return key_less_(a, b);
+    }
+
+    //! True if a == b ? constructed from key_less(). This requires the <
+    //! relation to be a total order, otherwise the B+ tree cannot be sorted.
+    bool key_equal(const key_type& a, const key_type& b) const
+    {
+        return !key_less_(a, b) && !key_less_(b, a);
+    }
+
+    //! \}
+
+public:
+    //! \name Allocators
+    //! \{
+
+    //! Return the base node allocator provided during construction.
+    allocator_type get_allocator() const
+    {
+        return allocator_;
+    }
+
+    //! \}
+
+private:
+    //! \name Node Object Allocation and Deallocation Functions
+    //! \{
+
+    //! Allocate and initialize a leaf node
+    LeafNode* allocate_leaf()
+    {
+        typename LeafNode::alloc_type a(allocator_);
+        LeafNode* n = new (a.allocate(1)) LeafNode();
+        n->initialize();
+        return n;
+    }
+
+    //! Allocate and initialize an inner node
+    InnerNode* allocate_inner(unsigned short level)
+    {
+        typename InnerNode::alloc_type a(allocator_);
+        InnerNode* n = new (a.allocate(1)) InnerNode();
+        n->initialize(level);
+        return n;
+    }
+
+    //! Correctly free either inner or leaf node.
+    void free_node(node* n)
+    {
+        if (n->is_leafnode())
+        {
+            LeafNode* ln = static_cast<LeafNode*>(n);
+            typename LeafNode::alloc_type a(allocator_);
+            std::allocator_traits<typename LeafNode::alloc_type>::destroy(a,
+                                                                          ln);
+            std::allocator_traits<typename LeafNode::alloc_type>::deallocate(
+                a, ln, 1);
+        }
+        else
+        {
+            InnerNode* in = static_cast<InnerNode*>(n);
+            typename InnerNode::alloc_type a(allocator_);
+            std::allocator_traits<typename InnerNode::alloc_type>::destroy(a,
+                                                                           in);
+            std::allocator_traits<typename InnerNode::alloc_type>::deallocate(
+                a, in, 1);
+        }
+    }
+
+    //! Recursively free up nodes.
+    void clear_recursive(node* n)
+    {
+        if (n->is_leafnode())
+            return;
+
+        InnerNode* inner = static_cast<InnerNode*>(n);
+        unsigned short slotuse = inner->slotuse.load(std::memory_order_relaxed);
+        for (unsigned short slot = 0; slot <= slotuse; ++slot)
+        {
+            clear_recursive(inner->child(slot));
+            free_node(inner->child(slot));
+        }
+    }
+
+    //! \}
+
+public:
+    //! \name Fast Destruction of the B+ Tree
+    //! \{
+
+    //! Frees all key/data pairs and all nodes of the tree. Must not run
+    //! concurrently with any other access.
+    void clear()
+    {
+        node* root = root_.load(std::memory_order_relaxed);
+        clear_recursive(root);
+        free_node(root);
+
+        root_.store(allocate_leaf(), std::memory_order_release);
+        size_.store(0, std::memory_order_relaxed);
+    }
+
+    //! \}
+
+public:
+    //! \name Access Functions to the Item Count
+    //! \{
+
+    //! Return the number of key/data pairs in the B+ tree. With concurrent
+    //! writers the count is only a snapshot.
+    size_type size() const
+    {
+        return size_.load(std::memory_order_relaxed);
+    }
+
+    //! Returns true if there is at least one key/data pair in the B+ tree
+    bool empty() const
+    {
+        return (size() == size_type(0));
+    }
+
+    //! \}
+
+private:
+    //! \name Optimistic Lock Coupling on the Version Words
+    //! \{
+
+    //! Pause the thread briefly while waiting for a lock or before a restart.
+    static void backoff(size_t* spins)
+    {
+        if (++*spins < 64)
+        {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+            __builtin_ia32_pause();
+#endif
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    //! Wait until n is unlocked and return its version.
+    static uint64_t read_lock(const node* n)
+    {
+        size_t spins = 0;
+        uint64_t v = n->version.load(std::memory_order_acquire);
+        while (v & 1)
+        {
+            backoff(&spins);
+            v = n->version.load(std::memory_order_acquire);
+        }
+        return v;
+    }
+
+    //! Check that n was not modified since its version v was read. Everything
+    //! read from n in between is consistent if this returns true.
+    static bool validate(const node* n, uint64_t v)
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return n->version.load(std::memory_order_relaxed) == v;
+    }
+
+    //! Lock n for writing if it still has version v.
+    static bool upgrade_lock(node* n, uint64_t v)
+    {
+        return n->version.compare_exchange_strong(
+            v, v + 1, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    //! Release the write lock on n, publishing a new version.
+    static void write_unlock(node* n)
+    {
+        n->version.fetch_add(1, std::memory_order_release);
+    }
+
+    //! \}
+
+private:
+    //! \name B+ Tree Node Binary Search Functions
+    //! \{
+
+    //! Specialized key search functions for the key type and comparator.
+    typedef btree_simd_search<key_type, key_compare> simd_search;
+
+    //! Searches for the first key in keys[0,num) greater or equal to key. Uses
+    //! binary search for nodes larger than traits::binsearch_threshold, and
+    //! the SIMD key search on the remaining window if available.
+    template <typename node_type>
+    unsigned short find_lower(const node_type* n, unsigned short num,
+                              const key_type& key) const
+    {
+        const key_type* keys = n->slotkey;
+        unsigned short lo = 0, hi = num;
+
+        if (sizeof(*n) > traits::binsearch_threshold)
+        {
+            while (hi - lo > simd_search::window)
+            {
+                unsigned short mid = (lo + hi) >> 1;
+
+                if (!key_less(keys[mid], key))
+                    hi = mid; // key <= mid
+                else
+                    lo = mid + 1; // key > mid
+            }
+        }
+
+        if (simd_search::enabled)
+        {
+            return static_cast<unsigned short>(
+                lo + simd_search::count_less(keys + lo, hi - lo, key));
+        }
+
+        while (lo < hi && key_less(keys[lo], key))
+            ++lo;
+        return lo;
+    }
+
+    //! Number of used slots of n as read by an optimistic reader, clamped to
+    //! the node's capacity in case the read is inconsistent. The acquire load
+    //! pairs with the writer's release store, which follows the slots.
+    static unsigned short read_slotuse(const node* n, unsigned short slotmax)
+    {
+        return std::min(n->slotuse.load(std::memory_order_acquire), slotmax);
+    }
+
+    //! Read the child of inner at slot and lock-couple to it: the parent is
+    //! validated once the pointer is read, which guarantees the child is
+    //! still the parent's, and again after the child's version is read,
+    //! which detects a split of the child in between. Returns nullptr if the
+    //! caller must restart, otherwise the child and its version in cv.
+    static node* read_child(const InnerNode* inner, uint64_t v,
+                            unsigned short slot, uint64_t* cv)
+    {
+        node* child = inner->childid[slot].load(std::memory_order_acquire);
+        if (!validate(inner, v))
+            return nullptr;
+        *cv = read_lock(child);
+        if (!validate(inner, v))
+            return nullptr;
+        return child;
+    }
+
+    //! Descend optimistically from the root to the leaf responsible for key.
+    //! Returns nullptr if the caller must restart, otherwise the leaf and its
+    //! version in v.
+    LeafNode* find_leaf(const key_type& key, uint64_t* v) const
+    {
+        node* n = root_.load(std::memory_order_acquire);
+        *v = read_lock(n);
+        if (n != root_.load(std::memory_order_acquire))
+            return nullptr;
+
+        while (!n->is_leafnode())
+        {
+            const InnerNode* inner = static_cast<const InnerNode*>(n);
+            unsigned short slot = find_lower(
+                inner, read_slotuse(inner, inner_slotmax), key);
+
+            uint64_t cv;
+            n = read_child(inner, *v, slot, &cv);
+            if (!n)
+                return nullptr;
+            *v = cv;
+        }
+
+        return static_cast<LeafNode*>(n);
+    }
+
+    //! \}
+
+public:
+    //! \name Concurrent Lookup Functions
+    //! \{
+
+    //! Non-STL function checking whether a key is in the B+ tree. The same as
+    //! find(key, nullptr).
+    bool exists(const key_type& key) const
+    {
+        return find(key, nullptr);
+    }
+
+    //! Tries to locate a key in the B+ tree and copies its data to *data, if
+    //! data is not nullptr. Returns true if the key was found.
+    bool find(const key_type& key, data_type* data) const
+    {
+        for (size_t spins = 0; ; backoff(&spins))
+        {
+            uint64_t v;
+            const LeafNode* leaf = find_leaf(key, &v);
+            if (!leaf)
+                continue;
+
+            unsigned short slotuse = read_slotuse(leaf, leaf_slotmax);
+            unsigned short slot = find_lower(leaf, slotuse, key);
+            bool found = slot < slotuse && key_equal(leaf->slotkey[slot], key);
+
+            data_type d;
+            if (found && data)
+                d = leaf->slotdata[slot];
+
+            if (!validate(leaf, v))
+                continue;
+
+            if (found && data)
+                *data = d;
+            return found;
+        }
+    }
+
+    //! \}
+
+public:
+    //! \name Concurrent Insertion and Erasure
+    //! \{
+
+    //! Attempt to insert a key/data pair into the B+ tree. Returns false if
+    //! the key was already present, which is left unchanged.
+    bool insert(const key_type& key, const data_type& data)
+    {
+        for (size_t spins = 0; ; backoff(&spins))
+        {
+            result_t r = try_insert(key, data, false);
+            if (r != result_restart)
+                return r == result_true;
+        }
+    }
+
+    //! Insert a key/data pair, or replace the data of an existing key.
+    //! Returns true if the key was inserted, false if it was assigned.
+    bool insert_or_assign(const key_type& key, const data_type& data)
+    {
+        for (size_t spins = 0; ; backoff(&spins))
+        {
+            result_t r = try_insert(key, data, true);
+            if (r != result_restart)
+                return r == result_true;
+        }
+    }
+
+    //! Erases the key/data pair referenced by key. Returns true if it was
+    //! found. Leaves are not merged if they underflow.
+    bool erase(const key_type& key)
+    {
+        for (size_t spins = 0; ; backoff(&spins))
+        {
+            uint64_t v;
+            LeafNode* leaf = find_leaf(key, &v);
+            if (!leaf)
+                continue;
+
+            unsigned short slotuse = read_slotuse(leaf, leaf_slotmax);
+            unsigned short slot = find_lower(leaf, slotuse, key);
+
+            if (slot >= slotuse || !key_equal(leaf->slotkey[slot], key))
+            {
+                if (!validate(leaf, v))
+                    continue;
+                return false;
+            }
+
+            if (!upgrade_lock(leaf, v))
+                continue;
+
+            std::copy(leaf->slotkey + slot + 1, leaf->slotkey + slotuse,
+                      leaf->slotkey + slot);
+            std::copy(leaf->slotdata + slot + 1, leaf->slotdata + slotuse,
+                      leaf->slotdata + slot);
+            leaf->slotuse.store(slotuse - 1, std::memory_order_release);
+
+            write_unlock(leaf);
+            size_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+private:
+    //! One optimistic attempt to insert or assign key/data. Descends like
+    //! find_leaf(), but splits any full node on the way, which requires
+    //! locking the node and its parent, and then restarts. Because parents
+    //! are never full, a split never propagates upwards.
+    result_t try_insert(const key_type& key, const data_type& data,
+                        bool assign)
+    {
+        node* n = root_.load(std::memory_order_acquire);
+        uint64_t v = read_lock(n);
+        if (n != root_.load(std::memory_order_acquire))
+            return result_restart;
+
+        InnerNode* parent = nullptr;
+        uint64_t parent_v = 0;
+
+        while (!n->is_leafnode())
+        {
+            InnerNode* inner = static_cast<InnerNode*>(n);
+            unsigned short slotuse = read_slotuse(inner, inner_slotmax);
+
+            if (slotuse == inner_slotmax)
+            {
+                split_node(parent, parent_v, inner, v);
+                return result_restart;
+            }
+
+            parent = inner;
+            parent_v = v;
+
+            uint64_t cv;
+            n = read_child(inner, v, find_lower(inner, slotuse, key), &cv);
+            if (!n)
+                return result_restart;
+            v = cv;
+        }
+
+        LeafNode* leaf = static_cast<LeafNode*>(n);
+        unsigned short slotuse = read_slotuse(leaf, leaf_slotmax);
+        unsigned short slot = find_lower(leaf, slotuse, key);
+
+        if (slot < slotuse && key_equal(leaf->slotkey[slot], key))
+        {
+            if (!assign)
+                return validate(leaf, v) ? result_false : result_restart;
+
+            if (!upgrade_lock(leaf, v))
+                return result_restart;
+            leaf->slotdata[slot] = data;
+            write_unlock(leaf);
+            return result_false;
+        }
+
+        if (slotuse == leaf_slotmax)
+        {
+            split_node(parent, parent_v, leaf, v);
+            return result_restart;
+        }
+
+        // slot and slotuse are valid if the leaf is still at version v.
+        if (!upgrade_lock(leaf, v))
+            return result_restart;
+
+        std::copy_backward(leaf->slotkey + slot, leaf->slotkey + slotuse,
+                           leaf->slotkey + slotuse + 1);
+        std::copy_backward(leaf->slotdata + slot, leaf->slotdata + slotuse,
+                           leaf->slotdata + slotuse + 1);
+        leaf->slotkey[slot] = key;
+        leaf->slotdata[slot] = data;
+        leaf->slotuse.store(slotuse + 1, std::memory_order_release);
+
+        write_unlock(leaf);
+        size_.fetch_add(1, std::memory_order_relaxed);
+        return result_true;
+    }
+
+    //! Lock the full node n and its parent, if both are still at the versions
+    //! read, and split n into two halves. The new right half is inserted into
+    //! the parent, or under a new root if n is the root. Returns without
+    //! change if a lock cannot be taken, the caller restarts either way.
+    void split_node(InnerNode* parent, uint64_t parent_v, node* n, uint64_t v)
+    {
+        if (parent && !upgrade_lock(parent, parent_v))
+            return;
+
+        if (!upgrade_lock(n, v))
+        {
+            if (parent)
+                write_unlock(parent);
+            return;
+        }
+
+        // without parent, n must still be the root: a new root above it is
+        // only installed while n is locked.
+        if (!parent && n != root_.load(std::memory_order_relaxed))
+        {
+            write_unlock(n);
+            return;
+        }
+
+        key_type newkey = key_type();
+        node* newnode;
+        if (n->is_leafnode())
+            newnode = split_leaf(static_cast<LeafNode*>(n), &newkey);
+        else
+            newnode = split_inner(static_cast<InnerNode*>(n), &newkey);
+
+        if (parent)
+        {
+            // parent was not full at version parent_v, so newnode fits.
+            unsigned short slotuse =
+                parent->slotuse.load(std::memory_order_relaxed);
+            unsigned short slot = find_lower(parent, slotuse, newkey);
+
+            std::copy_backward(parent->slotkey + slot,
+                               parent->slotkey + slotuse,
+                               parent->slotkey + slotuse + 1);
+            for (unsigned short i = slotuse + 1; i > slot + 1; --i)
+            {
+                parent->childid[i].store(
+                    parent->child(i - 1), std::memory_order_relaxed);
+            }
+            parent->slotkey[slot] = newkey;
+            // publish newnode's contents, then the grown slot range.
+            parent->childid[slot + 1].store(
+                newnode, std::memory_order_release);
+            parent->slotuse.store(slotuse + 1, std::memory_order_release);
+        }
+        else
+        {
+            InnerNode* newroot = allocate_inner(n->level + 1);
+            newroot->slotkey[0] = newkey;
+            newroot->childid[0].store(n, std::memory_order_relaxed);
+            newroot->childid[1].store(newnode, std::memory_order_relaxed);
+            newroot->slotuse.store(1, std::memory_order_relaxed);
+            root_.store(newroot, std::memory_order_release);
+        }
+
+        write_unlock(n);
+        if (parent)
+            write_unlock(parent);
+    }
+
+    //! Move the upper half of the locked leaf's items into a new leaf. Returns
+    //! the new leaf and its separator key, the largest key remaining in leaf.
+    LeafNode* split_leaf(LeafNode* leaf, key_type* newkey)
+    {
+        unsigned short slotuse = leaf->slotuse.load(std::memory_order_relaxed);
+        unsigned short mid = slotuse >> 1;
+
+        LeafNode* newleaf = allocate_leaf();
+        std::copy(leaf->slotkey + mid, leaf->slotkey + slotuse,
+                  newleaf->slotkey);
+        std::copy(leaf->slotdata + mid, leaf->slotdata + slotuse,
+                  newleaf->slotdata);
+        newleaf->slotuse.store(slotuse - mid, std::memory_order_relaxed);
+
+        leaf->slotuse.store(mid, std::memory_order_release);
+        *newkey = leaf->slotkey[mid - 1];
+        return newleaf;
+    }
+
+    //! Move the upper half of the locked inner node's children into a new
+    //! inner node. Returns the new node and the key separating both.
+    InnerNode* split_inner(InnerNode* inner, key_type* newkey)
+    {
+        unsigned short slotuse =
+            inner->slotuse.load(std::memory_order_relaxed);
+        unsigned short mid = slotuse >> 1;
+
+        InnerNode* newinner = allocate_inner(inner->level);
+        std::copy(inner->slotkey + mid + 1, inner->slotkey + slotuse,
+                  newinner->slotkey);
+        for (unsigned short i = mid + 1; i <= slotuse; ++i)
+        {
+            newinner->childid[i - mid - 1].store(
+                inner->child(i), std::memory_order_relaxed);
+        }
+        newinner->slotuse.store(slotuse - mid - 1, std::memory_order_relaxed);
+
+        inner->slotuse.store(mid, std::memory_order_release);
+        *newkey = inner->slotkey[mid];
+        return newinner;
+    }
+
+    //! \}
+
+public:
+    //! \name Verification of B+ Tree Invariants
+    //! \{
+
+    //! Run a thorough verification of all B+ tree invariants. No other thread
+    //! may access the tree meanwhile. The program aborts via tlx_die_unless()
+    //! if something is wrong. Unlike in BTree, nodes may underflow, and
+    //! separator keys are only upper bounds of their subtrees.
+    void verify() const
+    {
+        size_type size = 0;
+        verify_node(root_.load(std::memory_order_acquire), nullptr, nullptr,
+                    &size);
+        tlx_die_unless(size == this->size());
+    }
+
+private:
+    //! Recursively descend down the tree and verify each node. All keys in n
+    //! must be greater than *lower and at most *upper, if given.
+    void verify_node(const node* n, const key_type* lower,
+                     const key_type* upper, size_type* size) const
+    {
+        tlx_die_unless((n->version.load(std::memory_order_relaxed) & 1) == 0);
+
+        unsigned short slotuse = n->slotuse.load(std::memory_order_relaxed);
+
+        if (n->is_leafnode())
+        {
+            const LeafNode* leaf = static_cast<const LeafNode*>(n);
+            tlx_die_unless(slotuse <= leaf_slotmax);
+
+            for (unsigned short slot = 0; slot < slotuse; ++slot)
+            {
+                const key_type& key = leaf->slotkey[slot];
+                if (slot > 0)
+                    tlx_die_unless(key_less(leaf->slotkey[slot - 1], key));
+                tlx_die_unless(!lower || key_less(*lower, key));
+                tlx_die_unless(!upper || !key_less(*upper, key));
+            }
+
+            *size += slotuse;
+            return;
+        }
+
+        const InnerNode* inner = static_cast<const InnerNode*>(n);
+        tlx_die_unless(slotuse > 0 && slotuse <= inner_slotmax);
+
+        for (unsigned short slot = 0; slot <= slotuse; ++slot)
+        {
+            const key_type* sublower =
+                slot == 0 ? lower : &inner->slotkey[slot - 1];
+            const key_type* subupper =
+                slot == slotuse ? upper : &inner->slotkey[slot];
+
+            if (slot > 0 && slot < slotuse)
+                tlx_die_unless(key_less(*sublower, *subupper));
+
+            tlx_die_unless(inner->child(slot)->level + 1 == inner->level);
+            verify_node(inner->child(slot), sublower, subupper, size);
+        }
+    }
+
+    //! \}
+};
+
+//! \}
+
+} // namespace tlx
+
+#endif // !TLX_CONTAINER_BTREE_CONCURRENT_MAP_HEADER
+
+/******************************************************************************/
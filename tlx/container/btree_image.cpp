@@ -0,0 +1,94 @@
+/*******************************************************************************
+ * tlx/container/btree_image.cpp
+ *
+ * Part of tlx - http://panthema.net/tlx
+ *
+ * Copyright (C) 2026 Timo Bingmann <tb@panthema.net>
+ *
+ * All rights reserved. Published under the Boost Software License, Version 1.0
+ ******************************************************************************/
+
+#include <tlx/container/btree_image.hpp>
+#include <cstddef>
+#include <fstream>
+#include <string>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace tlx {
+
+btree_image_mapping::~btree_image_mapping()
+{
+    close();
+}
+
+bool btree_image_mapping::open(const std::string& path)
+{
+    close();
+
+#if !defined(_WIN32)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(st.st_size);
+    void* p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping remains valid after closing the descriptor
+    ::close(fd);
+    if (p == MAP_FAILED)
+        return false;
+
+    data_ = p;
+    size_ = size;
+    return true;
+#else
+    std::ifstream in(path.c_str(), std::ios::binary | std::ios::ate);
+    if (!in.good())
+        return false;
+
+    std::streamoff size = in.tellg();
+    if (size <= 0)
+        return false;
+
+    buffer_.resize(static_cast<size_t>(size));
+    in.seekg(0);
+    if (!in.read(buffer_.data(), size))
+    {
+        buffer_.clear();
+        return false;
+    }
+
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+    return true;
+#endif
+}
+
+void btree_image_mapping::close()
+{
+#if !defined(_WIN32)
+    if (data_)
+        munmap(data_, size_);
+#else
+    buffer_.clear();
+    buffer_.shrink_to_fit();
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
+
+} // namespace tlx
+
+/******************************************************************************/
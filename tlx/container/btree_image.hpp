@@ -0,0 +1,648 @@
+/*******************************************************************************
+ * tlx/container/btree_image.hpp
+ *
+ * Part of tlx - http://panthema.net/tlx
+ *
+ * Copyright (C) 2026 Timo Bingmann <tb@panthema.net>
+ *
+ * All rights reserved. Published under the Boost Software License, Version 1.0
+ ******************************************************************************/
+
+#ifndef TLX_CONTAINER_BTREE_IMAGE_HEADER
+#define TLX_CONTAINER_BTREE_IMAGE_HEADER
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tlx {
+
+//! \addtogroup tlx_container_btree
+//! \{
+
+/*!
+ * Header at the start of a B+ tree image written by btree_image::write(). All
+ * offsets are in bytes from the start of the image, and all sections start at
+ * a multiple of btree_image_header::alignment.
+ */
+struct btree_image_header
+{
+    //! magic bytes identifying the image
+    static constexpr const char* magic_string = "tlxBTimg";
+
+    //! current format version
+    static constexpr uint32_t current_version = 1;
+
+    //! alignment of the sections in the image
+    static constexpr uint64_t alignment = 64;
+
+    //! maximum number of separator levels
+    static constexpr uint32_t max_levels = 32;
+
+    //! magic bytes, equal to magic_string
+    char magic[8];
+
+    //! format version of the image
+    uint32_t version;
+
+    //! 0x01020304 as written, detects images of a different byte order
+    uint32_t byte_order;
+
+    //! sizeof(key_type) and sizeof(value_type) of the writing tree
+    uint32_t key_size, value_size;
+
+    //! number of items per leaf block and of separators per inner block
+    uint32_t leaf_slots, inner_slots;
+
+    //! number of items
+    uint64_t size;
+
+    //! total size of the image in bytes
+    uint64_t image_size;
+
+    //! offset of the sorted item array
+    uint64_t values_offset;
+
+    //! number of separator levels, 0 if all items fit into one leaf block
+    uint32_t levels;
+
+    //! 1 if the tree allowed duplicate keys, 0 otherwise
+    uint32_t duplicates;
+
+    //! offset and number of keys of each separator level, level 0 holds the
+    //! largest key of each leaf block.
+    uint64_t level_offset[max_levels];
+
+    //! number of keys of each separator level
+    uint64_t level_size[max_levels];
+};
+
+/*!
+ * Memory mapping of a file, read-only. On POSIX systems the file is mmap()-ed,
+ * on others it is read into a buffer.
+ */
+class btree_image_mapping
+{
+public:
+    //! construct an empty mapping
+    btree_image_mapping() = default;
+
+    //! non-copyable: delete copy-constructor
+    btree_image_mapping(const btree_image_mapping&) = delete;
+    //! non-copyable: delete assignment operator
+    btree_image_mapping& operator=(const btree_image_mapping&) = delete;
+
+    //! unmap the file
+    ~btree_image_mapping();
+
+    //! map the file at path, replacing a previous mapping. Returns false if
+    //! the file cannot be opened or mapped.
+    bool open(const std::string& path);
+
+    //! unmap the file
+    void close();
+
+    //! start of the mapped file
+    const void* data() const
+    {
+        return data_;
+    }
+
+    //! size of the mapped file
+    size_t size() const
+    {
+        return size_;
+    }
+
+private:
+    //! start of the mapped file
+    void* data_ = nullptr;
+
+    //! size of the mapped file
+    size_t size_ = 0;
+
+    //! buffer holding the file if it is not mmap()-ed
+    std::vector<char> buffer_;
+};
+
+/*!
+ * Read-only B+ tree stored in a compact, position-independent image, which is
+ * queried in place, e.g. directly on a memory mapped file.
+ *
+ * The image contains the sorted items of a BTreeType, i.e. a btree_set,
+ * btree_multiset, btree_map or btree_multimap, as one contiguous array, which
+ * is divided implicitly into leaf blocks of leaf_slotmax items. Above it are
+ * levels of separator keys: level 0 holds the largest key of each leaf block,
+ * and each higher level the largest key of each block of inner_slotmax + 1
+ * keys of the level below, until the top level fits into one block. The
+ * children of a block are found by their position, hence the image contains
+ * neither pointers nor offsets besides the ones in btree_image_header.
+ *
+ * Loading an image neither allocates nodes nor deserializes items: find(),
+ * lower_bound() and iteration work on the mapped memory, and the iterators are
+ * plain pointers into the item array. Keys and items must be trivially
+ * copyable and must not contain pointers. The image is only readable on
+ * systems with the same byte order and type layout.
+ */
+template <typename BTreeType>
+class btree_image
+{
+public:
+    //! \name Types
+    //! \{
+
+    //! The key type of the tree
+    typedef typename BTreeType::key_type key_type;
+
+    //! The value type of the tree, stored in the item array
+    typedef typename BTreeType::value_type value_type;
+
+    //! Key extractor class of the tree
+    typedef typename BTreeType::key_of_value key_of_value;
+
+    //! Key comparison function object of the tree
+    typedef typename BTreeType::key_compare key_compare;
+
+    //! Size type used to count keys
+    typedef size_t size_type;
+
+    //! Iterator over the items, a pointer into the image
+    typedef const value_type* const_iterator;
+
+    //! \}
+
+    static_assert(std::is_trivially_copyable<key_type>::value,
+                  "btree_image requires a trivially copyable key_type");
+    static_assert(std::is_standard_layout<value_type>::value &&
+                      std::is_trivially_destructible<value_type>::value,
+                  "btree_image requires a plain data value_type");
+
+public:
+    //! \name Writing Images
+    //! \{
+
+    //! Write an image of all items of tree to os. The leaf and inner block
+    //! sizes are taken from the tree's leaf_slotmax and inner_slotmax.
+    //! Returns false if writing failed.
+    static bool write(const BTreeType& tree, std::ostream& os)
+    {
+        const uint64_t leaf_slots = BTreeType::leaf_slotmax;
+        const uint64_t inner_slots = BTreeType::inner_slotmax + 1;
+
+        btree_image_header header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, btree_image_header::magic_string, 8);
+        header.version = btree_image_header::current_version;
+        header.byte_order = 0x01020304;
+        header.key_size = sizeof(key_type);
+        header.value_size = sizeof(value_type);
+        header.leaf_slots = static_cast<uint32_t>(leaf_slots);
+        header.inner_slots = static_cast<uint32_t>(inner_slots);
+        header.size = tree.size();
+        header.duplicates = BTreeType::allow_duplicates ? 1 : 0;
+
+        uint64_t offset = align(sizeof(header));
+        header.values_offset = offset;
+        offset = align(offset + header.size * sizeof(value_type));
+
+        uint64_t num = (header.size + leaf_slots - 1) / leaf_slots;
+        while (num > 1)
+        {
+            if (header.levels == btree_image_header::max_levels)
+                return false;
+
+            header.level_offset[header.levels] = offset;
+            header.level_size[header.levels] = num;
+            ++header.levels;
+            offset = align(offset + num * sizeof(key_type));
+
+            if (num <= inner_slots)
+                break;
+            num = (num + inner_slots - 1) / inner_slots;
+        }
+        header.image_size = offset;
+
+        uint64_t written = 0;
+        os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        written += sizeof(header);
+        pad(os, &written, header.values_offset);
+
+        // write the items in chunks and collect the separators of level 0.
+        std::vector<key_type> keys, upper;
+        std::vector<value_type> chunk;
+        chunk.reserve(4096);
+        size_type i = 0;
+        for (typename BTreeType::const_iterator it = tree.begin();
+             it != tree.end(); ++it, ++i)
+        {
+            chunk.push_back(*it);
+            if ((i + 1) % leaf_slots == 0 || i + 1 == header.size)
+                keys.push_back(key_of_value::get(*it));
+            if (chunk.size() == 4096)
+            {
+                write_array(os, &written, chunk);
+                chunk.clear();
+            }
+        }
+        write_array(os, &written, chunk);
+
+        for (uint32_t l = 0; l < header.levels; ++l)
+        {
+            pad(os, &written, header.level_offset[l]);
+            write_array(os, &written, keys);
+
+            upper.clear();
+            for (size_t k = inner_slots - 1; k < keys.size(); k += inner_slots)
+                upper.push_back(keys[k]);
+            if (keys.size() % inner_slots != 0)
+                upper.push_back(keys.back());
+            keys.swap(upper);
+        }
+        pad(os, &written, header.image_size);
+
+        return os.good();
+    }
+
+    //! \}
+
+public:
+    //! \name Constructors and Loading Images
+    //! \{
+
+    //! Construct an empty image, which contains no items.
+    explicit btree_image(const key_compare& kcf = key_compare())
+        : key_less_(kcf)
+    {
+    }
+
+    //! non-copyable: delete copy-constructor
+    btree_image(const btree_image&) = delete;
+    //! non-copyable: delete assignment operator
+    btree_image& operator = (const btree_image&) = delete;
+
+    //! Use the image in the memory [data, data + size), which must remain
+    //! valid while it is used. Checks the header against the tree type and
+    //! the layout of the sections, but not the items. Returns false, leaving
+    //! the image empty, if the header is invalid; see error().
+    bool attach(const void* data, size_t size)
+    {
+        header_ = nullptr;
+        values_ = nullptr;
+        error_ = check_header(data, size);
+        if (error_)
+            return false;
+
+        header_ = static_cast<const btree_image_header*>(data);
+        values_ = reinterpret_cast<const value_type*>(
+            static_cast<const char*>(data) + header_->values_offset);
+        for (uint32_t l = 0; l < header_->levels; ++l)
+        {
+            levels_[l] = reinterpret_cast<const key_type*>(
+                static_cast<const char*>(data) + header_->level_offset[l]);
+        }
+        return true;
+    }
+
+    //! Map the image file at path and attach() it. Returns false if the file
+    //! cannot be mapped or its header is invalid; see error().
+    bool open(const std::string& path)
+    {
+        if (!mapping_.open(path))
+        {
+            attach(nullptr, 0);
+            error_ = "cannot map file";
+            return false;
+        }
+        return attach(mapping_.data(), mapping_.size());
+    }
+
+    //! Description of why the last attach(), open() or verify() failed, or
+    //! nullptr.
+    const char* error() const
+    {
+        return error_;
+    }
+
+    //! \}
+
+public:
+    //! \name Access Functions
+    //! \{
+
+    //! Return the number of items in the image
+    size_type size() const
+    {
+        return header_ ? static_cast<size_type>(header_->size) : 0;
+    }
+
+    //! Returns true if there is at least one item in the image
+    bool empty() const
+    {
+        return (size() == size_type(0));
+    }
+
+    //! Iterator to the first item
+    const_iterator begin() const
+    {
+        return values_;
+    }
+
+    //! Iterator past the last item
+    const_iterator end() const
+    {
+        return values_ + size();
+    }
+
+    //! Constant access to the key comparison object
+    key_compare key_comp() const
+    {
+        return key_less_;
+    }
+
+    //! \}
+
+public:
+    //! \name Searching the Image
+    //! \{
+
+    //! Non-STL function checking whether a key is in the image.
+    bool exists(const key_type& key) const
+    {
+        return find(key) != end();
+    }
+
+    //! Returns an iterator to the first item with key, or end().
+    const_iterator find(const key_type& key) const
+    {
+        const_iterator it = lower_bound(key);
+        if (it != end() && !key_less_(key, key_of_value::get(*it)))
+            return it;
+        return end();
+    }
+
+    //! Returns the number of items with key.
+    size_type count(const key_type& key) const
+    {
+        return static_cast<size_type>(upper_bound(key) - lower_bound(key));
+    }
+
+    //! Returns an iterator to the first item with a key equal to or greater
+    //! than key, or end().
+    const_iterator lower_bound(const key_type& key) const
+    {
+        return search(key, [this](const key_type& a, const key_type& b) {
+                   return key_less_(a, b);
+               });
+    }
+
+    //! Returns an iterator to the first item with a key greater than key, or
+    //! end().
+    const_iterator upper_bound(const key_type& key) const
+    {
+        return search(key, [this](const key_type& a, const key_type& b) {
+                   return !key_less_(b, a);
+               });
+    }
+
+    //! Returns both lower_bound() and upper_bound() of key.
+    std::pair<const_iterator, const_iterator> equal_range(
+        const key_type& key) const
+    {
+        return std::make_pair(lower_bound(key), upper_bound(key));
+    }
+
+    //! \}
+
+public:
+    //! \name Verification of the Image
+    //! \{
+
+    //! Verify the items and separators of an attached image in one pass over
+    //! it: items must be sorted, unique unless the tree allowed duplicates,
+    //! and each separator must be the largest key of the block it refers to.
+    //! Returns false on the first violation; see error().
+    bool verify()
+    {
+        error_ = nullptr;
+        if (!header_)
+            return true;
+
+        const uint64_t leaf_slots = header_->leaf_slots;
+        const uint64_t inner_slots = header_->inner_slots;
+
+        for (size_type i = 1; i < size(); ++i)
+        {
+            const key_type& a = key_of_value::get(values_[i - 1]);
+            const key_type& b = key_of_value::get(values_[i]);
+            if (header_->duplicates ? key_less_(b, a) : !key_less_(a, b))
+            {
+                error_ = "items are not sorted";
+                return false;
+            }
+        }
+
+        for (uint32_t l = 0; l < header_->levels; ++l)
+        {
+            for (uint64_t k = 0; k < header_->level_size[l]; ++k)
+            {
+                // the last item or key in the block of separator k
+                const key_type* last;
+                if (l == 0)
+                {
+                    uint64_t end = std::min<uint64_t>((k + 1) * leaf_slots,
+                                                      size());
+                    last = &key_of_value::get(values_[end - 1]);
+                }
+                else
+                {
+                    uint64_t end = std::min<uint64_t>(
+                        (k + 1) * inner_slots, header_->level_size[l - 1]);
+                    last = &levels_[l - 1][end - 1];
+                }
+
+                const key_type& sep = levels_[l][k];
+                if (key_less_(sep, *last) || key_less_(*last, sep))
+                {
+                    error_ = "separator key does not match its block";
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    //! \}
+
+private:
+    //! \name Private Helpers
+    //! \{
+
+    //! Round offset up to the section alignment.
+    static uint64_t align(uint64_t offset)
+    {
+        const uint64_t a = btree_image_header::alignment;
+        return (offset + a - 1) / a * a;
+    }
+
+    //! Write zero bytes until offset is reached.
+    static void pad(std::ostream& os, uint64_t* written, uint64_t offset)
+    {
+        static const char zeros[btree_image_header::alignment] = { 0 };
+        while (*written < offset)
+        {
+            uint64_t n = std::min<uint64_t>(offset - *written, sizeof(zeros));
+            os.write(zeros, static_cast<std::streamsize>(n));
+            *written += n;
+        }
+    }
+
+    //! Write the contents of an array of plain data.
+    template <typename Type>
+    static void write_array(std::ostream& os, uint64_t* written,
+                            const std::vector<Type>& v)
+    {
+        os.write(reinterpret_cast<const char*>(v.data()),
+                 static_cast<std::streamsize>(v.size() * sizeof(Type)));
+        *written += v.size() * sizeof(Type);
+    }
+
+    //! Check that [data, data + size) contains a valid image for this tree
+    //! type. Returns an error description or nullptr.
+    static const char* check_header(const void* data, size_t size)
+    {
+        if (!data || size < sizeof(btree_image_header))
+            return "image is smaller than its header";
+        if (reinterpret_cast<uintptr_t>(data) % alignof(btree_image_header))
+            return "image is misaligned";
+
+        const btree_image_header* h =
+            static_cast<const btree_image_header*>(data);
+
+        if (std::memcmp(h->magic, btree_image_header::magic_string, 8) != 0)
+            return "image has wrong magic bytes";
+        if (h->version != btree_image_header::current_version)
+            return "image has unsupported format version";
+        if (h->byte_order != 0x01020304)
+            return "image has different byte order";
+        if (h->key_size != sizeof(key_type) ||
+            h->value_size != sizeof(value_type))
+            return "image has different key or value size";
+        if (h->leaf_slots < 1 || h->inner_slots < 2 ||
+            h->levels > btree_image_header::max_levels)
+            return "image has invalid block sizes";
+        if (h->image_size > size)
+            return "image is truncated";
+
+        if (!check_section(data, h, h->values_offset, h->size,
+                           sizeof(value_type), alignof(value_type)))
+            return "image has invalid item section";
+
+        // the separator levels must have the sizes given by the item count.
+        uint64_t num = (h->size + h->leaf_slots - 1) / h->leaf_slots;
+        for (uint32_t l = 0; l < h->levels; ++l)
+        {
+            if (num <= 1 || h->level_size[l] != num ||
+                !check_section(data, h, h->level_offset[l], num,
+                               sizeof(key_type), alignof(key_type)))
+                return "image has invalid separator level";
+            num = (num + h->inner_slots - 1) / h->inner_slots;
+        }
+        if (h->levels == 0 ? num > 1
+                           : h->level_size[h->levels - 1] > h->inner_slots)
+            return "image has too few separator levels";
+
+        return nullptr;
+    }
+
+    //! Check that count elements of elem_size bytes at offset lie inside the
+    //! image and are aligned.
+    static bool check_section(const void* data, const btree_image_header* h,
+                              uint64_t offset, uint64_t count,
+                              uint64_t elem_size, uint64_t elem_align)
+    {
+        if (offset < sizeof(btree_image_header) || offset > h->image_size)
+            return false;
+        if (count > (h->image_size - offset) / elem_size)
+            return false;
+        uintptr_t p = reinterpret_cast<uintptr_t>(data) + offset;
+        return p % elem_align == 0;
+    }
+
+    //! Descend through the separator levels to the first item for which
+    //! less(item key, key) is false, using the same predicate on the
+    //! separators.
+    template <typename Less>
+    const_iterator search(const key_type& key, Less less) const
+    {
+        if (empty())
+            return end();
+
+        // index of the block on the current level
+        uint64_t block = 0;
+        for (uint32_t l = header_->levels; l-- > 0; )
+        {
+            const key_type* keys = levels_[l];
+            uint64_t lo = block * header_->inner_slots;
+            uint64_t hi = std::min<uint64_t>(lo + header_->inner_slots,
+                                             header_->level_size[l]);
+
+            block = static_cast<uint64_t>(
+                std::partition_point(keys + lo, keys + hi,
+                                     [&](const key_type& k) {
+                                         return less(k, key);
+                                     }) -
+                keys);
+
+            // only possible on the top level: all keys are less
+            if (block == hi)
+                return end();
+        }
+
+        uint64_t lo = block * header_->leaf_slots;
+        uint64_t hi = std::min<uint64_t>(lo + header_->leaf_slots, size());
+        return std::partition_point(values_ + lo, values_ + hi,
+                                    [&](const value_type& v) {
+                                        return less(key_of_value::get(v), key);
+                                    });
+    }
+
+    //! \}
+
+private:
+    //! \name Data Members
+    //! \{
+
+    //! Header of the attached image, or nullptr.
+    const btree_image_header* header_ = nullptr;
+
+    //! Sorted item array of the attached image.
+    const value_type* values_ = nullptr;
+
+    //! Separator key arrays of the attached image.
+    const key_type* levels_[btree_image_header::max_levels];
+
+    //! Description of the last error, or nullptr.
+    const char* error_ = nullptr;
+
+    //! Key comparison object.
+    key_compare key_less_;
+
+    //! Mapping of the file opened by open().
+    btree_image_mapping mapping_;
+
+    //! \}
+};
+
+//! \}
+
+} // namespace tlx
+
+#endif // !TLX_CONTAINER_BTREE_IMAGE_HEADER
+
+/******************************************************************************/
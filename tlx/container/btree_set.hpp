@@ -15,6 +15,7 @@
 #include <functional>
 #include <memory>
 #include <utility>
+#include <vector>
 
 namespace tlx {
 
@@ -426,6 +427,114 @@ public:
 
     //! \}
 
+public:
+    //! \name Order Statistics: Rank and Select Queries
+    //! \{
+
+    //! Returns the number of items with keys less than key. Requires
+    //! order_statistics to be enabled in the traits.
+    template <bool OrderStatistics = btree_impl::order_statistics>
+    size_type rank(const key_type& key) const
+    {
+        return tree_.template rank<OrderStatistics>(key);
+    }
+
+    //! Returns an iterator to the k-th smallest item, or end() if k >= size().
+    //! Requires order_statistics to be enabled in the traits.
+    template <bool OrderStatistics = btree_impl::order_statistics>
+    iterator select(size_type k)
+    {
+        return tree_.template select<OrderStatistics>(k);
+    }
+
+    //! Returns a constant iterator to the k-th smallest item, or end() if k >=
+    //! size(). Requires order_statistics to be enabled in the traits.
+    template <bool OrderStatistics = btree_impl::order_statistics>
+    const_iterator select(size_type k) const
+    {
+        return tree_.template select<OrderStatistics>(k);
+    }
+
+    //! Returns the number of items between the two iterators in O(log n)
+    //! time. Requires order_statistics to be enabled in the traits.
+    template <bool OrderStatistics = btree_impl::order_statistics>
+    std::ptrdiff_t distance(const_iterator first, const_iterator last) const
+    {
+        return tree_.template distance<OrderStatistics>(first, last);
+    }
+
+    //! \}
+
+public:
+    //! \name Range Scans over Leaf Spans
+    //! \{
+
+    //! Call fn(first, last) for each contiguous span [first, last) of items in
+    //! one leaf, in order, covering all items whose keys are in [lo, hi).
+    //! Prefetches the leaves ahead of the scan.
+    template <typename Visitor>
+    void for_each_leaf_span(const key_type& lo, const key_type& hi,
+                            Visitor fn) const
+    {
+        tree_.for_each_leaf_span(lo, hi, fn);
+    }
+
+    //! Call fn(first, last) for each leaf's span of items, covering all items.
+    template <typename Visitor>
+    void for_each_leaf_span(Visitor fn) const
+    {
+        tree_.for_each_leaf_span(fn);
+    }
+
+    //! Call fn(value) for each item whose key is in [lo, hi), in order.
+    template <typename Function>
+    void for_each_range(const key_type& lo, const key_type& hi,
+                        Function fn) const
+    {
+        tree_.for_each_range(lo, hi, fn);
+    }
+
+    //! \}
+
+public:
+    //! \name Parallel Traversal of Subranges
+    //! \{
+
+    //! Split the items [first,last) into at most k consecutive subranges of
+    //! roughly equal size, using the inner nodes instead of walking leaves.
+    //! Returns the boundaries first = b[0] < b[1] < ... < b[j] = last.
+    std::vector<const_iterator> partition(const_iterator first,
+                                          const_iterator last, size_t k) const
+    {
+        return tree_.partition(first, last, k);
+    }
+
+    //! Split all items into at most k consecutive subranges of roughly equal
+    //! size.
+    std::vector<const_iterator> partition(size_t k) const
+    {
+        return tree_.partition(k);
+    }
+
+    //! Call fn(value) for each item in [first,last) using num_threads threads,
+    //! each processing one subrange of partition(). fn must be safe to call
+    //! concurrently.
+    template <typename Function>
+    void parallel_for_each(const_iterator first, const_iterator last,
+                           const Function& fn, size_t num_threads) const
+    {
+        tree_.parallel_for_each(first, last, fn, num_threads);
+    }
+
+    //! Call fn(value) for each item using num_threads threads.
+    template <typename Function>
+    void parallel_for_each(const Function& fn, size_t num_threads) const
+    {
+        tree_.parallel_for_each(fn, num_threads);
+    }
+
+    //! \}
+
 public:
     //! \name B+ Tree Object Comparison Functions
     //! \{
@@ -488,6 +597,15 @@ public:
     {
     }
 
+    //! Replace the contents with a copy of other, rebuilt in linear time into
+    //! nodes filled to about target_fill of their capacity and allocated in
+    //! key order, using up to num_threads threads.
+    void assign_compact(const btree_set& other, double target_fill = 1.0,
+                        size_t num_threads = 1)
+    {
+        tree_.assign_compact(other.tree_, target_fill, num_threads);
+    }
+
     //! \}
 
 public:
@@ -501,24 +619,20 @@ public:
         return tree_.insert(x);
     }
 
-    //! Attempt to insert a key into the B+ tree. The iterator hint is currently
-    //! ignored by the B+ tree insertion routine.
+    //! Attempt to insert a key into the B+ tree. The iterator hint saves the
+    //! descent from the root if the key belongs next to it.
     iterator insert(iterator hint, const key_type& x)
     {
         return tree_.insert(hint, x);
     }
 
     //! Attempt to insert the range [first,last) of iterators dereferencing to
-    //! key_type into the B+ tree. Each key/data pair is inserted individually.
+    //! key_type into the B+ tree. Each key is inserted individually, using the
+    //! previous one's position as hint while the keys ascend.
     template <typename InputIterator>
     void insert(InputIterator first, InputIterator last)
     {
-        InputIterator iter = first;
-        while (iter != last)
-        {
-            insert(*iter);
-            ++iter;
-        }
+        return tree_.insert(first, last);
     }
 
     //! Bulk load a sorted range [first,last). Loads items into leaves and
@@ -530,6 +644,25 @@ public:
         return tree_.bulk_load(first, last);
     }
 
+    //! Bulk load a sorted range [first,last) using num_threads threads. The
+    //! resulting tree is identical to the one constructed by the sequential
+    //! bulk_load(). The tree must be empty when calling this function.
+    template <typename Iterator>
+    void bulk_load(Iterator first, Iterator last, size_t num_threads)
+    {
+        return tree_.bulk_load(first, last, num_threads);
+    }
+
+    //! Insert the sorted range [first,last) into the possibly non-empty
+    //! set by merging it leaf by leaf. Items whose key is already present,
+    //! or equal to a preceding item of the range, are skipped. Returns the
+    //! number of items inserted.
+    template <typename Iterator>
+    size_type insert_sorted(Iterator first, Iterator last)
+    {
+        return tree_.insert_sorted(first, last);
+    }
+
     //! \}
 
 public:
@@ -555,14 +688,45 @@ public:
         return tree_.erase(iter);
     }
 
-#ifdef TLX_BTREE_TODO
-    //! Erase all keys in the range [first,last). This function is currently
-    //! not implemented by the B+ Tree.
-    void erase(iterator /* first */, iterator /* last */)
+    //! Erase all keys in the range [first,last).
+    void erase(iterator first, iterator last)
     {
-        abort();
+        return tree_.erase(first, last);
+    }
+
+    //! \}
+
+public:
+    //! \name Compaction of the Tree
+    //! \{
+
+    //! Re-pack all items into nodes filled to about target_fill of their
+    //! capacity in linear time, see get_stats() for the current fill.
+    //! Invalidates all iterators.
+    void compact(double target_fill = 1.0)
+    {
+        tree_.compact(target_fill);
+    }
+
+    //! \}
+
+public:
+    //! \name Splitting and Joining Whole Trees
+    //! \{
+
+    //! Move all keys greater or equal to key into the tree right, whose
+    //! previous contents are erased. Only O(log n) nodes are restructured.
+    void split(const key_type& key, btree_set& right)
+    {
+        tree_.split(key, right.tree_);
+    }
+
+    //! Append all keys of the tree right, which must be greater than the keys
+    //! in this tree. Only O(log n) nodes are restructured.
+    void join(btree_set&& right)
+    {
+        tree_.join(std::move(right.tree_));
     }
-#endif
 
     //! \}
 
@@ -0,0 +1,1324 @@
+/*******************************************************************************
+ * tlx/container/btree_snapshot_map.hpp
+ *
+ * Part of tlx - http://panthema.net/tlx
+ *
+ * Copyright (C) 2026 Timo Bingmann <tb@panthema.net>
+ *
+ * All rights reserved. Published under the Boost Software License, Version 1.0
+ ******************************************************************************/
+
+#ifndef TLX_CONTAINER_BTREE_SNAPSHOT_MAP_HEADER
+#define TLX_CONTAINER_BTREE_SNAPSHOT_MAP_HEADER
+
+#include <tlx/container/btree.hpp>
+#include <tlx/die/core.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+namespace tlx {
+
+//! \addtogroup tlx_container_btree
+//! \{
+
+/*!
+ * B+ tree map with O(1) copy-on-write snapshots.
+ *
+ * The nodes have the layout of BTree's nodes plus a reference count, and are
+ * shared between all maps copied from each other. snapshot(), the copy
+ * constructor and assignment only share the root. A modification copies the
+ * nodes on the root-to-leaf path which are shared with another map, and
+ * modifies only nodes referenced by this map alone. Hence a snapshot keeps
+ * its contents while the map it was taken from keeps changing.
+ *
+ * Shared leaves cannot be linked to different neighbours in each version, so
+ * the leaves have no prev/next pointers. Instead, each iterator holds the path
+ * from the root to its leaf and moves to the adjacent leaf through the
+ * lowest ancestor on that path which has another child in that direction.
+ *
+ * Reference counts are atomic and shared nodes are never modified, so
+ * different maps sharing nodes may be used from different threads, e.g. a
+ * snapshot can be iterated in a background thread while the map keeps being
+ * modified. A single map object is not thread-safe.
+ */
+template <typename Key_, typename Data_, typename Compare_ = std::less<Key_>,
+          typename Traits_ =
+              btree_default_traits<Key_, std::pair<Key_, Data_> >,
+          typename Alloc_ = std::allocator<std::pair<Key_, Data_> > >
+class btree_snapshot_map
+{
+public:
+    //! \name Template Parameter Types
+    //! \{
+
+    //! First template parameter: The key type of the btree. This is stored in
+    //! inner nodes.
+    typedef Key_ key_type;
+
+    //! Second template parameter: The value type associated with each key.
+    //! Stored in the B+ tree's leaves
+    typedef Data_ data_type;
+
+    //! Third template parameter: Key comparison function object
+    typedef Compare_ key_compare;
+
+    //! Fourth template parameter: Traits object used to define more parameters
+    //! of the B+ tree
+    typedef Traits_ traits;
+
+    //! Fifth template parameter: STL allocator for tree nodes
+    typedef Alloc_ allocator_type;
+
+    //! \}
+
+public:
+    //! \name Constructed Types
+    //! \{
+
+    //! Typedef of our own type
+    typedef btree_snapshot_map<key_type, data_type, key_compare, traits,
+                               allocator_type>
+        self;
+
+    //! Construct the STL-required value_type as a composition pair of key and
+    //! data types
+    typedef std::pair<key_type, data_type> value_type;
+
+    //! Size type used to count keys
+    typedef size_t size_type;
+
+    //! \}
+
+public:
+    //! \name Static Constant Options and Values of the B+ Tree
+    //! \{
+
+    //! Base B+ tree parameter: The number of key/data slots in each leaf
+    static const unsigned short leaf_slotmax = traits::leaf_slots;
+
+    //! Base B+ tree parameter: The number of key slots in each inner node,
+    //! this can differ from slots in each leaf.
+    static const unsigned short inner_slotmax = traits::inner_slots;
+
+    //! Computed B+ tree parameter: The minimum number of key/data slots used
+    //! in a leaf. If fewer slots are used, the leaf will be merged or slots
+    //! shifted from it's siblings.
+    static const unsigned short leaf_slotmin = (leaf_slotmax / 2);
+
+    //! Computed B+ tree parameter: The minimum number of key slots used
+    //! in an inner node. If fewer slots are used, the inner node will be
+    //! merged or slots shifted from it's siblings.
+    static const unsigned short inner_slotmin = (inner_slotmax / 2);
+
+    //! Maximum number of inner levels, which bounds the path stored in each
+    //! iterator. It is reached by no tree fitting into memory.
+    static const unsigned short max_height = 24;
+
+    //! \}
+
+private:
+    //! \name Node Classes for In-Memory Nodes
+    //! \{
+
+    //! The header structure of each node in-memory. This structure is extended
+    //! by InnerNode or LeafNode.
+    struct node
+    {
+        //! Number of maps and inner nodes referencing this node. Only nodes
+        //! with a single reference may be modified.
+        std::atomic<size_t> refs;
+
+        //! Level in the b-tree, if level == 0 -> leaf node
+        unsigned short level;
+
+        //! Number of key slotuse use, so the number of valid children or data
+        //! pointers
+        unsigned short slotuse;
+
+        //! Delayed initialisation of constructed node.
+        void initialize(const unsigned short l)
+        {
+            refs.store(1, std::memory_order_relaxed);
+            level = l;
+            slotuse = 0;
+        }
+
+        //! True if this is a leaf node.
+        bool is_leafnode() const
+        {
+            return (level == 0);
+        }
+    };
+
+    //! Extended structure of a inner node in-memory. Contains only keys and no
+    //! data items.
+    struct InnerNode : public node
+    {
+        //! Define an related allocator for the InnerNode structs.
+        typedef typename std::allocator_traits<
+            Alloc_>::template rebind_alloc<InnerNode>
+            alloc_type;
+
+        //! Keys of children or data pointers
+        key_type slotkey[inner_slotmax];
+
+        //! Pointers to children
+        node* childid[inner_slotmax + 1];
+
+        //! Set variables to initial values.
+        void initialize(const unsigned short l)
+        {
+            node::initialize(l);
+        }
+
+        //! Return key in slot s
+        const key_type& key(size_t s) const
+        {
+            return slotkey[s];
+        }
+
+        //! True if the node's slots are full.
+        bool is_full() const
+        {
+            return (node::slotuse == inner_slotmax);
+        }
+
+        //! True if node has too few entries.
+        bool is_underflow() const
+        {
+            return (node::slotuse < inner_slotmin);
+        }
+    };
+
+    //! Extended structure of a leaf node in memory. Contains pairs of keys and
+    //! data items.
+    struct LeafNode : public node
+    {
+        //! Define an related allocator for the LeafNode structs.
+        typedef typename std::allocator_traits<
+            Alloc_>::template rebind_alloc<LeafNode>
+            alloc_type;
+
+        //! Array of (key, data) pairs
+        value_type slotdata[leaf_slotmax];
+
+        //! Set variables to initial values
+        void initialize()
+        {
+            node::initialize(0);
+        }
+
+        //! Return key in slot s.
+        const key_type& key(size_t s) const
+        {
+            return slotdata[s].first;
+        }
+
+        //! True if the node's slots are full.
+        bool is_full() const
+        {
+            return (node::slotuse == leaf_slotmax);
+        }
+
+        //! True if node has too few entries.
+        bool is_underflow() const
+        {
+            return (node::slotuse < leaf_slotmin);
+        }
+    };
+
+    //! \}
+
+public:
+    //! \name Iterators
+    //! \{
+
+    //! STL-like read-only iterator object for B+ tree items. The iterator
+    //! points to a specific slot number in a leaf and stores the inner nodes
+    //! and slots on the path from the root to the leaf.
+    class const_iterator
+    {
+    public:
+        // *** Types
+
+        //! The key type of the btree. Returned by key().
+        typedef typename btree_snapshot_map::key_type key_type;
+
+        //! The value type of the btree. Returned by operator*().
+        typedef typename btree_snapshot_map::value_type value_type;
+
+        //! Reference to the value_type. STL required.
+        typedef const value_type& reference;
+
+        //! Pointer to the value_type. STL required.
+        typedef const value_type* pointer;
+
+        //! STL-magic iterator category
+        typedef std::bidirectional_iterator_tag iterator_category;
+
+        //! STL-magic
+        typedef ptrdiff_t difference_type;
+
+        //! Our own type
+        typedef const_iterator self;
+
+    private:
+        // *** Members
+
+        //! Number of inner nodes on the path
+        unsigned short height;
+
+        //! Inner nodes on the path from the root, and the slot of the child
+        //! taken in each.
+        struct
+        {
+            const InnerNode* inner;
+            unsigned short slot;
+        } path[max_height];
+
+        //! The currently referenced leaf node of the tree
+        const LeafNode* curr_leaf;
+
+        //! Current key/data slot referenced
+        unsigned short curr_slot;
+
+        //! Also friendly to the map, which sets up the path.
+        friend class btree_snapshot_map;
+
+        //! Append the inner node n and the child slot to the path.
+        void push(const InnerNode* n, unsigned short slot)
+        {
+            path[height].inner = n;
+            path[height].slot = slot;
+            ++height;
+        }
+
+        //! Descend from n to its leftmost leaf, appending to the path.
+        void descend_first(const node* n)
+        {
+            while (!n->is_leafnode())
+            {
+                const InnerNode* inner = static_cast<const InnerNode*>(n);
+                push(inner, 0);
+                n = inner->childid[0];
+            }
+            curr_leaf = static_cast<const LeafNode*>(n);
+            curr_slot = 0;
+        }
+
+        //! Descend from n to its rightmost leaf, appending to the path.
+        void descend_last(const node* n)
+        {
+            while (!n->is_leafnode())
+            {
+                const InnerNode* inner = static_cast<const InnerNode*>(n);
+                push(inner, inner->slotuse);
+                n = inner->childid[inner->slotuse];
+            }
+            curr_leaf = static_cast<const LeafNode*>(n);
+            curr_slot = curr_leaf->slotuse;
+        }
+
+        //! Move to the first slot of the next leaf, if there is one.
+        bool next_leaf()
+        {
+            unsigned short h = height;
+            while (h > 0 && path[h - 1].slot == path[h - 1].inner->slotuse)
+                --h;
+            if (h == 0)
+                return false;
+
+            height = h;
+            const InnerNode* inner = path[h - 1].inner;
+            unsigned short slot = ++path[h - 1].slot;
+            descend_first(inner->childid[slot]);
+            return true;
+        }
+
+        //! Move to the end of the previous leaf, if there is one.
+        bool prev_leaf()
+        {
+            unsigned short h = height;
+            while (h > 0 && path[h - 1].slot == 0)
+                --h;
+            if (h == 0)
+                return false;
+
+            height = h;
+            const InnerNode* inner = path[h - 1].inner;
+            unsigned short slot = --path[h - 1].slot;
+            descend_last(inner->childid[slot]);
+            return true;
+        }
+
+    public:
+        // *** Methods
+
+        //! Default-Constructor of a const iterator
+        const_iterator() : height(0), curr_leaf(nullptr), curr_slot(0)
+        {
+        }
+
+        //! Dereference the iterator.
+        reference operator*() const
+        {
+            return curr_leaf->slotdata[curr_slot];
+        }
+
+        //! Dereference the iterator.
+        pointer operator->() const
+        {
+            return &curr_leaf->slotdata[curr_slot];
+        }
+
+        //! Key of the current slot.
+        const key_type& key() const
+        {
+            return curr_leaf->key(curr_slot);
+        }
+
+        //! Prefix++ advance the iterator to the next slot.
+        const_iterator& operator++()
+        {
+            if (curr_slot + 1U < curr_leaf->slotuse || !next_leaf())
+                ++curr_slot; // at end(), if it was the last slot
+            return *this;
+        }
+
+        //! Postfix++ advance the iterator to the next slot.
+        const_iterator operator++(int)
+        {
+            const_iterator tmp = *this; // copy ourselves
+            ++*this;
+            return tmp;
+        }
+
+        //! Prefix-- backstep the iterator to the last slot.
+        const_iterator& operator--()
+        {
+            if (curr_slot > 0)
+                --curr_slot;
+            else if (prev_leaf())
+                curr_slot = curr_leaf->slotuse - 1;
+            return *this;
+        }
+
+        //! Postfix-- backstep the iterator to the last slot.
+        const_iterator operator--(int)
+        {
+            const_iterator tmp = *this; // copy ourselves
+            --*this;
+            return tmp;
+        }
+
+        //! Equality of iterators.
+        bool operator == (const const_iterator& x) const
+        {
+            return (x.curr_leaf == curr_leaf) && (x.curr_slot == curr_slot);
+        }
+
+        //! Inequality of iterators.
+        bool operator != (const const_iterator& x) const
+        {
+            return (x.curr_leaf != curr_leaf) || (x.curr_slot != curr_slot);
+        }
+    };
+
+    //! create read-only reverse iterator from STL magic
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+    //! \}
+
+private:
+    //! \name Tree Object Data Members
+    //! \{
+
+    //! Pointer to the B+ tree's root node, either leaf or inner node.
+    node* root_;
+
+    //! Number of items in the B+ tree.
+    size_type size_;
+
+    //! Key comparison object. More comparison functions are generated from
+    //! this < relation.
+    key_compare key_less_;
+
+    //! Memory allocator.
+    allocator_type allocator_;
+
+    //! \}
+
+public:
+    //! \name Constructors and Destructor
+    //! \{
+
+    //! Default constructor initializing an empty B+ tree with the standard key
+    //! comparison function.
+    explicit btree_snapshot_map(const allocator_type& alloc = allocator_type())
+        : root_(nullptr), size_(0), allocator_(alloc)
+    {
+    }
+
+    //! Constructor initializing an empty B+ tree with a special key comparison
+    //! object.
+    explicit btree_snapshot_map(
+        const key_compare& kcf,
+        const allocator_type& alloc = allocator_type())
+        : root_(nullptr), size_(0), key_less_(kcf), allocator_(alloc)
+    {
+    }
+
+    //! Copy constructor in O(1): shares all nodes of the other map.
+    btree_snapshot_map(const btree_snapshot_map& other)
+        : root_(other.root_), size_(other.size_),
+          key_less_(other.key_less_), allocator_(other.allocator_)
+    {
+        if (root_)
+            root_->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    //! Move constructor.
+    btree_snapshot_map(btree_snapshot_map&& other)
+        : root_(other.root_), size_(other.size_),
+          key_less_(other.key_less_), allocator_(other.allocator_)
+    {
+        other.root_ = nullptr;
+        other.size_ = 0;
+    }
+
+    //! Assignment operator in O(1): shares all nodes of the other map.
+    btree_snapshot_map& operator = (const btree_snapshot_map& other)
+    {
+        if (this != &other)
+        {
+            if (other.root_)
+                other.root_->refs.fetch_add(1, std::memory_order_relaxed);
+            clear();
+            root_ = other.root_;
+            size_ = other.size_;
+            key_less_ = other.key_less_;
+            allocator_ = other.allocator_;
+        }
+        return *this;
+    }
+
+    //! Move assignment operator.
+    btree_snapshot_map& operator = (btree_snapshot_map&& other)
+    {
+        if (this != &other)
+        {
+            clear();
+            std::swap(root_, other.root_);
+            std::swap(size_, other.size_);
+            key_less_ = other.key_less_;
+            allocator_ = other.allocator_;
+        }
+        return *this;
+    }
+
+    //! Releases this map's reference to the nodes, and frees those which are
+    //! not shared.
+    ~btree_snapshot_map()
+    {
+        clear();
+    }
+
+    //! Return a read-only point-in-time copy of the map in O(1). The same as
+    //! the copy constructor.
+    btree_snapshot_map snapshot() const
+    {
+        return btree_snapshot_map(*this);
+    }
+
+    //! Frees all key/data pairs which are not shared with other maps.
+    void clear()
+    {
+        if (root_)
+            release(root_);
+        root_ = nullptr;
+        size_ = 0;
+    }
+
+    //! \}
+
+public:
+    //! \name Key and Value Comparison Function Objects
+    //! \{
+
+    //! Constant access to the key comparison object sorting the B+ tree.
+    key_compare key_comp() const
+    {
+        return key_less_;
+    }
+
+    //! Return the base node allocator provided during construction.
+    allocator_type get_allocator() const
+    {
+        return allocator_;
+    }
+
+    //! \}
+
+private:
+    //! \name Convenient Key Comparison Functions Generated From key_less
+    //! \{
+
+    //! True if a < b ? "constructed" from key_less_()
+    bool key_less(const key_type& a, const key_type& b) const
+    {
+        return key_less_(a, b);
+    }
+
+    //! True if a == b ? constructed from key_less(). This requires the <
+    //! relation to be a total order, otherwise the B+ tree cannot be sorted.
+    bool key_equal(const key_type& a, const key_type& b) const
+    {
+        return !key_less_(a, b) && !key_less_(b, a);
+    }
+
+    //! \}
+
+private:
+    //! \name Node Object Allocation, Sharing and Deallocation
+    //! \{
+
+    //! Allocate and initialize a leaf node
+    LeafNode* allocate_leaf()
+    {
+        typename LeafNode::alloc_type a(allocator_);
+        LeafNode* n = new (a.allocate(1)) LeafNode();
+        n->initialize();
+        return n;
+    }
+
+    //! Allocate and initialize an inner node
+    InnerNode* allocate_inner(unsigned short level)
+    {
+        typename InnerNode::alloc_type a(allocator_);
+        InnerNode* n = new (a.allocate(1)) InnerNode();
+        n->initialize(level);
+        return n;
+    }
+
+    //! Free either inner or leaf node, without releasing its children.
+    void free_node(node* n)
+    {
+        if (n->is_leafnode())
+        {
+            LeafNode* ln = static_cast<LeafNode*>(n);
+            typename LeafNode::alloc_type a(allocator_);
+            std::allocator_traits<typename LeafNode::alloc_type>::destroy(a,
+                                                                          ln);
+            std::allocator_traits<typename LeafNode::alloc_type>::deallocate(
+                a, ln, 1);
+        }
+        else
+        {
+            InnerNode* in = static_cast<InnerNode*>(n);
+            typename InnerNode::alloc_type a(allocator_);
+            std::allocator_traits<typename InnerNode::alloc_type>::destroy(a,
+                                                                           in);
+            std::allocator_traits<typename InnerNode::alloc_type>::deallocate(
+                a, in, 1);
+        }
+    }
+
+    //! Drop one reference to n. If it was the last, release the children and
+    //! free the node.
+    void release(node* n)
+    {
+        if (n->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+
+        if (!n->is_leafnode())
+        {
+            InnerNode* inner = static_cast<InnerNode*>(n);
+            for (unsigned short slot = 0; slot <= inner->slotuse; ++slot)
+                release(inner->childid[slot]);
+        }
+        free_node(n);
+    }
+
+    //! Return n if it is referenced only once, otherwise a private copy of n
+    //! which replaces the caller's reference to n. The children of a copied
+    //! inner node become shared.
+    node* writable(node* n)
+    {
+        if (n->refs.load(std::memory_order_acquire) == 1)
+            return n;
+
+        node* copy;
+        if (n->is_leafnode())
+        {
+            const LeafNode* leaf = static_cast<const LeafNode*>(n);
+            LeafNode* newleaf = allocate_leaf();
+            std::copy(leaf->slotdata, leaf->slotdata + leaf->slotuse,
+                      newleaf->slotdata);
+            newleaf->slotuse = leaf->slotuse;
+            copy = newleaf;
+        }
+        else
+        {
+            const InnerNode* inner = static_cast<const InnerNode*>(n);
+            InnerNode* newinner = allocate_inner(inner->level);
+            std::copy(inner->slotkey, inner->slotkey + inner->slotuse,
+                      newinner->slotkey);
+            std::copy(inner->childid, inner->childid + inner->slotuse + 1,
+                      newinner->childid);
+            for (unsigned short slot = 0; slot <= inner->slotuse; ++slot)
+                inner->childid[slot]->refs.fetch_add(
+                    1, std::memory_order_relaxed);
+            newinner->slotuse = inner->slotuse;
+            copy = newinner;
+        }
+
+        release(n);
+        return copy;
+    }
+
+    //! Make the child in slot of the private inner node writable.
+    node* writable_child(InnerNode* inner, unsigned short slot)
+    {
+        return (inner->childid[slot] = writable(inner->childid[slot]));
+    }
+
+    //! \}
+
+private:
+    //! \name B+ Tree Node Binary Search Functions
+    //! \{
+
+    //! Searches for the first key in the node n greater or equal to key. Uses
+    //! binary search for nodes larger than traits::binsearch_threshold.
+    template <typename node_type>
+    unsigned short find_lower(const node_type* n, const key_type& key) const
+    {
+        unsigned short lo = 0;
+        if (sizeof(*n) > traits::binsearch_threshold)
+        {
+            unsigned short hi = n->slotuse;
+            while (lo < hi)
+            {
+                unsigned short mid = (lo + hi) >> 1;
+                if (key_less(n->key(mid), key))
+                    lo = mid + 1; // key > mid
+                else
+                    hi = mid; // key <= mid
+            }
+            return lo;
+        }
+
+        // for nodes <= binsearch_threshold do linear search.
+        while (lo < n->slotuse && key_less(n->key(lo), key))
+            ++lo;
+        return lo;
+    }
+
+    //! Searches for the first key in the node n greater than key.
+    template <typename node_type>
+    unsigned short find_upper(const node_type* n, const key_type& key) const
+    {
+        unsigned short lo = 0;
+        if (sizeof(*n) > traits::binsearch_threshold)
+        {
+            unsigned short hi = n->slotuse;
+            while (lo < hi)
+            {
+                unsigned short mid = (lo + hi) >> 1;
+                if (key_less(key, n->key(mid)))
+                    hi = mid; // key < mid
+                else
+                    lo = mid + 1; // key >= mid
+            }
+            return lo;
+        }
+
+        // for nodes <= binsearch_threshold do linear search.
+        while (lo < n->slotuse && !key_less(key, n->key(lo)))
+            ++lo;
+        return lo;
+    }
+
+    //! \}
+
+public:
+    //! \name Access Functions to the Item Count
+    //! \{
+
+    //! Return the number of key/data pairs in the B+ tree
+    size_type size() const
+    {
+        return size_;
+    }
+
+    //! Returns true if there is at least one key/data pair in the B+ tree
+    bool empty() const
+    {
+        return (size() == size_type(0));
+    }
+
+    //! \}
+
+public:
+    //! \name STL Iterator Construction Functions
+    //! \{
+
+    //! Constructs a read-only constant iterator that points to the first slot
+    //! in the first leaf of the B+ tree.
+    const_iterator begin() const
+    {
+        const_iterator it;
+        if (root_)
+            it.descend_first(root_);
+        return it;
+    }
+
+    //! Constructs a read-only constant iterator that points to the first
+    //! invalid slot in the last leaf of the B+ tree.
+    const_iterator end() const
+    {
+        const_iterator it;
+        if (root_)
+            it.descend_last(root_);
+        return it;
+    }
+
+    //! Constructs a read-only reverse iterator that points to the first
+    //! invalid slot in the last leaf of the B+ tree. Uses STL magic.
+    const_reverse_iterator rbegin() const
+    {
+        return const_reverse_iterator(end());
+    }
+
+    //! Constructs a read-only reverse iterator that points to the first slot
+    //! in the first leaf of the B+ tree. Uses STL magic.
+    const_reverse_iterator rend() const
+    {
+        return const_reverse_iterator(begin());
+    }
+
+    //! \}
+
+public:
+    //! \name STL Access Functions Querying the Tree by Descending to a Leaf
+    //! \{
+
+    //! Non-STL function checking whether a key is in the B+ tree. The same as
+    //! (find(k) != end()) or (count() != 0).
+    bool exists(const key_type& key) const
+    {
+        const node* n = root_;
+        if (!n)
+            return false;
+
+        while (!n->is_leafnode())
+        {
+            const InnerNode* inner = static_cast<const InnerNode*>(n);
+            n = inner->childid[find_lower(inner, key)];
+        }
+
+        const LeafNode* leaf = static_cast<const LeafNode*>(n);
+        unsigned short slot = find_lower(leaf, key);
+        return (slot < leaf->slotuse && key_equal(key, leaf->key(slot)));
+    }
+
+    //! Tries to locate a key in the B+ tree and returns an constant iterator to
+    //! the key/data slot if found. If unsuccessful it returns end().
+    const_iterator find(const key_type& key) const
+    {
+        const_iterator it = lower_bound(key);
+        if (it != end() && key_equal(key, it.key()))
+            return it;
+        return end();
+    }
+
+    //! Tries to locate a key in the B+ tree and returns the number of
+    //! identical key entries found, 0 or 1.
+    size_type count(const key_type& key) const
+    {
+        return exists(key) ? 1 : 0;
+    }
+
+    //! Searches the B+ tree and returns a constant iterator to the first pair
+    //! equal to or greater than key, or end() if all keys are smaller.
+    const_iterator lower_bound(const key_type& key) const
+    {
+        return search(key, false);
+    }
+
+    //! Searches the B+ tree and returns a constant iterator to the first pair
+    //! greater than key, or end() if all keys are smaller or equal.
+    const_iterator upper_bound(const key_type& key) const
+    {
+        return search(key, true);
+    }
+
+private:
+    //! Descend to the leaf and slot of lower_bound() or upper_bound(). As the
+    //! separator keys are upper bounds of their subtrees, the slot may be past
+    //! the leaf's last item, which is then advanced to the next leaf.
+    const_iterator search(const key_type& key, bool upper) const
+    {
+        const_iterator it;
+        const node* n = root_;
+        if (!n)
+            return it;
+
+        while (!n->is_leafnode())
+        {
+            const InnerNode* inner = static_cast<const InnerNode*>(n);
+            unsigned short slot =
+                upper ? find_upper(inner, key) : find_lower(inner, key);
+            it.push(inner, slot);
+            n = inner->childid[slot];
+        }
+
+        it.curr_leaf = static_cast<const LeafNode*>(n);
+        it.curr_slot =
+            upper ? find_upper(it.curr_leaf, key) : find_lower(it.curr_leaf, key);
+
+        if (it.curr_slot == it.curr_leaf->slotuse)
+        {
+            const_iterator next = it;
+            if (next.next_leaf())
+                return next;
+        }
+        return it;
+    }
+
+    //! \}
+
+public:
+    //! \name Public Insertion Functions
+    //! \{
+
+    //! Attempt to insert a key/data pair into the B+ tree. Fails if the key is
+    //! already present, without copying any node. Returns true if the pair was
+    //! inserted.
+    bool insert(const value_type& value)
+    {
+        if (exists(value.first))
+            return false;
+        return insert_start(value, false);
+    }
+
+    //! Attempt to insert a key/data pair into the B+ tree. Returns true if the
+    //! pair was inserted.
+    bool insert(const key_type& key, const data_type& data)
+    {
+        return insert(value_type(key, data));
+    }
+
+    //! Insert a key/data pair, or replace the data of an existing key.
+    //! Returns true if the key was inserted, false if it was assigned.
+    bool insert_or_assign(const key_type& key, const data_type& data)
+    {
+        return insert_start(value_type(key, data), true);
+    }
+
+private:
+    //! Start the insertion descent at the current root node and handle root
+    //! splits. Returns true if the item was inserted
+    bool insert_start(const value_type& value, bool assign)
+    {
+        if (!root_)
+            root_ = allocate_leaf();
+        else
+            root_ = writable(root_);
+
+        key_type newkey = key_type();
+        node* newchild = nullptr;
+
+        bool inserted = insert_descend(root_, value, assign, &newkey,
+                                       &newchild);
+
+        // the root was split: put a new root above it.
+        if (newchild)
+        {
+            tlx_die_unless(root_->level < max_height);
+
+            InnerNode* newroot = allocate_inner(root_->level + 1);
+            newroot->slotkey[0] = newkey;
+            newroot->childid[0] = root_;
+            newroot->childid[1] = newchild;
+            newroot->slotuse = 1;
+            root_ = newroot;
+        }
+
+        if (inserted)
+            ++size_;
+        return inserted;
+    }
+
+    //! Insert an item into the subtree of the private node n, copying shared
+    //! nodes on the way. If n is split, the new right sibling and the largest
+    //! key remaining in n are returned in *splitnode and *splitkey.
+    bool insert_descend(node* n, const value_type& value, bool assign,
+                        key_type* splitkey, node** splitnode)
+    {
+        const key_type& key = value.first;
+
+        if (n->is_leafnode())
+        {
+            LeafNode* leaf = static_cast<LeafNode*>(n);
+            unsigned short slot = find_lower(leaf, key);
+
+            if (slot < leaf->slotuse && key_equal(key, leaf->key(slot)))
+            {
+                if (assign)
+                    leaf->slotdata[slot].second = value.second;
+                return false;
+            }
+
+            if (leaf->is_full())
+            {
+                LeafNode* newleaf = split_leaf(leaf, splitkey);
+                *splitnode = newleaf;
+
+                // keys right of the last one kept go into the new leaf.
+                if (slot >= leaf->slotuse)
+                {
+                    slot -= leaf->slotuse;
+                    leaf = newleaf;
+                }
+            }
+
+            std::copy_backward(leaf->slotdata + slot,
+                               leaf->slotdata + leaf->slotuse,
+                               leaf->slotdata + leaf->slotuse + 1);
+            leaf->slotdata[slot] = value;
+            leaf->slotuse++;
+            return true;
+        }
+
+        InnerNode* inner = static_cast<InnerNode*>(n);
+        unsigned short slot = find_lower(inner, key);
+
+        key_type newkey = key_type();
+        node* newchild = nullptr;
+
+        bool inserted = insert_descend(writable_child(inner, slot), value,
+                                       assign, &newkey, &newchild);
+
+        if (newchild)
+        {
+            if (inner->is_full())
+            {
+                *splitnode =
+                    split_inner(inner, slot, newkey, newchild, splitkey);
+                return inserted;
+            }
+
+            std::copy_backward(inner->slotkey + slot,
+                               inner->slotkey + inner->slotuse,
+                               inner->slotkey + inner->slotuse + 1);
+            std::copy_backward(inner->childid + slot + 1,
+                               inner->childid + inner->slotuse + 1,
+                               inner->childid + inner->slotuse + 2);
+            inner->slotkey[slot] = newkey;
+            inner->childid[slot + 1] = newchild;
+            inner->slotuse++;
+        }
+
+        return inserted;
+    }
+
+    //! Move the upper half of the leaf's items into a new leaf. Returns the
+    //! new leaf and the largest key remaining in leaf.
+    LeafNode* split_leaf(LeafNode* leaf, key_type* newkey)
+    {
+        unsigned short mid = leaf->slotuse >> 1;
+
+        LeafNode* newleaf = allocate_leaf();
+        newleaf->slotuse = leaf->slotuse - mid;
+        std::copy(leaf->slotdata + mid, leaf->slotdata + leaf->slotuse,
+                  newleaf->slotdata);
+
+        leaf->slotuse = mid;
+        *newkey = leaf->key(mid - 1);
+        return newleaf;
+    }
+
+    //! Insert newkey and newchild at slot into the full inner node by
+    //! distributing its children and the new one evenly over inner and a new
+    //! right sibling. Returns the sibling and the key separating both.
+    InnerNode* split_inner(InnerNode* inner, unsigned short slot,
+                           const key_type& newkey, node* newchild,
+                           key_type* splitkey)
+    {
+        key_type keys[inner_slotmax + 1];
+        node* childs[inner_slotmax + 2];
+
+        std::copy(inner->slotkey, inner->slotkey + slot, keys);
+        keys[slot] = newkey;
+        std::copy(inner->slotkey + slot, inner->slotkey + inner_slotmax,
+                  keys + slot + 1);
+
+        std::copy(inner->childid, inner->childid + slot + 1, childs);
+        childs[slot + 1] = newchild;
+        std::copy(inner->childid + slot + 1,
+                  inner->childid + inner_slotmax + 1, childs + slot + 2);
+
+        unsigned short mid = inner_slotmax / 2;
+
+        InnerNode* newinner = allocate_inner(inner->level);
+        newinner->slotuse = inner_slotmax - mid;
+        std::copy(keys + mid + 1, keys + inner_slotmax + 1, newinner->slotkey);
+        std::copy(childs + mid + 1, childs + inner_slotmax + 2,
+                  newinner->childid);
+
+        inner->slotuse = mid;
+        std::copy(keys, keys + mid, inner->slotkey);
+        std::copy(childs, childs + mid + 1, inner->childid);
+
+        *splitkey = keys[mid];
+        return newinner;
+    }
+
+    //! \}
+
+public:
+    //! \name Public Erase Functions
+    //! \{
+
+    //! Erases the key/data pair referenced by key. Does not copy any node if
+    //! the key is not present. Returns the number of pairs erased, 0 or 1.
+    size_type erase(const key_type& key)
+    {
+        if (!exists(key))
+            return 0;
+
+        root_ = writable(root_);
+        erase_descend(root_, key);
+
+        // shrink the tree if the root is empty or has a single child.
+        if (root_->slotuse == 0)
+        {
+            node* oldroot = root_;
+            root_ = root_->is_leafnode()
+                        ? nullptr
+                        : static_cast<InnerNode*>(root_)->childid[0];
+            free_node(oldroot);
+        }
+
+        --size_;
+        return 1;
+    }
+
+private:
+    //! Erase the existing key from the subtree of the private node n, copying
+    //! shared nodes on the way. Underflowing children are merged with or
+    //! refilled from a sibling.
+    void erase_descend(node* n, const key_type& key)
+    {
+        if (n->is_leafnode())
+        {
+            LeafNode* leaf = static_cast<LeafNode*>(n);
+            unsigned short slot = find_lower(leaf, key);
+
+            std::copy(leaf->slotdata + slot + 1,
+                      leaf->slotdata + leaf->slotuse, leaf->slotdata + slot);
+            leaf->slotuse--;
+            return;
+        }
+
+        InnerNode* inner = static_cast<InnerNode*>(n);
+        unsigned short slot = find_lower(inner, key);
+
+        node* child = writable_child(inner, slot);
+        erase_descend(child, key);
+
+        bool underflow =
+            child->is_leafnode()
+                ? static_cast<LeafNode*>(child)->is_underflow()
+                : static_cast<InnerNode*>(child)->is_underflow();
+
+        if (underflow)
+            rebalance(inner, slot > 0 ? slot - 1 : slot);
+    }
+
+    //! Merge the children in slot and slot + 1 of inner if their items fit
+    //! into one node, otherwise distribute the items evenly between them.
+    void rebalance(InnerNode* inner, unsigned short slot)
+    {
+        node* left = writable_child(inner, slot);
+        node* right = writable_child(inner, slot + 1);
+
+        if (left->is_leafnode())
+        {
+            LeafNode* l = static_cast<LeafNode*>(left);
+            LeafNode* r = static_cast<LeafNode*>(right);
+
+            if (l->slotuse + r->slotuse <= leaf_slotmax)
+            {
+                std::copy(r->slotdata, r->slotdata + r->slotuse,
+                          l->slotdata + l->slotuse);
+                l->slotuse += r->slotuse;
+                remove_child(inner, slot);
+                free_node(r);
+                return;
+            }
+
+            unsigned short num = (l->slotuse + r->slotuse) / 2;
+            if (l->slotuse < num)
+            {
+                unsigned short d = num - l->slotuse;
+                std::copy(r->slotdata, r->slotdata + d,
+                          l->slotdata + l->slotuse);
+                std::copy(r->slotdata + d, r->slotdata + r->slotuse,
+                          r->slotdata);
+                l->slotuse += d;
+                r->slotuse -= d;
+            }
+            else
+            {
+                unsigned short d = l->slotuse - num;
+                std::copy_backward(r->slotdata, r->slotdata + r->slotuse,
+                                   r->slotdata + r->slotuse + d);
+                std::copy(l->slotdata + num, l->slotdata + l->slotuse,
+                          r->slotdata);
+                l->slotuse -= d;
+                r->slotuse += d;
+            }
+            inner->slotkey[slot] = l->key(l->slotuse - 1);
+            return;
+        }
+
+        InnerNode* l = static_cast<InnerNode*>(left);
+        InnerNode* r = static_cast<InnerNode*>(right);
+
+        if (l->slotuse + r->slotuse + 1 <= inner_slotmax)
+        {
+            l->slotkey[l->slotuse] = inner->slotkey[slot];
+            std::copy(r->slotkey, r->slotkey + r->slotuse,
+                      l->slotkey + l->slotuse + 1);
+            std::copy(r->childid, r->childid + r->slotuse + 1,
+                      l->childid + l->slotuse + 1);
+            l->slotuse += r->slotuse + 1;
+            remove_child(inner, slot);
+            free_node(r);
+            return;
+        }
+
+        // rotate children through the separator key in the parent.
+        unsigned short num = (l->slotuse + r->slotuse) / 2;
+        if (l->slotuse < num)
+        {
+            unsigned short d = num - l->slotuse;
+            l->slotkey[l->slotuse] = inner->slotkey[slot];
+            std::copy(r->slotkey, r->slotkey + d - 1,
+                      l->slotkey + l->slotuse + 1);
+            std::copy(r->childid, r->childid + d, l->childid + l->slotuse + 1);
+            inner->slotkey[slot] = r->slotkey[d - 1];
+            std::copy(r->slotkey + d, r->slotkey + r->slotuse, r->slotkey);
+            std::copy(r->childid + d, r->childid + r->slotuse + 1, r->childid);
+            l->slotuse += d;
+            r->slotuse -= d;
+        }
+        else
+        {
+            unsigned short d = l->slotuse - num;
+            std::copy_backward(r->slotkey, r->slotkey + r->slotuse,
+                               r->slotkey + r->slotuse + d);
+            std::copy_backward(r->childid, r->childid + r->slotuse + 1,
+                               r->childid + r->slotuse + 1 + d);
+            r->slotkey[d - 1] = inner->slotkey[slot];
+            std::copy(l->slotkey + num + 1, l->slotkey + l->slotuse,
+                      r->slotkey);
+            std::copy(l->childid + num + 1, l->childid + l->slotuse + 1,
+                      r->childid);
+            inner->slotkey[slot] = l->slotkey[num];
+            l->slotuse -= d;
+            r->slotuse += d;
+        }
+    }
+
+    //! Remove the key in slot and the child right of it from inner.
+    static void remove_child(InnerNode* inner, unsigned short slot)
+    {
+        std::copy(inner->slotkey + slot + 1, inner->slotkey + inner->slotuse,
+                  inner->slotkey + slot);
+        std::copy(inner->childid + slot + 2,
+                  inner->childid + inner->slotuse + 1,
+                  inner->childid + slot + 1);
+        inner->slotuse--;
+    }
+
+    //! \}
+
+public:
+    //! \name Verification of B+ Tree Invariants
+    //! \{
+
+    //! Run a thorough verification of all B+ tree invariants. The program
+    //! aborts via tlx_die_unless() if something is wrong. Separator keys are
+    //! upper bounds of their subtrees, not necessarily their maximum.
+    void verify() const
+    {
+        size_type size = 0;
+        if (root_)
+            verify_node(root_, nullptr, nullptr, &size);
+        tlx_die_unless(size == size_);
+    }
+
+private:
+    //! Recursively descend down the tree and verify each node. All keys in n
+    //! must be greater than *lower and at most *upper, if given.
+    void verify_node(const node* n, const key_type* lower,
+                     const key_type* upper, size_type* size) const
+    {
+        tlx_die_unless(n->refs.load(std::memory_order_relaxed) >= 1);
+
+        if (n->is_leafnode())
+        {
+            const LeafNode* leaf = static_cast<const LeafNode*>(n);
+            tlx_die_unless(leaf == root_ || !leaf->is_underflow());
+            tlx_die_unless(leaf->slotuse > 0);
+
+            for (unsigned short slot = 0; slot < leaf->slotuse; ++slot)
+            {
+                const key_type& key = leaf->key(slot);
+                if (slot > 0)
+                    tlx_die_unless(key_less(leaf->key(slot - 1), key));
+                tlx_die_unless(!lower || key_less(*lower, key));
+                tlx_die_unless(!upper || !key_less(*upper, key));
+            }
+
+            *size += leaf->slotuse;
+            return;
+        }
+
+        const InnerNode* inner = static_cast<const InnerNode*>(n);
+        tlx_die_unless(inner == root_ || !inner->is_underflow());
+        tlx_die_unless(inner->slotuse > 0);
+
+        for (unsigned short slot = 0; slot <= inner->slotuse; ++slot)
+        {
+            const key_type* sublower =
+                slot == 0 ? lower : &inner->slotkey[slot - 1];
+            const key_type* subupper =
+                slot == inner->slotuse ? upper : &inner->slotkey[slot];
+
+            if (slot > 0 && slot < inner->slotuse)
+                tlx_die_unless(key_less(*sublower, *subupper));
+
+            tlx_die_unless(inner->childid[slot]->level + 1 == inner->level);
+            verify_node(inner->childid[slot], sublower, subupper, size);
+        }
+    }
+
+    //! \}
+};
+
+//! \}
+
+} // namespace tlx
+
+#endif // !TLX_CONTAINER_BTREE_SNAPSHOT_MAP_HEADER
+
+/******************************************************************************/
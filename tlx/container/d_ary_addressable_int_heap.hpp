@@ -12,8 +12,10 @@
 #ifndef TLX_CONTAINER_D_ARY_ADDRESSABLE_INT_HEAP_HEADER
 #define TLX_CONTAINER_D_ARY_ADDRESSABLE_INT_HEAP_HEADER
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <limits>
 #include <queue>
@@ -24,20 +26,252 @@ namespace tlx {
 //! \addtogroup tlx_container
 //! \{
 
+/*!
+ * Handle store of a DAryAddressableIntHeap which holds an array indexed by the
+ * keys, hence it requires a multiple of the highest integer key as space!
+ */
+template <typename KeyType>
+class DAryHeapVectorHandles
+{
+public:
+    using key_type = KeyType;
+
+    //! Marks a key that is not in the heap.
+    static constexpr key_type not_present()
+    {
+        return static_cast<key_type>(-1);
+    }
+
+    //! Allocates space for the keys [0,new_size).
+    void reserve(size_t new_size)
+    {
+        if (handles_.size() < new_size)
+            handles_.resize(new_size, not_present());
+    }
+
+    //! Marks all keys as not present.
+    void clear()
+    {
+        std::fill(handles_.begin(), handles_.end(), not_present());
+    }
+
+    //! Returns the position of \c key, or not_present().
+    key_type find(key_type key) const
+    {
+        return key < handles_.size() ? handles_[key] : not_present();
+    }
+
+    //! Sets the position of \c key.
+    void set(key_type key, size_t pos)
+    {
+        if (key >= handles_.size())
+            handles_.resize(static_cast<size_t>(key) + 1, not_present());
+        handles_[key] = static_cast<key_type>(pos);
+    }
+
+    //! Marks \c key as not present.
+    void erase(key_type key)
+    {
+        handles_[key] = not_present();
+    }
+
+    //! Returns the number of keys present. Scans all keys, for debugging.
+    size_t size() const
+    {
+        return static_cast<size_t>(
+            handles_.size() -
+            std::count(handles_.begin(), handles_.end(), not_present()));
+    }
+
+private:
+    //! Positions of the keys in the heap vector.
+    std::vector<key_type> handles_;
+};
+
+/*!
+ * Handle store of a DAryAddressableIntHeap which holds an open addressing hash
+ * table with linear probing from the keys to their positions, hence it
+ * requires space proportional to the number of keys in the heap, and allows
+ * sparse keys such as 64-bit object ids. The table is at most half full and
+ * doubled beyond that. It is halved when less than an eighth full, such that
+ * both resizes leave it a quarter full, far from the other threshold. Entries
+ * are erased by shifting back the following ones of the probe sequence,
+ * without tombstones.
+ */
+template <typename KeyType>
+class DAryHeapHashHandles
+{
+public:
+    using key_type = KeyType;
+
+    //! Marks a key that is not in the heap, and an empty cell.
+    static constexpr key_type not_present()
+    {
+        return static_cast<key_type>(-1);
+    }
+
+    //! Allocates space for \c new_size keys.
+    void reserve(size_t new_size)
+    {
+        if (2 * new_size > cells_.size())
+            rehash(capacity_for(new_size));
+    }
+
+    //! Removes all keys and releases the table.
+    void clear()
+    {
+        std::vector<Cell>().swap(cells_);
+        size_ = 0;
+    }
+
+    //! Returns the position of \c key, or not_present().
+    key_type find(key_type key) const
+    {
+        if (cells_.empty())
+            return not_present();
+        const Cell& c = cells_[probe(key)];
+        return c.key == key ? c.pos : not_present();
+    }
+
+    //! Sets the position of \c key, inserting it if not present.
+    void set(key_type key, size_t pos)
+    {
+        if (cells_.empty())
+            rehash(min_capacity);
+        size_t i = probe(key);
+        if (cells_[i].key != key)
+        {
+            if (2 * (size_ + 1) > cells_.size())
+            {
+                rehash(2 * cells_.size());
+                i = probe(key);
+            }
+            cells_[i].key = key;
+            ++size_;
+        }
+        cells_[i].pos = static_cast<key_type>(pos);
+    }
+
+    //! Removes \c key, which must be present.
+    void erase(key_type key)
+    {
+        size_t i = probe(key);
+        assert(cells_[i].key == key);
+
+        // Shift back following cells of the probe sequence which may not
+        // stay behind the hole, i.e. whose home slot is not in (i,j].
+        for (size_t j = next(i); cells_[j].key != not_present(); j = next(j))
+        {
+            size_t h = slot(cells_[j].key);
+            bool stays = (i < j) ? (i < h && h <= j) : (i < h || h <= j);
+            if (!stays)
+            {
+                cells_[i] = cells_[j];
+                i = j;
+            }
+        }
+        cells_[i].key = not_present();
+        --size_;
+
+        // halving at a quarter would leave the table half full, one insert
+        // away from doubling again.
+        if (cells_.size() > min_capacity && 8 * size_ < cells_.size())
+            rehash(cells_.size() / 2);
+    }
+
+    //! Returns the number of keys present.
+    size_t size() const
+    {
+        return size_;
+    }
+
+private:
+    //! A key and its position in the heap vector.
+    struct Cell
+    {
+        key_type key;
+        key_type pos;
+    };
+
+    //! Smallest table size.
+    static constexpr size_t min_capacity = 16;
+
+    //! Table cells, the size is a power of two.
+    std::vector<Cell> cells_;
+
+    //! Number of keys in the table.
+    size_t size_ = 0;
+
+    //! Shift of the multiplicative hash to the table size.
+    unsigned shift_ = 64;
+
+    //! Returns the table size for new_size keys.
+    static size_t capacity_for(size_t new_size)
+    {
+        size_t capacity = min_capacity;
+        while (capacity < 2 * new_size)
+            capacity *= 2;
+        return capacity;
+    }
+
+    //! Returns the home slot of \c key by Fibonacci hashing.
+    size_t slot(key_type key) const
+    {
+        return static_cast<size_t>(
+            (static_cast<std::uint64_t>(key) * 0x9E3779B97F4A7C15ull) >>
+            shift_);
+    }
+
+    //! Returns the slot following \c i.
+    size_t next(size_t i) const
+    {
+        return (i + 1) & (cells_.size() - 1);
+    }
+
+    //! Returns the slot of \c key, or the empty slot ending its probe
+    //! sequence.
+    size_t probe(key_type key) const
+    {
+        size_t i = slot(key);
+        while (cells_[i].key != key && cells_[i].key != not_present())
+            i = next(i);
+        return i;
+    }
+
+    //! Moves all keys into a table of \c capacity cells.
+    void rehash(size_t capacity)
+    {
+        std::vector<Cell> old(capacity, Cell{not_present(), 0});
+        old.swap(cells_);
+        shift_ = 64;
+        for (size_t c = capacity; c > 1; c /= 2)
+            --shift_;
+        for (const Cell& c : old)
+        {
+            if (c.key != not_present())
+                cells_[probe(c.key)] = c;
+        }
+    }
+};
+
 /*!
  * This class implements an addressable integer priority queue, precisely a
  * d-ary heap.
  *
- * Keys must be unique unsigned integers. The addressable heap holds an array
+ * Keys must be unique unsigned integers. The positions of the keys in the heap
+ * are kept in a HandleStore: the default DAryHeapVectorHandles holds an array
  * indexed by the keys, hence it requires a multiple of the highest integer key
- * as space!
+ * as space! DAryHeapHashHandles holds a hash table instead, which requires
+ * space proportional to the number of keys in the heap.
  *
- * \tparam KeyType    Has to be an unsigned integer type.
- * \tparam Arity      A positive integer.
- * \tparam Compare    Function object.
+ * \tparam KeyType      Has to be an unsigned integer type.
+ * \tparam Arity        A positive integer.
+ * \tparam Compare      Function object.
+ * \tparam HandleStore  DAryHeapVectorHandles or DAryHeapHashHandles.
  */
 template <typename KeyType, unsigned Arity = 2,
-          class Compare = std::less<KeyType> >
+          class Compare = std::less<KeyType>,
+          class HandleStore = DAryHeapVectorHandles<KeyType> >
 class DAryAddressableIntHeap
 {
     static_assert(std::numeric_limits<KeyType>::is_integer &&
@@ -48,6 +282,7 @@ class DAryAddressableIntHeap
 public:
     using key_type = KeyType;
     using compare_type = Compare;
+    using handle_store_type = HandleStore;
 
     static constexpr size_t arity = Arity;
 
@@ -56,7 +291,7 @@ private:
     std::vector<key_type> heap_;
 
     //! Positions of the keys in the heap vector.
-    std::vector<key_type> handles_;
+    handle_store_type handles_;
 
     //! Compare function.
     compare_type cmp_;
@@ -64,24 +299,21 @@ private:
     //! Marks a key that is not in the heap.
     static constexpr key_type not_present()
     {
-        return static_cast<key_type>(-1);
+        return handle_store_type::not_present();
     }
 
 public:
     //! Allocates an empty heap.
     explicit DAryAddressableIntHeap(compare_type cmp = compare_type())
-        : heap_(0), handles_(0), cmp_(cmp)
+        : heap_(0), handles_(), cmp_(cmp)
     {
     }
 
     //! Allocates space for \c new_size items.
     void reserve(size_t new_size)
     {
-        if (handles_.size() < new_size)
-        {
-            handles_.resize(new_size, not_present());
-            heap_.reserve(new_size);
-        }
+        handles_.reserve(new_size);
+        heap_.reserve(new_size);
     }
 
     //! Copy.
@@ -95,7 +327,7 @@ public:
     //! Empties the heap.
     void clear()
     {
-        std::fill(handles_.begin(), handles_.end(), not_present());
+        handles_.clear();
         heap_.clear();
     }
 
@@ -122,13 +354,10 @@ public:
     {
         // Avoid to add the key that we use to mark non present keys.
         assert(new_key != not_present());
-        if (new_key >= handles_.size())
-            handles_.resize(new_key + 1, not_present());
-        else
-            assert(handles_[new_key] == not_present());
+        assert(!contains(new_key));
 
         // Insert the new item at the end of the heap.
-        handles_[new_key] = static_cast<key_type>(heap_.size());
+        handles_.set(new_key, heap_.size());
         heap_.push_back(new_key);
         sift_up(heap_.size() - 1);
     }
@@ -138,25 +367,44 @@ public:
     {
         // Avoid to add the key that we use to mark non present keys.
         assert(new_key != not_present());
-        if (new_key >= handles_.size())
-            handles_.resize(new_key + 1, not_present());
-        else
-            assert(handles_[new_key] == not_present());
+        assert(!contains(new_key));
 
         // Insert the new item at the end of the heap.
-        handles_[new_key] = static_cast<key_type>(heap_.size());
+        handles_.set(new_key, heap_.size());
         heap_.push_back(std::move(new_key));
         sift_up(heap_.size() - 1);
     }
 
+    /*!
+     * Inserts the keys [first,last), which must not be in the heap. If the
+     * batch is large compared to the work of sifting up each key, only the
+     * subtrees above the new keys are re-heapified bottom-up, one level at a
+     * time.
+     */
+    template <class InputIterator>
+    void push_bulk(InputIterator first, InputIterator last)
+    {
+        size_t begin = heap_.size();
+        for (; first != last; ++first)
+        {
+            key_type new_key = *first;
+            assert(new_key != not_present());
+            assert(!contains(new_key));
+
+            handles_.set(new_key, heap_.size());
+            heap_.push_back(new_key);
+        }
+        restore_appended(begin);
+    }
+
     //! Removes the item with key \c key.
     void remove(key_type key)
     {
         assert(contains(key));
-        key_type h = handles_[key];
+        key_type h = handles_.find(key);
         std::swap(heap_[h], heap_.back());
-        handles_[heap_[h]] = h;
-        handles_[heap_.back()] = not_present();
+        handles_.set(heap_[h], h);
+        handles_.erase(heap_.back());
         heap_.pop_back();
         // If we did not remove the last item in the heap vector.
         if (h < size())
@@ -189,6 +437,40 @@ public:
         return top_item;
     }
 
+    /*!
+     * Removes the \c k top items, or all if there are fewer, and writes them
+     * in sorted order to \c out. Returns the output iterator after the last
+     * written item.
+     */
+    template <class OutputIterator>
+    OutputIterator pop_k(size_t k, OutputIterator out)
+    {
+        for (; k != 0 && !empty(); --k)
+        {
+            *out = heap_[0];
+            ++out;
+            pop_extracted();
+        }
+        return out;
+    }
+
+    /*!
+     * Removes the top items while \c pred(top()) is true and writes them in
+     * sorted order to \c out, like pop_k(). Returns the output iterator after
+     * the last written item.
+     */
+    template <class Predicate, class OutputIterator>
+    OutputIterator pop_while(Predicate pred, OutputIterator out)
+    {
+        while (!empty() && pred(heap_[0]))
+        {
+            *out = heap_[0];
+            ++out;
+            pop_extracted();
+        }
+        return out;
+    }
+
     //! Rebuilds the heap.
     void update_all()
     {
@@ -205,19 +487,19 @@ public:
      */
     void update(key_type key)
     {
-        if (key >= handles_.size() || handles_[key] == not_present())
+        key_type h = handles_.find(key);
+        if (h == not_present())
             push(key);
-        else if (handles_[key] &&
-                 cmp_(heap_[handles_[key]], heap_[parent(handles_[key])]))
-            sift_up(handles_[key]);
+        else if (h && cmp_(heap_[h], heap_[parent(h)]))
+            sift_up(h);
         else
-            sift_down(handles_[key]);
+            sift_down(h);
     }
 
     //! Returns true if the key \c key is in the heap, false otherwise.
     bool contains(key_type key) const
     {
-        return key < handles_.size() ? handles_[key] != not_present() : false;
+        return handles_.find(key) != not_present();
     }
 
     //! Builds a heap from a container.
@@ -253,12 +535,12 @@ public:
         {
             return true;
         }
-        std::vector<unsigned char> mark(handles_.size());
         std::queue<size_t> q;
         // Explore from the root.
         q.push(0);
-        // mark first value as seen
-        mark.at(heap_[0]) = 1;
+        // check handle of the root
+        if (handles_.find(heap_[0]) != 0)
+            return false;
         while (!q.empty())
         {
             size_t s = q.front();
@@ -271,20 +553,13 @@ public:
                 if (cmp_(heap_[l], heap_[s]))
                     return false;
                 // check handle
-                if (handles_[heap_[l]] != l)
+                if (handles_.find(heap_[l]) != l)
                     return false;
-                // mark value as seen
-                mark.at(heap_[l]) = 1;
                 q.push(l++);
             }
         }
-        // check not_present handles
-        for (size_t i = 0; i < mark.size(); ++i)
-        {
-            if (mark[i] != (handles_[i] != not_present()))
-                return false;
-        }
-        return true;
+        // check that no other keys have handles
+        return handles_.size() == heap_.size();
     }
 
 private:
@@ -309,10 +584,10 @@ private:
         while (k > 0 && !cmp_(heap_[p], value))
         {
             heap_[k] = std::move(heap_[p]);
-            handles_[heap_[k]] = k;
+            handles_.set(heap_[k], k);
             k = p, p = parent(k);
         }
-        handles_[value] = k;
+        handles_.set(value, k);
         heap_[k] = std::move(value);
     }
 
@@ -343,17 +618,102 @@ private:
 
             // Swap current item with the child with minimum priority.
             heap_[k] = std::move(heap_[c]);
-            handles_[heap_[k]] = k;
+            handles_.set(heap_[k], k);
             k = c;
         }
-        handles_[value] = k;
+        handles_.set(value, k);
         heap_[k] = std::move(value);
     }
 
+    //! Restores the heap property after keys were appended at the positions
+    //! [begin,size()).
+    void restore_appended(size_t begin)
+    {
+        size_t end = heap_.size();
+        if (begin == 0)
+            return heapify();
+        if (end - begin <= 1)
+        {
+            if (begin != end)
+                sift_up(begin);
+            return;
+        }
+
+        // Count the ancestors of the new keys, which are contiguous on each
+        // level. Re-heapifying them costs about arity comparisons each, while
+        // sifting up may compare each new key with all its ancestors.
+        size_t nodes = 0, levels = 0;
+        for (size_t lo = parent(begin), hi = parent(end - 1);;
+             lo = parent(lo), hi = parent(hi))
+        {
+            nodes += hi - lo + 1, ++levels;
+            if (lo == 0)
+                break;
+        }
+
+        if (nodes * arity >= (end - begin) * levels)
+        {
+            for (size_t i = begin; i < end; ++i)
+                sift_up(i);
+            return;
+        }
+
+        for (size_t lo = parent(begin), hi = parent(end - 1);;
+             lo = parent(lo), hi = parent(hi))
+        {
+            for (size_t i = hi + 1; i != lo; --i)
+                sift_down(i - 1);
+            if (lo == 0)
+                break;
+        }
+    }
+
+    //! Removes the top key. In a binary heap, the hole is moved down to a
+    //! leaf along the minimum children and then filled with the last key,
+    //! which rarely rises far, saving one of two comparisons per level. Higher
+    //! arities gain little, they sift the last key down from the root like
+    //! pop().
+    void pop_extracted()
+    {
+        handles_.erase(heap_[0]);
+        key_type value = heap_.back();
+        heap_.pop_back();
+        if (heap_.empty())
+            return;
+
+        if (arity > 2)
+        {
+            heap_[0] = value;
+            sift_down(0);
+            return;
+        }
+
+        size_t k = 0;
+        while (true)
+        {
+            size_t l = left(k);
+            if (l >= heap_.size())
+                break;
+
+            // Get the min child and move it into the hole.
+            size_t c = l;
+            size_t right = std::min(heap_.size(), c + arity);
+            while (++l < right)
+            {
+                if (cmp_(heap_[l], heap_[c]))
+                    c = l;
+            }
+            heap_[k] = heap_[c];
+            handles_.set(heap_[k], k);
+            k = c;
+        }
+        heap_[k] = value;
+        sift_up(k);
+    }
+
     //! Reorganize heap_ into a heap.
     void heapify()
     {
-        key_type max_key = heap_.empty() ? 0 : heap_.front();
         if (heap_.size() >= 2)
         {
             // Iterate from the last internal node up to the root.
@@ -363,12 +723,10 @@ private:
                 // Index of the current internal node.
                 size_t cur = i - 1;
                 key_type value = std::move(heap_[cur]);
-                max_key = std::max(max_key, value);
 
                 do
                 {
                     size_t l = left(cur);
-                    max_key = std::max(max_key, heap_[l]);
                     // Find the minimum child of cur.
                     size_t min_elem = l;
                     for (size_t j = l + 1; j - l < arity && j < heap_.size();
@@ -376,7 +734,6 @@ private:
                     {
                         if (cmp_(heap_[j], heap_[min_elem]))
                             min_elem = j;
-                        max_key = std::max(max_key, heap_[j]);
                     }
 
                     // One of the children of cur is less then cur: swap and
@@ -392,12 +749,10 @@ private:
                 heap_[cur] = std::move(value);
             }
         }
-        // initialize handles_ vector
-        handles_.resize(
-            std::max(handles_.size(), static_cast<size_t>(max_key) + 1),
-            not_present());
+        // initialize handles_
+        handles_.reserve(heap_.size());
         for (size_t i = 0; i < heap_.size(); ++i)
-            handles_[heap_[i]] = i;
+            handles_.set(heap_[i], i);
     }
 };
 
@@ -407,6 +762,13 @@ template <typename KeyType, unsigned Arity = 2,
 using d_ary_addressable_int_heap =
     DAryAddressableIntHeap<KeyType, Arity, Compare>;
 
+//! make template alias of the addressable heap with a hash table of handles
+template <typename KeyType, unsigned Arity = 2,
+          typename Compare = std::less<KeyType> >
+using d_ary_addressable_hash_heap =
+    DAryAddressableIntHeap<KeyType, Arity, Compare,
+                           DAryHeapHashHandles<KeyType> >;
+
 //! \}
 
 } // namespace tlx
@@ -12,10 +12,18 @@
 #ifndef TLX_CONTAINER_D_ARY_HEAP_HEADER
 #define TLX_CONTAINER_D_ARY_HEAP_HEADER
 
+#include <tlx/allocator_base.hpp>
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <functional>
+#include <iterator>
+#include <new>
 #include <queue>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace tlx {
@@ -23,16 +31,96 @@ namespace tlx {
 //! \addtogroup tlx_container
 //! \{
 
+/*!
+ * Allocator for the cells of a cache-aligned DAryHeap. The memory is shifted
+ * such that the second item, where the children of the root start, lies on a
+ * cache line boundary. The children of item k start at item Arity * k + 1,
+ * hence if Arity * sizeof(Type) divides the cache line size, each group of
+ * siblings lies in one cache line, and sift-down loads one cache line per
+ * level. If it is a multiple, each group starts on a cache line boundary.
+ */
+template <typename Type>
+class DAryHeapAlignedAllocator : public AllocatorBase<Type>
+{
+public:
+    using value_type = Type;
+    using pointer = Type*;
+    using size_type = std::size_t;
+
+    //! C++11 type flag
+    using is_always_equal = std::true_type;
+
+    //! cache line size to align sibling groups to.
+    static constexpr size_t cache_line_size = 64;
+
+    //! required rebind.
+    template <typename Other>
+    struct rebind
+    {
+        using other = DAryHeapAlignedAllocator<Other>;
+    };
+
+    DAryHeapAlignedAllocator() noexcept = default;
+
+    //! constructor from another allocator
+    template <typename Other>
+    DAryHeapAlignedAllocator(const DAryHeapAlignedAllocator<Other>&) noexcept
+    {
+    }
+
+    //! allocate n items, storing the raw allocation in front of them.
+    pointer allocate(size_type n)
+    {
+        char* raw = static_cast<char*>(::operator new(
+            n * sizeof(Type) + cache_line_size + sizeof(char*)));
+        uintptr_t p = reinterpret_cast<uintptr_t>(raw) + sizeof(char*) +
+                      sizeof(Type) + cache_line_size - 1;
+        p = p / cache_line_size * cache_line_size - sizeof(Type);
+        char* ptr = reinterpret_cast<char*>(p);
+        std::memcpy(ptr - sizeof(char*), &raw, sizeof(char*));
+        return reinterpret_cast<pointer>(ptr);
+    }
+
+    //! release the raw allocation stored in front of p.
+    void deallocate(pointer p, size_type) noexcept
+    {
+        char* raw;
+        std::memcpy(&raw, reinterpret_cast<char*>(p) - sizeof(char*),
+                    sizeof(char*));
+        ::operator delete(raw);
+    }
+
+    template <typename Other>
+    bool operator==(const DAryHeapAlignedAllocator<Other>&) const noexcept
+    {
+        return true;
+    }
+
+    template <typename Other>
+    bool operator!=(const DAryHeapAlignedAllocator<Other>&) const noexcept
+    {
+        return false;
+    }
+};
+
 /*!
  * This class implements a d-ary comparison-based heap usable as a priority
  * queue. Higher arity yields better cache efficiency.
  *
- * \tparam KeyType    Key type.
- * \tparam Arity      A positive integer.
- * \tparam Compare    Function object to order keys.
+ * For arithmetic keys ordered by std::less or std::greater and Arity >= 4,
+ * the minimum child is selected without data-dependent branches, which are
+ * hard to predict in sift-down. With CacheAligned, the cells are allocated
+ * such that no group of siblings straddles cache lines, see
+ * DAryHeapAlignedAllocator, which pays off most if Arity * sizeof(KeyType) is
+ * 32 or 64 bytes.
+ *
+ * \tparam KeyType      Key type.
+ * \tparam Arity        A positive integer.
+ * \tparam Compare      Function object to order keys.
+ * \tparam CacheAligned Align sibling groups to cache lines.
  */
 template <typename KeyType, unsigned Arity = 2,
-          typename Compare = std::less<KeyType> >
+          typename Compare = std::less<KeyType>, bool CacheAligned = false>
 class DAryHeap
 {
     static_assert(Arity, "Arity must be greater than zero.");
@@ -40,12 +128,24 @@ class DAryHeap
 public:
     using key_type = KeyType;
     using compare_type = Compare;
+    using allocator_type =
+        typename std::conditional<CacheAligned,
+                                  DAryHeapAlignedAllocator<key_type>,
+                                  std::allocator<key_type> >::type;
 
     static constexpr size_t arity = Arity;
 
+    //! Whether the minimum child is selected with conditional moves. Binary
+    //! heaps are faster with a branch, which lets the processor speculatively
+    //! load the next level.
+    static constexpr bool branchless =
+        Arity >= 4 && std::is_arithmetic<key_type>::value &&
+        (std::is_same<compare_type, std::less<key_type> >::value ||
+         std::is_same<compare_type, std::greater<key_type> >::value);
+
 private:
     //! Cells in the heap.
-    std::vector<key_type> heap_;
+    std::vector<key_type, allocator_type> heap_;
 
     //! Compare function.
     compare_type cmp_;
@@ -110,6 +210,19 @@ public:
         sift_up(heap_.size() - 1);
     }
 
+    /*!
+     * Inserts the items [first,last). If the batch is large compared to the
+     * work of sifting up each item, only the subtrees above the new items are
+     * re-heapified bottom-up, one level at a time.
+     */
+    template <class InputIterator>
+    void push_bulk(InputIterator first, InputIterator last)
+    {
+        size_t begin = heap_.size();
+        heap_.insert(heap_.end(), first, last);
+        restore_appended(begin);
+    }
+
     //! Returns the top item.
     const key_type& top() const noexcept
     {
@@ -135,6 +248,40 @@ public:
         return top_item;
     }
 
+    /*!
+     * Removes the \c k top items, or all if there are fewer, and writes them
+     * in sorted order to \c out. Returns the output iterator after the last
+     * written item.
+     */
+    template <class OutputIterator>
+    OutputIterator pop_k(size_t k, OutputIterator out)
+    {
+        for (; k != 0 && !empty(); --k)
+        {
+            *out = std::move(heap_[0]);
+            ++out;
+            pop_extracted();
+        }
+        return out;
+    }
+
+    /*!
+     * Removes the top items while \c pred(top()) is true and writes them in
+     * sorted order to \c out, like pop_k(). Returns the output iterator after
+     * the last written item.
+     */
+    template <class Predicate, class OutputIterator>
+    OutputIterator pop_while(Predicate pred, OutputIterator out)
+    {
+        while (!empty() && pred(heap_[0]))
+        {
+            *out = std::move(heap_[0]);
+            ++out;
+            pop_extracted();
+        }
+        return out;
+    }
+
     //! Rebuilds the heap.
     void update_all()
     {
@@ -162,7 +309,8 @@ public:
     {
         if (!empty())
             heap_.clear();
-        heap_ = std::move(keys);
+        assign(std::move(keys),
+               std::is_same<allocator_type, std::allocator<key_type> >());
         heapify();
     }
 
@@ -207,6 +355,72 @@ private:
         return (k - 1) / arity;
     }
 
+    //! Takes over the buffer of \c keys. A template, such that it is only
+    //! instantiated if the vector types match.
+    template <typename KeyVector>
+    void assign(KeyVector&& keys, std::true_type)
+    {
+        heap_ = std::move(keys);
+    }
+
+    //! Moves the items of \c keys into the aligned buffer.
+    template <typename KeyVector>
+    void assign(KeyVector&& keys, std::false_type)
+    {
+        heap_.assign(std::make_move_iterator(keys.begin()),
+                     std::make_move_iterator(keys.end()));
+        keys.clear();
+    }
+
+    //! Returns the position of the minimum child of the node whose children
+    //! start at position \c l.
+    size_t min_child(size_t l) const
+    {
+        size_t right = std::min(heap_.size(), l + arity);
+        return min_child(l, right,
+                         std::integral_constant<bool, branchless>());
+    }
+
+    //! Scans the children [l,right) with the comparator.
+    size_t min_child(size_t l, size_t right, std::false_type) const
+    {
+        size_t c = l;
+        while (++l < right)
+        {
+            if (cmp_(heap_[l], heap_[c]))
+                c = l;
+        }
+        return c;
+    }
+
+    //! Scans the children [l,right) with conditional moves. A full group of
+    //! siblings has a constant length, which lets the loop be unrolled.
+    size_t min_child(size_t l, size_t right, std::true_type) const
+    {
+        const key_type* child = heap_.data() + l;
+        size_t n = right - l, c = 0;
+        key_type m = child[0];
+        if (n == arity)
+        {
+            for (size_t i = 1; i < arity; ++i)
+            {
+                bool less = cmp_(child[i], m);
+                m = less ? child[i] : m;
+                c = less ? i : c;
+            }
+        }
+        else
+        {
+            for (size_t i = 1; i < n; ++i)
+            {
+                bool less = cmp_(child[i], m);
+                m = less ? child[i] : m;
+                c = less ? i : c;
+            }
+        }
+        return l + c;
+    }
+
     //! Pushes the node at position \c k up until either it becomes the root or
     //! its parent has lower or equal priority.
     void sift_up(size_t k)
@@ -234,13 +448,7 @@ private:
                 break;
             }
             // Get the min child.
-            size_t c = l;
-            size_t right = std::min(heap_.size(), c + arity);
-            while (++l < right)
-            {
-                if (cmp_(heap_[l], heap_[c]))
-                    c = l;
-            }
+            size_t c = min_child(l);
 
             // Current item has lower or equal priority than the child with
             // minimum priority, stop.
@@ -256,6 +464,84 @@ private:
         heap_[k] = std::move(value);
     }
 
+    //! Restores the heap property after items were appended at the positions
+    //! [begin,size()).
+    void restore_appended(size_t begin)
+    {
+        size_t end = heap_.size();
+        if (begin == 0)
+            return heapify();
+        if (end - begin <= 1)
+        {
+            if (begin != end)
+                sift_up(begin);
+            return;
+        }
+
+        // Count the ancestors of the new items, which are contiguous on each
+        // level. Re-heapifying them costs about arity comparisons each, while
+        // sifting up may compare each new item with all its ancestors.
+        size_t nodes = 0, levels = 0;
+        for (size_t lo = parent(begin), hi = parent(end - 1);;
+             lo = parent(lo), hi = parent(hi))
+        {
+            nodes += hi - lo + 1, ++levels;
+            if (lo == 0)
+                break;
+        }
+
+        if (nodes * arity >= (end - begin) * levels)
+        {
+            for (size_t i = begin; i < end; ++i)
+                sift_up(i);
+            return;
+        }
+
+        for (size_t lo = parent(begin), hi = parent(end - 1);;
+             lo = parent(lo), hi = parent(hi))
+        {
+            for (size_t i = hi + 1; i != lo; --i)
+                sift_down(i - 1);
+            if (lo == 0)
+                break;
+        }
+    }
+
+    //! Removes the top item, whose value was already moved out. In a binary
+    //! heap, the hole is moved down to a leaf along the minimum children and
+    //! then filled with the last item, which rarely rises far, saving one of
+    //! two comparisons per level. Higher arities gain little, they sift the
+    //! last item down from the root like pop().
+    void pop_extracted()
+    {
+        key_type value = std::move(heap_.back());
+        heap_.pop_back();
+        if (heap_.empty())
+            return;
+
+        if (arity > 2)
+        {
+            heap_[0] = std::move(value);
+            sift_down(0);
+            return;
+        }
+
+        size_t k = 0;
+        while (true)
+        {
+            size_t l = left(k);
+            if (l >= heap_.size())
+                break;
+
+            // Get the min child and move it into the hole.
+            size_t c = min_child(l);
+            heap_[k] = std::move(heap_[c]);
+            k = c;
+        }
+        heap_[k] = std::move(value);
+        sift_up(k);
+    }
+
     //! Reorganize heap_ into a heap.
     void heapify()
     {
@@ -271,15 +557,8 @@ private:
 
                 do
                 {
-                    size_t l = left(cur);
                     // Find the minimum child of cur.
-                    size_t min_elem = l;
-                    for (size_t j = l + 1; j - l < arity && j < heap_.size();
-                         ++j)
-                    {
-                        if (cmp_(heap_[j], heap_[min_elem]))
-                            min_elem = j;
-                    }
+                    size_t min_elem = min_child(left(cur));
 
                     // One of the children of cur is less then cur: swap and
                     // do another iteration.
@@ -299,8 +578,8 @@ private:
 
 //! make template alias due to similarity with std::priority_queue
 template <typename KeyType, unsigned Arity = 2,
-          typename Compare = std::less<KeyType> >
-using d_ary_heap = DAryHeap<KeyType, Arity, Compare>;
+          typename Compare = std::less<KeyType>, bool CacheAligned = false>
+using d_ary_heap = DAryHeap<KeyType, Arity, Compare, CacheAligned>;
 
 //! \}
 
@@ -954,7 +954,326 @@ public:
 };
 
 /******************************************************************************/
-// LoserTreeSwitch selects loser tree by size of value type
+// LoserTreeInteger: branchless replay for integer keys
+
+/*!
+ * True if ValueType is an integer and Comparator is std::less or std::greater,
+ * such that comparisons are cheap and can be evaluated unconditionally.
+ */
+template <typename ValueType, typename Comparator>
+struct LoserTreeIsInteger
+    : public std::integral_constant<
+          bool, std::is_integral<ValueType>::value &&
+                    (std::is_same<Comparator, std::less<ValueType> >::value ||
+                     std::is_same<Comparator, std::greater<ValueType> >::value)>
+{ };
+
+/*!
+ * Guarded loser tree for integer keys, which replays the path to the root
+ * without data-dependent branches.
+ *
+ * The keys and the source indexes are stored in two separate arrays in level
+ * order, the sup flag is the highest bit of the source index. Each game on the
+ * path evaluates the full comparison and exchanges key and source with bit
+ * masks instead of a branch, since the outcome of comparing random keys is
+ * unpredictable. The games depend on each other's winner, hence they are not
+ * compared in parallel.
+ *
+ * \tparam Stable ties are broken by the source index
+ * \tparam ValueType integer element type
+ * \tparam Comparator comparator, which is called for all games, hence it must
+ *   be cheap and free of side effects.
+ */
+template <bool Stable, typename ValueType,
+          typename Comparator = std::less<ValueType> >
+class LoserTreeInteger
+{
+public:
+    //! size of counters and array indexes
+    using Source = std::uint32_t;
+
+    //! sentinel for invalid or finished Sources
+    static constexpr Source invalid_ = Source(-1);
+
+protected:
+    //! flag bit in sources_[] marking a virtual maximum sentinel
+    static constexpr Source sup_bit_ = Source(1) << 31;
+
+    // NOLINTBEGIN(cppcoreguidelines-non-private-member-variables-in-classes)
+
+    //! number of nodes
+    const Source ik_;
+    //! log_2(ik) next greater power of 2
+    const Source k_;
+    //! keys of the loser tree nodes
+    SimpleVector<ValueType> keys_;
+    //! source indexes of the loser tree nodes, with sup_bit_
+    SimpleVector<Source> sources_;
+    //! the comparator object
+    Comparator cmp_;
+
+    // NOLINTEND(cppcoreguidelines-non-private-member-variables-in-classes)
+
+    //! returns true if the player (key, source) beats (okey, osource): sup
+    //! players lose, then the smaller key wins, then the smaller source if
+    //! Stable. Evaluated without branches.
+    bool beats(const ValueType& key, const Source& source,
+               const ValueType& okey, const Source& osource) const
+    {
+        bool sup = (source & sup_bit_) != 0;
+        bool osup = (osource & sup_bit_) != 0;
+        bool less = cmp_(key, okey);
+        bool greater = cmp_(okey, key);
+        return (static_cast<int>(sup) < static_cast<int>(osup)) |
+               ((sup == osup) &
+                (less | (Stable & !greater & (source < osource))));
+    }
+
+public:
+    explicit LoserTreeInteger(const Source& k,
+                              const Comparator& cmp = Comparator())
+        : ik_(k), k_(round_up_to_power_of_two(ik_)), keys_(2 * k_),
+          sources_(2 * k_), cmp_(cmp)
+    {
+        assert(k_ < sup_bit_);
+        std::fill(keys_.begin(), keys_.end(), ValueType());
+        std::fill(sources_.begin(), sources_.end(), Source(invalid_));
+    }
+
+    //! return the index of the player with the smallest element.
+    Source min_source()
+    {
+        if (sources_[0] == invalid_)
+            return invalid_;
+        return sources_[0] & ~sup_bit_;
+    }
+
+    /*!
+     * Initializes the player source with the element key.
+     *
+     * \param keyp the element to insert
+     * \param source index of the player
+     * \param sup flag that determines whether the value to insert is an
+     *   explicit supremum sentinel.
+     */
+    void insert_start(const ValueType* keyp, const Source& source, bool sup)
+    {
+        Source pos = k_ + source;
+
+        assert(pos < sources_.size());
+        assert(sup == (keyp == nullptr));
+
+        keys_[pos] = keyp ? *keyp : ValueType();
+        sources_[pos] = sup ? (source | sup_bit_) : source;
+    }
+
+    /*!
+     * Computes the winner of the competition at player root.  Called
+     * recursively (starting at 0) to build the initial tree.
+     *
+     * \param root index of the game to start.
+     */
+    Source init_winner(const Source& root)
+    {
+        if (root >= k_)
+            return root;
+
+        Source left = init_winner(2 * root);
+        Source right = init_winner(2 * root + 1);
+        if (!beats(keys_[right], sources_[right], keys_[left], sources_[left]))
+        {
+            // left one is less or equal
+            keys_[root] = keys_[right];
+            sources_[root] = sources_[right];
+            return left;
+        }
+
+        // right one is less
+        keys_[root] = keys_[left];
+        sources_[root] = sources_[left];
+        return right;
+    }
+
+    void init()
+    {
+        if (TLX_UNLIKELY(k_ == 0))
+            return;
+        Source winner = init_winner(1);
+        keys_[0] = keys_[winner];
+        sources_[0] = sources_[winner];
+    }
+
+    void delete_min_insert(const ValueType* keyp, bool sup)
+    {
+        assert(sup == (keyp == nullptr));
+
+        Source source = sources_[0] & ~sup_bit_;
+        Source pos = (k_ + source) / 2;
+        ValueType key = keyp ? *keyp : ValueType();
+        if (sup)
+            source |= sup_bit_;
+
+        while (pos > 0)
+        {
+            ValueType okey = keys_[pos];
+            Source osource = sources_[pos];
+            // the winner moves on, the loser stays: exchange both by masks,
+            // which compilers cannot turn back into branches.
+            bool other = beats(okey, osource, key, source);
+            ValueType key_diff = (key ^ okey) & (ValueType(0) - other);
+            Source source_diff = (source ^ osource) & (Source(0) - other);
+            keys_[pos] = okey ^ key_diff;
+            sources_[pos] = osource ^ source_diff;
+            key ^= key_diff;
+            source ^= source_diff;
+            pos /= 2;
+        }
+
+        keys_[0] = key;
+        sources_[0] = source;
+    }
+};
+
+/*!
+ * Unguarded loser tree for integer keys, which replays the path to the root
+ * without data-dependent branches, like LoserTreeInteger.
+ *
+ * No guarding is done, therefore not a single input sequence must run empty.
+ *
+ * \tparam Stable ties are broken by the source index
+ * \tparam ValueType integer element type
+ * \tparam Comparator comparator, which is called for all games, hence it must
+ *   be cheap and free of side effects.
+ */
+template <bool Stable, typename ValueType,
+          typename Comparator = std::less<ValueType> >
+class LoserTreeIntegerUnguarded
+{
+public:
+    //! size of counters and array indexes
+    using Source = std::uint32_t;
+
+    //! sentinel for invalid or finished Sources
+    static constexpr Source invalid_ = Source(-1);
+
+protected:
+    // NOLINTBEGIN(cppcoreguidelines-non-private-member-variables-in-classes)
+
+    //! number of nodes
+    const Source ik_;
+    //! log_2(ik) next greater power of 2
+    const Source k_;
+    //! keys of the loser tree nodes
+    SimpleVector<ValueType> keys_;
+    //! source indexes of the loser tree nodes
+    SimpleVector<Source> sources_;
+    //! the comparator object
+    Comparator cmp_;
+
+    // NOLINTEND(cppcoreguidelines-non-private-member-variables-in-classes)
+
+    //! returns true if the player (key, source) beats (okey, osource): the
+    //! smaller key wins, then the smaller source if Stable. Evaluated without
+    //! branches.
+    bool beats(const ValueType& key, const Source& source,
+               const ValueType& okey, const Source& osource) const
+    {
+        bool less = cmp_(key, okey);
+        bool greater = cmp_(okey, key);
+        return less | (Stable & !greater & (source < osource));
+    }
+
+public:
+    LoserTreeIntegerUnguarded(Source k, const ValueType& sentinel,
+                              const Comparator& cmp = Comparator())
+        : ik_(k), k_(round_up_to_power_of_two(ik_)), keys_(2 * k_),
+          sources_(2 * k_), cmp_(cmp)
+    {
+        std::fill(keys_.begin(), keys_.end(), sentinel);
+        std::fill(sources_.begin(), sources_.end(), Source(invalid_));
+    }
+
+    //! return the index of the player with the smallest element.
+    Source min_source()
+    {
+        assert(sources_[0] != invalid_ &&
+               "Data underrun in unguarded merging.");
+        return sources_[0];
+    }
+
+    void insert_start(const ValueType* keyp, const Source& source, bool sup)
+    {
+        Source pos = k_ + source;
+
+        assert(pos < sources_.size());
+        assert(sup == (keyp == nullptr));
+        unused(sup);
+
+        keys_[pos] = *keyp;
+        sources_[pos] = source;
+    }
+
+    Source init_winner(const Source& root)
+    {
+        if (root >= k_)
+            return root;
+
+        Source left = init_winner(2 * root);
+        Source right = init_winner(2 * root + 1);
+        if (!beats(keys_[right], sources_[right], keys_[left], sources_[left]))
+        {
+            // left one is less or equal
+            keys_[root] = keys_[right];
+            sources_[root] = sources_[right];
+            return left;
+        }
+
+        // right one is less
+        keys_[root] = keys_[left];
+        sources_[root] = sources_[left];
+        return right;
+    }
+
+    void init()
+    {
+        if (TLX_UNLIKELY(k_ == 0))
+            return;
+        Source winner = init_winner(1);
+        keys_[0] = keys_[winner];
+        sources_[0] = sources_[winner];
+    }
+
+    void delete_min_insert(const ValueType* keyp, bool sup)
+    {
+        assert(sup == (keyp == nullptr));
+        unused(sup);
+
+        Source source = sources_[0];
+        ValueType key = *keyp;
+
+        for (Source pos = (k_ + source) / 2; pos > 0; pos /= 2)
+        {
+            ValueType okey = keys_[pos];
+            Source osource = sources_[pos];
+            // the winner moves on, the loser stays: exchange both by masks,
+            // which compilers cannot turn back into branches.
+            bool other = beats(okey, osource, key, source);
+            ValueType key_diff = (key ^ okey) & (ValueType(0) - other);
+            Source source_diff = (source ^ osource) & (Source(0) - other);
+            keys_[pos] = okey ^ key_diff;
+            sources_[pos] = osource ^ source_diff;
+            key ^= key_diff;
+            source ^= source_diff;
+        }
+
+        keys_[0] = key;
+        sources_[0] = source;
+    }
+};
+
+/******************************************************************************/
+// LoserTreeSwitch selects loser tree by size of value type, and the
+// branchless variant for integer keys
 
 template <bool Stable, typename ValueType, typename Comparator,
           typename Enable = void>
@@ -967,12 +1286,24 @@ public:
 template <bool Stable, typename ValueType, typename Comparator>
 class LoserTreeSwitch<
     Stable, ValueType, Comparator,
-    typename std::enable_if<sizeof(ValueType) <= 2 * sizeof(size_t)>::type>
+    typename std::enable_if<
+        sizeof(ValueType) <= 2 * sizeof(size_t) &&
+        !LoserTreeIsInteger<ValueType, Comparator>::value>::type>
 {
 public:
     using Type = LoserTreeCopy<Stable, ValueType, Comparator>;
 };
 
+template <bool Stable, typename ValueType, typename Comparator>
+class LoserTreeSwitch<
+    Stable, ValueType, Comparator,
+    typename std::enable_if<
+        LoserTreeIsInteger<ValueType, Comparator>::value>::type>
+{
+public:
+    using Type = LoserTreeInteger<Stable, ValueType, Comparator>;
+};
+
 template <bool Stable, typename ValueType, typename Comparator>
 using LoserTree = typename LoserTreeSwitch<Stable, ValueType, Comparator>::Type;
 
@@ -989,12 +1320,24 @@ public:
 template <bool Stable, typename ValueType, typename Comparator>
 class LoserTreeUnguardedSwitch<
     Stable, ValueType, Comparator,
-    typename std::enable_if<sizeof(ValueType) <= 2 * sizeof(size_t)>::type>
+    typename std::enable_if<
+        sizeof(ValueType) <= 2 * sizeof(size_t) &&
+        !LoserTreeIsInteger<ValueType, Comparator>::value>::type>
 {
 public:
     using Type = LoserTreeCopyUnguarded<Stable, ValueType, Comparator>;
 };
 
+template <bool Stable, typename ValueType, typename Comparator>
+class LoserTreeUnguardedSwitch<
+    Stable, ValueType, Comparator,
+    typename std::enable_if<
+        LoserTreeIsInteger<ValueType, Comparator>::value>::type>
+{
+public:
+    using Type = LoserTreeIntegerUnguarded<Stable, ValueType, Comparator>;
+};
+
 template <bool Stable, typename ValueType, typename Comparator>
 using LoserTreeUnguarded =
     typename LoserTreeUnguardedSwitch<Stable, ValueType, Comparator>::Type;
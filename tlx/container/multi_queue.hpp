@@ -0,0 +1,332 @@
+/*******************************************************************************
+ * tlx/container/multi_queue.hpp
+ *
+ * Part of tlx - http://panthema.net/tlx
+ *
+ * Copyright (C) 2026 Timo Bingmann <tb@panthema.net>
+ *
+ * All rights reserved. Published under the Boost Software License, Version 1.0
+ ******************************************************************************/
+
+#ifndef TLX_CONTAINER_MULTI_QUEUE_HEADER
+#define TLX_CONTAINER_MULTI_QUEUE_HEADER
+
+#include <tlx/container/d_ary_heap.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <random>
+#include <thread>
+#include <utility>
+
+namespace tlx {
+
+//! \addtogroup tlx_container
+//! \{
+
+/*!
+ * Relaxed concurrent priority queue which many threads can push to and pop
+ * from, built on c * p DAryHeaps for p threads, each guarded by its own spin
+ * lock.
+ *
+ * push() inserts into a random heap whose lock is free. try_pop() locks two
+ * random heaps and removes the better of their tops. Hence, pops do not
+ * return the global top item, but one of small rank: with c * p heaps the
+ * expected rank is in O(c * p). With a single heap, the MultiQueue is a
+ * locked DAryHeap.
+ *
+ * All methods except clear() and sanity_check() may be called concurrently.
+ * Threads pick heaps by a thread-local random generator.
+ *
+ * \tparam KeyType    Has to be copyable.
+ * \tparam Arity      Arity of the DAryHeaps.
+ * \tparam Compare    Function object, which must be callable concurrently.
+ */
+template <typename KeyType, unsigned Arity = 4,
+          class Compare = std::less<KeyType> >
+class MultiQueue
+{
+public:
+    using key_type = KeyType;
+    using compare_type = Compare;
+    using heap_type = DAryHeap<KeyType, Arity, Compare>;
+
+    static constexpr size_t arity = Arity;
+
+    /*!
+     * Creates c * p empty heaps for p = num_threads.
+     */
+    explicit MultiQueue(
+        size_t num_threads = std::thread::hardware_concurrency(),
+        size_t c = 2, compare_type cmp = compare_type())
+        : num_queues_(std::max<size_t>(1, c * num_threads)),
+          queues_(new Queue[num_queues_]),
+          cmp_(cmp)
+    {
+        for (size_t i = 0; i < num_queues_; ++i)
+            queues_[i].heap = heap_type(cmp);
+    }
+
+    //! Non-copyable.
+    MultiQueue(const MultiQueue&) = delete;
+    MultiQueue& operator=(const MultiQueue&) = delete;
+
+    //! Returns the number of heaps.
+    size_t num_queues() const noexcept
+    {
+        return num_queues_;
+    }
+
+    //! Returns the number of items, which may be outdated under concurrent
+    //! modification. Sums the sizes of all heaps.
+    size_t size() const noexcept
+    {
+        size_t total = 0;
+        for (size_t i = 0; i < num_queues_; ++i)
+            total += queues_[i].size.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    //! Returns true if there are no items, which may be outdated under
+    //! concurrent modification. Checks the sizes of all heaps.
+    bool empty() const noexcept
+    {
+        for (size_t i = 0; i < num_queues_; ++i)
+        {
+            if (queues_[i].size.load(std::memory_order_relaxed) != 0)
+                return false;
+        }
+        return true;
+    }
+
+    //! Inserts a new item into a random heap.
+    void push(const key_type& new_key)
+    {
+        Queue& q = lock_random();
+        q.heap.push(new_key);
+        q.update_size();
+        q.unlock();
+    }
+
+    //! Inserts a new item into a random heap.
+    void push(key_type&& new_key)
+    {
+        Queue& q = lock_random();
+        q.heap.push(std::move(new_key));
+        q.update_size();
+        q.unlock();
+    }
+
+    /*!
+     * Removes the better top item of two random heaps and writes it to \c out.
+     * If both are empty, retries with other heaps, and finally scans all heaps.
+     * Returns false if no item was found. Heaps whose size reads as zero are
+     * skipped without locking them.
+     */
+    bool try_pop(key_type& out)
+    {
+        for (size_t round = 0; round < num_queues_; ++round)
+        {
+            size_t i = random_index(), j = random_index();
+            if (queues_[i].is_empty())
+            {
+                if (queues_[j].is_empty())
+                    continue;
+                std::swap(i, j);
+            }
+
+            Queue& a = queues_[i];
+            if (!a.try_lock())
+                continue;
+
+            Queue* best = a.heap.empty() ? nullptr : &a;
+            if (j != i && !queues_[j].is_empty() && queues_[j].try_lock())
+            {
+                Queue& b = queues_[j];
+                if (!b.heap.empty() &&
+                    (best == nullptr || cmp_(b.heap.top(), a.heap.top())))
+                {
+                    best = &b;
+                }
+                if (best != &b)
+                    b.unlock();
+                else
+                    a.unlock();
+            }
+
+            if (best != nullptr)
+            {
+                extract_top(*best, out);
+                return true;
+            }
+            a.unlock();
+        }
+
+        // Few items remain: scan all heaps for one.
+        for (size_t i = 0; i < num_queues_; ++i)
+        {
+            Queue& q = queues_[i];
+            if (q.is_empty())
+                continue;
+            q.lock();
+            if (!q.heap.empty())
+            {
+                extract_top(q, out);
+                return true;
+            }
+            q.unlock();
+        }
+        return false;
+    }
+
+    //! Removes all items. Not thread-safe.
+    void clear()
+    {
+        for (size_t i = 0; i < num_queues_; ++i)
+        {
+            queues_[i].heap.clear();
+            queues_[i].update_size();
+        }
+    }
+
+    //! Checks the heap property and the number of items of all heaps. Not
+    //! thread-safe.
+    bool sanity_check()
+    {
+        for (size_t i = 0; i < num_queues_; ++i)
+        {
+            Queue& q = queues_[i];
+            if (q.is_locked() || !q.heap.sanity_check() ||
+                q.size.load(std::memory_order_relaxed) != q.heap.size())
+                return false;
+        }
+        return true;
+    }
+
+private:
+    //! A heap and its spin lock, padded to separate the locks of neighboring
+    //! heaps in different cache lines.
+    struct Queue
+    {
+        //! Spin lock of the heap.
+        std::atomic<bool> locked{false};
+
+        //! The heap itself.
+        heap_type heap;
+
+        //! Number of items in the heap, written under the lock and read
+        //! without it. Kept per heap, since a shared counter would be
+        //! modified by every operation of every thread.
+        std::atomic<size_t> size{0};
+
+        //! Padding against false sharing.
+        char padding[64];
+
+        //! Acquires the lock if it is free.
+        bool try_lock()
+        {
+            return !locked.load(std::memory_order_relaxed) &&
+                   !locked.exchange(true, std::memory_order_acquire);
+        }
+
+        //! Acquires the lock, waiting for it.
+        void lock()
+        {
+            size_t spins = 0;
+            while (!try_lock())
+                backoff(&spins);
+        }
+
+        //! Releases the lock.
+        void unlock()
+        {
+            locked.store(false, std::memory_order_release);
+        }
+
+        //! True if the lock is held.
+        bool is_locked() const
+        {
+            return locked.load(std::memory_order_relaxed);
+        }
+
+        //! True if the heap's size reads as zero, possibly outdated.
+        bool is_empty() const
+        {
+            return size.load(std::memory_order_relaxed) == 0;
+        }
+
+        //! Publishes the heap's size, while holding the lock.
+        void update_size()
+        {
+            size.store(heap.size(), std::memory_order_relaxed);
+        }
+    };
+
+    //! Number of heaps.
+    size_t num_queues_;
+
+    //! The heaps.
+    std::unique_ptr<Queue[]> queues_;
+
+    //! Compares two keys.
+    compare_type cmp_;
+
+    //! Pause the thread briefly while waiting for a lock.
+    static void backoff(size_t* spins)
+    {
+        if (++*spins < 64)
+        {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+            __builtin_ia32_pause();
+#endif
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    //! Returns a random heap index from a thread-local generator.
+    size_t random_index() const
+    {
+        static thread_local std::minstd_rand rng(static_cast<unsigned>(
+            std::hash<std::thread::id>()(std::this_thread::get_id())));
+        return static_cast<size_t>(rng()) % num_queues_;
+    }
+
+    //! Locks a random heap whose lock is free.
+    Queue& lock_random()
+    {
+        size_t spins = 0;
+        for (;;)
+        {
+            Queue& q = queues_[random_index()];
+            if (q.try_lock())
+                return q;
+            backoff(&spins);
+        }
+    }
+
+    //! Moves the top item of a locked heap to out and unlocks it.
+    void extract_top(Queue& q, key_type& out)
+    {
+        out = q.heap.extract_top();
+        q.update_size();
+        q.unlock();
+    }
+};
+
+//! make template alias of MultiQueue
+template <typename KeyType, unsigned Arity = 4,
+          typename Compare = std::less<KeyType> >
+using multi_queue = MultiQueue<KeyType, Arity, Compare>;
+
+//! \}
+
+} // namespace tlx
+
+#endif // !TLX_CONTAINER_MULTI_QUEUE_HEADER
+
+/******************************************************************************/
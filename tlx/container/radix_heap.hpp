@@ -22,6 +22,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <limits>
+#include <new>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -361,6 +362,293 @@ public:
         num_buckets_(std::numeric_limits<Int>::digits) + 1;
 };
 
+/*!
+ * Pool of fixed-size blocks of items, from which the buckets of a RadixHeap are
+ * built. Blocks released by the buckets are kept in a free list and handed out
+ * again, hence once the pool holds enough blocks for the peak number of items,
+ * pushes, pops, and redistributions do not call the allocator.
+ */
+template <typename ValueType>
+class BucketBlockPool
+{
+public:
+    //! Number of items per block: about 4 KiB, a power of two, at least 8.
+    static constexpr size_t block_size =
+        size_t(1) << Log2<(sizeof(ValueType) < 4096 / 8 ?
+                               4096 / sizeof(ValueType) : 8)>::floor;
+
+    //! A block of uninitialized items, linked into a bucket or the free list.
+    struct Block
+    {
+        Block* next;
+        typename std::aligned_storage<sizeof(ValueType),
+                                      alignof(ValueType)>::type
+            items[block_size];
+
+        ValueType* item(size_t i)
+        {
+            return reinterpret_cast<ValueType*>(&items[i]);
+        }
+        const ValueType* item(size_t i) const
+        {
+            return reinterpret_cast<const ValueType*>(&items[i]);
+        }
+    };
+
+    BucketBlockPool() = default;
+
+    //! Non-copyable.
+    BucketBlockPool(const BucketBlockPool&) = delete;
+    BucketBlockPool& operator=(const BucketBlockPool&) = delete;
+
+    //! Move the blocks and counters, the other pool becomes empty.
+    BucketBlockPool(BucketBlockPool&& other) noexcept
+        : free_(other.free_), num_free_(other.num_free_),
+          num_blocks_(other.num_blocks_),
+          num_allocations_(other.num_allocations_)
+    {
+        other.free_ = nullptr;
+        other.num_free_ = other.num_blocks_ = other.num_allocations_ = 0;
+    }
+
+    //! Move the blocks and counters, the other pool becomes empty. All blocks
+    //! of this pool must be free.
+    BucketBlockPool& operator=(BucketBlockPool&& other) noexcept
+    {
+        if (this == &other)
+            return *this;
+        shrink();
+        assert(num_blocks_ == 0);
+        std::swap(free_, other.free_);
+        std::swap(num_free_, other.num_free_);
+        std::swap(num_blocks_, other.num_blocks_);
+        std::swap(num_allocations_, other.num_allocations_);
+        return *this;
+    }
+
+    //! Releases the free blocks. All blocks must have been returned.
+    ~BucketBlockPool()
+    {
+        shrink();
+        assert(num_blocks_ == 0);
+    }
+
+    //! Hands out a free block, or allocates a new one.
+    Block* get()
+    {
+        if (TLX_LIKELY(free_ != nullptr))
+        {
+            Block* b = free_;
+            free_ = b->next;
+            --num_free_;
+            return b;
+        }
+        ++num_blocks_, ++num_allocations_;
+        return new Block;
+    }
+
+    //! Returns a block to the free list.
+    void put(Block* b)
+    {
+        b->next = free_;
+        free_ = b;
+        ++num_free_;
+    }
+
+    //! Allocates blocks until the pool holds at least num_blocks in total.
+    void reserve(size_t num_blocks)
+    {
+        while (num_blocks_ < num_blocks)
+        {
+            ++num_blocks_, ++num_allocations_;
+            put(new Block);
+        }
+    }
+
+    //! Releases all free blocks to the allocator.
+    void shrink()
+    {
+        while (free_ != nullptr)
+        {
+            Block* b = free_;
+            free_ = b->next;
+            delete b;
+            --num_blocks_;
+        }
+        num_free_ = 0;
+    }
+
+    //! Number of blocks held, in use and free.
+    size_t num_blocks() const
+    {
+        return num_blocks_;
+    }
+
+    //! Number of blocks in the free list.
+    size_t num_free() const
+    {
+        return num_free_;
+    }
+
+    //! Number of blocks allocated over the lifetime of the pool.
+    size_t num_allocations() const
+    {
+        return num_allocations_;
+    }
+
+private:
+    //! Singly linked list of free blocks.
+    Block* free_ = nullptr;
+    //! Number of blocks in the free list.
+    size_t num_free_ = 0;
+    //! Number of blocks held, in use and free.
+    size_t num_blocks_ = 0;
+    //! Number of blocks allocated.
+    size_t num_allocations_ = 0;
+};
+
+/*!
+ * Bucket of a RadixHeap: a stack of items in a singly linked list of blocks
+ * from a BucketBlockPool. Only the head block is partially filled. All
+ * modifying methods take the pool, which must be the same on every call.
+ */
+template <typename ValueType>
+class BucketBlockList
+{
+public:
+    using pool_type = BucketBlockPool<ValueType>;
+    using block_type = typename pool_type::Block;
+
+    static constexpr size_t block_size = pool_type::block_size;
+
+    BucketBlockList() = default;
+
+    //! Non-copyable, use copy_from().
+    BucketBlockList(const BucketBlockList&) = delete;
+    BucketBlockList& operator=(const BucketBlockList&) = delete;
+
+    //! Move the blocks, the other bucket becomes empty.
+    BucketBlockList(BucketBlockList&& other) noexcept
+        : head_(other.head_), size_(other.size_)
+    {
+        other.head_ = nullptr;
+        other.size_ = 0;
+    }
+
+    //! Move the blocks, the other bucket becomes empty. This bucket must be
+    //! empty.
+    BucketBlockList& operator=(BucketBlockList&& other) noexcept
+    {
+        assert(empty());
+        std::swap(head_, other.head_);
+        std::swap(size_, other.size_);
+        return *this;
+    }
+
+    //! The blocks must have been returned by clear().
+    ~BucketBlockList()
+    {
+        assert(head_ == nullptr);
+    }
+
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+    //! Returns the most recently inserted item.
+    ValueType& back()
+    {
+        assert(!empty());
+        return *head_->item((size_ - 1) % block_size);
+    }
+
+    //! Constructs a new item, taking a new block if the head block is full.
+    template <typename... Args>
+    void emplace_back(pool_type& pool, Args&&... args)
+    {
+        const size_t i = size_ % block_size;
+        block_type* b = (i == 0) ? pool.get() : head_;
+        new (b->item(i)) ValueType(std::forward<Args>(args)...);
+        if (i == 0)
+        {
+            b->next = head_;
+            head_ = b;
+        }
+        ++size_;
+    }
+
+    //! Destroys the most recently inserted item, and returns an emptied block
+    //! to the pool.
+    void pop_back(pool_type& pool)
+    {
+        assert(!empty());
+        const size_t i = --size_ % block_size;
+        head_->item(i)->~ValueType();
+        if (i == 0)
+        {
+            block_type* b = head_;
+            head_ = b->next;
+            pool.put(b);
+        }
+    }
+
+    //! Calls f(std::move(item)) for all items and empties the bucket. Each
+    //! block is returned to the pool as soon as its items are consumed, hence
+    //! f may insert into other buckets of the same pool.
+    template <typename Functor>
+    void consume(pool_type& pool, Functor&& f)
+    {
+        size_t n = size_ % block_size;
+        if (n == 0)
+            n = block_size;
+        while (head_ != nullptr)
+        {
+            block_type* b = head_;
+            head_ = b->next;
+            for (size_t i = 0; i < n; ++i)
+            {
+                f(std::move(*b->item(i)));
+                b->item(i)->~ValueType();
+            }
+            pool.put(b);
+            n = block_size;
+        }
+        size_ = 0;
+    }
+
+    //! Destroys all items and returns the blocks to the pool.
+    void clear(pool_type& pool)
+    {
+        consume(pool, [](ValueType&&) {});
+    }
+
+    //! Inserts copies of all items of other, which must use another pool.
+    void copy_from(const BucketBlockList& other, pool_type& pool)
+    {
+        size_t n = other.size_ % block_size;
+        if (n == 0)
+            n = block_size;
+        for (const block_type* b = other.head_; b != nullptr; b = b->next)
+        {
+            for (size_t i = 0; i < n; ++i)
+                emplace_back(pool, *b->item(i));
+            n = block_size;
+        }
+    }
+
+private:
+    //! Head block, which holds the most recently inserted items.
+    block_type* head_ = nullptr;
+    //! Number of items.
+    size_t size_ = 0;
+};
+
 //! Used as an adapter to implement RadixHeapPair on top of RadixHeap.
 template <typename KeyType, typename DataType>
 struct PairKeyExtract
@@ -398,6 +686,12 @@ struct PairKeyExtract
  * of Priority Queues in External Memory" [Bregel et al.] and is also inspired
  * by https://github.com/iwiwi/radix-heap
  *
+ * The buckets are stacks of fixed-size blocks of about 4 KiB, which are taken
+ * from and returned to a free list shared by all buckets. Hence, once the heap
+ * has held its peak number of items, or after reserve(), pushes, pops and
+ * redistributions reuse blocks and do not call the allocator. clear() keeps the
+ * blocks, shrink_to_fit() releases the unused ones.
+ *
  * \tparam KeyType   Has to be an unsigned integer type
  * \tparam DataType  Type of data payload
  * \tparam Radix     A power of two <= 64.
@@ -429,9 +723,15 @@ protected:
         div_ceil(8 * sizeof(ranked_key_type), radix_bits);
     static constexpr unsigned num_buckets = bucket_map_type::num_buckets;
 
+    using bucket_type = radix_heap_detail::BucketBlockList<value_type>;
+    using pool_type = typename bucket_type::pool_type;
+
 public:
     using bucket_data_type = std::vector<value_type>;
 
+    //! Number of items per block of bucket storage.
+    static constexpr size_t block_size = bucket_type::block_size;
+
     explicit RadixHeap(KeyExtract key_extract = KeyExtract{})
         : key_extract_(key_extract)
     {
@@ -439,12 +739,66 @@ public:
     }
 
     // Copy
-    RadixHeap(const RadixHeap&) = default;
-    RadixHeap& operator=(const RadixHeap&) = default;
+    RadixHeap(const RadixHeap& other)
+        : key_extract_(other.key_extract_),
+          size_(other.size_),
+          insertion_limit_(other.insertion_limit_),
+          current_bucket_(other.current_bucket_),
+          bucket_map_(other.bucket_map_),
+          mins_(other.mins_),
+          filled_(other.filled_)
+    {
+        pool_.reserve(other.pool_.num_blocks() - other.pool_.num_free());
+        for (size_t i = 0; i < num_buckets; ++i)
+            buckets_data_[i].copy_from(other.buckets_data_[i], pool_);
+    }
+
+    RadixHeap& operator=(const RadixHeap& other)
+    {
+        if (this != &other)
+            *this = RadixHeap(other);
+        return *this;
+    }
 
     // Move
-    RadixHeap(RadixHeap&&) = default;
-    RadixHeap& operator=(RadixHeap&&) = default;
+    RadixHeap(RadixHeap&& other) noexcept
+        : key_extract_(std::move(other.key_extract_)),
+          size_(other.size_),
+          insertion_limit_(other.insertion_limit_),
+          current_bucket_(other.current_bucket_),
+          bucket_map_(other.bucket_map_),
+          pool_(std::move(other.pool_)),
+          buckets_data_(std::move(other.buckets_data_)),
+          mins_(other.mins_),
+          filled_(other.filled_)
+    {
+        other.initialize_();
+    }
+
+    RadixHeap& operator=(RadixHeap&& other) noexcept
+    {
+        if (this == &other)
+            return *this;
+        release_buckets_();
+        key_extract_ = std::move(other.key_extract_);
+        size_ = other.size_;
+        insertion_limit_ = other.insertion_limit_;
+        current_bucket_ = other.current_bucket_;
+        bucket_map_ = other.bucket_map_;
+        pool_ = std::move(other.pool_);
+        for (size_t i = 0; i < num_buckets; ++i)
+            buckets_data_[i] = std::move(other.buckets_data_[i]);
+        mins_ = other.mins_;
+        filled_ = other.filled_;
+        other.initialize_();
+        return *this;
+    }
+
+    //! Returns all blocks to the pool, which then releases them.
+    ~RadixHeap()
+    {
+        release_buckets_();
+    }
 
     bucket_index_type get_bucket(const value_type& value) const
     {
@@ -491,7 +845,7 @@ public:
     {
         if (buckets_data_[idx].empty())
             filled_.set_bit(idx);
-        buckets_data_[idx].emplace_back(std::forward<Args>(args)...);
+        buckets_data_[idx].emplace_back(pool_, std::forward<Args>(args)...);
 
         const auto enc =
             Encoder::rank_of_int(key_extract_(buckets_data_[idx].back()));
@@ -528,7 +882,7 @@ public:
 
         if (buckets_data_[idx].empty())
             filled_.set_bit(idx);
-        buckets_data_[idx].push_back(value);
+        buckets_data_[idx].emplace_back(pool_, value);
 
         if (mins_[idx] > enc)
             mins_[idx] = enc;
@@ -569,14 +923,15 @@ public:
     void pop()
     {
         reorganize_();
-        buckets_data_[current_bucket_].pop_back();
+        buckets_data_[current_bucket_].pop_back(pool_);
         if (buckets_data_[current_bucket_].empty())
             filled_.clear_bit(current_bucket_);
         --size_;
     }
 
-    //! Exchanges the top buckets with an *empty* user provided bucket.
-    //! Can be used for bulk removals and may reduce allocation overhead
+    //! Moves the items of the top bucket into an *empty* user provided
+    //! bucket. Can be used for bulk removals, reusing the exchange bucket
+    //! avoids allocations.
     //! \warning The exchange bucket has to be empty
     //! \warning Updates insertion limit; no smaller keys can be inserted later
     void swap_top_bucket(bucket_data_type& exchange_bucket)
@@ -584,20 +939,53 @@ public:
         reorganize_();
 
         assert(exchange_bucket.empty());
-        size_ -= buckets_data_[current_bucket_].size();
-        buckets_data_[current_bucket_].swap(exchange_bucket);
+        bucket_type& bucket = buckets_data_[current_bucket_];
+        size_ -= bucket.size();
+        exchange_bucket.reserve(bucket.size());
+        bucket.consume(pool_, [&exchange_bucket](value_type&& x) {
+            exchange_bucket.push_back(std::move(x));
+        });
 
         filled_.clear_bit(current_bucket_);
     }
 
-    //! Clears all internal queues and resets insertion limit
+    //! Clears all internal queues and resets insertion limit. Keeps the
+    //! blocks of bucket storage for reuse.
     void clear()
     {
         for (auto& x : buckets_data_)
-            x.clear();
+            x.clear(pool_);
         initialize_();
     }
 
+    //! Allocates bucket storage for \c new_size items, such that pushes
+    //! up to this size do not call the allocator. As the head block of each
+    //! bucket and the block being redistributed may be partially filled, one
+    //! block per bucket and one more are added.
+    void reserve(size_t new_size)
+    {
+        pool_.reserve(div_ceil(new_size, size_t(block_size)) + num_buckets + 1);
+    }
+
+    //! Releases bucket storage not used by the current items.
+    void shrink_to_fit()
+    {
+        pool_.shrink();
+    }
+
+    //! Returns the number of items that fit into the bucket storage held,
+    //! used and unused.
+    size_t capacity() const
+    {
+        return pool_.num_blocks() * block_size;
+    }
+
+    //! Returns the number of blocks of bucket storage allocated so far.
+    size_t num_block_allocations() const
+    {
+        return pool_.num_allocations();
+    }
+
 private:
     KeyExtract key_extract_;
     size_t size_{0};
@@ -606,7 +994,10 @@ private:
 
     bucket_map_type bucket_map_;
 
-    std::array<bucket_data_type, num_buckets> buckets_data_;
+    //! Free list of blocks for the buckets, declared before them
+    pool_type pool_;
+
+    std::array<bucket_type, num_buckets> buckets_data_;
 
     std::array<ranked_key_type, num_buckets> mins_;
     radix_heap_detail::BitArray<num_buckets> filled_;
@@ -623,6 +1014,12 @@ private:
         filled_.clear_all();
     }
 
+    void release_buckets_()
+    {
+        for (auto& x : buckets_data_)
+            x.clear(pool_);
+    }
+
     void reorganize_()
     {
         assert(!empty());
@@ -671,8 +1068,8 @@ private:
 
         auto& data_source = buckets_data_[first_non_empty];
 
-        for (auto& x : data_source)
-        {
+        // the blocks of data_source are reused while it is consumed
+        data_source.consume(pool_, [&](value_type&& x) {
             const ranked_key_type key = Encoder::rank_of_int(key_extract_(x));
             assert(key >= mins_[first_non_empty]);
             assert(first_non_empty == mins_.size() - 1 ||
@@ -683,12 +1080,10 @@ private:
             // insert into bucket
             if (buckets_data_[idx].empty())
                 filled_.set_bit(idx);
-            buckets_data_[idx].push_back(std::move(x));
+            buckets_data_[idx].emplace_back(pool_, std::move(x));
             if (mins_[idx] > key)
                 mins_[idx] = key;
-        }
-
-        data_source.clear();
+        });
 
         // mark consumed bucket as empty
         mins_[first_non_empty] = std::numeric_limits<ranked_key_type>::max();
@@ -0,0 +1,427 @@
+/*******************************************************************************
+ * tlx/container/sequence_heap.hpp
+ *
+ * Part of tlx - http://panthema.net/tlx
+ *
+ * Copyright (C) 2026 Timo Bingmann <tb@panthema.net>
+ *
+ * All rights reserved. Published under the Boost Software License, Version 1.0
+ ******************************************************************************/
+
+#ifndef TLX_CONTAINER_SEQUENCE_HEAP_HEADER
+#define TLX_CONTAINER_SEQUENCE_HEAP_HEADER
+
+#include <tlx/algorithm/multiway_merge.hpp>
+#include <tlx/container/d_ary_heap.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace tlx {
+
+//! \addtogroup tlx_container
+//! \{
+
+/*!
+ * This class implements a sequence heap [Sanders, "Fast Priority Queues for
+ * Cached Memory", 2000], a priority queue for very many items which accesses
+ * memory mostly sequentially.
+ *
+ * New items are pushed into a small insertion heap, a DAryHeap, which fits
+ * into the cache. When it is full, it is sorted and becomes a run of group 0.
+ * Group i holds up to \c group_arity sorted runs of about
+ * insert_heap_size * group_arity^i items. When a group is full, its runs are
+ * merged into one run of the next group. The smallest items of each group are
+ * merged from its runs into a group buffer, and the smallest items of all
+ * groups are merged from the group buffers into a deletion buffer. The merges
+ * use multiway_merge(), hence loser trees for many runs. The top item is the
+ * smaller of the insertion heap's top and the deletion buffer's front.
+ *
+ * The following invariants hold: the items of the deletion buffer are not
+ * larger than those of any group, and the items of a group buffer are not
+ * larger than those of its group's runs.
+ *
+ * \tparam KeyType    Has to be default constructible and copyable.
+ * \tparam Compare    Function object, top() is the item a with !cmp(b, a) for
+ *                    all items b.
+ */
+template <typename KeyType, class Compare = std::less<KeyType> >
+class SequenceHeap
+{
+public:
+    using key_type = KeyType;
+    using compare_type = Compare;
+
+    //! Allocates an empty sequence heap. The insertion heap and the group
+    //! buffers hold \c insert_heap_size items, the deletion buffer half of
+    //! them, and each group up to \c group_arity runs.
+    explicit SequenceHeap(compare_type cmp = compare_type(),
+                          size_t insert_heap_size = 4096,
+                          size_t group_arity = 64)
+        : cmp_(cmp),
+          insert_heap_(cmp),
+          insert_heap_size_(std::max<size_t>(insert_heap_size, 2)),
+          deletion_size_(insert_heap_size_ / 2),
+          group_arity_(std::max<size_t>(group_arity, 2))
+    {
+        insert_heap_.reserve(insert_heap_size_);
+    }
+
+    //! Returns the number of items.
+    size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    //! Returns true if there are no items.
+    bool empty() const noexcept
+    {
+        return size_ == 0;
+    }
+
+    //! Returns the number of groups.
+    size_t num_groups() const noexcept
+    {
+        return groups_.size();
+    }
+
+    //! Empties the heap.
+    void clear()
+    {
+        insert_heap_.clear();
+        deletion_.clear();
+        groups_.clear();
+        size_ = 0;
+    }
+
+    //! Inserts a new item.
+    void push(const key_type& new_key)
+    {
+        if (insert_heap_.size() >= insert_heap_size_)
+            flush_insert_heap();
+        insert_heap_.push(new_key);
+        ++size_;
+    }
+
+    //! Inserts a new item.
+    void push(key_type&& new_key)
+    {
+        if (insert_heap_.size() >= insert_heap_size_)
+            flush_insert_heap();
+        insert_heap_.push(std::move(new_key));
+        ++size_;
+    }
+
+    //! Returns the top item. Refills the deletion buffer if it is empty.
+    const key_type& top()
+    {
+        assert(!empty());
+        if (top_in_deletion())
+            return deletion_.front();
+        return insert_heap_.top();
+    }
+
+    //! Removes the top item.
+    void pop()
+    {
+        assert(!empty());
+        if (top_in_deletion())
+            deletion_.pop_front();
+        else
+            insert_heap_.pop();
+        --size_;
+    }
+
+    //! Removes and returns the top item.
+    key_type extract_top()
+    {
+        key_type top_item = top();
+        pop();
+        return top_item;
+    }
+
+    //! For debugging: checks that all buffers and runs are sorted, that the
+    //! invariants hold, and the number of items.
+    bool sanity_check()
+    {
+        if (!insert_heap_.sanity_check())
+            return false;
+        size_t total = insert_heap_.size() + deletion_.size();
+        if (!deletion_.is_sorted(cmp_))
+            return false;
+        for (Group& g : groups_)
+        {
+            if (!g.buffer.is_sorted(cmp_))
+                return false;
+            // deletion buffer <= group buffer <= runs
+            if (!deletion_.empty() && !g.buffer.empty() &&
+                cmp_(g.buffer.front(), deletion_.back()))
+                return false;
+            size_t group_size = 0;
+            for (Sequence& r : g.runs)
+            {
+                if (r.empty() || !r.is_sorted(cmp_))
+                    return false;
+                if (!g.buffer.empty() && cmp_(r.front(), g.buffer.back()))
+                    return false;
+                if (!deletion_.empty() && cmp_(r.front(), deletion_.back()))
+                    return false;
+                group_size += r.size();
+            }
+            if (group_size != g.size)
+                return false;
+            total += g.buffer.size() + g.size;
+        }
+        return total == size_;
+    }
+
+private:
+    //! A sorted sequence of items, of which the first pos are consumed.
+    struct Sequence
+    {
+        std::vector<key_type> data;
+        size_t pos = 0;
+
+        using iterator = typename std::vector<key_type>::iterator;
+
+        size_t size() const
+        {
+            return data.size() - pos;
+        }
+        bool empty() const
+        {
+            return pos == data.size();
+        }
+        iterator begin()
+        {
+            return data.begin() + pos;
+        }
+        iterator end()
+        {
+            return data.end();
+        }
+        const key_type& front() const
+        {
+            return data[pos];
+        }
+        const key_type& back() const
+        {
+            return data.back();
+        }
+        void pop_front()
+        {
+            ++pos;
+        }
+        void clear()
+        {
+            data.clear();
+            pos = 0;
+        }
+        //! Moves the remaining items to the front of data.
+        void compact()
+        {
+            data.erase(data.begin(), data.begin() + pos);
+            pos = 0;
+        }
+        bool is_sorted(const compare_type& cmp) const
+        {
+            return std::is_sorted(data.begin() + pos, data.end(), cmp);
+        }
+    };
+
+    //! A group of runs and its buffer.
+    struct Group
+    {
+        //! Sorted runs, none is empty.
+        std::vector<Sequence> runs;
+        //! Smallest items of the group, merged from the runs.
+        Sequence buffer;
+        //! Number of items in the runs.
+        size_t size = 0;
+    };
+
+    using iterator_pair =
+        std::pair<typename Sequence::iterator, typename Sequence::iterator>;
+
+    //! Compare function.
+    compare_type cmp_;
+
+    //! Insertion heap.
+    DAryHeap<key_type, 4, compare_type> insert_heap_;
+
+    //! Capacity of the insertion heap and the group buffers.
+    size_t insert_heap_size_;
+
+    //! Capacity of the deletion buffer.
+    size_t deletion_size_;
+
+    //! Maximum number of runs per group.
+    size_t group_arity_;
+
+    //! Smallest items of all groups.
+    Sequence deletion_;
+
+    //! Groups of runs with growing run length.
+    std::vector<Group> groups_;
+
+    //! Number of items.
+    size_t size_ = 0;
+
+    //! Returns true if the top item is the deletion buffer's front, after
+    //! refilling it if it is empty.
+    bool top_in_deletion()
+    {
+        if (deletion_.empty())
+            refill_deletion();
+        return !deletion_.empty() &&
+               (insert_heap_.empty() ||
+                !cmp_(insert_heap_.top(), deletion_.front()));
+    }
+
+    //! Merges the first \c size items of the sequences into target, and
+    //! advances the sequences.
+    void merge(std::vector<Sequence*>& seqs, typename Sequence::iterator target,
+               size_t size)
+    {
+        std::vector<iterator_pair> pairs;
+        pairs.reserve(seqs.size());
+        for (Sequence* s : seqs)
+            pairs.emplace_back(s->begin(), s->end());
+        multiway_merge(pairs.begin(), pairs.end(), target,
+                       static_cast<std::ptrdiff_t>(size), cmp_);
+        for (size_t i = 0; i < seqs.size(); ++i)
+            seqs[i]->pos = static_cast<size_t>(pairs[i].first -
+                                               seqs[i]->data.begin());
+    }
+
+    //! Sorts the insertion heap into a new run of group 0. Its items are merged
+    //! with those of the deletion buffer and group buffer 0 first, which then
+    //! take back the smallest ones.
+    void flush_insert_heap()
+    {
+        if (groups_.empty())
+            groups_.emplace_back();
+
+        Sequence sorted;
+        sorted.data.reserve(insert_heap_.size());
+        insert_heap_.pop_k(insert_heap_.size(),
+                           std::back_inserter(sorted.data));
+
+        Group& g0 = groups_[0];
+        size_t deletion_items = deletion_.size();
+        size_t buffer_items = g0.buffer.size();
+
+        Sequence run;
+        std::vector<Sequence*> seqs = {&sorted, &deletion_, &g0.buffer};
+        run.data.resize(sorted.size() + deletion_items + buffer_items);
+        merge(seqs, run.data.begin(), run.data.size());
+
+        deletion_.data.assign(run.data.begin(),
+                              run.data.begin() + deletion_items);
+        deletion_.pos = 0;
+        g0.buffer.data.assign(run.data.begin() + deletion_items,
+                              run.data.begin() + deletion_items + buffer_items);
+        g0.buffer.pos = 0;
+        run.pos = deletion_items + buffer_items;
+        run.compact();
+
+        add_run(0, std::move(run));
+    }
+
+    //! Adds a run to group i. If the group is full, its runs are merged with
+    //! the buffer of group i + 1 into a run of group i + 1 first.
+    void add_run(size_t i, Sequence&& run)
+    {
+        if (groups_[i].runs.size() >= group_arity_)
+        {
+            if (i + 1 == groups_.size())
+                groups_.emplace_back();
+
+            Group& g = groups_[i];
+            Group& next = groups_[i + 1];
+
+            std::vector<Sequence*> seqs;
+            for (Sequence& r : g.runs)
+                seqs.push_back(&r);
+            seqs.push_back(&next.buffer);
+
+            Sequence merged;
+            merged.data.resize(g.size + next.buffer.size());
+            merge(seqs, merged.data.begin(), merged.data.size());
+
+            g.runs.clear();
+            g.size = 0;
+            next.buffer.clear();
+
+            add_run(i + 1, std::move(merged));
+        }
+
+        Group& g = groups_[i];
+        g.size += run.size();
+        g.runs.emplace_back(std::move(run));
+    }
+
+    //! Fills the buffer of group i from its runs.
+    void refill_buffer(Group& g)
+    {
+        size_t n = std::min(insert_heap_size_ - g.buffer.size(), g.size);
+        if (n == 0)
+            return;
+
+        g.buffer.compact();
+        size_t old_size = g.buffer.data.size();
+        g.buffer.data.resize(old_size + n);
+
+        std::vector<Sequence*> seqs;
+        for (Sequence& r : g.runs)
+            seqs.push_back(&r);
+        merge(seqs, g.buffer.data.begin() + old_size, n);
+        g.size -= n;
+
+        g.runs.erase(
+            std::remove_if(g.runs.begin(), g.runs.end(),
+                           [](const Sequence& r) { return r.empty(); }),
+            g.runs.end());
+    }
+
+    //! Fills the deletion buffer from the group buffers, which are filled
+    //! first, such that none runs empty while its group has more items.
+    void refill_deletion()
+    {
+        std::vector<Sequence*> seqs;
+        size_t total = 0;
+        for (Group& g : groups_)
+        {
+            if (g.buffer.size() < deletion_size_)
+                refill_buffer(g);
+            if (!g.buffer.empty())
+            {
+                seqs.push_back(&g.buffer);
+                total += g.buffer.size();
+            }
+        }
+
+        size_t n = std::min(deletion_size_, total);
+        deletion_.clear();
+        if (n == 0)
+            return;
+        deletion_.data.resize(n);
+        merge(seqs, deletion_.data.begin(), n);
+    }
+};
+
+//! make template alias of SequenceHeap
+template <typename KeyType, typename Compare = std::less<KeyType> >
+using sequence_heap = SequenceHeap<KeyType, Compare>;
+
+//! \}
+
+} // namespace tlx
+
+#endif // !TLX_CONTAINER_SEQUENCE_HEAP_HEADER
+
+/******************************************************************************/
@@ -0,0 +1,231 @@
+/*******************************************************************************
+ * tlx/slab_allocator.cpp
+ *
+ * Part of tlx - http://panthema.net/tlx
+ *
+ * Copyright (C) 2026 Timo Bingmann <tb@panthema.net>
+ *
+ * All rights reserved. Published under the Boost Software License, Version 1.0
+ ******************************************************************************/
+
+#include <tlx/slab_allocator.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+
+#if !defined(_WIN32) && (defined(MAP_ANONYMOUS) || defined(MAP_ANON))
+#define TLX_SLAB_ALLOCATOR_MMAP 1
+#if !defined(MAP_ANONYMOUS)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#else
+#define TLX_SLAB_ALLOCATOR_MMAP 0
+#endif
+
+namespace tlx {
+
+//! huge page size, to which slabs are aligned for transparent huge pages
+static constexpr size_t slab_huge_page_size = 2 * 1024 * 1024;
+
+//! round a request size up to a multiple of the block alignment
+static inline size_t round_up(size_t size)
+{
+    if (size == 0)
+        return SlabArena::alignment;
+    return (size + SlabArena::alignment - 1) / SlabArena::alignment *
+           SlabArena::alignment;
+}
+
+SlabArena::SlabArena(size_t slab_size, bool huge_pages)
+    : slab_size_(slab_size), huge_pages_(huge_pages)
+{
+    // a slab must hold at least four of the smallest blocks
+    if (slab_size_ < 4 * alignment)
+        slab_size_ = 4 * alignment;
+    slab_size_ = round_up(slab_size_);
+}
+
+SlabArena::~SlabArena()
+{
+    for (const Slab& s : slabs_)
+    {
+#if TLX_SLAB_ALLOCATOR_MMAP
+        if (s.mapped)
+        {
+            munmap(s.base, s.size);
+            continue;
+        }
+#endif
+        operator delete(s.base);
+    }
+}
+
+SlabArena::SizeClass* SlabArena::find_class(size_t size, bool create)
+{
+    for (size_t i = 0; i < num_classes_; ++i)
+    {
+        if (classes_[i].size == size)
+            return &classes_[i];
+    }
+    if (!create || num_classes_ == max_size_classes)
+        return nullptr;
+
+    SizeClass& sc = classes_[num_classes_++];
+    sc.size = size;
+    sc.free_list = nullptr;
+    return &sc;
+}
+
+void SlabArena::allocate_slab()
+{
+    Slab s;
+    s.base = nullptr;
+    s.size = slab_size_;
+    s.mapped = false;
+    char* begin = nullptr;
+
+    // make room first, such that push_back() below cannot throw and leak.
+    slabs_.reserve(slabs_.size() + 1);
+
+#if TLX_SLAB_ALLOCATOR_MMAP
+#if defined(MAP_HUGETLB)
+    // explicit huge pages, only available if the administrator reserved some.
+    if (huge_pages_ && !hugetlb_failed_ &&
+        slab_size_ % slab_huge_page_size == 0)
+    {
+        void* p = mmap(nullptr, slab_size_, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED)
+        {
+            s.base = p;
+            s.mapped = true;
+            begin = static_cast<char*>(p);
+        }
+        else
+        {
+            hugetlb_failed_ = true;
+        }
+    }
+#endif
+    if (!begin)
+    {
+        // over-allocate to align the slab to a huge page boundary, then trim.
+        size_t extra = huge_pages_ ? slab_huge_page_size : 0;
+        void* p = mmap(nullptr, slab_size_ + extra, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p != MAP_FAILED)
+        {
+            char* raw = static_cast<char*>(p);
+            char* aligned = raw;
+            if (extra)
+            {
+                uintptr_t a = reinterpret_cast<uintptr_t>(raw);
+                a = (a + extra - 1) / extra * extra;
+                aligned = reinterpret_cast<char*>(a);
+                if (aligned != raw)
+                    munmap(raw, static_cast<size_t>(aligned - raw));
+                size_t tail = static_cast<size_t>(raw + extra - aligned);
+                if (tail)
+                    munmap(aligned + slab_size_, tail);
+#if defined(MADV_HUGEPAGE)
+                madvise(aligned, slab_size_, MADV_HUGEPAGE);
+#endif
+            }
+            s.base = aligned;
+            s.mapped = true;
+            begin = aligned;
+        }
+    }
+#endif
+    if (!begin)
+    {
+        s.base = operator new(slab_size_);
+        begin = static_cast<char*>(s.base);
+    }
+
+    slabs_.push_back(s);
+    slab_ptr_ = begin;
+    slab_end_ = begin + slab_size_;
+    bytes_reserved_.fetch_add(slab_size_, std::memory_order_relaxed);
+}
+
+void* SlabArena::allocate(size_t size)
+{
+    size = round_up(size);
+
+    if (size <= slab_size_ / 4)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        SizeClass* sc = find_class(size, /* create */ true);
+        if (sc)
+        {
+            void* p;
+            if (sc->free_list)
+            {
+                // recycle a freed block of the same size
+                p = sc->free_list;
+                sc->free_list = sc->free_list->next;
+            }
+            else
+            {
+                // otherwise carve a new block, the rest of the slab is wasted
+                if (static_cast<size_t>(slab_end_ - slab_ptr_) < size)
+                    allocate_slab();
+
+                p = slab_ptr_;
+                slab_ptr_ += size;
+            }
+            bytes_used_.fetch_add(size, std::memory_order_relaxed);
+            return p;
+        }
+    }
+
+    // large blocks and too many size classes: fall back to operator new.
+    void* p = operator new(size);
+    bytes_reserved_.fetch_add(size, std::memory_order_relaxed);
+    bytes_used_.fetch_add(size, std::memory_order_relaxed);
+    return p;
+}
+
+void SlabArena::deallocate(void* p, size_t size) noexcept
+{
+    if (!p)
+        return;
+
+    size = round_up(size);
+
+    bytes_used_.fetch_sub(size, std::memory_order_relaxed);
+
+    if (size <= slab_size_ / 4)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        SizeClass* sc = find_class(size, /* create */ false);
+        if (sc)
+        {
+            FreeBlock* b = static_cast<FreeBlock*>(p);
+            b->next = sc->free_list;
+            sc->free_list = b;
+            return;
+        }
+    }
+
+    bytes_reserved_.fetch_sub(size, std::memory_order_relaxed);
+    operator delete(p);
+}
+
+size_t SlabArena::num_slabs() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return slabs_.size();
+}
+
+} // namespace tlx
+
+/******************************************************************************/
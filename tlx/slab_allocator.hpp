@@ -0,0 +1,282 @@
+/*******************************************************************************
+ * tlx/slab_allocator.hpp
+ *
+ * A pooling allocator for many small fixed-size objects such as B+ tree nodes,
+ * which carves blocks out of large, optionally huge-page backed memory regions
+ * and recycles freed blocks through per-size free lists.
+ *
+ * Part of tlx - http://panthema.net/tlx
+ *
+ * Copyright (C) 2026 Timo Bingmann <tb@panthema.net>
+ *
+ * All rights reserved. Published under the Boost Software License, Version 1.0
+ ******************************************************************************/
+
+#ifndef TLX_SLAB_ALLOCATOR_HEADER
+#define TLX_SLAB_ALLOCATOR_HEADER
+
+#include <tlx/allocator_base.hpp>
+#include <tlx/counting_ptr.hpp>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace tlx {
+
+/*!
+ * Memory pool used by SlabAllocator. The arena reserves memory in large
+ * regions called slabs and hands out blocks from them. Each distinct block size
+ * is a size class with its own free list, hence freed blocks are reused only
+ * for objects of the same size. Slabs are returned to the system only when the
+ * arena is destroyed.
+ *
+ * On Linux, slabs are mmap()-ed and, if requested, backed by huge pages: first
+ * by trying MAP_HUGETLB, which requires preallocated huge pages, and otherwise
+ * by aligning the slab to the huge page size and advising the kernel with
+ * madvise(MADV_HUGEPAGE). On other systems slabs are plain operator new
+ * allocations.
+ *
+ * Requests larger than a quarter of the slab size, and requests of block sizes
+ * exceeding max_size_classes distinct sizes, bypass the pool and are passed to
+ * operator new.
+ *
+ * All methods are thread-safe.
+ */
+class SlabArena : public ReferenceCounter
+{
+public:
+    //! default size of slabs: one x86-64 huge page.
+    static constexpr size_t default_slab_size = 2 * 1024 * 1024;
+
+    //! alignment of blocks, block sizes are rounded up to a multiple of it.
+    static constexpr size_t alignment = 16;
+
+    //! maximum number of different block sizes served from the pool.
+    static constexpr size_t max_size_classes = 8;
+
+    //! construct an empty arena, slabs are allocated on demand.
+    explicit SlabArena(size_t slab_size = default_slab_size,
+                       bool huge_pages = true);
+
+    //! non-copyable: delete copy-constructor
+    SlabArena(const SlabArena&) = delete;
+    //! non-copyable: delete assignment operator
+    SlabArena& operator=(const SlabArena&) = delete;
+
+    //! release all slabs. Blocks still allocated become invalid.
+    ~SlabArena();
+
+    //! allocate a block of size bytes.
+    void* allocate(size_t size);
+
+    //! return a block previously allocated with the same size.
+    void deallocate(void* p, size_t size) noexcept;
+
+    //! number of bytes reserved from the system, in slabs and for large blocks.
+    size_t bytes_reserved() const noexcept
+    {
+        return bytes_reserved_.load(std::memory_order_relaxed);
+    }
+
+    //! number of bytes in blocks currently handed out.
+    size_t bytes_used() const noexcept
+    {
+        return bytes_used_.load(std::memory_order_relaxed);
+    }
+
+    //! number of slabs allocated.
+    size_t num_slabs() const;
+
+    //! size of each slab.
+    size_t slab_size() const noexcept
+    {
+        return slab_size_;
+    }
+
+private:
+    //! a freed block, linked into the free list of its size class.
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    //! a block size and the freed blocks of this size.
+    struct SizeClass
+    {
+        size_t size;
+        FreeBlock* free_list;
+    };
+
+    //! a reserved memory region.
+    struct Slab
+    {
+        //! start of the region as returned by the system.
+        void* base;
+        //! length of the region.
+        size_t size;
+        //! whether the region was mmap()-ed, otherwise it is from operator new.
+        bool mapped;
+    };
+
+    //! size of slabs
+    size_t slab_size_;
+
+    //! whether to back slabs with huge pages
+    bool huge_pages_;
+
+    //! set after MAP_HUGETLB failed once, to avoid futile system calls.
+    bool hugetlb_failed_ = false;
+
+    //! size classes and their free lists
+    SizeClass classes_[max_size_classes];
+
+    //! number of size classes in use
+    size_t num_classes_ = 0;
+
+    //! unused area of the current slab
+    char* slab_ptr_ = nullptr;
+
+    //! end of the current slab
+    char* slab_end_ = nullptr;
+
+    //! all slabs reserved
+    std::vector<Slab> slabs_;
+
+    //! mutex protecting all fields except the statistics
+    mutable std::mutex mutex_;
+
+    //! statistics: bytes reserved from the system
+    std::atomic<size_t> bytes_reserved_{0};
+
+    //! statistics: bytes handed out
+    std::atomic<size_t> bytes_used_{0};
+
+    //! find the size class of a block size, or create it if create is set.
+    //! Returns nullptr if there is none.
+    SizeClass* find_class(size_t size, bool create);
+
+    //! reserve a new slab and make it the current one.
+    void allocate_slab();
+};
+
+/*!
+ * STL-compatible allocator which takes memory from a shared SlabArena. All
+ * allocators rebound or copied from one another use the same arena, which is
+ * reference counted and lives as long as any allocator using it. A default
+ * constructed SlabAllocator creates a new arena.
+ *
+ * The allocator is intended for node-based containers which allocate single
+ * objects, like the B+ tree: the tree's LeafNode and InnerNode objects each
+ * get their own size class and free list. The B+ tree also reports the arena's
+ * bytes_reserved() in its tree_stats.
+ */
+template <typename Type>
+class SlabAllocator : public AllocatorBase<Type>
+{
+public:
+    using value_type = Type;
+    using pointer = Type*;
+    using const_pointer = const Type*;
+    using reference = Type&;
+    using const_reference = const Type&;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+
+    //! C++11 type flag
+    using is_always_equal = std::false_type;
+    //! C++11 type flag
+    using propagate_on_container_copy_assignment = std::true_type;
+    //! C++11 type flag
+    using propagate_on_container_swap = std::true_type;
+
+    //! required rebind.
+    template <typename Other>
+    struct rebind
+    {
+        using other = SlabAllocator<Other>;
+    };
+
+    //! default constructor: creates a new arena with default parameters.
+    SlabAllocator() : arena_(make_counting<SlabArena>())
+    {
+    }
+
+    //! constructor with explicit, possibly shared, arena
+    explicit SlabAllocator(const CountingPtr<SlabArena>& arena) noexcept
+        : arena_(arena)
+    {
+    }
+
+    //! constructor from another allocator, sharing its arena
+    template <typename Other>
+    SlabAllocator(const SlabAllocator<Other>& other) noexcept
+        : arena_(other.arena_)
+    {
+    }
+
+    //! copy-constructor: default. There are no move operations, since a
+    //! moved-from allocator must still be able to deallocate.
+    SlabAllocator(const SlabAllocator&) noexcept = default;
+
+    //! copy-assignment: default
+    SlabAllocator& operator=(const SlabAllocator&) noexcept = default;
+
+    //! allocate method: get memory from arena
+    pointer allocate(size_t n)
+    {
+        static_assert(alignof(Type) <= SlabArena::alignment,
+                      "SlabAllocator cannot align Type sufficiently");
+        return static_cast<Type*>(arena_->allocate(n * sizeof(Type)));
+    }
+
+    //! deallocate method: release to arena
+    void deallocate(pointer p, size_t n) noexcept
+    {
+        arena_->deallocate(p, n * sizeof(Type));
+    }
+
+    //! number of bytes the arena reserved from the system.
+    size_t bytes_reserved() const noexcept
+    {
+        return arena_->bytes_reserved();
+    }
+
+    //! number of bytes the arena handed out to all of its allocators.
+    size_t bytes_used() const noexcept
+    {
+        return arena_->bytes_used();
+    }
+
+    //! the arena shared by this allocator.
+    const CountingPtr<SlabArena>& arena() const noexcept
+    {
+        return arena_;
+    }
+
+    template <typename Other>
+    bool operator==(const SlabAllocator<Other>& other) const noexcept
+    {
+        return arena_ == other.arena_;
+    }
+
+    template <typename Other>
+    bool operator!=(const SlabAllocator<Other>& other) const noexcept
+    {
+        return !operator==(other);
+    }
+
+    template <typename Other>
+    friend class SlabAllocator;
+
+private:
+    //! shared arena
+    CountingPtr<SlabArena> arena_;
+};
+
+} // namespace tlx
+
+#endif // !TLX_SLAB_ALLOCATOR_HEADER
+
+/******************************************************************************/
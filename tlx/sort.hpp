@@ -19,6 +19,7 @@ foreach (sort grep(!/_impl/, glob("tlx/sort/"."*.hpp"))) {
   print "#include <$_> // NOLINT(misc-include-cleaner)\n";
 }
 ]]]*/
+#include <tlx/sort/external_sort.hpp>      // NOLINT(misc-include-cleaner)
 #include <tlx/sort/parallel_mergesort.hpp> // NOLINT(misc-include-cleaner)
 #include <tlx/sort/strings.hpp>            // NOLINT(misc-include-cleaner)
 #include <tlx/sort/strings_parallel.hpp>   // NOLINT(misc-include-cleaner)
@@ -0,0 +1,537 @@
+/*******************************************************************************
+ * tlx/sort/external_sort.hpp
+ *
+ * External memory sorter for more items than fit into main memory.
+ *
+ * Part of tlx - http://panthema.net/tlx
+ *
+ * Copyright (C) 2026 Timo Bingmann <tb@panthema.net>
+ *
+ * All rights reserved. Published under the Boost Software License, Version 1.0
+ ******************************************************************************/
+
+#ifndef TLX_SORT_EXTERNAL_SORT_HEADER
+#define TLX_SORT_EXTERNAL_SORT_HEADER
+
+#include <tlx/algorithm/multiway_merge_stream.hpp>
+#include <tlx/sort/parallel_mergesort.hpp>
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tlx {
+
+//! \addtogroup tlx_sort
+//! \{
+
+namespace external_sort_detail {
+
+/*!
+ * Writes items to a file in a background thread, while the caller prepares
+ * the next ones. The thread lives as long as the file is open and takes one
+ * write at a time from the caller.
+ */
+template <typename ValueType>
+class AsyncFileWriter
+{
+public:
+    //! Creates or truncates the file, see good().
+    explicit AsyncFileWriter(const std::string& path)
+        : opened_(writer_.open(path)), thread_([this]() { run(); })
+    {
+    }
+
+    //! Non-copyable.
+    AsyncFileWriter(const AsyncFileWriter&) = delete;
+    AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+    ~AsyncFileWriter()
+    {
+        close();
+    }
+
+    //! Starts writing size items from data, after the previous write is done.
+    //! The data must remain unchanged until the next write_async() or close().
+    void write_async(const ValueType* data, size_t size)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return !pending_; });
+        data_ = data;
+        size_ = size;
+        pending_ = true;
+        cv_.notify_all();
+    }
+
+    //! Waits for the current write.
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return !pending_; });
+    }
+
+    //! Waits for the current write and closes the file, returns false if it
+    //! was not opened or not written completely.
+    bool close()
+    {
+        if (thread_.joinable())
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this]() { return !pending_; });
+                closing_ = true;
+            }
+            cv_.notify_all();
+            thread_.join();
+        }
+        return writer_.close() && opened_;
+    }
+
+    //! Returns true if the file is open and no error occurred. Only valid
+    //! while no write is running.
+    bool good() const noexcept
+    {
+        return writer_.good();
+    }
+
+private:
+    //! the file
+    FileBlockWriter writer_;
+
+    //! whether the file was opened
+    bool opened_;
+
+    //! handoff of the next write to the thread, signalled in both directions
+    //! by cv_
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    const ValueType* data_ = nullptr;
+    size_t size_ = 0;
+    bool pending_ = false;
+    bool closing_ = false;
+
+    //! thread running the writes, started last
+    std::thread thread_;
+
+    //! Runs the writes handed over by write_async() until close().
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            cv_.wait(lock, [this]() { return pending_ || closing_; });
+            if (!pending_)
+                return;
+
+            // data_ and size_ are not changed while pending_ is set
+            lock.unlock();
+            writer_.write(data_, size_ * sizeof(ValueType));
+            lock.lock();
+
+            pending_ = false;
+            cv_.notify_all();
+        }
+    }
+};
+
+/*!
+ * Sink for multiway_merge_stream() writing to a file with double buffering:
+ * one block is written in the background while the merge fills the other.
+ */
+template <typename ValueType>
+class AsyncFileSink
+{
+public:
+    using value_type = ValueType;
+
+    //! Creates or truncates the file, see good().
+    AsyncFileSink(const std::string& path, size_t block_size)
+        : writer_(path), block_size_(block_size)
+    {
+        blocks_[0].resize(block_size);
+        blocks_[1].resize(block_size);
+    }
+
+    //! Copies the block and writes it in the background.
+    void write(const ValueType* data, size_t size)
+    {
+        assert(size <= block_size_);
+        // the write of this buffer finished before the other one started
+        std::vector<ValueType>& block = blocks_[current_];
+        std::copy(data, data + size, block.begin());
+        writer_.write_async(block.data(), size);
+        current_ ^= 1;
+    }
+
+    //! Closes the file, returns false if it was not written completely.
+    bool close()
+    {
+        return writer_.close();
+    }
+
+private:
+    //! the file
+    AsyncFileWriter<ValueType> writer_;
+
+    //! size of a block in items
+    size_t block_size_;
+
+    //! the two blocks, and the one to fill next
+    std::vector<ValueType> blocks_[2];
+    size_t current_ = 0;
+};
+
+} // namespace external_sort_detail
+
+/*!
+ * Sorts more items than fit into main memory, using temporary files.
+ *
+ * Items are pushed into a run buffer. When it is full, it is sorted with
+ * parallel_mergesort() and written to a temporary file by a background
+ * thread, while the next run is filled. Since parallel_mergesort() sorts a
+ * copy of its input, the run being written, the one being sorted, and its copy
+ * take the memory limit, and runs hold memory_limit / 3 bytes.
+ *
+ * finish() merges the runs with multiway_merge_stream() into a sink. Each run
+ * is read in blocks of block_bytes, and three more blocks are needed for the
+ * merge output and the double-buffered writing of intermediate runs. If there
+ * are more runs than fit into the memory limit, groups of them are merged into
+ * longer runs first, in as many passes as needed. If all items fit into the
+ * run buffer, nothing is written to disk.
+ *
+ * Errors of the temporary files are reported by good(). The sort is not
+ * stable.
+ *
+ * \tparam ValueType  Trivially copyable item type, written to the temporary
+ *                    files in its binary representation.
+ * \tparam Comparator Function object comparing two items.
+ */
+template <typename ValueType, typename Comparator = std::less<ValueType> >
+class ExternalSorter
+{
+    static_assert(std::is_trivially_copyable<ValueType>::value,
+                  "ExternalSorter requires a trivially copyable type");
+
+public:
+    using value_type = ValueType;
+    using compare_type = Comparator;
+
+    /*!
+     * Creates an empty sorter.
+     *
+     * \param memory_limit Bytes used for buffers, at least about five blocks.
+     * \param temp_dir Directory for temporary files.
+     * \param cmp Comparator.
+     * \param block_bytes Size of I/O blocks in bytes.
+     * \param num_threads Number of threads for parallel_mergesort().
+     */
+    ExternalSorter(size_t memory_limit, const std::string& temp_dir,
+                   compare_type cmp = compare_type(),
+                   size_t block_bytes = 1024 * 1024,
+                   size_t num_threads = std::thread::hardware_concurrency())
+        : cmp_(cmp), temp_dir_(temp_dir),
+          num_threads_(std::max<size_t>(num_threads, 1))
+    {
+        // fit at least two run blocks and three merge output blocks
+        block_bytes = std::min(block_bytes, memory_limit / 5);
+        block_size_ = std::max<size_t>(block_bytes / sizeof(ValueType), 1);
+        // the run being written, the run being sorted, and the sort's copy
+        run_size_ = std::max<size_t>(memory_limit / 3 / sizeof(ValueType), 1);
+        fan_in_ = std::max<size_t>(
+            memory_limit / (block_size_ * sizeof(ValueType)), 5) - 3;
+
+        // distinguish the temporary files of concurrent sorters
+        std::random_device rd;
+        token_ = std::to_string(rd()) + "_" + std::to_string(rd());
+    }
+
+    //! Non-copyable.
+    ExternalSorter(const ExternalSorter&) = delete;
+    ExternalSorter& operator=(const ExternalSorter&) = delete;
+
+    //! Removes all temporary files.
+    ~ExternalSorter()
+    {
+        clear();
+    }
+
+    //! Returns the number of items pushed.
+    std::uint64_t size() const noexcept
+    {
+        return size_;
+    }
+
+    //! Returns true if no error occurred on the temporary files.
+    bool good() const noexcept
+    {
+        return !error_;
+    }
+
+    //! Returns the maximum number of runs merged at once.
+    size_t fan_in() const noexcept
+    {
+        return fan_in_;
+    }
+
+    //! Returns the number of runs written so far.
+    size_t num_runs() const noexcept
+    {
+        return num_runs_;
+    }
+
+    //! Returns the number of merge passes before the final one.
+    size_t num_passes() const noexcept
+    {
+        return num_passes_;
+    }
+
+    //! Returns the number of bytes written to temporary files.
+    std::uint64_t bytes_written() const noexcept
+    {
+        return bytes_written_;
+    }
+
+    //! Returns the number of bytes read from temporary files.
+    std::uint64_t bytes_read() const noexcept
+    {
+        return bytes_read_;
+    }
+
+    //! Adds an item.
+    void push(const ValueType& item)
+    {
+        if (buffer_.size() >= run_size_)
+            write_run();
+        if (buffer_.capacity() < run_size_)
+            buffer_.reserve(run_size_);
+        buffer_.push_back(item);
+        ++size_;
+    }
+
+    /*!
+     * Writes all items in sorted order to the sink, which has a method
+     * <tt>void write(const value_type* data, size_t size)</tt>, in blocks.
+     * Returns the number of items written. The sorter is empty afterwards.
+     */
+    template <typename Sink>
+    std::uint64_t finish(Sink& sink)
+    {
+        std::uint64_t total = 0;
+
+        if (runs_.empty())
+        {
+            // all items are in memory
+            parallel_mergesort(buffer_.begin(), buffer_.end(), cmp_,
+                               num_threads_);
+            for (size_t i = 0; i < buffer_.size(); i += block_size_)
+            {
+                size_t n = std::min(block_size_, buffer_.size() - i);
+                sink.write(buffer_.data() + i, n);
+            }
+            total = buffer_.size();
+        }
+        else
+        {
+            if (!buffer_.empty())
+                write_run();
+            finish_run();
+
+            // release the run buffers for the merge
+            std::vector<ValueType>().swap(buffer_);
+            std::vector<ValueType>().swap(writing_);
+
+            while (runs_.size() > fan_in_)
+                merge_pass();
+
+            total = merge_runs(0, runs_.size(), sink);
+            remove_runs(0, runs_.size());
+            runs_.clear();
+        }
+
+        clear();
+        return total;
+    }
+
+    //! Removes all items and temporary files.
+    void clear()
+    {
+        if (run_writer_)
+        {
+            run_writer_->close();
+            run_writer_.reset();
+        }
+        remove_runs(0, runs_.size());
+        runs_.clear();
+        std::vector<ValueType>().swap(buffer_);
+        std::vector<ValueType>().swap(writing_);
+        size_ = 0;
+    }
+
+private:
+    //! A sorted run in a temporary file.
+    struct Run
+    {
+        std::string path;
+        std::uint64_t size;
+    };
+
+    //! Comparator.
+    compare_type cmp_;
+
+    //! Directory of the temporary files, and their common name part.
+    std::string temp_dir_, token_;
+
+    //! Number of threads for sorting runs.
+    size_t num_threads_;
+
+    //! Items per I/O block.
+    size_t block_size_;
+
+    //! Items per run.
+    size_t run_size_;
+
+    //! Maximum number of runs merged at once.
+    size_t fan_in_;
+
+    //! The run being filled, and the one being written.
+    std::vector<ValueType> buffer_, writing_;
+
+    //! Writes the previous run in the background.
+    std::unique_ptr<external_sort_detail::AsyncFileWriter<ValueType> >
+        run_writer_;
+
+    //! The runs in temporary files.
+    std::vector<Run> runs_;
+
+    //! Counter for temporary file names.
+    size_t file_counter_ = 0;
+
+    //! Statistics.
+    std::uint64_t size_ = 0;
+    size_t num_runs_ = 0, num_passes_ = 0;
+    std::uint64_t bytes_written_ = 0, bytes_read_ = 0;
+
+    //! Set on errors of the temporary files.
+    bool error_ = false;
+
+    //! Returns a new temporary file name.
+    std::string temp_path()
+    {
+        return temp_dir_ + "/tlx_external_sort_" + token_ + "_" +
+               std::to_string(file_counter_++);
+    }
+
+    //! Waits for the run being written.
+    void finish_run()
+    {
+        if (!run_writer_)
+            return;
+        if (!run_writer_->close())
+            error_ = true;
+        run_writer_.reset();
+    }
+
+    //! Sorts the run buffer, and writes it in the background while the other
+    //! buffer is filled.
+    void write_run()
+    {
+        parallel_mergesort(buffer_.begin(), buffer_.end(), cmp_,
+                           num_threads_);
+
+        finish_run();
+        std::swap(buffer_, writing_);
+        buffer_.clear();
+
+        Run run{ temp_path(), writing_.size() };
+        run_writer_.reset(
+            new external_sort_detail::AsyncFileWriter<ValueType>(run.path));
+        run_writer_->write_async(writing_.data(), writing_.size());
+
+        bytes_written_ += run.size * sizeof(ValueType);
+        runs_.push_back(std::move(run));
+        ++num_runs_;
+    }
+
+    //! Merges the runs [begin, end) into the sink, returns the number of
+    //! items. A read error or a run shorter than written, e.g. a truncated
+    //! file, is an error.
+    template <typename Sink>
+    std::uint64_t merge_runs(size_t begin, size_t end, Sink& sink)
+    {
+        std::vector<FileBlockSource<ValueType> > sources;
+        sources.reserve(end - begin);
+        std::uint64_t expected = 0;
+        for (size_t i = begin; i < end; ++i)
+        {
+            sources.emplace_back(runs_[i].path, block_size_);
+            expected += runs_[i].size;
+        }
+
+        std::uint64_t total = multiway_merge_stream(
+            sources.begin(), sources.end(), sink, block_size_, cmp_);
+        bytes_read_ += total * sizeof(ValueType);
+
+        for (const FileBlockSource<ValueType>& source : sources)
+        {
+            if (!source.good())
+                error_ = true;
+        }
+        if (total != expected)
+            error_ = true;
+        return total;
+    }
+
+    //! Removes the files of runs [begin, end).
+    void remove_runs(size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+            std::remove(runs_[i].path.c_str());
+    }
+
+    //! Merges consecutive groups of fan_in runs into longer runs.
+    void merge_pass()
+    {
+        std::vector<Run> next;
+        for (size_t i = 0; i < runs_.size(); i += fan_in_)
+        {
+            size_t end = std::min(i + fan_in_, runs_.size());
+            if (end - i == 1)
+            {
+                next.push_back(std::move(runs_[i]));
+                continue;
+            }
+
+            Run run{ temp_path(), 0 };
+            external_sort_detail::AsyncFileSink<ValueType> sink(run.path,
+                                                                block_size_);
+            run.size = merge_runs(i, end, sink);
+            if (!sink.close())
+                error_ = true;
+            remove_runs(i, end);
+
+            bytes_written_ += run.size * sizeof(ValueType);
+            next.push_back(std::move(run));
+        }
+        runs_ = std::move(next);
+        ++num_passes_;
+    }
+};
+
+//! \}
+
+} // namespace tlx
+
+#endif // !TLX_SORT_EXTERNAL_SORT_HEADER
+
+/******************************************************************************/